@@ -0,0 +1,17 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Totals of every global operator new since program start, aligned forms included. The benchmark replaces the global
+// allocation functions to keep them; malloc based allocations (e.g. Array2D storage) are not seen and have to be
+// reported explicitly.
+struct AllocationTotals {
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+};
+
+// Gets the allocation totals so far, summed over all threads.
+AllocationTotals GetAllocationTotals();
+
+#endif // ALLOCATION_COUNTER_H
@@ -0,0 +1,142 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "allocation_counter.h"
+
+// Command line options shared by all benchmark suites.
+struct BenchmarkOptions {
+    std::vector<int> sizes = { 257, 513, 1025, 2049, 4097 }; // Terrain sizes in posts per side.
+    std::vector<int> iterations = { 100, 500, 2000 }; // Fault iterations.
+    std::vector<int> threads; // Thread counts for scalability suites, empty for the suite defaults.
+    std::vector<int> counts; // Entity counts for simulation suites, empty for the suite defaults.
+    int repeats = 10; // Timed runs per measurement.
+    int warmup = 1; // Untimed runs before the timed ones.
+    unsigned int seed = 1; // Seed of all generated inputs, so runs are comparable across commits.
+};
+
+// Timings of one measured stage under one set of parameters.
+struct BenchmarkResult {
+    std::string suite;
+    std::string stage;
+    std::vector<std::pair<std::string, double>> parameters; // e.g. ("size", 1025), ("iterations", 500).
+    std::vector<double> milliseconds; // One sample per timed run.
+    uint64_t bytesAllocated = 0; // Mean bytes allocated per run.
+    uint64_t allocations = 0; // Mean number of allocations per run.
+    std::vector<std::pair<std::string, double>> metrics; // Additional per stage numbers, e.g. error or throughput.
+
+    // Gets the mean of the samples.
+    double Mean() const;
+
+    // Gets the sample standard deviation.
+    double StdDev() const;
+
+    // Gets a percentile of the samples, linearly interpolated between ranks.
+    // @param p: Percentile in [0, 100].
+    double Percentile(double p) const;
+};
+
+// BenchmarkContext runs measurements and collects their results for reporting.
+class BenchmarkContext
+{
+public:
+    // Constructor.
+    // @param options: Repeats and warmup runs used by Measure.
+    explicit BenchmarkContext(const BenchmarkOptions& options) : m_options(options) {}
+
+    // Times a stage. setup runs untimed before every run (including warmup runs) and prepares the input, so stages
+    // that modify their input in place can be measured in isolation.
+    // @param suite: Name of the suite, e.g. "terrain".
+    // @param stage: Name of the measured stage, e.g. "fir_filter".
+    // @param parameters: Parameters the stage ran with.
+    // @param setup: Callable preparing the input of one run.
+    // @param run: Callable performing the measured work.
+    // @return: The recorded result, so suites can attach metrics.
+    template <typename Setup, typename Run>
+    BenchmarkResult& Measure(const std::string& suite, const std::string& stage,
+        const std::vector<std::pair<std::string, double>>& parameters, Setup&& setup, Run&& run);
+
+    // Records bytes allocated outside of operator new (e.g. with malloc) by the run currently being measured.
+    // @param bytes: Number of bytes allocated.
+    void CountAllocation(uint64_t bytes) { m_extraBytes += bytes; m_extraAllocations++; }
+
+    // Gets the recorded results in measurement order.
+    const std::vector<BenchmarkResult>& GetResults() const { return m_results; }
+
+    // Gets the options the benchmark runs with.
+    const BenchmarkOptions& GetOptions() const { return m_options; }
+
+    // Prints a summary table to stdout.
+    void PrintTable() const;
+
+    // Writes all results as JSON.
+    // @param pFilename: Output path.
+    // @param label: Free text identifying the run, e.g. a commit hash.
+    // @return: False if the file could not be written.
+    bool WriteJson(const char* pFilename, const std::string& label) const;
+
+    // Writes all results as CSV, one row per result.
+    // @param pFilename: Output path.
+    // @param label: Free text identifying the run, e.g. a commit hash.
+    // @return: False if the file could not be written.
+    bool WriteCsv(const char* pFilename, const std::string& label) const;
+
+private:
+    BenchmarkOptions m_options;
+    std::vector<BenchmarkResult> m_results;
+    uint64_t m_extraBytes = 0;
+    uint64_t m_extraAllocations = 0;
+};
+
+template <typename Setup, typename Run>
+BenchmarkResult& BenchmarkContext::Measure(const std::string& suite, const std::string& stage,
+    const std::vector<std::pair<std::string, double>>& parameters, Setup&& setup, Run&& run)
+{
+    for (int i = 0; i < m_options.warmup; i++)
+    {
+        setup();
+        run();
+    }
+
+    BenchmarkResult result;
+    result.suite = suite;
+    result.stage = stage;
+    result.parameters = parameters;
+
+    uint64_t totalBytes = 0;
+    uint64_t totalAllocations = 0;
+    for (int i = 0; i < m_options.repeats; i++)
+    {
+        setup();
+
+        m_extraBytes = 0;
+        m_extraAllocations = 0;
+        AllocationTotals before = GetAllocationTotals();
+        auto start = std::chrono::steady_clock::now();
+
+        run();
+
+        auto end = std::chrono::steady_clock::now();
+        AllocationTotals after = GetAllocationTotals();
+
+        result.milliseconds.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        totalBytes += after.bytes - before.bytes + m_extraBytes;
+        totalAllocations += after.count - before.count + m_extraAllocations;
+    }
+
+    if (m_options.repeats > 0)
+    {
+        result.bytesAllocated = totalBytes / m_options.repeats;
+        result.allocations = totalAllocations / m_options.repeats;
+    }
+
+    m_results.push_back(std::move(result));
+    return m_results.back();
+}
+
+#endif // BENCHMARK_H
@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_SUITES_H
+#define BENCHMARK_SUITES_H
+
+#include "benchmark.h"
+
+// Fault formation stages (faults, FIR filter, normalize) and the TerrainGrid vertex and index build, over the
+// matrix of terrain sizes and fault iterations.
+void RunTerrainBenchmarks(BenchmarkContext& context);
+
+// Airfoil coefficient lookups: binary search of the source polar against the resampled table, single and batched.
+void RunAirfoilBenchmarks(BenchmarkContext& context);
+
+// Batched lift, drag and moment of wing surfaces with each compiled instruction set against the scalar reference.
+void RunAeroBenchmarks(BenchmarkContext& context);
+
+// Standard atmosphere: the analytic layer model against the interpolated table, with the table's largest errors.
+void RunAtmosphereBenchmarks(BenchmarkContext& context);
+
+// Mass property updates: inertia::tensor and an inverse after every change against the incremental MassDistribution,
+// with its error against the full recompute after a long run of changes.
+void RunMassBenchmarks(BenchmarkContext& context);
+
+// Job system scalability over the thread counts: empty jobs, a parallel for, nested parent and child jobs and the
+// aero batch, each with its speedup over the first thread count.
+void RunJobBenchmarks(BenchmarkContext& context);
+
+// AI traffic: one step of the whole fleet and its render transforms, with the share of a 60 Hz frame, against the
+// same fleet as individual physics::Airplane objects, and the fleet stepped at distance and visibility rates by a
+// SimulationScheduler.
+void RunTrafficBenchmarks(BenchmarkContext& context);
+
+// Integrators: cost per airplane step against the trajectory error of a 20 s flight and the energy and angular
+// momentum drift of a tumbling spring oscillator, at physics rates from 30 to 480 Hz.
+void RunIntegratorBenchmarks(BenchmarkContext& context);
+
+// Flight recorder: the cost of Record and of a keyframe on the simulation thread with the share of a 60 Hz frame, the
+// encoding and writing of a whole recording with its size per sample, reading it back, and seeking into recordings of
+// different lengths.
+void RunRecorderBenchmarks(BenchmarkContext& context);
+
+// World snapshots: capturing and restoring the whole simulation at 1000 and 5000 traffic aircraft with the share of a
+// 60 Hz frame, whether branches flown from one snapshot repeat bit for bit, and writing and reading snapshot files.
+void RunSnapshotBenchmarks(BenchmarkContext& context);
+
+// Collision: building the broadphase hash and finding every close pair from 1000 to 10000 entities with the cost per
+// entity, against testing all pairs, proximity queries, and terrain contacts through the height bounds with the share
+// of entities that still sample the ground.
+void RunCollisionBenchmarks(BenchmarkContext& context);
+
+// Ground proximity: the batched terrain query against sampling one height at a time, and terrain alerts for 1000 to
+// 10000 aircraft with the cost per aircraft, the share of paths that still sample the ground and the agreement with
+// sampling every path point one by one.
+void RunGroundProximityBenchmarks(BenchmarkContext& context);
+
+// Wind: building the mean wind grid and turbulence over a 513 post terrain, the delay of a background rebuild after a
+// wind shift with the cost of the Update calls meanwhile, and sampling 100000 points one by one and as a batch.
+void RunWindBenchmarks(BenchmarkContext& context);
+
+// Lift: building the ridge and thermal lift map of a 513 post terrain, the share of tiles a small and a large wind
+// shift refresh, and sampling the map against deriving ridge lift from the ground on every query.
+void RunLiftBenchmarks(BenchmarkContext& context);
+
+// Autopilot: the batched gain-scheduled autopilot against the scalar loop per aircraft, and the autopilot pass of a
+// traffic step timed on its own against the whole step, at the full rate and with far aircraft at the reduced rate.
+void RunAutopilotBenchmarks(BenchmarkContext& context);
+
+#endif // BENCHMARK_SUITES_H
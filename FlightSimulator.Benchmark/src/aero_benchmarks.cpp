@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "aero_batch.h"
+#include "airplane.h"
+#include "benchmark_suites.h"
+#include "data.h"
+#include "parallel.h"
+
+// Surfaces per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 4096, 65536, 1 << 20 };
+
+// Fills a batch with the surfaces of many airplanes in flight at random speeds, attitudes and control inputs.
+static void FillSurfaces(physics::AeroSurfaces& surfaces, const std::vector<physics::Wing>& wings,
+    const std::vector<int>& airfoilIds, int count, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> speed(20.0f, 120.0f);
+    std::uniform_real_distribution<float> angle(-0.4f, 0.4f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> altitude(0.0f, 8000.0f);
+
+    surfaces.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        size_t wing = i % wings.size();
+        surfaces.set_surface(i, wings[wing], airfoilIds[wing]);
+
+        float pitch = angle(rng), yaw = angle(rng) * 0.5f, v = speed(rng);
+        surfaces.velocity_x[i] = v * std::sin(yaw);
+        surfaces.velocity_y[i] = -v * std::sin(pitch);
+        surfaces.velocity_z[i] = -v * std::cos(pitch) * std::cos(yaw);
+        surfaces.control[i] = unit(rng);
+        surfaces.density[i] = isa::get_air_density(altitude(rng));
+    }
+}
+
+void RunAeroBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    physics::Airfoil wingAirfoil(NACA_2412_data);
+    physics::Airfoil tailAirfoil(NACA_0012_data);
+    physics::Airplane airplane(&wingAirfoil, &tailAirfoil);
+
+    physics::AirfoilLibrary library;
+    int wingId = library.add(wingAirfoil);
+    int tailId = library.add(tailAirfoil);
+    std::vector<int> airfoilIds;
+    for (const physics::Wing& wing : airplane.wings)
+        airfoilIds.push_back(wing.airfoil == &wingAirfoil ? wingId : tailId);
+
+    const physics::AeroIsa isas[] = { physics::AeroIsa::Reference, physics::AeroIsa::Sse2, physics::AeroIsa::Avx2,
+        physics::AeroIsa::Avx512 };
+
+    for (int count : counts)
+    {
+        physics::AeroSurfaces surfaces;
+        FillSurfaces(surfaces, airplane.wings, airfoilIds, count, options.seed);
+        size_t end = surfaces.padded_count();
+
+        // Reference forces to compare the vector kernels against.
+        physics::evaluate_aero(library, surfaces, 0, end, physics::AeroIsa::Reference);
+        std::vector<float> referenceX = surfaces.force_x, referenceY = surfaces.force_y, referenceZ = surfaces.force_z;
+
+        for (physics::AeroIsa isa : isas)
+        {
+            if (!physics::is_aero_isa_available(isa))
+                continue;
+
+            BenchmarkResult& result = context.Measure("aero", physics::get_aero_isa_name(isa), { { "count", count } },
+                []() {},
+                [&]() { physics::evaluate_aero(library, surfaces, 0, end, isa); });
+
+            // Largest force difference relative to the force magnitude, the vector kernels approximate asin.
+            float maxError = 0.0f;
+            for (int i = 0; i < count; i++)
+            {
+                float dx = surfaces.force_x[i] - referenceX[i];
+                float dy = surfaces.force_y[i] - referenceY[i];
+                float dz = surfaces.force_z[i] - referenceZ[i];
+                float magnitude = std::sqrt(referenceX[i] * referenceX[i] + referenceY[i] * referenceY[i] +
+                    referenceZ[i] * referenceZ[i]);
+                maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz) / std::max(magnitude, 1.0f));
+            }
+
+            result.metrics.push_back({ "surfaces_per_ms", count / std::max(result.Mean(), 1e-9) });
+            result.metrics.push_back({ "max_relative_error", maxError });
+        }
+
+        // Widest kernel on chunks of whole vectors across all hardware threads, the way traffic evaluates its batch.
+        const int vectors = (int)(end / physics::AeroSurfaces::LANES);
+        BenchmarkResult& parallel = context.Measure("aero", "best_parallel", { { "count", count } },
+            []() {},
+            [&]() {
+                ParallelForRange(0, vectors, [&](int chunkBegin, int chunkEnd) {
+                    physics::evaluate_aero(library, surfaces, chunkBegin * physics::AeroSurfaces::LANES,
+                        chunkEnd * physics::AeroSurfaces::LANES);
+                });
+            });
+        parallel.metrics.push_back({ "surfaces_per_ms", count / std::max(parallel.Mean(), 1e-9) });
+        parallel.metrics.push_back({ "threads", (double)GetJobSystem().GetThreadCount() });
+    }
+}
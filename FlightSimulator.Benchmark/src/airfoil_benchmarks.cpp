@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "airfoil.h"
+#include "benchmark_suites.h"
+#include "data.h"
+
+// Queries per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1 << 16, 1 << 20 };
+
+// Lookup the table replaces: a binary search of the source polar per query.
+static glm::vec2 SearchPolar(const std::vector<glm::vec3>& data, float alpha)
+{
+    alpha = glm::clamp(alpha, data.front().x, data.back().x);
+    auto upper = std::lower_bound(data.begin(), data.end(), alpha,
+        [](const glm::vec3& sample, float a) { return sample.x < a; });
+    if (upper == data.begin())
+        return { upper->y, upper->z };
+
+    auto lower = upper - 1;
+    float t = (alpha - lower->x) / (upper->x - lower->x);
+    return { lower->y + (upper->y - lower->y) * t, lower->z + (upper->z - lower->z) * t };
+}
+
+void RunAirfoilBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    // A second polar with less lift stands in for a low Reynolds number measurement.
+    std::vector<glm::vec3> lowReynoldsData = NACA_2412_data;
+    for (glm::vec3& sample : lowReynoldsData)
+    {
+        sample.y *= 0.85f;
+        sample.z *= 1.3f;
+    }
+
+    physics::Airfoil airfoil(NACA_2412_data);
+    physics::Airfoil multiPolar({ { 2.0e5f, &lowReynoldsData }, { 1.0e6f, &NACA_2412_data } });
+
+    context.Measure("airfoil", "build_table", { { "polars", 2 } },
+        []() {},
+        [&]() { physics::Airfoil table({ { 2.0e5f, &lowReynoldsData }, { 1.0e6f, &NACA_2412_data } }); });
+
+    for (int count : counts)
+    {
+        // Angles of attack of a wing in normal flight, so the search reference is not helped by clamping.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> alphaDistribution(-15.0f, 18.0f);
+        std::uniform_real_distribution<float> reynoldsDistribution(1.0e5f, 2.0e6f);
+        std::vector<float> alpha(count), reynolds(count), cl(count), cd(count);
+        for (int i = 0; i < count; i++)
+        {
+            alpha[i] = alphaDistribution(rng);
+            reynolds[i] = reynoldsDistribution(rng);
+        }
+
+        auto addThroughput = [&](BenchmarkResult& result) {
+            result.metrics.push_back({ "queries_per_ms", count / std::max(result.Mean(), 1e-9) });
+        };
+
+        addThroughput(context.Measure("airfoil", "binary_search", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < count; i++)
+                {
+                    glm::vec2 coefficients = SearchPolar(NACA_2412_data, alpha[i]);
+                    cl[i] = coefficients.x;
+                    cd[i] = coefficients.y;
+                }
+            }));
+
+        addThroughput(context.Measure("airfoil", "table_scalar", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < count; i++)
+                {
+                    glm::vec2 coefficients = airfoil.sample(alpha[i]);
+                    cl[i] = coefficients.x;
+                    cd[i] = coefficients.y;
+                }
+            }));
+
+        BenchmarkResult& batch = context.Measure("airfoil", "table_batch", { { "count", count } },
+            []() {},
+            [&]() { airfoil.sample(alpha.data(), cl.data(), cd.data(), count); });
+        addThroughput(batch);
+
+        // Largest difference to the source polar; the table uses its sample spacing, so this is rounding only.
+        float maxError = 0.0f;
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec2 reference = SearchPolar(NACA_2412_data, alpha[i]);
+            maxError = std::max({ maxError, std::fabs(reference.x - cl[i]), std::fabs(reference.y - cd[i]) });
+        }
+        batch.metrics.push_back({ "max_error", maxError });
+
+        addThroughput(context.Measure("airfoil", "table_reynolds_batch", { { "count", count } },
+            []() {},
+            [&]() { multiPolar.sample(alpha.data(), reynolds.data(), cl.data(), cd.data(), count); }));
+    }
+}
@@ -0,0 +1,102 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "allocation_counter.h"
+
+static std::atomic<uint64_t> allocatedBytes{ 0 };
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+AllocationTotals GetAllocationTotals()
+{
+    AllocationTotals totals;
+    totals.bytes = allocatedBytes.load(std::memory_order_relaxed);
+    totals.count = allocationCount.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void* operator new(std::size_t size)
+{
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// Over-aligned types, e.g. alignas(64) batches, come through the aligned forms, which need their own matching deletes.
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    const std::size_t align = (std::size_t)alignment;
+    const std::size_t rounded = (size + align - 1) & ~(align - 1);
+#ifdef _WIN32
+    void* p = _aligned_malloc(rounded ? rounded : align, align);
+#else
+    void* p = aligned_alloc(align, rounded ? rounded : align);
+#endif
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(p, alignment);
+}
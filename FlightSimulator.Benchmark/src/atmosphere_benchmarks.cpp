@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "atmosphere.h"
+#include "benchmark_suites.h"
+
+// Queries per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1 << 16, 1 << 20 };
+
+void RunAtmosphereBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    context.Measure("atmosphere", "build_table", { { "layers", 7 } },
+        []() {},
+        []() { isa::AtmosphereTable table; });
+
+    const isa::AtmosphereTable& table = isa::get_atmosphere_table();
+
+    for (int count : counts)
+    {
+        // Altitudes over the whole model, including the clamped range below sea level.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> altitudeDistribution(-1000.0f, isa::ATMOSPHERE_TOP);
+        std::vector<float> altitude(count), density(count);
+        std::vector<isa::AtmosphereSample> samples(count), reference(count);
+        for (int i = 0; i < count; i++)
+            altitude[i] = altitudeDistribution(rng);
+
+        auto addThroughput = [&](BenchmarkResult& result) {
+            result.metrics.push_back({ "queries_per_ms", count / std::max(result.Mean(), 1e-9) });
+        };
+
+        addThroughput(context.Measure("atmosphere", "analytic", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < count; i++)
+                    reference[i] = isa::get_standard_atmosphere(altitude[i]);
+            }));
+
+        addThroughput(context.Measure("atmosphere", "table_density", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < count; i++)
+                    density[i] = table.get_density(altitude[i]);
+            }));
+
+        addThroughput(context.Measure("atmosphere", "table_density_batch", { { "count", count } },
+            []() {},
+            [&]() { table.get_density(altitude.data(), density.data(), count); }));
+
+        BenchmarkResult& batch = context.Measure("atmosphere", "table_sample_batch", { { "count", count } },
+            []() {},
+            [&]() { table.sample(altitude.data(), samples.data(), count); });
+        addThroughput(batch);
+
+        // Largest relative difference of each quantity to the analytic model.
+        double densityError = 0.0, pressureError = 0.0, temperatureError = 0.0, speedOfSoundError = 0.0;
+        for (int i = 0; i < count; i++)
+        {
+            densityError = std::max(densityError, std::fabs((double)samples[i].density / reference[i].density - 1.0));
+            pressureError = std::max(pressureError, std::fabs((double)samples[i].pressure / reference[i].pressure - 1.0));
+            temperatureError = std::max(temperatureError,
+                std::fabs((double)samples[i].temperature / reference[i].temperature - 1.0));
+            speedOfSoundError = std::max(speedOfSoundError,
+                std::fabs((double)samples[i].speed_of_sound / reference[i].speed_of_sound - 1.0));
+        }
+        batch.metrics.push_back({ "max_density_error", densityError });
+        batch.metrics.push_back({ "max_pressure_error", pressureError });
+        batch.metrics.push_back({ "max_temperature_error", temperatureError });
+        batch.metrics.push_back({ "max_speed_of_sound_error", speedOfSoundError });
+    }
+}
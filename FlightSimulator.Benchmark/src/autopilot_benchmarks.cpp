@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "airplane.h"
+#include "autopilot.h"
+#include "benchmark_suites.h"
+#include "data.h"
+#include "traffic.h"
+
+// Aircraft per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1000, 5000, 20000 };
+
+// Traffic step, the rate AI aircraft are simulated at.
+static const float trafficStep = 1.0f / 60.0f;
+
+// Distance between neighbours on the grid of the fleet, wide enough that most of a large fleet is far from the view.
+static const float gridSpacing = 500.0f;
+
+// Wraps an angle into [-pi, pi].
+static float WrapAngle(float angle)
+{
+    return angle - 2.0f * physics::PI * std::floor((angle + physics::PI) / (2.0f * physics::PI));
+}
+
+// The autopilot of one entry with the library functions, one aircraft at a time, the loop the batch replaces.
+static void RunReference(const AutopilotSettings& g, float referencePressure, AutopilotBatch& b, int e)
+{
+    glm::quat orientation(b.orientationW[e], b.orientationX[e], b.orientationY[e], b.orientationZ[e]);
+    glm::vec3 forward = orientation * physics::FORWARD;
+    glm::vec3 up = orientation * physics::UP;
+    glm::vec3 right = orientation * physics::RIGHT;
+    glm::vec3 bodyRates = glm::conjugate(orientation) *
+        glm::vec3(b.angularVelocityX[e], b.angularVelocityY[e], b.angularVelocityZ[e]);
+    glm::vec3 velocity(b.velocityX[e], b.velocityY[e], b.velocityZ[e]);
+
+    float pitch = std::asin(glm::clamp(forward.y, -1.0f, 1.0f));
+    float bank = std::atan2(-right.y, up.y);
+    float heading = std::atan2(forward.x, -forward.z);
+    float speed = glm::length(velocity);
+    float scale = glm::clamp(referencePressure / std::max(0.5f * b.density[e] * speed * speed, 1.0e-3f),
+        g.minGainScale, g.maxGainScale);
+
+    float climbRate = glm::clamp((b.targetAltitude[e] - b.positionY[e]) * g.climbRatePerMetre, -g.maxClimbRate,
+        g.maxClimbRate);
+    float targetPitch = glm::clamp((climbRate - velocity.y) * g.pitchPerClimbRate, -g.maxPitch, g.maxPitch);
+    b.pitchIntegral[e] = glm::clamp(b.pitchIntegral[e] + (climbRate - velocity.y) * g.elevatorPerClimbRateIntegral *
+        scale * b.stepSize[e], -1.0f, 1.0f);
+    b.elevator[e] = glm::clamp(((targetPitch - pitch) * g.elevatorPerPitch - bodyRates.x * g.elevatorPerPitchRate) *
+        scale + b.pitchIntegral[e], -1.0f, 1.0f);
+
+    float targetBank = glm::clamp(WrapAngle(b.targetHeading[e] - heading) * g.bankPerHeading, -g.maxBank, g.maxBank);
+    b.aileron[e] = glm::clamp(((targetBank - bank) * g.aileronPerBank + bodyRates.z * g.aileronPerRollRate) * scale,
+        -1.0f, 1.0f);
+    b.rudder[e] = 0.0f;
+    b.throttle[e] = glm::clamp(g.cruiseThrottle + (b.targetSpeed[e] - speed) * g.throttlePerSpeed, 0.0f, 1.0f);
+}
+
+void RunAutopilotBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    physics::Airfoil wingAirfoil(NACA_2412_data);
+    physics::Airfoil tailAirfoil(NACA_0012_data);
+    physics::Airplane prototype(&wingAirfoil, &tailAirfoil);
+    const AutopilotSettings settings;
+    const Autopilot autopilot(settings);
+    const float referencePressure = 0.5f * isa::sea_level_air_density * physics::sq(settings.referenceSpeed);
+
+    for (int count : counts)
+    {
+        // Aircraft in gentle manoeuvres on random headings, altitudes and speeds, turning onto random targets.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> heading(-physics::PI, physics::PI);
+        std::uniform_real_distribution<float> attitude(-0.3f, 0.3f);
+        std::uniform_real_distribution<float> rate(-0.2f, 0.2f);
+        std::uniform_real_distribution<float> altitude(500.0f, 3000.0f);
+        std::uniform_real_distribution<float> speed(45.0f, 70.0f);
+
+        const int batchCount = (count + AutopilotBatch::CAPACITY - 1) / AutopilotBatch::CAPACITY;
+        std::vector<AutopilotBatch> batches(batchCount);
+        for (int i = 0; i < count; i++)
+        {
+            AutopilotBatch& b = batches[i / AutopilotBatch::CAPACITY];
+            const int e = b.count++;
+            glm::quat orientation = glm::angleAxis(-heading(rng), physics::UP) *
+                glm::angleAxis(attitude(rng), physics::RIGHT) * glm::angleAxis(attitude(rng), physics::BACKWARD);
+            glm::vec3 velocity = orientation * physics::FORWARD * speed(rng);
+            b.index[e] = i;
+            b.orientationW[e] = orientation.w;
+            b.orientationX[e] = orientation.x;
+            b.orientationY[e] = orientation.y;
+            b.orientationZ[e] = orientation.z;
+            b.velocityX[e] = velocity.x;
+            b.velocityY[e] = velocity.y;
+            b.velocityZ[e] = velocity.z;
+            b.angularVelocityX[e] = rate(rng);
+            b.angularVelocityY[e] = rate(rng);
+            b.angularVelocityZ[e] = rate(rng);
+            b.positionY[e] = altitude(rng);
+            b.density[e] = isa::get_air_density(b.positionY[e]);
+            b.targetHeading[e] = heading(rng);
+            b.targetAltitude[e] = altitude(rng);
+            b.targetSpeed[e] = speed(rng);
+            b.stepSize[e] = trafficStep;
+            b.pitchIntegral[e] = 0.0f;
+        }
+
+        // The commands of one run of both from the same state, before the runs below move the pitch integrals
+        std::vector<AutopilotBatch> reference = batches;
+        float maxDifference = 0.0f;
+        for (int k = 0; k < batchCount; k++)
+        {
+            autopilot.Run(batches[k]);
+            for (int e = 0; e < reference[k].count; e++)
+            {
+                RunReference(settings, referencePressure, reference[k], e);
+                const Joystick a = batches[k].GetControls(e), b = reference[k].GetControls(e);
+                maxDifference = std::max({ maxDifference, std::fabs(a.leftAileron - b.leftAileron),
+                    std::fabs(a.elevator - b.elevator), std::fabs(a.throttle - b.throttle) });
+            }
+        }
+
+        BenchmarkResult& scalar = context.Measure("autopilot", "scalar", { { "count", count } },
+            []() {},
+            [&]() {
+                for (AutopilotBatch& b : reference)
+                {
+                    for (int e = 0; e < b.count; e++)
+                        RunReference(settings, referencePressure, b, e);
+                }
+            });
+        const double scalarMean = scalar.Mean();
+        scalar.metrics.push_back({ "ns_per_aircraft", scalarMean * 1.0e6 / count });
+
+        BenchmarkResult& batch = context.Measure("autopilot", "batch", { { "count", count } },
+            []() {},
+            [&]() {
+                for (AutopilotBatch& b : batches)
+                    autopilot.Run(b);
+            });
+        batch.metrics.push_back({ "ns_per_aircraft", batch.Mean() * 1.0e6 / count });
+        batch.metrics.push_back({ "speedup", scalarMean / batch.Mean() });
+        batch.metrics.push_back({ "max_command_difference", maxDifference });
+
+        // The autopilot in the traffic step: the step of the whole fleet on autopilot, and the autopilot pass of the
+        // step on its own over the same state, gather, Autopilot::Run and scatter. Then the same seen from the middle of
+        // the grid, so far aircraft run their autopilot at the reduced rate.
+        TrafficSystem traffic(prototype, settings);
+        const int columns = (int)std::ceil(std::sqrt((double)count));
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 position((i % columns) * gridSpacing, altitude(rng), (i / columns) * gridSpacing);
+            traffic.AddAircraft(position, heading(rng), speed(rng));
+            traffic.SetTarget(i, heading(rng), altitude(rng), speed(rng));
+        }
+
+        BenchmarkResult& step = context.Measure("autopilot", "traffic_step", { { "count", count } },
+            []() {},
+            [&]() { traffic.Step(trafficStep); });
+        const double stepMean = step.Mean();
+        step.metrics.push_back({ "ns_per_aircraft", stepMean * 1.0e6 / count });
+
+        BenchmarkResult& pass = context.Measure("autopilot", "traffic_autopilot", { { "count", count } },
+            []() {},
+            [&]() { traffic.RunAutopilotRange(0, count, trafficStep); });
+        pass.metrics.push_back({ "ns_per_aircraft", pass.Mean() * 1.0e6 / count });
+        pass.metrics.push_back({ "step_percent", pass.Mean() / stepMean * 100.0 });
+
+        traffic.SetAutopilotView(glm::vec3(columns * gridSpacing * 0.5f, 1500.0f, columns * gridSpacing * 0.5f));
+        BenchmarkResult& reducedStep = context.Measure("autopilot", "traffic_step_reduced_rate",
+            { { "count", count } },
+            []() {},
+            [&]() { traffic.Step(trafficStep); });
+        const double reducedStepMean = reducedStep.Mean();
+        reducedStep.metrics.push_back({ "ns_per_aircraft", reducedStepMean * 1.0e6 / count });
+
+        // Aircraft whose autopilot ran in the last step start over from no elapsed time
+        const TrafficState& state = traffic.GetState();
+        int ran = 0;
+        for (int i = 0; i < count; i++)
+            ran += state.autopilotElapsed[i] == 0.0f;
+
+        BenchmarkResult& reducedPass = context.Measure("autopilot", "traffic_autopilot_reduced_rate",
+            { { "count", count } },
+            []() {},
+            [&]() { traffic.RunAutopilotRange(0, count, trafficStep); });
+        reducedPass.metrics.push_back({ "ns_per_aircraft", reducedPass.Mean() * 1.0e6 / count });
+        reducedPass.metrics.push_back({ "step_percent", reducedPass.Mean() / reducedStepMean * 100.0 });
+        reducedPass.metrics.push_back({ "autopilots_run_percent", ran * 100.0 / count });
+    }
+}
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "benchmark.h"
+#include "process_memory.h"
+
+#ifdef NDEBUG
+static const char* buildConfiguration = "Release";
+#else
+static const char* buildConfiguration = "Debug";
+#endif
+
+#if defined(_MSC_VER)
+static const std::string compilerName = "msvc " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+static const std::string compilerName = "clang " + std::to_string(__clang_major__) + "." + std::to_string(__clang_minor__);
+#elif defined(__GNUC__)
+static const std::string compilerName = "gcc " + std::to_string(__GNUC__) + "." + std::to_string(__GNUC_MINOR__);
+#else
+static const std::string compilerName = "unknown";
+#endif
+
+double BenchmarkResult::Mean() const
+{
+    if (milliseconds.empty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (double sample : milliseconds)
+        sum += sample;
+    return sum / milliseconds.size();
+}
+
+double BenchmarkResult::StdDev() const
+{
+    if (milliseconds.size() < 2)
+        return 0.0;
+
+    double mean = Mean();
+    double sum = 0.0;
+    for (double sample : milliseconds)
+        sum += (sample - mean) * (sample - mean);
+    return std::sqrt(sum / (milliseconds.size() - 1));
+}
+
+double BenchmarkResult::Percentile(double p) const
+{
+    if (milliseconds.empty())
+        return 0.0;
+
+    std::vector<double> sorted = milliseconds;
+    std::sort(sorted.begin(), sorted.end());
+
+    double rank = std::clamp(p, 0.0, 100.0) / 100.0 * (sorted.size() - 1);
+    size_t lower = (size_t)std::floor(rank);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
+// Formats parameters as "size=1025 iterations=500".
+static std::string FormatParameters(const std::vector<std::pair<std::string, double>>& parameters, char separator)
+{
+    std::string text;
+    char buf[64];
+    for (const auto& parameter : parameters)
+    {
+        if (!text.empty())
+            text += separator;
+        snprintf(buf, sizeof(buf), "%g", parameter.second);
+        text += parameter.first + "=" + buf;
+    }
+    return text;
+}
+
+// Quotes a CSV field, doubling the quotes inside, so commas and line breaks in it do not split the row.
+static std::string CsvString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Escapes the characters JSON strings cannot hold verbatim.
+static std::string JsonString(const std::string& text)
+{
+    std::string escaped = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if ((unsigned char)c >= 0x20)
+            escaped += c;
+    }
+    return escaped + "\"";
+}
+
+void BenchmarkContext::PrintTable() const
+{
+    printf("%-10s %-22s %-30s %10s %10s %10s %10s %12s\n", "suite", "stage", "parameters", "mean ms", "p50 ms", "p90 ms",
+        "p99 ms", "alloc KB");
+    for (const BenchmarkResult& result : m_results)
+    {
+        printf("%-10s %-22s %-30s %10.3f %10.3f %10.3f %10.3f %12.1f\n", result.suite.c_str(), result.stage.c_str(),
+            FormatParameters(result.parameters, ' ').c_str(), result.Mean(), result.Percentile(50.0),
+            result.Percentile(90.0), result.Percentile(99.0), result.bytesAllocated / 1024.0);
+
+        for (const auto& metric : result.metrics)
+            printf("%-10s %-22s   %s = %g\n", "", "", metric.first.c_str(), metric.second);
+    }
+}
+
+bool BenchmarkContext::WriteJson(const char* pFilename, const std::string& label) const
+{
+    FILE* f = nullptr;
+    errno_t err = fopen_s(&f, pFilename, "w");
+    if (err != 0 || !f)
+    {
+        printf("%s:%d - cannot write %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    // Everything needed to decide whether two result files are comparable goes into the header.
+    fprintf(f, "{\n");
+    fprintf(f, "  \"label\": %s,\n", JsonString(label).c_str());
+    fprintf(f, "  \"build\": %s,\n", JsonString(buildConfiguration).c_str());
+    fprintf(f, "  \"compiler\": %s,\n", JsonString(compilerName).c_str());
+    fprintf(f, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(f, "  \"repeats\": %d,\n", m_options.repeats);
+    fprintf(f, "  \"warmup\": %d,\n", m_options.warmup);
+    fprintf(f, "  \"seed\": %u,\n", m_options.seed);
+    fprintf(f, "  \"peak_rss_bytes\": %zu,\n", GetPeakResidentBytes());
+    fprintf(f, "  \"results\": [\n");
+
+    for (size_t i = 0; i < m_results.size(); i++)
+    {
+        const BenchmarkResult& result = m_results[i];
+        fprintf(f, "    {\n");
+        fprintf(f, "      \"suite\": %s,\n", JsonString(result.suite).c_str());
+        fprintf(f, "      \"stage\": %s,\n", JsonString(result.stage).c_str());
+
+        fprintf(f, "      \"parameters\": {");
+        for (size_t j = 0; j < result.parameters.size(); j++)
+            fprintf(f, "%s%s: %.17g", j ? ", " : " ", JsonString(result.parameters[j].first).c_str(), result.parameters[j].second);
+        fprintf(f, " },\n");
+
+        fprintf(f, "      \"mean_ms\": %.6f,\n", result.Mean());
+        fprintf(f, "      \"stddev_ms\": %.6f,\n", result.StdDev());
+        fprintf(f, "      \"min_ms\": %.6f,\n", result.Percentile(0.0));
+        fprintf(f, "      \"p50_ms\": %.6f,\n", result.Percentile(50.0));
+        fprintf(f, "      \"p90_ms\": %.6f,\n", result.Percentile(90.0));
+        fprintf(f, "      \"p99_ms\": %.6f,\n", result.Percentile(99.0));
+        fprintf(f, "      \"max_ms\": %.6f,\n", result.Percentile(100.0));
+        fprintf(f, "      \"bytes_allocated\": %llu,\n", (unsigned long long)result.bytesAllocated);
+        fprintf(f, "      \"allocations\": %llu,\n", (unsigned long long)result.allocations);
+
+        fprintf(f, "      \"metrics\": {");
+        for (size_t j = 0; j < result.metrics.size(); j++)
+            fprintf(f, "%s%s: %.17g", j ? ", " : " ", JsonString(result.metrics[j].first).c_str(), result.metrics[j].second);
+        fprintf(f, " },\n");
+
+        fprintf(f, "      \"samples_ms\": [");
+        for (size_t j = 0; j < result.milliseconds.size(); j++)
+            fprintf(f, "%s%.6f", j ? ", " : "", result.milliseconds[j]);
+        fprintf(f, "]\n");
+
+        fprintf(f, "    }%s\n", i + 1 < m_results.size() ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+bool BenchmarkContext::WriteCsv(const char* pFilename, const std::string& label) const
+{
+    FILE* f = nullptr;
+    errno_t err = fopen_s(&f, pFilename, "w");
+    if (err != 0 || !f)
+    {
+        printf("%s:%d - cannot write %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    fprintf(f, "label,build,suite,stage,parameters,repeats,mean_ms,stddev_ms,min_ms,p50_ms,p90_ms,p99_ms,max_ms,"
+        "bytes_allocated,allocations,metrics\n");
+    for (const BenchmarkResult& result : m_results)
+    {
+        fprintf(f, "%s,%s,%s,%s,%s,%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%llu,%llu,%s\n", CsvString(label).c_str(),
+            CsvString(buildConfiguration).c_str(), CsvString(result.suite).c_str(), CsvString(result.stage).c_str(),
+            CsvString(FormatParameters(result.parameters, ';')).c_str(), result.milliseconds.size(), result.Mean(),
+            result.StdDev(), result.Percentile(0.0), result.Percentile(50.0), result.Percentile(90.0),
+            result.Percentile(99.0), result.Percentile(100.0), (unsigned long long)result.bytesAllocated,
+            (unsigned long long)result.allocations, CsvString(FormatParameters(result.metrics, ';')).c_str());
+    }
+
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "broad_phase.h"
+#include "height_field.h"
+#include "terrain_bounds.h"
+
+// Entities per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1000, 2500, 5000, 10000 };
+
+// Horizontal area per entity, so the density and the pairs per entity stay the same at every count.
+static const float spacing = 300.0f; // m
+static const float conflictDistance = 150.0f; // m
+static const float terrainMargin = 30.0f; // m
+static const float maxRadius = 20.0f; // m
+static const int queriesPerRun = 1000;
+
+// Ground under the entities: 30 km square, up to 3000 m high.
+static const int terrainSize = 513;
+static const float terrainScale = 60.0f;
+
+struct Entities {
+    std::vector<float> x, y, z, radius;
+};
+
+static Entities MakeEntities(int count, float extent, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> horizontal(0.0f, extent);
+    std::uniform_real_distribution<float> altitude(0.0f, 4000.0f);
+    std::uniform_real_distribution<float> size(5.0f, maxRadius);
+    Entities entities;
+    for (int i = 0; i < count; i++)
+    {
+        entities.x.push_back(horizontal(rng));
+        entities.y.push_back(altitude(rng));
+        entities.z.push_back(horizontal(rng));
+        entities.radius.push_back(size(rng));
+    }
+    return entities;
+}
+
+// Every pair closer than the distance by testing all of them, the reference for the broadphase.
+static std::vector<BroadPhasePair> FindPairsBruteForce(const Entities& e, float distance)
+{
+    std::vector<BroadPhasePair> pairs;
+    const int count = (int)e.x.size();
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = i + 1; j < count; j++)
+        {
+            float dx = e.x[j] - e.x[i], dy = e.y[j] - e.y[i], dz = e.z[j] - e.z[i];
+            float limit = distance + e.radius[i] + e.radius[j];
+            float squared = dx * dx + dy * dy + dz * dz;
+            if (squared < limit * limit)
+                pairs.push_back({ i, j, std::sqrt(squared) });
+        }
+    }
+    return pairs;
+}
+
+static bool SamePairs(const std::vector<BroadPhasePair>& a, const std::vector<BroadPhasePair>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].first != b[i].first || a[i].second != b[i].second)
+            return false;
+    }
+    return true;
+}
+
+void RunCollisionBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    HeightField ground;
+    ground.GenerateFaultFormation(terrainSize, 200, 0.0f, 3000.0f, 0.8f, options.seed, terrainScale);
+    TerrainBounds bounds;
+    BenchmarkResult& boundsBuild = context.Measure("collision", "terrain_bounds", { { "posts", terrainSize } },
+        []() {},
+        [&]() { bounds.Build(ground); });
+    boundsBuild.metrics.push_back({ "cells", (double)bounds.GetCellsX() * bounds.GetCellsZ() });
+
+    for (int count : counts)
+    {
+        const float extent = std::sqrt((float)count) * spacing;
+        const Entities entities = MakeEntities(count, extent, options.seed + count);
+        const double entityCount = count;
+
+        BroadPhase broadPhase(2.0f * (conflictDistance + 2.0f * maxRadius));
+        BenchmarkResult& build = context.Measure("collision", "build", { { "entities", entityCount } },
+            []() {},
+            [&]() {
+                broadPhase.Build(entities.x.data(), entities.y.data(), entities.z.data(), entities.radius.data(),
+                    count);
+            });
+        build.metrics.push_back({ "ns_per_entity", build.Mean() * 1.0e6 / entityCount });
+        build.metrics.push_back({ "buckets", (double)broadPhase.GetBucketCount() });
+
+        std::vector<BroadPhasePair> pairs;
+        BenchmarkResult& find = context.Measure("collision", "find_pairs", { { "entities", entityCount } },
+            []() {},
+            [&]() { broadPhase.FindPairs(conflictDistance, pairs); });
+        find.metrics.push_back({ "ns_per_entity", find.Mean() * 1.0e6 / entityCount });
+        find.metrics.push_back({ "pairs", (double)pairs.size() });
+
+        std::vector<BroadPhasePair> expected;
+        BenchmarkResult& brute = context.Measure("collision", "all_pairs", { { "entities", entityCount } },
+            []() {},
+            [&]() { expected = FindPairsBruteForce(entities, conflictDistance); });
+        brute.metrics.push_back({ "speedup_of_broadphase", brute.Mean() / (build.Mean() + find.Mean()) });
+        brute.metrics.push_back({ "matches_broadphase", (double)SamePairs(pairs, expected) });
+
+        // Proximity queries around random points, like a conflict probe ahead of an aircraft.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> horizontal(0.0f, extent);
+        std::vector<int> found;
+        size_t foundTotal = 0;
+        BenchmarkResult& query = context.Measure("collision", "query", { { "entities", entityCount } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < queriesPerRun; i++)
+                {
+                    broadPhase.Query({ horizontal(rng), 2000.0f, horizontal(rng) }, 1000.0f, found);
+                    foundTotal += found.size();
+                }
+            });
+        query.metrics.push_back({ "us_per_query", query.Mean() * 1000.0 / queriesPerRun });
+
+        // Terrain contacts through the height bounds against sampling the ground under every entity.
+        std::vector<TerrainContact> contacts;
+        int sampled = 0;
+        BenchmarkResult& terrain = context.Measure("collision", "terrain_contacts", { { "entities", entityCount } },
+            []() {},
+            [&]() {
+                sampled = bounds.FindContacts(entities.x.data(), entities.y.data(), entities.z.data(),
+                    entities.radius.data(), count, terrainMargin, ground, contacts);
+            });
+        int expectedContacts = 0;
+        for (int i = 0; i < count; i++)
+            expectedContacts += entities.y[i] - entities.radius[i] - ground.GetHeight(entities.x[i], entities.z[i]) <
+                terrainMargin;
+        terrain.metrics.push_back({ "ns_per_entity", terrain.Mean() * 1.0e6 / entityCount });
+        terrain.metrics.push_back({ "sampled_percent", sampled * 100.0 / entityCount });
+        terrain.metrics.push_back({ "contacts", (double)contacts.size() });
+        terrain.metrics.push_back({ "matches_sampling", (double)((int)contacts.size() == expectedContacts) });
+    }
+}
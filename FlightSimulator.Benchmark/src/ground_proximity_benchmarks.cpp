@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "ground_proximity.h"
+#include "height_field.h"
+#include "terrain_bounds.h"
+
+// Aircraft per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1000, 2500, 5000, 10000 };
+
+// Horizontal area per aircraft, like the collision suite.
+static const float spacing = 300.0f; // m
+static const int heightSamples = 100000;
+
+// Ground under the aircraft: 30 km square, up to 3000 m high.
+static const int terrainSize = 513;
+static const float terrainScale = 60.0f;
+
+struct Aircraft {
+    std::vector<float> x, y, z, vx, vy, vz;
+};
+
+// Aircraft between the ground and 6000 m at airliner to light aircraft speeds, climbing or descending a little.
+static Aircraft MakeAircraft(int count, float extent, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> horizontal(0.0f, extent);
+    std::uniform_real_distribution<float> altitude(0.0f, 6000.0f);
+    std::uniform_real_distribution<float> heading(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> speed(50.0f, 250.0f);
+    std::uniform_real_distribution<float> climb(-20.0f, 10.0f);
+    Aircraft aircraft;
+    for (int i = 0; i < count; i++)
+    {
+        const float h = heading(rng), s = speed(rng);
+        aircraft.x.push_back(horizontal(rng));
+        aircraft.y.push_back(altitude(rng));
+        aircraft.z.push_back(horizontal(rng));
+        aircraft.vx.push_back(std::cos(h) * s);
+        aircraft.vy.push_back(climb(rng));
+        aircraft.vz.push_back(std::sin(h) * s);
+    }
+    return aircraft;
+}
+
+// The alerts of every aircraft by sampling every point of every path one by one, the reference for the batch.
+static std::vector<TerrainAlert> FindAlertsOneByOne(const Aircraft& a, const GroundProximitySettings& settings,
+    const HeightField& ground)
+{
+    const int count = (int)a.x.size();
+    const float sampleSeconds = settings.lookAheadSeconds / (settings.samples - 1);
+    std::vector<TerrainAlert> alerts(count, TerrainAlert::None);
+    for (int i = 0; i < count; i++)
+    {
+        for (int k = 0; k < settings.samples; k++)
+        {
+            const float t = k * sampleSeconds;
+            const float height = a.y[i] + a.vy[i] * t;
+            if (height - ground.GetHeight(a.x[i] + a.vx[i] * t, a.z[i] + a.vz[i] * t) < settings.floor)
+            {
+                alerts[i] = t <= settings.warningSeconds ? TerrainAlert::Warning : TerrainAlert::Caution;
+                break;
+            }
+        }
+    }
+    return alerts;
+}
+
+void RunGroundProximityBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    HeightField ground;
+    ground.GenerateFaultFormation(terrainSize, 200, 0.0f, 3000.0f, 0.8f, options.seed, terrainScale);
+    TerrainBounds bounds;
+    bounds.Build(ground);
+
+    // The batched terrain query on its own, against sampling one height at a time.
+    {
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> horizontal(-1000.0f, ground.GetExtent() + 1000.0f);
+        std::vector<float> x(heightSamples), z(heightSamples), batch(heightSamples), single(heightSamples);
+        for (int i = 0; i < heightSamples; i++)
+        {
+            x[i] = horizontal(rng);
+            z[i] = horizontal(rng);
+        }
+
+        BenchmarkResult& one = context.Measure("ground_proximity", "get_height", { { "samples", heightSamples } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < heightSamples; i++)
+                    single[i] = ground.GetHeight(x[i], z[i]);
+            });
+        const double oneMean = one.Mean();
+        one.metrics.push_back({ "ns_per_sample", oneMean * 1.0e6 / heightSamples });
+
+        BenchmarkResult& heights = context.Measure("ground_proximity", "get_heights", { { "samples", heightSamples } },
+            []() {},
+            [&]() { ground.GetHeights(x.data(), z.data(), batch.data(), heightSamples); });
+        float maxError = 0.0f;
+        for (int i = 0; i < heightSamples; i++)
+            maxError = std::max(maxError, std::fabs(batch[i] - single[i]));
+        heights.metrics.push_back({ "ns_per_sample", heights.Mean() * 1.0e6 / heightSamples });
+        heights.metrics.push_back({ "speedup", oneMean / heights.Mean() });
+        heights.metrics.push_back({ "max_error_m", maxError });
+    }
+
+    for (int count : counts)
+    {
+        const float extent = std::sqrt((float)count) * spacing;
+        const Aircraft aircraft = MakeAircraft(count, extent, options.seed + count);
+        const double aircraftCount = count;
+
+        GroundProximity proximity;
+        const GroundProximitySettings& settings = proximity.GetSettings();
+        std::vector<TerrainAlert> expected;
+        BenchmarkResult& naive = context.Measure("ground_proximity", "one_by_one", { { "aircraft", aircraftCount } },
+            []() {},
+            [&]() { expected = FindAlertsOneByOne(aircraft, settings, ground); });
+        const double naiveMean = naive.Mean();
+        naive.metrics.push_back({ "ns_per_aircraft", naiveMean * 1.0e6 / aircraftCount });
+
+        BenchmarkResult& update = context.Measure("ground_proximity", "update", { { "aircraft", aircraftCount } },
+            []() {},
+            [&]() {
+                proximity.Update(aircraft.x.data(), aircraft.y.data(), aircraft.z.data(), aircraft.vx.data(),
+                    aircraft.vy.data(), aircraft.vz.data(), count, bounds, ground);
+            });
+
+        // Batch and reference interpolate the same way, only a path grazing the floor may come out differently
+        int mismatches = 0;
+        for (int i = 0; i < count; i++)
+            mismatches += proximity.GetAlert(i) != expected[i];
+        update.metrics.push_back({ "ns_per_aircraft", update.Mean() * 1.0e6 / aircraftCount });
+        update.metrics.push_back({ "speedup", naiveMean / update.Mean() });
+        update.metrics.push_back({ "sampled_percent", proximity.GetSampledCount() * 100.0 / aircraftCount });
+        update.metrics.push_back({ "cautions", (double)proximity.CountAlerts(TerrainAlert::Caution) });
+        update.metrics.push_back({ "warnings", (double)proximity.CountAlerts(TerrainAlert::Warning) });
+        update.metrics.push_back({ "mismatches", (double)mismatches });
+    }
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "airplane.h"
+#include "benchmark_suites.h"
+#include "data.h"
+
+// Physics rates compared, steps per simulated second. The reference rate is a multiple of all of them.
+static const std::vector<int> rates = { 30, 60, 120, 240, 480 };
+static const int referenceRate = 1920;
+
+static const physics::Integrator integrators[] = {
+    physics::Integrator::semi_implicit_euler,
+    physics::Integrator::verlet,
+    physics::Integrator::rk4,
+    physics::Integrator::adaptive,
+};
+
+// Simulated seconds of the accuracy runs.
+static const float oscillatorSeconds = 60.0f;
+static const float flightSeconds = 20.0f;
+
+// Airframe on a spring pulling its centre of mass to the origin with a 2 s period, tumbling freely. Nothing takes
+// energy or angular momentum out, so whatever the integrator loses or gains is its own error.
+struct Oscillator {
+    physics::RigidBody body;
+    float stiffness;
+
+    explicit Oscillator(physics::Integrator integrator)
+    {
+        const physics::inertia::MassProperties& properties =
+            physics::inertia::mass_properties<physics::TrainerAirframe>;
+        body.set_mass_properties(properties.mass, properties.get_tensor(), properties.get_inverse_tensor());
+        body.apply_gravity = false;
+        body.integrator = integrator;
+        body.position = { 20.0f, 0.0f, 0.0f };
+        body.velocity = { 0.0f, 5.0f, 0.0f };
+        body.angular_velocity = { 0.3f, 0.1f, 1.5f };
+        stiffness = body.mass * physics::sq(physics::PI);
+    }
+
+    void Step(float dt)
+    {
+        body.step(dt, [this]() { body.add_force(-stiffness * body.position); });
+    }
+
+    double Energy() const
+    {
+        glm::vec3 w = body.angular_velocity;
+        return 0.5 * body.mass * glm::dot(body.velocity, body.velocity) +
+            0.5 * stiffness * glm::dot(body.position, body.position) + 0.5 * glm::dot(w, body.get_world_inertia() * w);
+    }
+
+    glm::vec3 AngularMomentum() const { return body.get_world_inertia() * body.angular_velocity; }
+};
+
+// Largest relative change of energy and angular momentum over the oscillator run.
+static void MeasureDrift(physics::Integrator integrator, int rate, double& energyDrift, double& momentumDrift)
+{
+    Oscillator oscillator(integrator);
+    const double energy = oscillator.Energy();
+    const glm::vec3 momentum = oscillator.AngularMomentum();
+
+    energyDrift = 0.0;
+    momentumDrift = 0.0;
+    const int steps = (int)(oscillatorSeconds * rate);
+    for (int i = 0; i < steps; i++)
+    {
+        oscillator.Step(1.0f / rate);
+        energyDrift = std::max(energyDrift, std::abs(oscillator.Energy() - energy) / energy);
+        momentumDrift = std::max(momentumDrift,
+            (double)(glm::length(oscillator.AngularMomentum() - momentum) / glm::length(momentum)));
+    }
+}
+
+// Airplane in a climbing turn on fixed inputs.
+static void StartFlight(physics::Airplane& airplane, physics::Integrator integrator)
+{
+    Joystick joystick;
+    joystick.throttle = 0.7f;
+    joystick.elevator = 0.1f;
+    joystick.leftAileron = 0.05f;
+
+    airplane.integrator = integrator;
+    airplane.position = { 0.0f, 1000.0f, 0.0f };
+    airplane.orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    airplane.velocity = physics::FORWARD * 55.0f;
+    airplane.angular_velocity = glm::vec3(0.0f);
+    airplane.set_controls(joystick);
+    airplane.reset_interpolation();
+}
+
+// Position after every whole second of flight.
+static std::vector<glm::vec3> Fly(physics::Airplane& airplane, int rate)
+{
+    std::vector<glm::vec3> track;
+    for (int second = 0; second < (int)flightSeconds; second++)
+    {
+        for (int i = 0; i < rate; i++)
+            airplane.update(1.0f / rate);
+        track.push_back(airplane.position);
+    }
+    return track;
+}
+
+void RunIntegratorBenchmarks(BenchmarkContext& context)
+{
+    physics::Airfoil wingAirfoil(NACA_2412_data);
+    physics::Airfoil tailAirfoil(NACA_0012_data);
+
+    physics::Airplane reference(&wingAirfoil, &tailAirfoil);
+    StartFlight(reference, physics::Integrator::rk4);
+    const std::vector<glm::vec3> referenceTrack = Fly(reference, referenceRate);
+
+    for (physics::Integrator integrator : integrators)
+    {
+        for (int rate : rates)
+        {
+            physics::Airplane airplane(&wingAirfoil, &tailAirfoil);
+            StartFlight(airplane, integrator);
+            std::vector<glm::vec3> track = Fly(airplane, rate);
+            double positionError = 0.0;
+            for (size_t i = 0; i < track.size(); i++)
+                positionError = std::max(positionError, (double)glm::length(track[i] - referenceTrack[i]));
+
+            double energyDrift, momentumDrift;
+            MeasureDrift(integrator, rate, energyDrift, momentumDrift);
+
+            // One simulated second of the airplane, the cost at this rate.
+            long long evaluations = 0;
+            BenchmarkResult& result = context.Measure("integrators", physics::get_integrator_name(integrator),
+                { { "rate_hz", rate } },
+                [&]() { StartFlight(airplane, integrator); evaluations = 0; },
+                [&]() {
+                    for (int i = 0; i < rate; i++)
+                    {
+                        airplane.update(1.0f / rate);
+                        evaluations += airplane.get_evaluation_count();
+                    }
+                });
+            result.metrics.push_back({ "us_per_step", result.Mean() * 1000.0 / rate });
+            result.metrics.push_back({ "evaluations_per_step", (double)evaluations / rate });
+            result.metrics.push_back({ "position_error_m", positionError });
+            result.metrics.push_back({ "energy_drift", energyDrift });
+            result.metrics.push_back({ "angular_momentum_drift", momentumDrift });
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aero_batch.h"
+#include "airplane.h"
+#include "benchmark_suites.h"
+#include "data.h"
+#include "job_system.h"
+
+// Thread counts when no --threads are given. Counts above the hardware threads show the cost of oversubscription.
+static const std::vector<int> defaultThreads = { 1, 2, 4, 8, 16, 32, 64 };
+
+// Jobs, loop iterations and surfaces per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 65536 };
+
+// Iterations of a parallel for handled by one job.
+static const int chunkSize = 1024;
+
+// Children of every job in the nested stage.
+static const int fanOut = 16;
+
+// Some arithmetic per loop iteration that the compiler can not drop.
+static float Work(float x)
+{
+    for (int i = 0; i < 16; i++)
+        x = std::sqrt(x * x + 1.0f) * 0.999f;
+    return x;
+}
+
+// Spawns fanOut children of a job down to the given depth, each doing a little work on its own output slot.
+static void SpawnTree(JobSystem& jobs, JobHandle parent, int depth, float* values, int& next)
+{
+    for (int i = 0; i < fanOut; i++)
+    {
+        float* value = &values[next++];
+        JobHandle child = jobs.Create([value]() { *value = Work(*value); }, parent);
+        if (depth > 1)
+            SpawnTree(jobs, child, depth - 1, values, next);
+        jobs.Submit(child);
+    }
+}
+
+void RunJobBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& threadCounts = options.threads.empty() ? defaultThreads : options.threads;
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    physics::Airfoil wingAirfoil(NACA_2412_data);
+    physics::Airfoil tailAirfoil(NACA_0012_data);
+    physics::Airplane airplane(&wingAirfoil, &tailAirfoil);
+
+    physics::AirfoilLibrary library;
+    int wingId = library.add(wingAirfoil);
+    int tailId = library.add(tailAirfoil);
+
+    for (int count : counts)
+    {
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<float> input(count), output(count);
+        for (float& x : input)
+            x = unit(rng);
+
+        // Depth of the nested tree holding about count jobs.
+        int depth = std::max(1, (int)std::lround(std::log((double)count) / std::log((double)fanOut)));
+        int treeJobs = 0;
+        for (int level = 1, width = fanOut; level <= depth; level++, width *= fanOut)
+            treeJobs += width;
+        std::vector<float> treeValues(treeJobs);
+
+        // Wing surfaces of many airplanes in cruise.
+        physics::AeroSurfaces surfaces;
+        surfaces.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            const physics::Wing& wing = airplane.wings[i % airplane.wings.size()];
+            surfaces.set_surface(i, wing, wing.airfoil == &wingAirfoil ? wingId : tailId);
+            surfaces.velocity_z[i] = -40.0f - 60.0f * input[i];
+            surfaces.velocity_y[i] = -5.0f * input[i];
+            surfaces.density[i] = 1.0f;
+        }
+        const int vectors = (int)(surfaces.padded_count() / physics::AeroSurfaces::LANES);
+
+        // Mean time of every stage at the first thread count, the baseline of the speedups.
+        std::map<std::string, double> baseline;
+        auto addSpeedup = [&](BenchmarkResult& result, const std::string& stage) {
+            double mean = std::max(result.Mean(), 1e-9);
+            if (!baseline.count(stage))
+                baseline[stage] = mean;
+            result.metrics.push_back({ "speedup", baseline[stage] / mean });
+        };
+
+        for (int threads : threadCounts)
+        {
+            JobSystem jobs(threads);
+            const std::vector<std::pair<std::string, double>> parameters = { { "threads", jobs.GetThreadCount() },
+                { "count", count } };
+
+            // Scheduling overhead alone: empty jobs under a common parent.
+            BenchmarkResult& empty = context.Measure("jobs", "empty_jobs", parameters,
+                []() {},
+                [&]() {
+                    JobHandle root = jobs.Create([]() {});
+                    for (int i = 0; i < count; i++)
+                        jobs.Run([]() {}, root);
+                    jobs.Submit(root);
+                    jobs.Wait(root);
+                });
+            empty.metrics.push_back({ "jobs_per_ms", count / std::max(empty.Mean(), 1e-9) });
+            addSpeedup(empty, "empty_jobs");
+
+            BenchmarkResult& loop = context.Measure("jobs", "parallel_for", parameters,
+                []() {},
+                [&]() {
+                    jobs.Wait(jobs.ParallelFor(0, count, chunkSize, [&](int first, int last) {
+                        for (int i = first; i < last; i++)
+                            output[i] = Work(input[i]);
+                    }));
+                });
+            loop.metrics.push_back({ "items_per_ms", count / std::max(loop.Mean(), 1e-9) });
+            addSpeedup(loop, "parallel_for");
+
+            // Jobs spawning children, finished only when the whole tree is.
+            BenchmarkResult& nested = context.Measure("jobs", "nested", parameters,
+                []() {},
+                [&]() {
+                    int next = 0;
+                    JobHandle root = jobs.Create([]() {});
+                    SpawnTree(jobs, root, depth, treeValues.data(), next);
+                    jobs.Submit(root);
+                    jobs.Wait(root);
+                });
+            nested.metrics.push_back({ "jobs_per_ms", treeJobs / std::max(nested.Mean(), 1e-9) });
+            addSpeedup(nested, "nested");
+
+            BenchmarkResult& aero = context.Measure("jobs", "aero_batch", parameters,
+                []() {},
+                [&]() {
+                    const int vectorsPerJob = std::max(1, chunkSize / (int)physics::AeroSurfaces::LANES);
+                    jobs.Wait(jobs.ParallelFor(0, vectors, vectorsPerJob, [&](int first, int last) {
+                        physics::evaluate_aero(library, surfaces, first * physics::AeroSurfaces::LANES,
+                            last * physics::AeroSurfaces::LANES);
+                    }));
+                });
+            aero.metrics.push_back({ "surfaces_per_ms", count / std::max(aero.Mean(), 1e-9) });
+            addSpeedup(aero, "aero_batch");
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "height_field.h"
+#include "lift_map.h"
+
+static const int liftSamples = 100000;
+
+// Ground under the lift: 30 km square, up to 3000 m high.
+static const int terrainSize = 513;
+static const float terrainScale = 60.0f;
+
+// A wind shift of the size WindField rebuilds its grid for, and a quarter turn.
+static const float smallShift = 0.01f; // rad
+static const float largeShift = 1.5708f;
+
+// Ridge lift at a position derived from the ground on every query, what the map saves.
+static float DeriveRidgeLift(const HeightField& ground, const glm::vec2& wind, const glm::vec3& position,
+    float spacing, float ridgeDepth)
+{
+    const float half = 0.5f * spacing;
+    const glm::vec2 slope(ground.GetHeight(position.x + half, position.z) - ground.GetHeight(position.x - half,
+        position.z), ground.GetHeight(position.x, position.z + half) - ground.GetHeight(position.x, position.z - half));
+    const float height = std::max(position.y - ground.GetHeight(position.x, position.z), 0.0f);
+    return glm::dot(wind, slope / spacing) * std::exp(-height / ridgeDepth);
+}
+
+void RunLiftBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+
+    HeightField ground;
+    ground.GenerateFaultFormation(terrainSize, 200, 0.0f, 3000.0f, 0.8f, options.seed, terrainScale);
+
+    WindSettings wind;
+    LiftMap lift;
+    BenchmarkResult& build = context.Measure("lift", "build", { { "posts", terrainSize } },
+        []() {},
+        [&]() { lift.Build(ground, wind); });
+    build.metrics.push_back({ "nodes", (double)lift.GetNodesX() * lift.GetNodesZ() });
+    build.metrics.push_back({ "thermals", (double)lift.GetThermalCount() });
+
+    // Wind shifts back and forth, so every run refreshes the same tiles
+    const float shifts[] = { smallShift, largeShift };
+    for (float shift : shifts)
+    {
+        WindSettings shifted = wind;
+        int refreshed = 0;
+        bool forth = true;
+        BenchmarkResult& update = context.Measure("lift", "set_wind", { { "shift_deg", shift * 57.2958 } },
+            []() {},
+            [&]() {
+                shifted.direction = wind.direction + (forth ? shift : 0.0f);
+                refreshed = lift.SetWind(shifted);
+                forth = !forth;
+            });
+        update.metrics.push_back({ "tiles_refreshed_percent", refreshed * 100.0 / lift.GetTileCount() });
+    }
+
+    // The ridge lift after a small shift against a map built for that wind, within the tolerance
+    lift.Build(ground, wind);
+    WindSettings shifted = wind;
+    shifted.direction += smallShift;
+    lift.SetWind(shifted);
+    LiftMap reference;
+    reference.Build(ground, shifted);
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> horizontal(0.0f, ground.GetExtent());
+    std::uniform_real_distribution<float> altitude(0.0f, 4000.0f);
+    std::vector<glm::vec3> positions(liftSamples);
+    for (glm::vec3& position : positions)
+        position = glm::vec3(horizontal(rng), altitude(rng), horizontal(rng));
+
+    float maxError = 0.0f;
+    for (const glm::vec3& position : positions)
+        maxError = std::max(maxError, std::fabs(lift.GetRidgeLift(position) - reference.GetRidgeLift(position)));
+
+    double total = 0.0;
+    BenchmarkResult& sample = context.Measure("lift", "get_lift", { { "samples", liftSamples } },
+        []() {},
+        [&]() {
+            for (const glm::vec3& position : positions)
+                total += lift.GetLift(position);
+        });
+    sample.metrics.push_back({ "ns_per_sample", sample.Mean() * 1.0e6 / liftSamples });
+    sample.metrics.push_back({ "max_ridge_error_after_shift", maxError });
+
+    BenchmarkResult& ridge = context.Measure("lift", "get_ridge_lift", { { "samples", liftSamples } },
+        []() {},
+        [&]() {
+            for (const glm::vec3& position : positions)
+                total += lift.GetRidgeLift(position);
+        });
+    const double ridgeMean = ridge.Mean();
+    ridge.metrics.push_back({ "ns_per_sample", ridgeMean * 1.0e6 / liftSamples });
+
+    const glm::vec2 horizontalWind = glm::vec2(std::cos(shifted.direction), std::sin(shifted.direction)) *
+        shifted.speed;
+    const float spacing = 2.0f * terrainScale;
+    BenchmarkResult& derive = context.Measure("lift", "derive_ridge_lift", { { "samples", liftSamples } },
+        []() {},
+        [&]() {
+            for (const glm::vec3& position : positions)
+                total += DeriveRidgeLift(ground, horizontalWind, position, spacing, reference.GetSettings().ridgeDepth);
+        });
+    derive.metrics.push_back({ "ns_per_sample", derive.Mean() * 1.0e6 / liftSamples });
+    derive.metrics.push_back({ "slowdown_over_map", derive.Mean() / ridgeMean });
+}
@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "benchmark_suites.h"
+
+// A named group of measurements that can be selected on the command line.
+struct BenchmarkSuite {
+    const char* name;
+    void (*run)(BenchmarkContext& context);
+};
+
+static const BenchmarkSuite suites[] = {
+    { "terrain", RunTerrainBenchmarks },
+    { "airfoil", RunAirfoilBenchmarks },
+    { "aero", RunAeroBenchmarks },
+    { "atmosphere", RunAtmosphereBenchmarks },
+    { "mass", RunMassBenchmarks },
+    { "jobs", RunJobBenchmarks },
+    { "traffic", RunTrafficBenchmarks },
+    { "integrators", RunIntegratorBenchmarks },
+    { "recorder", RunRecorderBenchmarks },
+    { "snapshots", RunSnapshotBenchmarks },
+    { "collision", RunCollisionBenchmarks },
+    { "ground_proximity", RunGroundProximityBenchmarks },
+    { "wind", RunWindBenchmarks },
+    { "lift", RunLiftBenchmarks },
+    { "autopilot", RunAutopilotBenchmarks },
+};
+
+static void PrintUsage()
+{
+    printf("Usage: FlightSimulator.Benchmark [options]\n"
+        "\n"
+        "Runs headless benchmarks of the simulator. No window or GL context is created.\n"
+        "\n"
+        "Options:\n"
+        "  --suite <name>          Run only this suite, may be repeated (default: all)\n"
+        "  --list                  List the suites and exit\n"
+        "  --sizes <a,b,...>       Terrain sizes (default 257,513,1025,2049,4097)\n"
+        "  --iterations <a,b,...>  Fault iterations (default 100,500,2000)\n"
+        "  --threads <a,b,...>     Thread counts for scalability suites\n"
+        "  --counts <a,b,...>      Entity counts for simulation suites\n"
+        "  --repeats <n>           Timed runs per measurement (default 10)\n"
+        "  --warmup <n>            Untimed runs before measuring (default 1)\n"
+        "  --seed <n>              Seed of all generated inputs (default 1)\n"
+        "  --json <path>           Write results as JSON\n"
+        "  --csv <path>            Write results as CSV\n"
+        "  --label <text>          Label stored with the results, e.g. the commit hash\n");
+}
+
+// Parses a comma separated list of integers.
+static std::vector<int> ParseList(const char* text)
+{
+    std::vector<int> values;
+    std::string item;
+    for (const char* p = text;; p++)
+    {
+        if (*p == ',' || *p == '\0')
+        {
+            if (!item.empty())
+                values.push_back(atoi(item.c_str()));
+            item.clear();
+            if (*p == '\0')
+                break;
+        }
+        else
+        {
+            item.push_back(*p);
+        }
+    }
+    return values;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    std::vector<std::string> selected;
+    const char* jsonPath = nullptr;
+    const char* csvPath = nullptr;
+    std::string label;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--list") == 0)
+        {
+            for (const BenchmarkSuite& suite : suites)
+                printf("%s\n", suite.name);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--suite") == 0 && hasValue)
+            selected.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--sizes") == 0 && hasValue)
+            options.sizes = ParseList(argv[++i]);
+        else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+            options.iterations = ParseList(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+            options.threads = ParseList(argv[++i]);
+        else if (strcmp(argv[i], "--counts") == 0 && hasValue)
+            options.counts = ParseList(argv[++i]);
+        else if (strcmp(argv[i], "--repeats") == 0 && hasValue)
+            options.repeats = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+            options.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+            options.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--json") == 0 && hasValue)
+            jsonPath = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+            csvPath = argv[++i];
+        else if (strcmp(argv[i], "--label") == 0 && hasValue)
+            label = argv[++i];
+        else
+        {
+            printf("Unknown or incomplete option %s\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.sizes.empty() || options.iterations.empty() || options.repeats <= 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    BenchmarkContext context(options);
+    for (const BenchmarkSuite& suite : suites)
+    {
+        bool run = selected.empty();
+        for (const std::string& name : selected)
+            run = run || name == suite.name;
+        if (!run)
+            continue;
+
+        printf("Running %s...\n", suite.name);
+        suite.run(context);
+    }
+
+    context.PrintTable();
+
+    if (jsonPath && !context.WriteJson(jsonPath, label))
+        return 1;
+    if (csvPath && !context.WriteCsv(csvPath, label))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "mass_properties.h"
+
+// Mass elements per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 16, 256, 4096 };
+
+// Mass changes per timed run.
+static const int updatesPerRun = 1024;
+
+// Fuel tanks and stores spread over an airframe.
+static std::vector<physics::inertia::Element> MakeElements(int count, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> size(0.1f, 1.5f);
+    std::uniform_real_distribution<float> mass(5.0f, 200.0f);
+
+    std::vector<physics::inertia::Element> elements;
+    for (int i = 0; i < count; i++)
+    {
+        glm::vec3 extent(size(rng), size(rng), size(rng));
+        elements.push_back(physics::inertia::cube({ position(rng), position(rng) * 0.2f, position(rng) }, extent, mass(rng)));
+    }
+    return elements;
+}
+
+// One element burns fuel or moves, the same change applied to the plain element list.
+struct MassChange {
+    int element;
+    float mass;
+    glm::vec3 position;
+    bool move;
+};
+
+static std::vector<MassChange> MakeChanges(const std::vector<physics::inertia::Element>& elements, int count,
+    std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> element(0, (int)elements.size() - 1);
+    std::uniform_real_distribution<float> burn(0.98f, 1.0f);
+    std::uniform_real_distribution<float> offset(-0.05f, 0.05f);
+    std::uniform_int_distribution<int> kind(0, 7);
+
+    std::vector<float> mass;
+    std::vector<glm::vec3> position;
+    for (const auto& e : elements)
+    {
+        mass.push_back(e.mass);
+        position.push_back(e.position);
+    }
+
+    std::vector<MassChange> changes;
+    for (int i = 0; i < count; i++)
+    {
+        int e = element(rng);
+        bool move = kind(rng) == 0;
+        if (move)
+            position[e] += glm::vec3(offset(rng), offset(rng), offset(rng));
+        else
+            mass[e] = std::max(mass[e] * burn(rng), 0.5f);
+        changes.push_back({ e, mass[e], position[e], move });
+    }
+    return changes;
+}
+
+static void ApplyFull(std::vector<physics::inertia::Element>& elements, const MassChange& change)
+{
+    physics::inertia::Element& element = elements[change.element];
+    if (change.move)
+        element.position = change.position;
+    else
+    {
+        element.mass = change.mass;
+        element.inertia = physics::inertia::cuboid(change.mass, element.size);
+    }
+}
+
+static void ApplyIncremental(physics::inertia::MassDistribution& distribution, const MassChange& change)
+{
+    if (change.move)
+        distribution.set_position(change.element, change.position);
+    else
+        distribution.set_mass(change.element, change.mass);
+}
+
+// Largest element of the difference relative to the largest element of the reference.
+static float RelativeError(const glm::mat3& value, const glm::mat3& reference)
+{
+    float error = 0.0f, scale = 0.0f;
+    for (int c = 0; c < 3; c++)
+        for (int r = 0; r < 3; r++)
+        {
+            error = std::max(error, std::fabs(value[c][r] - reference[c][r]));
+            scale = std::max(scale, std::fabs(reference[c][r]));
+        }
+    return error / scale;
+}
+
+void RunMassBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    for (int count : counts)
+    {
+        std::mt19937 rng(options.seed);
+        const std::vector<physics::inertia::Element> initial = MakeElements(count, rng);
+        const std::vector<MassChange> changes = MakeChanges(initial, updatesPerRun, rng);
+
+        std::vector<physics::inertia::Element> elements;
+        physics::inertia::MassDistribution distribution;
+        std::vector<glm::mat3> fullInverses(updatesPerRun), incrementalInverses(updatesPerRun);
+
+        auto addThroughput = [&](BenchmarkResult& result) {
+            result.metrics.push_back({ "updates_per_ms", updatesPerRun / std::max(result.Mean(), 1e-9) });
+        };
+
+        // Every change followed by inertia::tensor over all elements and a matrix inverse.
+        addThroughput(context.Measure("mass", "full_recompute", { { "count", count } },
+            [&]() { elements = initial; },
+            [&]() {
+                for (int i = 0; i < updatesPerRun; i++)
+                {
+                    ApplyFull(elements, changes[i]);
+                    fullInverses[i] = glm::inverse(physics::inertia::tensor(elements));
+                }
+            }));
+
+        BenchmarkResult& incremental = context.Measure("mass", "incremental", { { "count", count } },
+            [&]() {
+                distribution = physics::inertia::MassDistribution();
+                for (const auto& element : initial)
+                    distribution.add(element);
+            },
+            [&]() {
+                for (int i = 0; i < updatesPerRun; i++)
+                {
+                    ApplyIncremental(distribution, changes[i]);
+                    incrementalInverses[i] = distribution.get_inverse_tensor();
+                }
+            });
+        addThroughput(incremental);
+
+        float stepError = 0.0f;
+        for (int i = 0; i < updatesPerRun; i++)
+            stepError = std::max(stepError, RelativeError(incrementalInverses[i], fullInverses[i]));
+        incremental.metrics.push_back({ "max_inverse_error", stepError });
+
+        // Accuracy after a long run of changes, including stores dropped and loaded again, against a full recompute.
+        BenchmarkResult& accuracy = context.Measure("mass", "validate", { { "count", count } },
+            [&]() {
+                elements = initial;
+                distribution = physics::inertia::MassDistribution();
+                for (const auto& element : initial)
+                    distribution.add(element);
+            },
+            [&]() {
+                for (int round = 0; round < 256; round++)
+                {
+                    for (const MassChange& change : changes)
+                    {
+                        ApplyFull(elements, change);
+                        ApplyIncremental(distribution, change);
+                    }
+                    int dropped = round % count;
+                    distribution.remove(dropped);
+                    distribution.add(elements[dropped]);
+                }
+            });
+
+        glm::vec3 cg;
+        glm::mat3 tensor = physics::inertia::tensor(elements, false, &cg);
+        accuracy.metrics.push_back({ "max_tensor_error", RelativeError(distribution.get_tensor(), tensor) });
+        accuracy.metrics.push_back(
+            { "max_inverse_error", RelativeError(distribution.get_inverse_tensor(), glm::inverse(tensor)) });
+        accuracy.metrics.push_back({ "cg_error_m", glm::length(distribution.get_center_of_gravity() - cg) });
+    }
+}
@@ -0,0 +1,147 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "flight_recorder.h"
+#include "lockstep_simulation.h"
+
+// Simulated seconds recorded for the record, write and read stages, and the recording lengths seeking is compared
+// over.
+static const float recordingSeconds = 60.0f;
+static const std::vector<int> seekRecordingSeconds = { 60, 600 };
+static const int seeksPerRun = 16;
+static const char* recordingPath = "recorder_benchmark.fsr";
+
+// Steps per 60 Hz frame at the lockstep rate.
+static const double stepsPerFrame = 240.0 / 60.0;
+
+static LockstepSettings GetSettings(unsigned int seed)
+{
+    LockstepSettings settings;
+    settings.seed = seed;
+    settings.terrain.size = 257;
+    settings.terrain.iterations = 100;
+    return settings;
+}
+
+// Flies a simulation on slowly varying inputs, recording it if a recorder is given, and keeps every step as a sample.
+static std::vector<FlightSample> Fly(LockstepSimulation& simulation, float seconds, FlightRecorder* pRecorder)
+{
+    const float stepSize = simulation.GetSettings().stepSize;
+    std::vector<FlightSample> samples;
+    Joystick input;
+    input.throttle = simulation.GetSettings().startThrottle;
+    const int steps = (int)std::lround(seconds / stepSize);
+    for (int i = 0; i < steps; i++)
+    {
+        // inputs held for a quarter of a second at a time, like a pilot's
+        if (i % 60 == 0)
+        {
+            float t = i * stepSize;
+            input.elevator = 0.1f * std::sin(t * 0.5f);
+            input.leftAileron = 0.05f * std::sin(t * 0.3f);
+            input.rightAileron = -input.leftAileron;
+        }
+        simulation.Step(input);
+        samples.push_back(FlightRecorder::MakeSample(simulation, input));
+        if (pRecorder)
+        {
+            pRecorder->Record(samples.back());
+            pRecorder->RecordKeyframe(simulation);
+        }
+    }
+    return samples;
+}
+
+void RunRecorderBenchmarks(BenchmarkContext& context)
+{
+    const LockstepSettings settings = GetSettings(context.GetOptions().seed);
+    HeightField ground;
+    LockstepSimulation::GenerateGround(settings.terrain, ground);
+    LockstepSimulation simulation(settings, ground);
+    const std::vector<FlightSample> samples = Fly(simulation, recordingSeconds, nullptr);
+    const double sampleCount = (double)samples.size();
+
+    // The simulation thread's cost: handing every sample to the ring while the writer drains it.
+    FlightRecorder recorder((size_t)samples.size());
+    FlightRecorderStats stats;
+    BenchmarkResult& record = context.Measure("recorder", "record", { { "samples", sampleCount } },
+        [&]() {
+            recorder.Stop();
+            recorder.Start(recordingPath, simulation);
+        },
+        [&]() {
+            for (const FlightSample& sample : samples)
+                recorder.Record(sample);
+        });
+    recorder.Stop();
+    stats = recorder.GetStats();
+    double recordNanoseconds = record.Mean() * 1.0e6 / sampleCount;
+    record.metrics.push_back({ "ns_per_sample", recordNanoseconds });
+    record.metrics.push_back({ "frame_percent", recordNanoseconds * stepsPerFrame * 1.0e-9 * 60.0 * 100.0 });
+    record.metrics.push_back({ "dropped", (double)stats.dropped });
+
+    // The simulation thread's cost of a keyframe, once per keyframe interval.
+    std::vector<uint8_t> state;
+    BenchmarkResult& keyframe = context.Measure("recorder", "keyframe",
+        { { "traffic", (double)settings.trafficCount } },
+        [&]() { state.clear(); },
+        [&]() { simulation.SaveState(state); });
+    keyframe.metrics.push_back({ "bytes", (double)state.size() });
+    keyframe.metrics.push_back({ "frame_percent", keyframe.Mean() * 60.0 / 1000.0 * 100.0 });
+
+    // The writer thread's cost: everything from the first sample to the closed file.
+    BenchmarkResult& write = context.Measure("recorder", "encode_and_write", { { "samples", sampleCount } },
+        []() {},
+        [&]() {
+            recorder.Start(recordingPath, simulation);
+            for (const FlightSample& sample : samples)
+                recorder.Record(sample);
+            recorder.Stop();
+        });
+    stats = recorder.GetStats();
+    write.metrics.push_back({ "samples_per_second", sampleCount * 1000.0 / write.Mean() });
+    write.metrics.push_back({ "bytes_per_sample", (double)stats.bytes / sampleCount });
+    write.metrics.push_back({ "raw_bytes_per_sample", (double)sizeof(FlightSample) });
+
+    FlightRecording recording;
+    std::vector<FlightSample> read;
+    BenchmarkResult& load = context.Measure("recorder", "open_and_read", { { "samples", sampleCount } },
+        []() {},
+        [&]() {
+            recording.Open(recordingPath);
+            recording.ReadSamples(read);
+            recording.Close();
+        });
+    load.metrics.push_back({ "samples_per_second", sampleCount * 1000.0 / load.Mean() });
+
+    // Seeks to random steps of recordings of different lengths; the cost should not grow with the length.
+    for (int seconds : seekRecordingSeconds)
+    {
+        LockstepSimulation recorded(settings, ground);
+        FlightRecorder seekRecorder;
+        seekRecorder.Start(recordingPath, recorded);
+        Fly(recorded, (float)seconds, &seekRecorder);
+        seekRecorder.Stop();
+
+        recording.Open(recordingPath);
+        LockstepSimulation replayed(recording.GetSettings(), ground);
+        const uint64_t firstStep = recording.GetFirstStep(), endStep = recording.GetEndStep();
+        std::mt19937 rng(context.GetOptions().seed);
+        int failed = 0;
+        BenchmarkResult& seek = context.Measure("recorder", "seek",
+            { { "seconds", seconds }, { "keyframe_interval", recording.GetKeyframeInterval() } },
+            []() {},
+            [&]() {
+                for (int i = 0; i < seeksPerRun; i++)
+                    failed += !recording.Seek(replayed, firstStep + rng() % (endStep - firstStep));
+            });
+        seek.metrics.push_back({ "ms_per_seek", seek.Mean() / seeksPerRun });
+        seek.metrics.push_back({ "failed", (double)failed });
+        recording.Close();
+    }
+
+    remove(recordingPath);
+}
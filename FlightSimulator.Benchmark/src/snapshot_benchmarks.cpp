@@ -0,0 +1,85 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "world_snapshot.h"
+
+// Traffic counts the snapshot stages are measured over, and the steps flown on each branch.
+static const std::vector<int> trafficCounts = { 1000, 5000 };
+static const int branchSteps = 480;
+static const char* snapshotPath = "snapshot_benchmark.fss";
+
+// Flies a branch from the current state; the elevator differs between branches.
+static uint64_t FlyBranch(LockstepSimulation& simulation, float elevator)
+{
+    Joystick input;
+    input.throttle = simulation.GetSettings().startThrottle;
+    input.elevator = elevator;
+    for (int i = 0; i < branchSteps; i++)
+        simulation.Step(input);
+    return simulation.ComputeChecksum();
+}
+
+void RunSnapshotBenchmarks(BenchmarkContext& context)
+{
+    for (int count : trafficCounts)
+    {
+        LockstepSettings settings;
+        settings.seed = context.GetOptions().seed;
+        settings.terrain.size = 257;
+        settings.terrain.iterations = 100;
+        settings.trafficCount = count;
+        settings.trafficSpacing = 100.0f;
+        HeightField ground;
+        LockstepSimulation::GenerateGround(settings.terrain, ground);
+        LockstepSimulation simulation(settings, ground);
+        Joystick input;
+        input.throttle = settings.startThrottle;
+        for (int i = 0; i < 240; i++)
+            simulation.Step(input);
+
+        WorldSnapshot snapshot;
+        WorldSnapshotView view{};
+        BenchmarkResult& capture = context.Measure("snapshots", "capture", { { "traffic", (double)count } },
+            []() {},
+            [&]() { snapshot.Capture(simulation, view); });
+        capture.metrics.push_back({ "bytes", (double)snapshot.GetSize() });
+        capture.metrics.push_back({ "frame_percent", capture.Mean() * 60.0 / 1000.0 * 100.0 });
+
+        // Every run flies away from the snapshot first, so the restore has something to undo.
+        int failed = 0;
+        BenchmarkResult& restore = context.Measure("snapshots", "restore", { { "traffic", (double)count } },
+            [&]() { simulation.Step(input); },
+            [&]() { failed += !snapshot.Restore(simulation, view); });
+        restore.metrics.push_back({ "frame_percent", restore.Mean() * 60.0 / 1000.0 * 100.0 });
+        restore.metrics.push_back({ "failed", (double)failed });
+
+        // Two branches from the same instant: A twice, which must agree bit for bit, and B, which must not.
+        snapshot.Restore(simulation, view);
+        const uint64_t branchA = FlyBranch(simulation, 0.1f);
+        snapshot.Restore(simulation, view);
+        const uint64_t branchB = FlyBranch(simulation, -0.1f);
+        snapshot.Restore(simulation, view);
+        const uint64_t branchAAgain = FlyBranch(simulation, 0.1f);
+        restore.metrics.push_back({ "branch_repeats", (double)(branchA == branchAAgain) });
+        restore.metrics.push_back({ "branches_differ", (double)(branchA != branchB) });
+
+        BenchmarkResult& save = context.Measure("snapshots", "save_file", { { "traffic", (double)count } },
+            []() {},
+            [&]() { snapshot.Save(snapshotPath); });
+        save.metrics.push_back({ "megabytes_per_second", snapshot.GetSize() / 1.0e6 * 1000.0 / save.Mean() });
+
+        WorldSnapshot loaded;
+        BenchmarkResult& load = context.Measure("snapshots", "load_file", { { "traffic", (double)count } },
+            []() {},
+            [&]() { loaded.Load(snapshotPath); });
+        load.metrics.push_back({ "megabytes_per_second", snapshot.GetSize() / 1.0e6 * 1000.0 / load.Mean() });
+
+        // The loaded snapshot flies branch A like the captured one.
+        loaded.Restore(simulation, view);
+        load.metrics.push_back({ "branch_repeats", (double)(FlyBranch(simulation, 0.1f) == branchA) });
+    }
+
+    remove(snapshotPath);
+}
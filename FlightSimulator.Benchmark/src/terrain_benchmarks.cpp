@@ -0,0 +1,81 @@
+#include <cstring>
+
+#include "benchmark_suites.h"
+#include "fault_formation.h"
+#include "terrain_grid.h"
+
+// Parameters of the terrain created by the simulator, so the numbers match what startup and regeneration pay.
+static constexpr float minHeight = 0.0f;
+static constexpr float maxHeight = 5000.0f;
+static constexpr float filter = 0.80f;
+static constexpr float worldScale = 20.0f;
+static constexpr float textureScale = 40.0f;
+
+// Copies the posts of one heightmap into another of the same size.
+static void CopyHeightMap(const Array2D<float>& src, Array2D<float>& dst)
+{
+    memcpy(dst.GetBaseAddr(), src.GetBaseAddr(), src.GetSizeInBytes());
+}
+
+void RunTerrainBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+
+    for (int size : options.sizes)
+    {
+        Array2D<float> faulted;
+        Array2D<float> filtered;
+        Array2D<float> work;
+        work.InitArray2D(size, size, 0.0f);
+
+        // Faults depend on the iteration count; every later stage only on the size.
+        for (int iterations : options.iterations)
+        {
+            context.Measure("terrain", "faults", { { "size", size }, { "iterations", iterations } },
+                [&]() { memset(work.GetBaseAddr(), 0, work.GetSizeInBytes()); },
+                [&]() { FaultFormation::ApplyFaults(work, size, iterations, minHeight, maxHeight, options.seed); });
+
+            // Whole CPU side of FaultFormationTerrain::CreateFaultFormation, including the heightmap allocation.
+            TerrainGrid::MeshData meshData;
+            Array2D<float> heightMap;
+            context.Measure("terrain", "total", { { "size", size }, { "iterations", iterations } },
+                [&]() { meshData = TerrainGrid::MeshData(); heightMap.Destroy(); },
+                [&]() {
+                    heightMap.InitArray2D(size, size, 0.0f);
+                    context.CountAllocation(heightMap.GetSizeInBytes());
+                    FaultFormation::GenerateHeightMap(heightMap, size, iterations, minHeight, maxHeight, filter, options.seed);
+                    TerrainGrid::BuildMeshData(heightMap, size, size, worldScale, textureScale, meshData);
+                });
+        }
+
+        // Inputs of the later stages come from the largest iteration count.
+        faulted.InitArray2D(size, size, 0.0f);
+        FaultFormation::ApplyFaults(faulted, size, options.iterations.back(), minHeight, maxHeight, options.seed);
+        filtered.InitArray2D(size, size, 0.0f);
+        CopyHeightMap(faulted, filtered);
+        FaultFormation::ApplyFIRFilter(filtered, size, filter);
+
+        context.Measure("terrain", "fir_filter", { { "size", size } },
+            [&]() { CopyHeightMap(faulted, work); },
+            [&]() { FaultFormation::ApplyFIRFilter(work, size, filter); });
+
+        context.Measure("terrain", "normalize", { { "size", size } },
+            [&]() { CopyHeightMap(filtered, work); },
+            [&]() { work.Normalize(minHeight, maxHeight); });
+
+        work.Normalize(minHeight, maxHeight);
+
+        TerrainGrid::MeshData meshData;
+        context.Measure("terrain", "grid_vertices", { { "size", size } },
+            [&]() { meshData = TerrainGrid::MeshData(); },
+            [&]() { TerrainGrid::BuildVertices(work, size, size, worldScale, textureScale, meshData); });
+
+        context.Measure("terrain", "grid_indices", { { "size", size } },
+            [&]() { meshData = TerrainGrid::MeshData(); },
+            [&]() { TerrainGrid::BuildIndices(size, size, meshData); });
+
+        context.Measure("terrain", "grid_mesh", { { "size", size } },
+            [&]() { meshData = TerrainGrid::MeshData(); },
+            [&]() { TerrainGrid::BuildMeshData(work, size, size, worldScale, textureScale, meshData); });
+    }
+}
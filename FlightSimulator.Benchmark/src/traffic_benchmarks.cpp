@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "airplane.h"
+#include "benchmark_suites.h"
+#include "data.h"
+#include "job_system.h"
+#include "simulation_scheduler.h"
+#include "traffic.h"
+
+// Aircraft per measurement when no --counts are given.
+static const std::vector<int> defaultCounts = { 1000, 5000, 20000 };
+
+// Traffic step, the rate AI aircraft are simulated at.
+static const float trafficStep = 1.0f / 60.0f;
+
+// Frame time at 60 Hz in milliseconds.
+static const double frameMilliseconds = 1000.0 / 60.0;
+
+// Largest distance between a traffic aircraft and a physics::Airplane flown with the same fixed inputs for ten
+// seconds, from the vector aero kernel and the single Reynolds row of the batch.
+static double MeasurePositionError(const physics::Airplane& prototype, const physics::Airfoil* wingAirfoil,
+    const physics::Airfoil* tailAirfoil)
+{
+    Joystick joystick;
+    joystick.throttle = 0.6f;
+    joystick.elevator = 0.05f;
+    joystick.leftAileron = 0.1f;
+
+    TrafficSystem traffic(prototype);
+    traffic.AddAircraft({ 0.0f, 1000.0f, 0.0f }, 0.0f, 55.0f);
+    traffic.SetControls(0, joystick);
+
+    physics::Airplane airplane(wingAirfoil, tailAirfoil);
+    airplane.position = { 0.0f, 1000.0f, 0.0f };
+    airplane.velocity = physics::FORWARD * 55.0f;
+    airplane.set_controls(joystick);
+
+    double maxError = 0.0;
+    for (int i = 0; i < 10 * 240; i++)
+    {
+        traffic.StepRange(0, 1, 1.0f / 240.0f);
+        airplane.update(1.0f / 240.0f);
+        maxError = std::max(maxError, (double)glm::length(airplane.position - traffic.GetPosition(0)));
+    }
+    return maxError;
+}
+
+void RunTrafficBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+    const std::vector<int>& counts = options.counts.empty() ? defaultCounts : options.counts;
+
+    physics::Airfoil wingAirfoil(NACA_2412_data);
+    physics::Airfoil tailAirfoil(NACA_0012_data);
+    physics::Airplane prototype(&wingAirfoil, &tailAirfoil);
+    const double positionError = MeasurePositionError(prototype, &wingAirfoil, &tailAirfoil);
+
+    for (int count : counts)
+    {
+        // A grid of aircraft turning onto random headings, altitudes and speeds.
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> heading(-physics::PI, physics::PI);
+        std::uniform_real_distribution<float> altitude(500.0f, 3000.0f);
+        std::uniform_real_distribution<float> speed(45.0f, 70.0f);
+
+        TrafficSystem traffic(prototype);
+        std::vector<physics::Airplane> airplanes;
+        const int columns = (int)std::ceil(std::sqrt((double)count));
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec3 position((i % columns) * 200.0f, altitude(rng), (i / columns) * 200.0f);
+            float initialHeading = heading(rng);
+            traffic.AddAircraft(position, initialHeading, speed(rng));
+            traffic.SetTarget(i, heading(rng), altitude(rng), speed(rng));
+
+            airplanes.emplace_back(&wingAirfoil, &tailAirfoil);
+            airplanes.back().position = position;
+            airplanes.back().orientation = glm::angleAxis(-initialHeading, physics::UP);
+            airplanes.back().velocity = airplanes.back().orientation * physics::FORWARD * 55.0f;
+        }
+
+        BenchmarkResult& step = context.Measure("traffic", "step", { { "count", count } },
+            []() {},
+            [&]() { traffic.Step(trafficStep); });
+        step.metrics.push_back({ "aircraft_per_ms", count / std::max(step.Mean(), 1e-9) });
+        step.metrics.push_back({ "frame_percent_60hz", step.Mean() / frameMilliseconds * 100.0 });
+        step.metrics.push_back({ "threads", (double)GetJobSystem().GetThreadCount() });
+        step.metrics.push_back({ "max_position_error_m", positionError });
+        // Later measurements can move the results, keep the value rather than the reference.
+        const double stepMilliseconds = step.Mean();
+
+        BenchmarkResult& transforms = context.Measure("traffic", "transforms", { { "count", count } },
+            []() {},
+            [&]() { traffic.UpdateTransforms(0.5f); });
+        transforms.metrics.push_back({ "aircraft_per_ms", count / std::max(transforms.Mean(), 1e-9) });
+
+        // The same fleet as one physics::Airplane per aircraft, stepped in parallel the same way.
+        BenchmarkResult& airplane = context.Measure("traffic", "airplane_objects", { { "count", count } },
+            []() {},
+            [&]() {
+                JobSystem& jobs = GetJobSystem();
+                jobs.Wait(jobs.ParallelFor(0, count, TrafficSystem::CHUNK_AIRCRAFT, [&](int first, int last) {
+                    for (int i = first; i < last; i++)
+                        airplanes[i].update(trafficStep);
+                }));
+            });
+        airplane.metrics.push_back({ "aircraft_per_ms", count / std::max(airplane.Mean(), 1e-9) });
+        airplane.metrics.push_back({ "traffic_speedup", airplane.Mean() / std::max(stepMilliseconds, 1e-9) });
+
+        // The fleet seen from its middle looking along -Z, every aircraft stepped at the rate its distance and
+        // direction get it. One run is the period of the slowest level, so every aircraft steps at least once.
+        SimulationScheduler scheduler;
+        for (int i = 0; i < count; i++)
+            scheduler.Add();
+        SchedulerView view;
+        view.position = glm::vec3(columns * 100.0f, 1500.0f, columns * 100.0f);
+        view.cosHalfFov = 0.7f;
+        const TrafficState& state = traffic.GetState();
+        scheduler.Rebalance(view, state.positionX, state.positionY, state.positionZ, count);
+        const int period = 1 << (scheduler.GetSettings().levelCount - 1);
+        const int rebalancePerTick = std::max(1, count / period);
+
+        BenchmarkResult& scheduled = context.Measure("traffic", "scheduled_tick", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int tick = 0; tick < period; tick++)
+                {
+                    scheduler.Rebalance(view, state.positionX, state.positionY, state.positionZ,
+                        rebalancePerTick);
+                    int due = scheduler.Tick();
+                    traffic.StepSelected(scheduler.GetDue().data(), scheduler.GetDueSteps().data(), due);
+                }
+            });
+        const double tickMilliseconds = scheduled.Mean() / period;
+        scheduled.metrics.push_back({ "ms_per_tick", tickMilliseconds });
+        scheduled.metrics.push_back({ "steps_per_tick", scheduler.GetStepsPerTick() });
+        scheduled.metrics.push_back({ "full_rate_percent", tickMilliseconds / std::max(stepMilliseconds, 1e-9) * 100.0 });
+        for (int level = 0; level < scheduler.GetSettings().levelCount; level++)
+            scheduled.metrics.push_back({ "level" + std::to_string(level), (double)scheduler.GetLevelPopulation(level) });
+
+        // The scheduler alone: rebalancing and collecting the due aircraft.
+        BenchmarkResult& overhead = context.Measure("traffic", "scheduler_overhead", { { "count", count } },
+            []() {},
+            [&]() {
+                for (int tick = 0; tick < period; tick++)
+                {
+                    scheduler.Rebalance(view, state.positionX, state.positionY, state.positionZ,
+                        rebalancePerTick);
+                    scheduler.Tick();
+                }
+            });
+        overhead.metrics.push_back({ "ms_per_tick", overhead.Mean() / period });
+        overhead.metrics.push_back({ "ns_per_step", overhead.Mean() * 1e6 / std::max(scheduler.GetStepsPerTick() * period, 1.0f) });
+
+        std::vector<float> elapsed;
+        BenchmarkResult& extrapolate = context.Measure("traffic", "extrapolate_transforms", { { "count", count } },
+            []() {},
+            [&]() {
+                scheduler.GetElapsed(0.5f, elapsed);
+                traffic.ExtrapolateTransforms(elapsed.data());
+            });
+        extrapolate.metrics.push_back({ "aircraft_per_ms", count / std::max(extrapolate.Mean(), 1e-9) });
+    }
+}
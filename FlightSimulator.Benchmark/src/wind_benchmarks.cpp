@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "benchmark_suites.h"
+#include "height_field.h"
+#include "wind_field.h"
+
+static const int windSamples = 100000;
+
+// Ground under the wind: 30 km square, up to 3000 m high.
+static const int terrainSize = 513;
+static const float terrainScale = 60.0f;
+
+void RunWindBenchmarks(BenchmarkContext& context)
+{
+    const BenchmarkOptions& options = context.GetOptions();
+
+    HeightField ground;
+    ground.GenerateFaultFormation(terrainSize, 200, 0.0f, 3000.0f, 0.8f, options.seed, terrainScale);
+
+    WindField wind;
+    WindSettings settings;
+    BenchmarkResult& build = context.Measure("wind", "build", { { "posts", terrainSize } },
+        []() {},
+        [&]() { wind.Build(ground, settings, options.seed); });
+    const double nodes = (double)wind.GetNodesX() * wind.GetNodesZ() * wind.GetLevels();
+    build.metrics.push_back({ "nodes", nodes });
+    build.metrics.push_back({ "grid_mb", nodes * 3 * sizeof(float) / (1024.0 * 1024.0) });
+
+    // A wind shift: the time from the wind changing until the rebuilt grid is taken over, and the cost of the Update
+    // calls on the frame meanwhile.
+    double updateSeconds = 0.0;
+    int updates = 0;
+    BenchmarkResult& rebuild = context.Measure("wind", "rebuild", { { "posts", terrainSize } },
+        []() {},
+        [&]() {
+            settings.direction += 0.5f;
+            wind.SetWind(settings);
+            wind.Update(1.0f);
+            while (wind.IsRebuilding())
+            {
+                auto start = std::chrono::steady_clock::now();
+                wind.Update(0.0f);
+                updateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                updates++;
+                std::this_thread::yield();
+            }
+        });
+    rebuild.metrics.push_back({ "us_per_update", updates ? updateSeconds * 1.0e6 / updates : 0.0 });
+    rebuild.metrics.push_back({ "grids", (double)wind.GetGridCount() });
+
+    // Sampling at random points from the ground to the ceiling, one by one and as a batch.
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> horizontal(-500.0f, ground.GetExtent() + 500.0f);
+    std::uniform_real_distribution<float> altitude(0.0f, 6500.0f);
+    std::vector<float> x(windSamples), y(windSamples), z(windSamples);
+    for (int i = 0; i < windSamples; i++)
+    {
+        x[i] = horizontal(rng);
+        y[i] = altitude(rng);
+        z[i] = horizontal(rng);
+    }
+
+    std::vector<glm::vec3> single(windSamples);
+    BenchmarkResult& one = context.Measure("wind", "get_wind", { { "samples", windSamples } },
+        []() {},
+        [&]() {
+            for (int i = 0; i < windSamples; i++)
+                single[i] = wind.GetWind(glm::vec3(x[i], y[i], z[i]));
+        });
+    const double oneMean = one.Mean();
+    one.metrics.push_back({ "ns_per_sample", oneMean * 1.0e6 / windSamples });
+
+    std::vector<float> windX(windSamples), windY(windSamples), windZ(windSamples);
+    BenchmarkResult& batch = context.Measure("wind", "get_winds", { { "samples", windSamples } },
+        []() {},
+        [&]() {
+            wind.GetWinds(x.data(), y.data(), z.data(), windX.data(), windY.data(), windZ.data(), windSamples);
+        });
+    float maxDifference = 0.0f;
+    double speed = 0.0;
+    for (int i = 0; i < windSamples; i++)
+    {
+        maxDifference = std::max(maxDifference, glm::length(glm::vec3(windX[i], windY[i], windZ[i]) - single[i]));
+        speed += glm::length(single[i]);
+    }
+    batch.metrics.push_back({ "ns_per_sample", batch.Mean() * 1.0e6 / windSamples });
+    batch.metrics.push_back({ "speedup", oneMean / batch.Mean() });
+    batch.metrics.push_back({ "max_difference", maxDifference });
+    batch.metrics.push_back({ "mean_speed", speed / windSamples });
+}
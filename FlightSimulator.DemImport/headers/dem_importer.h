@@ -0,0 +1,125 @@
+#ifndef DEM_IMPORTER_H
+#define DEM_IMPORTER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "dem_reader.h"
+#include "terrain_database.h"
+
+// Georeferencing and output options of an import.
+struct DemImportSettings {
+    int tileSize = 257; // Posts along one side of an output tile, including the border shared with the next tile.
+    float outputSpacing = 0.0f; // Post spacing of the finest level in metres, 0 to keep the source resolution.
+
+    // Metric source: distance in metres between neighbouring samples.
+    float pixelSize = 30.0f;
+
+    // Geographic source: samples are on a latitude/longitude grid and get reprojected to metres.
+    bool geographic = false;
+    double west = 0.0; // Longitude of the first sample column in degrees.
+    double north = 0.0; // Latitude of the first sample row in degrees.
+    double degreesPerPixelX = 0.0;
+    double degreesPerPixelY = 0.0;
+
+    float heightScale = 1.0f; // Applied to every sample before heightOffset.
+    float heightOffset = 0.0f;
+    float noDataHeight = 0.0f; // Height written for posts without source data.
+};
+
+// Numbers reported after an import.
+struct DemImportStats {
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t postsWritten = 0;
+    uint64_t tilesWritten = 0;
+    int levelCount = 0;
+    size_t workingSetBytes = 0; // Bytes of row band and tile buffers, independent of the raster height.
+    double seconds = 0.0;
+};
+
+// DemImporter converts a DEM raster into a terrain database (see terrain_database.h).
+//
+// The finest level is produced one row of tiles at a time. For each tile row only the band of source rows it
+// samples from is held in memory, and rows shared with the previous band are kept instead of being read again.
+// Geographic rasters are reprojected to a sinusoidal projection around the central meridian of the raster, which
+// keeps post spacing metric along both axes. Coarser levels are built afterwards by reading the four child tiles of
+// each tile back from the output file, so memory use stays bounded by one band no matter how large the raster is.
+class DemImporter
+{
+public:
+    // Constructor.
+    // @param reader: Opened source raster.
+    // @param settings: Georeferencing and output options.
+    DemImporter(DemReader& reader, const DemImportSettings& settings);
+
+    // Runs the import.
+    // @param pFilename: Path of the database to write.
+    // @return: False on an I/O error.
+    bool Run(const char* pFilename);
+
+    // Gets the statistics of the last Run().
+    const DemImportStats& GetStats() const { return m_stats; }
+
+private:
+    // Sets up the output grid of the finest level and the mapping from output posts to source samples.
+    void ComputeOutputGrid();
+
+    // Gets the source row sampled by an output post row.
+    double SourceRow(int postZ) const;
+
+    // Gets the source column sampled by an output post.
+    double SourceColumn(int postX, int postZ) const;
+
+    // Makes sure the source rows [firstRow, lastRow] are in the band buffer, reading only rows not already there.
+    bool LoadBand(int firstRow, int lastRow);
+
+    // Samples the band buffer bilinearly. Void samples are skipped.
+    // @return: The height, or NaN if the position has no valid source samples.
+    float SampleBand(double column, double row) const;
+
+    // Writes the finest level.
+    bool WriteFinestLevel();
+
+    // Gets the post of the 2 x 2 child tiles below a tile that a post of the tile samples.
+    // @param tile: Tile column or row.
+    // @param post: Post column or row within the tile.
+    // @param childPosts: Posts of the child level along the same axis.
+    // @return: Post column or row counted from the first post of the child tiles.
+    int ChildPost(int tile, int post, uint32_t childPosts) const;
+
+    // Writes a coarser level by taking every second post of the previous level.
+    bool WriteCoarserLevel(int level);
+
+    // Appends a tile to the output file and records it in the tile table.
+    bool WriteTile(const std::vector<float>& heights, TerrainDatabaseTile& entry);
+
+    // Writes the level and tile tables and the final header.
+    bool WriteTables();
+
+    // Appends bytes at m_writeOffset.
+    bool Append(const void* data, size_t size);
+
+    DemReader& m_reader;
+    DemImportSettings m_settings;
+    DemImportStats m_stats;
+    FILE* m_output = nullptr;
+    uint64_t m_writeOffset = 0;
+
+    // Output grid.
+    double m_spacing = 0.0;
+    double m_centerColumn = 0.0; // Geographic: source column of the central meridian.
+    double m_halfWidthMetres = 0.0; // Geographic: distance from the west edge of the output to the central meridian.
+    std::vector<TerrainDatabaseLevel> m_levels;
+    std::vector<TerrainDatabaseTile> m_tiles;
+    float m_minHeight = 0.0f;
+    float m_maxHeight = 0.0f;
+
+    // Source rows currently loaded, first row m_bandFirstRow.
+    std::vector<float> m_band;
+    int m_bandFirstRow = 0;
+    int m_bandRowCount = 0;
+};
+
+#endif // DEM_IMPORTER_H
@@ -0,0 +1,76 @@
+#ifndef DEM_READER_H
+#define DEM_READER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Sample encodings of the supported DEM rasters.
+enum class DemFormat {
+    Float32, // Raw little endian floats, e.g. heightmaps saved by the simulator.
+    Int16LE, // Raw signed 16 bit, little endian.
+    Int16BE, // Raw signed 16 bit, big endian, e.g. SRTM .hgt tiles.
+    UInt16LE, // Raw unsigned 16 bit, little endian, e.g. .r16 heightmaps.
+    UInt16BE, // Raw unsigned 16 bit, big endian.
+    Pgm // Binary (P5) PGM with 8 or 16 bit samples.
+};
+
+// DemReader reads rows of a DEM raster on demand and converts them to float heights. Nothing but the requested rows is
+// ever held in memory, so rasters of any size can be converted.
+class DemReader
+{
+public:
+    // Default constructor.
+    DemReader() = default;
+
+    // Closes the raster file.
+    ~DemReader();
+
+    DemReader(const DemReader&) = delete;
+    DemReader& operator=(const DemReader&) = delete;
+
+    // Guesses the format of a raster from its file extension: .pgm, .hgt, .r16, anything else is read as Float32.
+    // @param pFilename: Path of the raster.
+    static DemFormat FormatFromFilename(const char* pFilename);
+
+    // Opens a raster.
+    // @param pFilename: Path of the raster.
+    // @param format: Sample encoding of the raster.
+    // @param width: Samples per row of a raw raster, 0 to assume a square raster. Ignored for PGM.
+    // @param height: Number of rows of a raw raster, 0 to assume a square raster. Ignored for PGM.
+    // @return: False if the file cannot be opened or its size does not match the dimensions.
+    bool Open(const char* pFilename, DemFormat format, int width, int height);
+
+    // Reads consecutive rows and converts them to heights. Void samples (-32768 in signed 16 bit data, NaN or huge
+    // negative floats) become NaN.
+    // @param firstRow: First row to read.
+    // @param rowCount: Number of rows to read.
+    // @param dst: Receives rowCount x GetWidth() heights.
+    // @return: False on a read error.
+    bool ReadRows(int firstRow, int rowCount, float* dst);
+
+    // Gets the number of samples per row.
+    int GetWidth() const { return m_width; }
+
+    // Gets the number of rows.
+    int GetHeight() const { return m_height; }
+
+    // Gets the number of raster bytes read so far.
+    uint64_t GetBytesRead() const { return m_bytesRead; }
+
+private:
+    // Parses the header of a binary PGM file.
+    // @return: False if the file is not a P5 PGM.
+    bool ReadPgmHeader();
+
+    FILE* m_file = nullptr;
+    DemFormat m_format = DemFormat::Float32;
+    int m_width = 0;
+    int m_height = 0;
+    int m_bytesPerSample = 4;
+    uint64_t m_dataOffset = 0; // File offset of the first sample.
+    uint64_t m_bytesRead = 0;
+    std::vector<uint8_t> m_rowBytes; // Undecoded samples of the rows being read.
+};
+
+#endif // DEM_READER_H
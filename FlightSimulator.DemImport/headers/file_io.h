@@ -0,0 +1,34 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <cstdint>
+#include <cstdio>
+
+// Seeks to an absolute 64 bit offset. The plain fseek is limited to 2 GB on Windows.
+// @param f: Open file.
+// @param offset: Offset from the start of the file.
+// @return: True on success.
+inline bool Seek64(FILE* f, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// Gets the size of an open file. Leaves the position at the end of the file.
+// @param f: Open file.
+// @return: Size in bytes.
+inline uint64_t FileSize64(FILE* f)
+{
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    return (uint64_t)_ftelli64(f);
+#else
+    fseeko(f, 0, SEEK_END);
+    return (uint64_t)ftello(f);
+#endif
+}
+
+#endif // FILE_IO_H
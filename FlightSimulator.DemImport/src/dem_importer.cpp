@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "dem_importer.h"
+#include "file_io.h"
+#include "parallel.h"
+
+// Mean earth radius in metres.
+static constexpr double EARTH_RADIUS = 6371008.8;
+static constexpr double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+// Number of finest level tiles sampled in parallel before they are written out.
+static constexpr int TILE_GROUP_SIZE = 16;
+
+DemImporter::DemImporter(DemReader& reader, const DemImportSettings& settings)
+    : m_reader(reader), m_settings(settings)
+{
+}
+
+bool DemImporter::Run(const char* pFilename)
+{
+    auto start = std::chrono::steady_clock::now();
+    m_stats = DemImportStats();
+
+    errno_t err = fopen_s(&m_output, pFilename, "w+b");
+    if (err != 0 || !m_output)
+    {
+        printf("%s:%d - cannot create %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    ComputeOutputGrid();
+
+    // The header is rewritten with the table offsets once everything else is on disk.
+    TerrainDatabaseHeader header = {};
+    bool ok = Append(&header, sizeof(header)) && WriteFinestLevel();
+    for (int level = 1; ok && level < (int)m_levels.size(); level++)
+        ok = WriteCoarserLevel(level);
+    ok = ok && WriteTables();
+
+    fclose(m_output);
+    m_output = nullptr;
+
+    m_stats.bytesRead = m_reader.GetBytesRead();
+    m_stats.bytesWritten = m_writeOffset;
+    m_stats.levelCount = (int)m_levels.size();
+    m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+void DemImporter::ComputeOutputGrid()
+{
+    const int width = m_reader.GetWidth();
+    const int height = m_reader.GetHeight();
+    double widthMetres;
+    double heightMetres;
+
+    if (m_settings.geographic)
+    {
+        // Rows of a sinusoidal projection are as wide as their latitude circle, so the output is as wide as the row
+        // closest to the equator and narrower rows are padded with no data posts.
+        const double south = m_settings.north - (height - 1) * m_settings.degreesPerPixelY;
+        const double widestLatitude = (m_settings.north >= 0.0 && south <= 0.0) ? 0.0
+            : std::min(std::fabs(m_settings.north), std::fabs(south));
+        widthMetres = (width - 1) * m_settings.degreesPerPixelX * DEG_TO_RAD * EARTH_RADIUS * std::cos(widestLatitude * DEG_TO_RAD);
+        heightMetres = (height - 1) * m_settings.degreesPerPixelY * DEG_TO_RAD * EARTH_RADIUS;
+        m_spacing = (m_settings.outputSpacing > 0.0f) ? m_settings.outputSpacing
+            : m_settings.degreesPerPixelY * DEG_TO_RAD * EARTH_RADIUS;
+        m_centerColumn = (width - 1) * 0.5;
+        m_halfWidthMetres = widthMetres * 0.5;
+    }
+    else
+    {
+        widthMetres = (width - 1) * (double)m_settings.pixelSize;
+        heightMetres = (height - 1) * (double)m_settings.pixelSize;
+        m_spacing = (m_settings.outputSpacing > 0.0f) ? m_settings.outputSpacing : m_settings.pixelSize;
+    }
+
+    const int tileCells = m_settings.tileSize - 1;
+    int postsX = (int)std::floor(widthMetres / m_spacing) + 1;
+    int postsZ = (int)std::floor(heightMetres / m_spacing) + 1;
+
+    // Every level halves the resolution of the previous one until a single tile covers everything.
+    m_levels.clear();
+    uint64_t firstTile = 0;
+    for (int level = 0;; level++)
+    {
+        TerrainDatabaseLevel info = {};
+        info.postsX = postsX;
+        info.postsZ = postsZ;
+        info.tilesX = std::max(1, (postsX - 1 + tileCells - 1) / tileCells);
+        info.tilesZ = std::max(1, (postsZ - 1 + tileCells - 1) / tileCells);
+        info.firstTile = firstTile;
+        info.postSpacing = (float)(m_spacing * (1 << level));
+        m_levels.push_back(info);
+        firstTile += (uint64_t)info.tilesX * info.tilesZ;
+
+        if (info.tilesX == 1 && info.tilesZ == 1)
+            break;
+        // An odd number of cells leaves the last post of the level between two coarser posts, so the coarser level
+        // gets one more post that repeats it instead of dropping the edge.
+        postsX = postsX / 2 + 1;
+        postsZ = postsZ / 2 + 1;
+    }
+
+    m_tiles.assign(firstTile, TerrainDatabaseTile());
+}
+
+double DemImporter::SourceRow(int postZ) const
+{
+    if (m_settings.geographic)
+        return postZ * m_spacing / (m_settings.degreesPerPixelY * DEG_TO_RAD * EARTH_RADIUS);
+    return postZ * m_spacing / m_settings.pixelSize;
+}
+
+double DemImporter::SourceColumn(int postX, int postZ) const
+{
+    if (m_settings.geographic)
+    {
+        // Sinusoidal projection: x is the distance from the central meridian along the latitude circle.
+        double latitude = m_settings.north - SourceRow(postZ) * m_settings.degreesPerPixelY;
+        double x = postX * m_spacing - m_halfWidthMetres;
+        double longitudeOffset = x / (EARTH_RADIUS * std::cos(latitude * DEG_TO_RAD)) / DEG_TO_RAD;
+        return m_centerColumn + longitudeOffset / m_settings.degreesPerPixelX;
+    }
+    return postX * m_spacing / m_settings.pixelSize;
+}
+
+bool DemImporter::LoadBand(int firstRow, int lastRow)
+{
+    const int width = m_reader.GetWidth();
+    firstRow = std::clamp(firstRow, 0, m_reader.GetHeight() - 1);
+    lastRow = std::clamp(lastRow, firstRow, m_reader.GetHeight() - 1);
+
+    const size_t rowCount = (size_t)(lastRow - firstRow + 1);
+    if (m_band.size() < rowCount * width)
+        m_band.resize(rowCount * width);
+
+    // Consecutive tile rows share their border posts, so the last rows of the previous band are usually reused.
+    int readFrom = firstRow;
+    const int keepLast = std::min(lastRow, m_bandFirstRow + m_bandRowCount - 1);
+    if (m_bandRowCount > 0 && firstRow >= m_bandFirstRow && firstRow <= keepLast)
+    {
+        memmove(m_band.data(), m_band.data() + (size_t)(firstRow - m_bandFirstRow) * width,
+            (size_t)(keepLast - firstRow + 1) * width * sizeof(float));
+        readFrom = keepLast + 1;
+    }
+
+    m_bandFirstRow = firstRow;
+    m_bandRowCount = (int)rowCount;
+    m_stats.workingSetBytes = std::max(m_stats.workingSetBytes, m_band.size() * sizeof(float));
+
+    if (readFrom > lastRow)
+        return true;
+    return m_reader.ReadRows(readFrom, lastRow - readFrom + 1, m_band.data() + (size_t)(readFrom - firstRow) * width);
+}
+
+float DemImporter::SampleBand(double column, double row) const
+{
+    const int width = m_reader.GetWidth();
+    const int height = m_reader.GetHeight();
+    const double epsilon = 1e-6;
+    if (column < -epsilon || row < -epsilon || column > width - 1 + epsilon || row > height - 1 + epsilon)
+        return std::numeric_limits<float>::quiet_NaN();
+
+    int ix = std::clamp((int)std::floor(column), 0, std::max(width - 2, 0));
+    int iz = std::clamp((int)std::floor(row), m_bandFirstRow, std::max(m_bandFirstRow + m_bandRowCount - 2, m_bandFirstRow));
+    double u = std::clamp(column - ix, 0.0, 1.0);
+    double v = std::clamp(row - iz, 0.0, 1.0);
+
+    // Bilinear weights, renormalized over the valid samples so voids do not pull the surface down.
+    const int ix1 = std::min(ix + 1, width - 1);
+    const int iz1 = std::min(iz + 1, m_bandFirstRow + m_bandRowCount - 1);
+    const float samples[4] = {
+        m_band[(size_t)(iz - m_bandFirstRow) * width + ix], m_band[(size_t)(iz - m_bandFirstRow) * width + ix1],
+        m_band[(size_t)(iz1 - m_bandFirstRow) * width + ix], m_band[(size_t)(iz1 - m_bandFirstRow) * width + ix1]
+    };
+    const double weights[4] = { (1 - u) * (1 - v), u * (1 - v), (1 - u) * v, u * v };
+
+    double sum = 0.0;
+    double weightSum = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (std::isnan(samples[i]) || weights[i] <= 0.0)
+            continue;
+        sum += samples[i] * weights[i];
+        weightSum += weights[i];
+    }
+
+    if (weightSum <= 0.0)
+        return std::numeric_limits<float>::quiet_NaN();
+    return (float)(sum / weightSum);
+}
+
+bool DemImporter::WriteFinestLevel()
+{
+    const TerrainDatabaseLevel& info = m_levels[0];
+    const int tileSize = m_settings.tileSize;
+    const int tileCells = tileSize - 1;
+
+    std::vector<std::vector<float>> group(TILE_GROUP_SIZE, std::vector<float>((size_t)tileSize * tileSize));
+    std::vector<char> groupHasData(TILE_GROUP_SIZE);
+    std::vector<float> groupMin(TILE_GROUP_SIZE);
+    std::vector<float> groupMax(TILE_GROUP_SIZE);
+
+    m_minHeight = std::numeric_limits<float>::max();
+    m_maxHeight = -std::numeric_limits<float>::max();
+
+    for (int tileZ = 0; tileZ < (int)info.tilesZ; tileZ++)
+    {
+        // Source rows sampled by this tile row, one more for the bilinear filter.
+        const int firstPost = tileZ * tileCells;
+        const int lastPost = std::min(firstPost + tileCells, (int)info.postsZ - 1);
+        if (!LoadBand((int)std::floor(SourceRow(firstPost)), (int)std::floor(SourceRow(lastPost)) + 1))
+            return false;
+
+        for (int groupStart = 0; groupStart < (int)info.tilesX; groupStart += TILE_GROUP_SIZE)
+        {
+            const int groupCount = std::min(TILE_GROUP_SIZE, (int)info.tilesX - groupStart);
+
+            ParallelForRange(0, groupCount, [&](int first, int last) {
+                for (int i = first; i < last; i++)
+                {
+                    std::vector<float>& heights = group[i];
+                    const int tileX = groupStart + i;
+                    bool hasData = false;
+                    float minHeight = std::numeric_limits<float>::max();
+                    float maxHeight = -std::numeric_limits<float>::max();
+
+                    for (int z = 0; z < tileSize; z++)
+                    {
+                        const int postZ = firstPost + z;
+                        const double row = SourceRow(postZ);
+                        for (int x = 0; x < tileSize; x++)
+                        {
+                            const int postX = tileX * tileCells + x;
+                            float height = std::numeric_limits<float>::quiet_NaN();
+                            if (postX < (int)info.postsX && postZ < (int)info.postsZ)
+                                height = SampleBand(SourceColumn(postX, postZ), row);
+
+                            if (std::isnan(height))
+                            {
+                                heights[(size_t)z * tileSize + x] = m_settings.noDataHeight;
+                                continue;
+                            }
+
+                            height = height * m_settings.heightScale + m_settings.heightOffset;
+                            heights[(size_t)z * tileSize + x] = height;
+                            minHeight = std::min(minHeight, height);
+                            maxHeight = std::max(maxHeight, height);
+                            hasData = true;
+                        }
+                    }
+
+                    groupHasData[i] = hasData;
+                    groupMin[i] = minHeight;
+                    groupMax[i] = maxHeight;
+                }
+            });
+
+            for (int i = 0; i < groupCount; i++)
+            {
+                TerrainDatabaseTile& entry = m_tiles[info.firstTile + (uint64_t)tileZ * info.tilesX + groupStart + i];
+                if (!groupHasData[i])
+                {
+                    entry.minHeight = entry.maxHeight = m_settings.noDataHeight;
+                    continue;
+                }
+
+                if (!WriteTile(group[i], entry))
+                    return false;
+                m_minHeight = std::min(m_minHeight, groupMin[i]);
+                m_maxHeight = std::max(m_maxHeight, groupMax[i]);
+            }
+        }
+    }
+
+    if (m_minHeight > m_maxHeight)
+        m_minHeight = m_maxHeight = m_settings.noDataHeight;
+
+    m_stats.workingSetBytes += group.size() * group[0].size() * sizeof(float);
+    return true;
+}
+
+int DemImporter::ChildPost(int tile, int post, uint32_t childPosts) const
+{
+    const int tileCells = m_settings.tileSize - 1;
+    const int childPost = 2 * post;
+
+    // The post one past the end of the child level repeats its last post.
+    if (2 * tile * tileCells + childPost == (int)childPosts)
+        return childPost - 1;
+    return childPost;
+}
+
+bool DemImporter::WriteCoarserLevel(int level)
+{
+    const TerrainDatabaseLevel& parent = m_levels[level];
+    const TerrainDatabaseLevel& child = m_levels[level - 1];
+    const int tileSize = m_settings.tileSize;
+    const int tileCells = tileSize - 1;
+    const size_t tileBytes = (size_t)tileSize * tileSize * sizeof(float);
+
+    std::vector<float> children[4];
+    bool childHasData[4];
+    std::vector<float> heights((size_t)tileSize * tileSize);
+
+    for (int tileZ = 0; tileZ < (int)parent.tilesZ; tileZ++)
+        for (int tileX = 0; tileX < (int)parent.tilesX; tileX++)
+        {
+            // A tile covers exactly the 2 x 2 child tiles below it, which are read back from the output file.
+            bool anyChild = false;
+            for (int i = 0; i < 4; i++)
+            {
+                const int childX = 2 * tileX + (i & 1);
+                const int childZ = 2 * tileZ + (i >> 1);
+                childHasData[i] = false;
+                if (childX >= (int)child.tilesX || childZ >= (int)child.tilesZ)
+                    continue;
+
+                const TerrainDatabaseTile& entry = m_tiles[child.firstTile + (uint64_t)childZ * child.tilesX + childX];
+                if (entry.offset == 0)
+                    continue;
+
+                children[i].resize((size_t)tileSize * tileSize);
+                if (!Seek64(m_output, entry.offset) || fread(children[i].data(), 1, tileBytes, m_output) != tileBytes)
+                {
+                    printf("%s:%d - read back of level %d failed\n", __FILE__, __LINE__, level - 1);
+                    return false;
+                }
+                childHasData[i] = true;
+                anyChild = true;
+            }
+
+            TerrainDatabaseTile& entry = m_tiles[parent.firstTile + (uint64_t)tileZ * parent.tilesX + tileX];
+            if (!anyChild)
+            {
+                entry.minHeight = entry.maxHeight = m_settings.noDataHeight;
+                continue;
+            }
+
+            for (int z = 0; z < tileSize; z++)
+            {
+                const int childPostZ = ChildPost(tileZ, z, child.postsZ);
+                const int childZ = std::min(childPostZ / tileCells, 1);
+                const int localZ = childPostZ - childZ * tileCells;
+                for (int x = 0; x < tileSize; x++)
+                {
+                    const int childPostX = ChildPost(tileX, x, child.postsX);
+                    const int childX = std::min(childPostX / tileCells, 1);
+                    const int localX = childPostX - childX * tileCells;
+                    const int i = childZ * 2 + childX;
+                    heights[(size_t)z * tileSize + x] = childHasData[i]
+                        ? children[i][(size_t)localZ * tileSize + localX] : m_settings.noDataHeight;
+                }
+            }
+
+            if (!WriteTile(heights, entry))
+                return false;
+        }
+
+    m_stats.workingSetBytes = std::max(m_stats.workingSetBytes, 5 * tileBytes);
+    return true;
+}
+
+bool DemImporter::WriteTile(const std::vector<float>& heights, TerrainDatabaseTile& entry)
+{
+    static const uint8_t padding[TERRAIN_DATABASE_ALIGNMENT] = {};
+    const uint64_t aligned = (m_writeOffset + TERRAIN_DATABASE_ALIGNMENT - 1) & ~(TERRAIN_DATABASE_ALIGNMENT - 1);
+    if (aligned != m_writeOffset && !Append(padding, (size_t)(aligned - m_writeOffset)))
+        return false;
+
+    // Bounds cover every stored post including no data fill, so they are safe for culling and collision.
+    auto range = std::minmax_element(heights.begin(), heights.end());
+    entry.offset = m_writeOffset;
+    entry.minHeight = *range.first;
+    entry.maxHeight = *range.second;
+
+    m_stats.tilesWritten++;
+    m_stats.postsWritten += heights.size();
+    return Append(heights.data(), heights.size() * sizeof(float));
+}
+
+bool DemImporter::WriteTables()
+{
+    TerrainDatabaseHeader header = {};
+    memcpy(header.magic, TERRAIN_DATABASE_MAGIC, sizeof(header.magic));
+    header.version = TERRAIN_DATABASE_VERSION;
+    header.tileSize = m_settings.tileSize;
+    header.levelCount = (uint32_t)m_levels.size();
+    header.postSpacing = (float)m_spacing;
+    header.minHeight = m_minHeight;
+    header.maxHeight = m_maxHeight;
+    header.noDataHeight = m_settings.noDataHeight;
+
+    header.levelTableOffset = m_writeOffset;
+    if (!Append(m_levels.data(), m_levels.size() * sizeof(TerrainDatabaseLevel)))
+        return false;
+
+    header.tileTableOffset = m_writeOffset;
+    if (!Append(m_tiles.data(), m_tiles.size() * sizeof(TerrainDatabaseTile)))
+        return false;
+
+    return Seek64(m_output, 0) && fwrite(&header, sizeof(header), 1, m_output) == 1;
+}
+
+bool DemImporter::Append(const void* data, size_t size)
+{
+    // Levels are read back while the file is written, so always seek to the end explicitly.
+    if (!Seek64(m_output, m_writeOffset) || fwrite(data, 1, size, m_output) != size)
+    {
+        printf("%s:%d - write error\n", __FILE__, __LINE__);
+        return false;
+    }
+    m_writeOffset += size;
+    return true;
+}
@@ -0,0 +1,164 @@
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "dem_reader.h"
+#include "file_io.h"
+
+DemReader::~DemReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+DemFormat DemReader::FormatFromFilename(const char* pFilename)
+{
+    std::string name(pFilename);
+    size_t dot = name.find_last_of('.');
+    std::string extension = (dot == std::string::npos) ? "" : name.substr(dot + 1);
+    for (char& c : extension)
+        c = (char)tolower((unsigned char)c);
+
+    if (extension == "pgm")
+        return DemFormat::Pgm;
+    if (extension == "hgt")
+        return DemFormat::Int16BE;
+    if (extension == "r16")
+        return DemFormat::UInt16LE;
+    return DemFormat::Float32;
+}
+
+bool DemReader::Open(const char* pFilename, DemFormat format, int width, int height)
+{
+    errno_t err = fopen_s(&m_file, pFilename, "rb");
+    if (err != 0 || !m_file)
+    {
+        printf("%s:%d - cannot open %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    m_format = format;
+    if (format == DemFormat::Pgm)
+        return ReadPgmHeader();
+
+    m_bytesPerSample = (format == DemFormat::Float32) ? 4 : 2;
+    m_dataOffset = 0;
+
+    uint64_t samples = FileSize64(m_file) / m_bytesPerSample;
+    if (width <= 0 || height <= 0)
+    {
+        // Square rasters need no dimensions, the same way BaseTerrain::LoadFromFile infers its size.
+        width = height = (int)std::llround(std::sqrt((double)samples));
+    }
+
+    if ((uint64_t)width * (uint64_t)height != samples)
+    {
+        printf("%s:%d - %s holds %llu samples, not %d x %d\n", __FILE__, __LINE__, pFilename,
+            (unsigned long long)samples, width, height);
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    return true;
+}
+
+bool DemReader::ReadPgmHeader()
+{
+    // P5 <whitespace> width <whitespace> height <whitespace> maxval <single whitespace> samples, with # comments.
+    auto readToken = [this](std::string& token) {
+        token.clear();
+        int c = fgetc(m_file);
+        while (c != EOF && (isspace(c) || c == '#'))
+        {
+            if (c == '#')
+                while (c != EOF && c != '\n')
+                    c = fgetc(m_file);
+            c = fgetc(m_file);
+        }
+        while (c != EOF && !isspace(c))
+        {
+            token.push_back((char)c);
+            c = fgetc(m_file);
+        }
+        return !token.empty();
+    };
+
+    std::string magic, width, height, maxValue;
+    if (!readToken(magic) || magic != "P5" || !readToken(width) || !readToken(height) || !readToken(maxValue))
+    {
+        printf("%s:%d - not a binary PGM file\n", __FILE__, __LINE__);
+        return false;
+    }
+
+    m_width = atoi(width.c_str());
+    m_height = atoi(height.c_str());
+    m_bytesPerSample = (atoi(maxValue.c_str()) < 256) ? 1 : 2;
+    m_dataOffset = (uint64_t)ftell(m_file);
+
+    uint64_t expectedSize = m_dataOffset + (uint64_t)m_width * m_height * m_bytesPerSample;
+    if (m_width <= 0 || m_height <= 0 || FileSize64(m_file) < expectedSize)
+    {
+        printf("%s:%d - truncated PGM file\n", __FILE__, __LINE__);
+        return false;
+    }
+    return true;
+}
+
+bool DemReader::ReadRows(int firstRow, int rowCount, float* dst)
+{
+    const size_t sampleCount = (size_t)rowCount * m_width;
+    m_rowBytes.resize(sampleCount * m_bytesPerSample);
+
+    if (!Seek64(m_file, m_dataOffset + (uint64_t)firstRow * m_width * m_bytesPerSample) ||
+        fread(m_rowBytes.data(), 1, m_rowBytes.size(), m_file) != m_rowBytes.size())
+    {
+        printf("%s:%d - read error at row %d\n", __FILE__, __LINE__, firstRow);
+        return false;
+    }
+    m_bytesRead += m_rowBytes.size();
+
+    const uint8_t* p = m_rowBytes.data();
+    const float noData = std::numeric_limits<float>::quiet_NaN();
+
+    switch (m_format)
+    {
+    case DemFormat::Float32:
+        memcpy(dst, p, sampleCount * sizeof(float));
+        for (size_t i = 0; i < sampleCount; i++)
+            if (!(dst[i] > -1.0e30f))
+                dst[i] = noData;
+        break;
+    case DemFormat::Int16LE:
+    case DemFormat::Int16BE:
+        for (size_t i = 0; i < sampleCount; i++)
+        {
+            uint16_t bits = (m_format == DemFormat::Int16LE) ? (uint16_t)(p[2 * i] | (p[2 * i + 1] << 8))
+                                                             : (uint16_t)((p[2 * i] << 8) | p[2 * i + 1]);
+            int16_t value = (int16_t)bits;
+            dst[i] = (value == -32768) ? noData : (float)value;
+        }
+        break;
+    case DemFormat::UInt16LE:
+        for (size_t i = 0; i < sampleCount; i++)
+            dst[i] = (float)(p[2 * i] | (p[2 * i + 1] << 8));
+        break;
+    case DemFormat::UInt16BE:
+        for (size_t i = 0; i < sampleCount; i++)
+            dst[i] = (float)((p[2 * i] << 8) | p[2 * i + 1]);
+        break;
+    case DemFormat::Pgm:
+        // 16 bit PGM samples are big endian.
+        if (m_bytesPerSample == 1)
+            for (size_t i = 0; i < sampleCount; i++)
+                dst[i] = (float)p[i];
+        else
+            for (size_t i = 0; i < sampleCount; i++)
+                dst[i] = (float)((p[2 * i] << 8) | p[2 * i + 1]);
+        break;
+    }
+
+    return true;
+}
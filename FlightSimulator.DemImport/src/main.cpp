@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "dem_reader.h"
+#include "dem_importer.h"
+#include "terrain_database.h"
+#include "process_memory.h"
+
+static void PrintUsage()
+{
+    printf("Usage: FlightSimulator.DemImport <input> <output.tdb> [options]\n"
+        "\n"
+        "Converts a DEM raster into a tiled LOD terrain database for the simulator.\n"
+        "\n"
+        "Options:\n"
+        "  --format f32|s16le|s16be|u16le|u16be|pgm   Sample encoding (default from extension: .pgm, .hgt = s16be,\n"
+        "                                             .r16 = u16le, otherwise f32)\n"
+        "  --size <width> <height>                    Dimensions of a raw raster (default: square)\n"
+        "  --pixel-size <metres>                      Sample spacing of a metric raster (default 30)\n"
+        "  --geographic <west> <north> <dx> <dy>      Raster is a latitude/longitude grid in degrees, starting at the\n"
+        "                                             north west sample; it is reprojected to metres\n"
+        "  --spacing <metres>                         Post spacing of the finest level (default: source resolution)\n"
+        "  --tile-size <posts>                        Posts per tile side, 2^n + 1 (default 257)\n"
+        "  --height-scale <s> --height-offset <o>     Height = sample * s + o\n"
+        "  --nodata <height>                          Height written where the raster has no data (default 0)\n");
+}
+
+static bool ParseFormat(const char* name, DemFormat& format)
+{
+    static const struct { const char* name; DemFormat format; } formats[] = {
+        { "f32", DemFormat::Float32 }, { "s16le", DemFormat::Int16LE }, { "s16be", DemFormat::Int16BE },
+        { "u16le", DemFormat::UInt16LE }, { "u16be", DemFormat::UInt16BE }, { "pgm", DemFormat::Pgm }
+    };
+
+    for (const auto& entry : formats)
+    {
+        if (strcmp(name, entry.name) == 0)
+        {
+            format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* inputPath = argv[1];
+    const char* outputPath = argv[2];
+    DemFormat format = DemReader::FormatFromFilename(inputPath);
+    int width = 0;
+    int height = 0;
+    DemImportSettings settings;
+
+    for (int i = 3; i < argc; i++)
+    {
+        auto hasArgs = [&](int count) { return i + count < argc; };
+
+        if (strcmp(argv[i], "--format") == 0 && hasArgs(1) && ParseFormat(argv[i + 1], format))
+            i += 1;
+        else if (strcmp(argv[i], "--size") == 0 && hasArgs(2))
+        {
+            width = atoi(argv[i + 1]);
+            height = atoi(argv[i + 2]);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--pixel-size") == 0 && hasArgs(1))
+            settings.pixelSize = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--geographic") == 0 && hasArgs(4))
+        {
+            settings.geographic = true;
+            settings.west = atof(argv[i + 1]);
+            settings.north = atof(argv[i + 2]);
+            settings.degreesPerPixelX = atof(argv[i + 3]);
+            settings.degreesPerPixelY = atof(argv[i + 4]);
+            i += 4;
+        }
+        else if (strcmp(argv[i], "--spacing") == 0 && hasArgs(1))
+            settings.outputSpacing = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--tile-size") == 0 && hasArgs(1))
+            settings.tileSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height-scale") == 0 && hasArgs(1))
+            settings.heightScale = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--height-offset") == 0 && hasArgs(1))
+            settings.heightOffset = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--nodata") == 0 && hasArgs(1))
+            settings.noDataHeight = (float)atof(argv[++i]);
+        else
+        {
+            printf("Unknown or incomplete option %s\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Power of two tiles keep every post of a coarser level on a post of the finer one.
+    const int tileCells = settings.tileSize - 1;
+    if (tileCells < 2 || (tileCells & (tileCells - 1)) != 0)
+    {
+        printf("Tile size must be 2^n + 1, got %d\n", settings.tileSize);
+        return 1;
+    }
+
+    if (settings.geographic && (settings.degreesPerPixelX <= 0.0 || settings.degreesPerPixelY <= 0.0))
+    {
+        printf("Geographic pixel sizes must be positive\n");
+        return 1;
+    }
+
+    DemReader reader;
+    if (!reader.Open(inputPath, format, width, height))
+        return 1;
+
+    printf("Importing %s: %d x %d samples\n", inputPath, reader.GetWidth(), reader.GetHeight());
+
+    DemImporter importer(reader, settings);
+    if (!importer.Run(outputPath))
+        return 1;
+
+    // Report throughput and memory, then check the result opens the way the simulator will open it.
+    const DemImportStats& stats = importer.GetStats();
+    const double megabyte = 1024.0 * 1024.0;
+    printf("Wrote %s: %d levels, %llu tiles, %.1f MB\n", outputPath, stats.levelCount,
+        (unsigned long long)stats.tilesWritten, stats.bytesWritten / megabyte);
+    printf("Time %.2f s, input %.1f MB/s, output %.2f Mposts/s\n", stats.seconds,
+        stats.bytesRead / megabyte / stats.seconds, stats.postsWritten / 1.0e6 / stats.seconds);
+    printf("Working buffers %.1f MB, peak RSS %.1f MB\n", stats.workingSetBytes / megabyte,
+        GetPeakResidentBytes() / megabyte);
+
+    TerrainDatabase database;
+    if (!database.Open(outputPath))
+    {
+        printf("Verification failed: %s is not a valid terrain database\n", outputPath);
+        return 1;
+    }
+
+    const TerrainDatabaseHeader& header = database.GetHeader();
+    printf("Heights %.1f .. %.1f m\n", header.minHeight, header.maxHeight);
+    for (int level = 0; level < database.GetLevelCount(); level++)
+    {
+        const TerrainDatabaseLevel& info = database.GetLevel(level);
+        printf("  level %d: %u x %u posts, %u x %u tiles, %.1f m spacing\n", level, info.postsX, info.postsZ,
+            info.tilesX, info.tilesZ, info.postSpacing);
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef ENVELOPE_SWEEP_H
+#define ENVELOPE_SWEEP_H
+
+#include <cstdint>
+#include <vector>
+
+#include "airfoil.h"
+
+// Evenly spaced values from first to last.
+struct SweepAxis {
+    float first;
+    float last;
+    int count;
+
+    float Get(int i) const { return count > 1 ? first + (last - first) * i / (count - 1) : first; }
+};
+
+// Settings of a sweep, every combination of the axes is one point.
+struct EnvelopeSettings {
+    SweepAxis airspeed{ 20.0f, 100.0f, 81 }; // True airspeed, m/s.
+    SweepAxis altitude{ 0.0f, 6000.0f, 25 }; // m.
+    SweepAxis mass{ 800.0f, 1300.0f, 11 }; // kg.
+    SweepAxis centerOfGravity{ -0.3f, 0.3f, 5 }; // Shift of the center of gravity aft of the design one, m.
+    float tolerance = 1.0e-4f; // Largest residual force and pitching moment of a trim, as a share of the weight.
+    int maxIterations = 30;
+    int threads = 0; // Worker threads, 0 for one per hardware thread.
+};
+
+// How the solve of a point ended.
+enum class TrimStatus : uint8_t {
+    Converged = 0,
+    Unconverged = 1, // The solve ran out of iterations or its Jacobian went singular.
+    BelowStall = 2, // Slower than a point the wings already stalled at, left unsolved.
+};
+
+// Steady level flight of the airplane at one point of the sweep. The trim values are NaN for points below the stall.
+struct TrimPoint {
+    float airspeed;
+    float altitude;
+    float mass;
+    float centerOfGravity;
+    TrimStatus status;
+    bool trimmed; // Converged with the elevator and throttle in their range and the wing below its stall.
+    float alpha; // Angle of attack of the fuselage, the pitch in level flight, degrees.
+    float elevator; // Joystick elevator, -1..1 when trimmed.
+    float throttle; // 0..1 when trimmed.
+    float climbRate; // At full throttle from the trimmed attitude, m/s. Negative where level flight needs more thrust.
+    float stallSpeed; // Least speed the wings carry the weight at, m/s true airspeed.
+    float stallMargin; // Airspeed over the stall speed.
+    float alphaMargin; // Degrees left to the stall angle of the wing airfoil.
+    int iterations;
+};
+
+// Results of a sweep.
+struct EnvelopeStats {
+    double wallSeconds = 0.0;
+    uint64_t evaluations = 0; // Force evaluations of the airplane over all points.
+    uint64_t jacobians = 0; // Jacobians built and inverted over all points.
+    int trimmed = 0;
+    int unconverged = 0;
+    int belowStall = 0;
+    int threads = 0;
+};
+
+// EnvelopeSweep trims the airplane of the simulator for level flight at every combination of airspeed, altitude,
+// mass and center of gravity, to find where it flies and with what margins.
+//
+// Each point is a Newton solve of the pitch, elevator and throttle that zero the force along and across the flight
+// path and the pitching moment, with the forces coming from the Airplane itself. Points along the airspeed axis
+// change the least from one to the next, so a row of them at one altitude, mass and center of gravity is solved in
+// order: every point starts from the trim of the one before and keeps its inverted Jacobian for as long as the
+// Newton steps converge with it, building a new one only when they stall. Rows are independent jobs that threads
+// which finish early steal.
+class EnvelopeSweep
+{
+public:
+    // Airfoils of the simulator's airplane, from the polars in data.h.
+    EnvelopeSweep();
+
+    // Trims every point of the sweep in parallel.
+    void Run(const EnvelopeSettings& settings);
+
+    const std::vector<TrimPoint>& GetPoints() const { return m_points; }
+    const EnvelopeStats& GetStats() const { return m_stats; }
+
+    // @return: False if the file could not be written.
+    bool WriteCsv(const char* pFilename) const;
+
+private:
+    physics::Airfoil m_wingAirfoil;
+    physics::Airfoil m_tailAirfoil;
+    float m_wingStallAlpha; // Angle of attack of the highest lift of the wing polar, degrees.
+    EnvelopeSettings m_settings;
+    std::vector<TrimPoint> m_points;
+    std::vector<uint64_t> m_rowEvaluations;
+    std::vector<uint64_t> m_rowJacobians;
+    EnvelopeStats m_stats;
+
+    // Trims the points of the rows [first, last), each row along the airspeed axis.
+    void TrimRows(int first, int last);
+};
+
+#endif // ENVELOPE_SWEEP_H
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "envelope_sweep.h"
+#include "airplane.h"
+#include "data.h"
+#include "job_system.h"
+
+// Pitching moment that counts as much as a force of the weight, the chord of the main wings, m.
+static const float MOMENT_ARM = 1.5f;
+
+// Steps of the unknowns the Jacobian is taken over: pitch (rad), elevator and throttle.
+static const glm::vec3 JACOBIAN_STEP(0.003f, 0.01f, 0.01f);
+
+// Largest change of the unknowns in one Newton step, so a step never leaves the range where the forces are smooth.
+static const glm::vec3 MAX_STEP(0.09f, 0.5f, 0.5f);
+
+// Range the pitch is kept in, rad. Past it the wings are deep in stall and no trim is of use.
+static const float MIN_ALPHA = -0.35f;
+static const float MAX_ALPHA = 0.6f;
+
+// A kept Jacobian is rebuilt once a step with it shrinks the residual by less than this.
+static const float CONTRACTION = 0.25f;
+
+// Times a step with a fresh Jacobian is halved while it fails to shrink the residual.
+static const int MAX_HALVINGS = 4;
+
+// Where every row starts: a few degrees of pitch, elevator centred and half throttle.
+static const glm::vec3 INITIAL_TRIM(0.07f, 0.0f, 0.5f);
+
+// The airplane at one altitude, mass and center of gravity, and the forces on it in level flight.
+struct TrimModel {
+    physics::Airplane airplane;
+    float weight;
+    uint64_t evaluations = 0;
+
+    TrimModel(const physics::Airfoil* wingAirfoil, const physics::Airfoil* tailAirfoil, float altitude, float mass,
+        float centerOfGravity)
+        : airplane(wingAirfoil, tailAirfoil), weight(mass * physics::EARTH_GRAVITY)
+    {
+        // Surfaces are placed relative to the center of gravity, so moving it aft brings them forward
+        for (physics::Wing& wing : airplane.wings)
+            wing.position.z -= centerOfGravity;
+
+        const physics::inertia::MassProperties& properties = physics::inertia::mass_properties<physics::TrainerAirframe>;
+        const float scale = mass / properties.mass;
+        airplane.set_mass_properties(mass, properties.get_tensor() * scale, properties.get_inverse_tensor() * (1.0f / scale));
+        airplane.position = glm::vec3(0.0f, altitude, 0.0f);
+    }
+
+    // Residuals of a trim at an airspeed: force along and across the flight path and pitching moment, as a share of
+    // the weight. The trim is (pitch, joystick elevator, throttle), taken unclamped so the solve sees how far out
+    // of range a point needs its controls.
+    glm::vec3 Evaluate(const glm::vec3& trim)
+    {
+        airplane.orientation = glm::angleAxis(trim.x, physics::X_AXIS);
+        airplane.wings[2].control_input = -trim.y; // as Airplane::set_controls maps the elevator
+        airplane.engine.throttle = trim.z;
+
+        airplane.clear_forces();
+        airplane.apply_forces();
+        evaluations++;
+
+        const glm::vec3& force = airplane.get_force();
+        return glm::vec3(-force.z, force.y - weight, airplane.get_torque().x / MOMENT_ARM) / weight;
+    }
+};
+
+static float GetNorm(const glm::vec3& residual)
+{
+    return std::max(std::max(std::fabs(residual.x), std::fabs(residual.y)), std::fabs(residual.z));
+}
+
+// Scales a Newton step down to the largest change allowed, keeping its direction.
+static glm::vec3 LimitStep(const glm::vec3& step)
+{
+    const glm::vec3 ratio = glm::abs(step) / MAX_STEP;
+    const float largest = std::max(std::max(ratio.x, ratio.y), ratio.z);
+    return largest > 1.0f ? step / largest : step;
+}
+
+// Angle of attack of the highest lift coefficient of a polar, degrees.
+static float GetStallAlpha(const std::vector<glm::vec3>& polar)
+{
+    return std::max_element(polar.begin(), polar.end(),
+        [](const glm::vec3& a, const glm::vec3& b) { return a.y < b.y; })->x;
+}
+
+EnvelopeSweep::EnvelopeSweep()
+    : m_wingAirfoil(NACA_2412_data), m_tailAirfoil(NACA_0012_data), m_wingStallAlpha(GetStallAlpha(NACA_2412_data))
+{
+}
+
+void EnvelopeSweep::Run(const EnvelopeSettings& settings)
+{
+    m_settings = settings;
+    const int speeds = std::max(settings.airspeed.count, 0);
+    const int rows = std::max(settings.altitude.count, 0) * std::max(settings.mass.count, 0) *
+        std::max(settings.centerOfGravity.count, 0);
+    m_points.resize((size_t)rows * speeds);
+    m_rowEvaluations.assign(rows, 0);
+    m_rowJacobians.assign(rows, 0);
+
+    JobSystem jobs(settings.threads);
+
+    // Rows take about the same time, a few per job keep the stealing cheap while leaving enough jobs to balance
+    const int rowsPerJob = std::max(rows / (jobs.GetThreadCount() * 16), 1);
+    auto start = std::chrono::steady_clock::now();
+    jobs.Wait(jobs.ParallelFor(0, rows, rowsPerJob, [this](int first, int last) { TrimRows(first, last); }));
+    auto end = std::chrono::steady_clock::now();
+
+    m_stats = EnvelopeStats();
+    m_stats.wallSeconds = std::chrono::duration<double>(end - start).count();
+    m_stats.threads = jobs.GetThreadCount();
+    for (int row = 0; row < rows; row++)
+    {
+        m_stats.evaluations += m_rowEvaluations[row];
+        m_stats.jacobians += m_rowJacobians[row];
+    }
+    for (const TrimPoint& point : m_points)
+    {
+        m_stats.trimmed += point.trimmed;
+        m_stats.unconverged += point.status == TrimStatus::Unconverged;
+        m_stats.belowStall += point.status == TrimStatus::BelowStall;
+    }
+}
+
+void EnvelopeSweep::TrimRows(int first, int last)
+{
+    const EnvelopeSettings& settings = m_settings;
+    const int speeds = settings.airspeed.count;
+    const int altitudes = settings.altitude.count;
+    const int masses = settings.mass.count;
+
+    for (int row = first; row < last; row++)
+    {
+        const float altitude = settings.altitude.Get(row % altitudes);
+        const float mass = settings.mass.Get(row / altitudes % masses);
+        const float centerOfGravity = settings.centerOfGravity.Get(row / (altitudes * masses));
+        TrimModel model(&m_wingAirfoil, &m_tailAirfoil, altitude, mass, centerOfGravity);
+
+        // The wings alone carry the weight at their highest lift coefficient at the stall speed
+        const float airDensity = isa::get_air_density(altitude);
+        const float wingArea = model.airplane.wings[0].area + model.airplane.wings[1].area;
+        const float stallSpeed = std::sqrt(2.0f * model.weight / (airDensity * wingArea * m_wingAirfoil.cl_max));
+
+        glm::vec3 trim = INITIAL_TRIM;
+        glm::mat3 inverseJacobian(1.0f);
+        bool haveJacobian = false;
+        uint64_t jacobians = 0;
+
+        // From the fast end of the row, where the trim is easy, down towards the stall. Once the wings stall without
+        // carrying the weight the slower points need even more lift, so they are left unconverged without a solve.
+        const bool slowing = settings.airspeed.last > settings.airspeed.first;
+        bool stalled = false;
+        for (int i = 0; i < speeds; i++)
+        {
+            const int s = slowing ? speeds - 1 - i : i;
+            const float airspeed = settings.airspeed.Get(s);
+            model.airplane.velocity = airspeed * physics::FORWARD;
+
+            glm::vec3 residual(1.0f);
+            float norm = stalled ? 1.0f : GetNorm(residual = model.Evaluate(trim));
+            int iteration = 0;
+            for (; !stalled && iteration < settings.maxIterations && norm > settings.tolerance; iteration++)
+            {
+                // The Jacobian of the previous point or iteration is reused until it stops converging
+                const bool fresh = !haveJacobian;
+                if (fresh)
+                {
+                    glm::mat3 jacobian;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        glm::vec3 probe = trim;
+                        probe[axis] += JACOBIAN_STEP[axis];
+                        jacobian[axis] = (model.Evaluate(probe) - residual) / JACOBIAN_STEP[axis];
+                    }
+                    if (std::fabs(glm::determinant(jacobian)) <= physics::EPSILON)
+                        break;
+                    inverseJacobian = glm::inverse(jacobian);
+                    haveJacobian = true;
+                    jacobians++;
+                }
+
+                glm::vec3 step = LimitStep(-(inverseJacobian * residual));
+                glm::vec3 next, nextResidual;
+                float nextNorm;
+                for (int halving = 0;; halving++)
+                {
+                    next = trim + step;
+                    next.x = glm::clamp(next.x, MIN_ALPHA, MAX_ALPHA);
+                    nextResidual = model.Evaluate(next);
+                    nextNorm = GetNorm(nextResidual);
+                    if (nextNorm < norm || !fresh || halving == MAX_HALVINGS)
+                        break;
+                    step *= 0.5f;
+                }
+
+                if (nextNorm > CONTRACTION * norm)
+                    haveJacobian = false;
+
+                // A kept Jacobian that made things worse is dropped without taking its step
+                if (nextNorm < norm || fresh)
+                {
+                    trim = next;
+                    residual = nextResidual;
+                    norm = nextNorm;
+                }
+            }
+
+            TrimPoint& point = m_points[(size_t)row * speeds + s];
+            point.airspeed = airspeed;
+            point.altitude = altitude;
+            point.mass = mass;
+            point.centerOfGravity = centerOfGravity;
+            point.stallSpeed = stallSpeed;
+            point.stallMargin = airspeed / stallSpeed;
+            point.iterations = iteration;
+
+            // Points below the stall keep no trim, the last one solved is not theirs
+            if (stalled)
+            {
+                const float none = std::numeric_limits<float>::quiet_NaN();
+                point.status = TrimStatus::BelowStall;
+                point.alpha = point.elevator = point.throttle = point.climbRate = point.alphaMargin = none;
+                point.trimmed = false;
+                continue;
+            }
+
+            point.status = norm <= settings.tolerance ? TrimStatus::Converged : TrimStatus::Unconverged;
+            point.alpha = glm::degrees(trim.x);
+            point.elevator = trim.y;
+            point.throttle = trim.z;
+            point.climbRate = (1.0f - trim.z) * model.airplane.engine.max_thrust * airspeed / model.weight;
+            point.alphaMargin = m_wingStallAlpha - point.alpha;
+            point.trimmed = point.status == TrimStatus::Converged && point.throttle >= 0.0f && point.throttle <= 1.0f &&
+                std::fabs(point.elevator) <= 1.0f && point.alphaMargin > 0.0f;
+
+            // A point the solve lost is no start for the next one
+            if (point.status == TrimStatus::Unconverged)
+            {
+                stalled = slowing && point.alphaMargin <= 0.0f;
+                if (!stalled)
+                {
+                    trim = INITIAL_TRIM;
+                    haveJacobian = false;
+                }
+            }
+        }
+
+        m_rowEvaluations[row] = model.evaluations;
+        m_rowJacobians[row] = jacobians;
+    }
+}
+
+bool EnvelopeSweep::WriteCsv(const char* pFilename) const
+{
+    FILE* file = fopen(pFilename, "w");
+    if (!file)
+    {
+        printf("%s:%d - cannot write %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    // Points below the stall leave their trim columns empty
+    static const char* const statusNames[] = { "converged", "no_convergence", "below_stall" };
+    fprintf(file, "airspeed,altitude,mass,cg,status,trimmed,alpha,elevator,throttle,climb_rate,stall_speed,"
+        "stall_margin,alpha_margin,iterations\n");
+    for (const TrimPoint& p : m_points)
+    {
+        fprintf(file, "%.2f,%.1f,%.1f,%.3f,%s,%d,", p.airspeed, p.altitude, p.mass, p.centerOfGravity,
+            statusNames[(int)p.status], p.trimmed);
+        if (p.status == TrimStatus::BelowStall)
+            fprintf(file, ",,,,%.2f,%.3f,,%d\n", p.stallSpeed, p.stallMargin, p.iterations);
+        else
+            fprintf(file, "%.3f,%.4f,%.4f,%.3f,%.2f,%.3f,%.3f,%d\n", p.alpha, p.elevator, p.throttle, p.climbRate,
+                p.stallSpeed, p.stallMargin, p.alphaMargin, p.iterations);
+    }
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    if (!ok)
+        printf("%s:%d - error writing %s\n", __FILE__, __LINE__, pFilename);
+    return ok;
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "envelope_sweep.h"
+
+static void PrintUsage()
+{
+    printf("Usage: FlightSimulator.Envelope [options]\n"
+        "\n"
+        "Trims the simulator's airplane for level flight over a sweep of airspeed, altitude, mass and center of\n"
+        "gravity, and reports where it flies with its trim, climb rate and stall margins.\n"
+        "\n"
+        "Options:\n"
+        "  --airspeed <first> <last> <n>  True airspeeds in m/s (default 20 100 81)\n"
+        "  --altitude <first> <last> <n>  Altitudes in metres (default 0 6000 25)\n"
+        "  --mass <first> <last> <n>      Masses in kg (default 800 1300 11)\n"
+        "  --cg <first> <last> <n>        Center of gravity shifts aft in metres (default -0.3 0.3 5)\n"
+        "  --tolerance <t>                Largest residual force of a trim as a share of the weight (default 1e-4)\n"
+        "  --iterations <n>               Newton iterations per point before giving up (default 30)\n"
+        "  --threads <n>                  Worker threads (default: one per hardware thread)\n"
+        "  --output <path>                Write every point as CSV\n");
+}
+
+static bool ParseAxis(char** argv, int& i, SweepAxis& axis)
+{
+    axis.first = (float)atof(argv[i + 1]);
+    axis.last = (float)atof(argv[i + 2]);
+    axis.count = atoi(argv[i + 3]);
+    i += 3;
+    return axis.count > 0;
+}
+
+int main(int argc, char** argv)
+{
+    EnvelopeSettings settings;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto hasArgs = [&](int count) { return i + count < argc; };
+
+        bool ok = true;
+        if (strcmp(argv[i], "--airspeed") == 0 && hasArgs(3))
+            ok = ParseAxis(argv, i, settings.airspeed);
+        else if (strcmp(argv[i], "--altitude") == 0 && hasArgs(3))
+            ok = ParseAxis(argv, i, settings.altitude);
+        else if (strcmp(argv[i], "--mass") == 0 && hasArgs(3))
+            ok = ParseAxis(argv, i, settings.mass);
+        else if (strcmp(argv[i], "--cg") == 0 && hasArgs(3))
+            ok = ParseAxis(argv, i, settings.centerOfGravity);
+        else if (strcmp(argv[i], "--tolerance") == 0 && hasArgs(1))
+            settings.tolerance = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--iterations") == 0 && hasArgs(1))
+            settings.maxIterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasArgs(1))
+            settings.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && hasArgs(1))
+            outputPath = argv[++i];
+        else
+        {
+            printf("Unknown or incomplete option %s\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+
+        if (!ok)
+        {
+            printf("Sweep of %s needs at least one value\n\n", argv[i - 3]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!(settings.tolerance > 0.0f) || settings.maxIterations <= 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t pointCount = (size_t)settings.airspeed.count * settings.altitude.count * settings.mass.count *
+        settings.centerOfGravity.count;
+    printf("Trimming %zu points: %d airspeeds, %d altitudes, %d masses, %d centers of gravity\n", pointCount,
+        settings.airspeed.count, settings.altitude.count, settings.mass.count, settings.centerOfGravity.count);
+
+    EnvelopeSweep sweep;
+    sweep.Run(settings);
+
+    const EnvelopeStats& stats = sweep.GetStats();
+    printf("Wall time %.3f s on %d threads, %.0f points/s\n", stats.wallSeconds, stats.threads,
+        pointCount / stats.wallSeconds);
+    printf("%.2f force evaluations and %.3f Jacobians per point\n", (double)stats.evaluations / pointCount,
+        (double)stats.jacobians / pointCount);
+    printf("%d points trimmed, %d out of control or stall range, %d did not converge, %d below the stall left "
+        "unsolved\n", stats.trimmed, (int)pointCount - stats.trimmed - stats.unconverged - stats.belowStall,
+        stats.unconverged, stats.belowStall);
+
+    // The speed range and best climb of each mass at the first altitude and center of gravity as a quick check
+    const std::vector<TrimPoint>& points = sweep.GetPoints();
+    const int speeds = settings.airspeed.count;
+    for (int m = 0; m < settings.mass.count; m++)
+    {
+        const TrimPoint* row = points.data() + (size_t)m * settings.altitude.count * speeds;
+        float minSpeed = 0.0f, maxSpeed = 0.0f, bestClimb = 0.0f, bestClimbSpeed = 0.0f;
+        for (int s = 0; s < speeds; s++)
+        {
+            if (!row[s].trimmed)
+                continue;
+            if (minSpeed == 0.0f)
+                minSpeed = row[s].airspeed;
+            maxSpeed = row[s].airspeed;
+            if (row[s].climbRate > bestClimb)
+            {
+                bestClimb = row[s].climbRate;
+                bestClimbSpeed = row[s].airspeed;
+            }
+        }
+        printf("  %.0f kg at %.0f m: level flight from %.1f to %.1f m/s, stall %.1f m/s, best climb %.1f m/s at "
+            "%.1f m/s\n", row[0].mass, row[0].altitude, minSpeed, maxSpeed, row[0].stallSpeed, bestClimb,
+            bestClimbSpeed);
+    }
+
+    if (outputPath)
+    {
+        if (!sweep.WriteCsv(outputPath))
+            return 1;
+        printf("Wrote %zu points to %s\n", pointCount, outputPath);
+    }
+
+    return 0;
+}
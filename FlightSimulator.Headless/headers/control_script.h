@@ -0,0 +1,59 @@
+#ifndef CONTROL_SCRIPT_H
+#define CONTROL_SCRIPT_H
+
+#include <string>
+#include <vector>
+
+#include "joystick.h"
+
+// One point of a control script: the stick, pedal and throttle positions at a time.
+struct ControlKeyframe {
+    float time; // Seconds from the start of the run.
+    float aileron; // -1 full left .. 1 full right, split into Joystick::leftAileron and rightAileron.
+    float elevator; // -1 .. 1, positive pitches up.
+    float rudder; // -1 .. 1, positive yaws right.
+    float throttle; // 0 .. 1.
+};
+
+// ControlScript scripts the pilot inputs of a headless run as keyframes that are linearly interpolated. After the
+// last keyframe the script either holds it or loops back to the start.
+class ControlScript
+{
+public:
+    // Default constructor, an empty script holds neutral controls at cruise throttle.
+    ControlScript() = default;
+
+    // Loads a script from a text file with one keyframe per line: time aileron elevator rudder throttle.
+    // Empty lines and lines starting with # are skipped, times must increase.
+    // @param pFilename: Path of the script.
+    // @return: False if the file cannot be read or a line is malformed.
+    bool Load(const char* pFilename);
+
+    // Loads one of the built-in scripts.
+    // @param name: level, climb, turns, rolls or doublets.
+    // @return: False if there is no built-in script of that name.
+    bool LoadBuiltIn(const std::string& name);
+
+    // Gets the names of the built-in scripts, separated by commas.
+    static const char* GetBuiltInNames() { return "level, climb, turns, rolls, doublets"; }
+
+    // Adds a keyframe after the existing ones.
+    void AddKeyframe(const ControlKeyframe& keyframe) { m_keyframes.push_back(keyframe); }
+
+    // Sets whether the script starts over after its last keyframe.
+    void SetLooping(bool looping) { m_looping = looping; }
+
+    // Gets the interpolated controls at a time.
+    // @param time: Seconds from the start of the run.
+    // @return: Joystick state to hand to Airplane::set_controls.
+    Joystick Sample(float time) const;
+
+    // Gets the time of the last keyframe.
+    float GetDuration() const { return m_keyframes.empty() ? 0.0f : m_keyframes.back().time; }
+
+private:
+    std::vector<ControlKeyframe> m_keyframes;
+    bool m_looping = false;
+};
+
+#endif // CONTROL_SCRIPT_H
@@ -0,0 +1,91 @@
+#ifndef HEADLESS_SIMULATION_H
+#define HEADLESS_SIMULATION_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "airplane.h"
+#include "control_script.h"
+#include "height_field.h"
+
+// Settings of a headless run.
+struct HeadlessSettings {
+    int aircraftCount = 1;
+    float duration = 60.0f; // Simulated seconds.
+    float step = 1.0f / 240.0f; // Fixed physics step, the rate of the interactive simulator.
+    physics::Integrator integrator = physics::Integrator::semi_implicit_euler;
+    float startAltitude = 1500.0f; // Metres above the ground under each aircraft.
+    float startSpeed = 55.0f; // m/s.
+    float spacing = 200.0f; // Distance between aircraft on the start grid.
+    float scriptOffset = 0.0f; // Seconds every further aircraft is ahead in the script, so they do not fly in lockstep.
+    float sampleInterval = 0.0f; // Seconds between trajectory samples, 0 to record none.
+    int threads = 0; // Worker threads, 0 for one per hardware thread.
+    unsigned int seed = 1; // Seed of the start heading and speed variation.
+    float variation = 0.0f; // Random variation of start heading (radians) and speed (fraction), 0 for none.
+};
+
+// One recorded state of an aircraft.
+struct TrajectorySample {
+    float time;
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 velocity;
+    Joystick controls;
+};
+
+// Results of a headless run.
+struct HeadlessStats {
+    double wallSeconds = 0.0;
+    double simulatedSeconds = 0.0; // Per aircraft.
+    uint64_t steps = 0; // Physics steps over all aircraft.
+    uint64_t groundContacts = 0; // Steps that ended with an aircraft pushed back above the ground.
+    int threads = 0;
+};
+
+// HeadlessSimulation flies a fleet of airplanes through a control script as fast as the machine allows, without a
+// window or GL context. Aircraft are independent, so each one is a job stepped from start to end and no
+// synchronization happens per step.
+class HeadlessSimulation
+{
+public:
+    // @param settings: Fleet size, duration and recording options.
+    // @param script: Control inputs of every aircraft, must outlive the simulation.
+    // @param ground: Terrain the aircraft are kept above, must outlive the simulation. May be empty for flat ground.
+    HeadlessSimulation(const HeadlessSettings& settings, const ControlScript& script, const HeightField& ground);
+
+    // Places the fleet on the start grid and flies it for the configured duration.
+    void Run();
+
+    // Gets the timing of the last run.
+    const HeadlessStats& GetStats() const { return m_stats; }
+
+    // Gets the aircraft after the run.
+    const std::vector<std::unique_ptr<physics::Airplane>>& GetAircraft() const { return m_aircraft; }
+
+    // Gets the recorded trajectory of an aircraft.
+    const std::vector<TrajectorySample>& GetTrajectory(int aircraft) const { return m_trajectories[aircraft]; }
+
+    // Writes all trajectories as CSV, one row per aircraft and sample.
+    // @param pFilename: Path of the CSV file.
+    // @return: False if the file cannot be written.
+    bool WriteTrajectories(const char* pFilename) const;
+
+private:
+    HeadlessSettings m_settings;
+    const ControlScript& m_script;
+    const HeightField& m_ground;
+
+    physics::Airfoil m_wingAirfoil;
+    physics::Airfoil m_tailAirfoil;
+    std::vector<std::unique_ptr<physics::Airplane>> m_aircraft;
+    std::vector<std::vector<TrajectorySample>> m_trajectories;
+    std::vector<uint64_t> m_groundContacts;
+    HeadlessStats m_stats;
+
+    void PlaceAircraft();
+    void FlyAircraft(int first, int last);
+    void Record(int aircraft, float time, const Joystick& controls);
+};
+
+#endif // HEADLESS_SIMULATION_H
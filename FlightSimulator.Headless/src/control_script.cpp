@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "control_script.h"
+
+// Reads keyframes from a text file
+bool ControlScript::Load(const char* pFilename)
+{
+    std::ifstream file(pFilename);
+    if (!file)
+    {
+        printf("%s:%d - cannot open %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    std::vector<ControlKeyframe> keyframes;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); lineNumber++)
+    {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        ControlKeyframe keyframe;
+        std::istringstream fields(line);
+        if (!(fields >> keyframe.time >> keyframe.aileron >> keyframe.elevator >> keyframe.rudder >> keyframe.throttle) ||
+            (!keyframes.empty() && keyframe.time <= keyframes.back().time))
+        {
+            printf("%s:%d - %s line %d: expected increasing time aileron elevator rudder throttle\n", __FILE__,
+                __LINE__, pFilename, lineNumber);
+            return false;
+        }
+        keyframes.push_back(keyframe);
+    }
+
+    m_keyframes = std::move(keyframes);
+    return true;
+}
+
+// Fills the script with one of the built-in manoeuvres
+bool ControlScript::LoadBuiltIn(const std::string& name)
+{
+    // time, aileron, elevator, rudder, throttle
+    static const std::vector<ControlKeyframe> level = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+    };
+    static const std::vector<ControlKeyframe> climb = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 5.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+        { 8.0f, 0.0f, 0.15f, 0.0f, 1.0f },
+        { 40.0f, 0.0f, 0.15f, 0.0f, 1.0f },
+        { 45.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+    };
+    static const std::vector<ControlKeyframe> turns = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.7f },
+        { 2.0f, -0.3f, 0.05f, -0.05f, 0.7f },
+        { 4.0f, 0.0f, 0.1f, 0.0f, 0.7f },
+        { 20.0f, 0.0f, 0.1f, 0.0f, 0.7f },
+        { 22.0f, 0.3f, 0.0f, 0.05f, 0.7f },
+        { 26.0f, 0.3f, 0.0f, 0.05f, 0.7f },
+        { 28.0f, 0.0f, 0.1f, 0.0f, 0.7f },
+        { 44.0f, 0.0f, 0.1f, 0.0f, 0.7f },
+        { 46.0f, -0.3f, 0.0f, -0.05f, 0.7f },
+        { 48.0f, 0.0f, 0.0f, 0.0f, 0.7f },
+    };
+    static const std::vector<ControlKeyframe> rolls = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.8f },
+        { 2.0f, 0.0f, 0.2f, 0.0f, 0.8f },
+        { 3.0f, 1.0f, 0.0f, 0.0f, 0.8f },
+        { 6.0f, 1.0f, 0.0f, 0.0f, 0.8f },
+        { 7.0f, 0.0f, 0.0f, 0.0f, 0.8f },
+        { 15.0f, 0.0f, 0.0f, 0.0f, 0.8f },
+    };
+    static const std::vector<ControlKeyframe> doublets = {
+        { 0.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 5.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 5.1f, 0.0f, 0.3f, 0.0f, 0.6f },
+        { 6.0f, 0.0f, 0.3f, 0.0f, 0.6f },
+        { 6.2f, 0.0f, -0.3f, 0.0f, 0.6f },
+        { 7.0f, 0.0f, -0.3f, 0.0f, 0.6f },
+        { 7.1f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 15.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 15.1f, 0.3f, 0.0f, 0.0f, 0.6f },
+        { 16.0f, 0.3f, 0.0f, 0.0f, 0.6f },
+        { 16.2f, -0.3f, 0.0f, 0.0f, 0.6f },
+        { 17.0f, -0.3f, 0.0f, 0.0f, 0.6f },
+        { 17.1f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 25.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 25.1f, 0.0f, 0.0f, 0.3f, 0.6f },
+        { 26.0f, 0.0f, 0.0f, 0.3f, 0.6f },
+        { 26.2f, 0.0f, 0.0f, -0.3f, 0.6f },
+        { 27.0f, 0.0f, 0.0f, -0.3f, 0.6f },
+        { 27.1f, 0.0f, 0.0f, 0.0f, 0.6f },
+        { 40.0f, 0.0f, 0.0f, 0.0f, 0.6f },
+    };
+
+    static const struct { const char* name; const std::vector<ControlKeyframe>* keyframes; bool looping; } scripts[] = {
+        { "level", &level, false }, { "climb", &climb, false }, { "turns", &turns, true }, { "rolls", &rolls, true },
+        { "doublets", &doublets, true }
+    };
+
+    for (const auto& script : scripts)
+    {
+        if (name == script.name)
+        {
+            m_keyframes = *script.keyframes;
+            m_looping = script.looping;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Interpolates the keyframes around a time
+Joystick ControlScript::Sample(float time) const
+{
+    ControlKeyframe controls = { time, 0.0f, 0.0f, 0.0f, 0.6f };
+    if (!m_keyframes.empty())
+    {
+        float duration = GetDuration();
+        if (m_looping && duration > 0.0f)
+            time = std::fmod(std::max(time, 0.0f), duration);
+
+        auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+            [](float t, const ControlKeyframe& keyframe) { return t < keyframe.time; });
+        if (next == m_keyframes.begin())
+            controls = m_keyframes.front();
+        else if (next == m_keyframes.end())
+            controls = m_keyframes.back();
+        else
+        {
+            const ControlKeyframe& a = *(next - 1);
+            const ControlKeyframe& b = *next;
+            float t = (time - a.time) / (b.time - a.time);
+            controls.aileron = a.aileron + (b.aileron - a.aileron) * t;
+            controls.elevator = a.elevator + (b.elevator - a.elevator) * t;
+            controls.rudder = a.rudder + (b.rudder - a.rudder) * t;
+            controls.throttle = a.throttle + (b.throttle - a.throttle) * t;
+        }
+    }
+
+    // Same split of the roll axis as the gamepad input of the simulator.
+    Joystick joystick;
+    joystick.leftAileron = std::min(controls.aileron, 0.0f);
+    joystick.rightAileron = std::max(controls.aileron, 0.0f);
+    joystick.elevator = controls.elevator;
+    joystick.rudder = controls.rudder;
+    joystick.throttle = controls.throttle;
+    return joystick;
+}
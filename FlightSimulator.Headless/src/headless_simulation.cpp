@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "headless_simulation.h"
+#include "data.h"
+#include "job_system.h"
+
+HeadlessSimulation::HeadlessSimulation(const HeadlessSettings& settings, const ControlScript& script,
+    const HeightField& ground)
+    : m_settings(settings), m_script(script), m_ground(ground), m_wingAirfoil(NACA_2412_data),
+      m_tailAirfoil(NACA_0012_data)
+{
+}
+
+// Lines the fleet up on a square grid over the middle of the terrain, all heading north at the start speed
+void HeadlessSimulation::PlaceAircraft()
+{
+    const int count = m_settings.aircraftCount;
+    const int columns = (int)std::ceil(std::sqrt((double)count));
+    const float center = m_ground.IsLoaded() ? m_ground.GetExtent() * 0.5f : 0.0f;
+    const float gridOrigin = center - (columns - 1) * m_settings.spacing * 0.5f;
+
+    std::mt19937 rng(m_settings.seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    m_aircraft.clear();
+    m_trajectories.assign(count, {});
+    m_groundContacts.assign(count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        auto plane = std::make_unique<physics::Airplane>(&m_wingAirfoil, &m_tailAirfoil);
+
+        float x = gridOrigin + (i % columns) * m_settings.spacing;
+        float z = gridOrigin + (i / columns) * m_settings.spacing;
+        float heading = unit(rng) * m_settings.variation;
+        float speed = m_settings.startSpeed * (1.0f + unit(rng) * m_settings.variation);
+
+        plane->position = glm::vec3(x, m_ground.GetHeight(x, z) + m_settings.startAltitude, z);
+        plane->orientation = glm::angleAxis(heading, physics::UP);
+        plane->velocity = plane->transform_direction(physics::FORWARD) * speed;
+        plane->integrator = m_settings.integrator;
+        plane->reset_interpolation();
+        m_aircraft.push_back(std::move(plane));
+    }
+}
+
+// Steps a share of the fleet through the whole run
+void HeadlessSimulation::FlyAircraft(int first, int last)
+{
+    const float step = m_settings.step;
+    const uint64_t stepCount = (uint64_t)std::llround(m_settings.duration / step);
+    const uint64_t sampleSteps =
+        m_settings.sampleInterval > 0.0f ? std::max<uint64_t>(1, std::llround(m_settings.sampleInterval / step)) : 0;
+
+    for (int i = first; i < last; i++)
+    {
+        physics::Airplane& plane = *m_aircraft[i];
+        const float scriptStart = i * m_settings.scriptOffset;
+
+        for (uint64_t s = 0; s < stepCount; s++)
+        {
+            float time = s * step;
+            Joystick controls = m_script.Sample(scriptStart + time);
+            if (sampleSteps && s % sampleSteps == 0)
+                Record(i, time, controls);
+
+            plane.set_controls(controls);
+            plane.update(step);
+
+            // Same ground handling as the interactive simulator.
+            float groundHeight = m_ground.GetHeight(plane.position.x, plane.position.z);
+            if (plane.position.y < groundHeight)
+            {
+                plane.position.y = groundHeight;
+                plane.velocity.y = std::max(plane.velocity.y, 0.0f);
+                m_groundContacts[i]++;
+            }
+        }
+
+        if (sampleSteps)
+            Record(i, stepCount * step, m_script.Sample(scriptStart + stepCount * step));
+    }
+}
+
+void HeadlessSimulation::Record(int aircraft, float time, const Joystick& controls)
+{
+    const physics::Airplane& plane = *m_aircraft[aircraft];
+    m_trajectories[aircraft].push_back({ time, plane.position, plane.orientation, plane.velocity, controls });
+}
+
+void HeadlessSimulation::Run()
+{
+    PlaceAircraft();
+
+    const int count = m_settings.aircraftCount;
+    JobSystem jobs(m_settings.threads > 0 ? std::min(m_settings.threads, count) : 0);
+
+    // Every aircraft is one job flown from start to end, so threads that finish early steal the remaining aircraft.
+    auto start = std::chrono::steady_clock::now();
+    jobs.Wait(jobs.ParallelFor(0, count, 1, [this](int first, int last) { FlyAircraft(first, last); }));
+    auto end = std::chrono::steady_clock::now();
+
+    const uint64_t stepCount = (uint64_t)std::llround(m_settings.duration / m_settings.step);
+    m_stats.wallSeconds = std::chrono::duration<double>(end - start).count();
+    m_stats.simulatedSeconds = stepCount * (double)m_settings.step;
+    m_stats.steps = stepCount * count;
+    m_stats.groundContacts = 0;
+    for (uint64_t contacts : m_groundContacts)
+        m_stats.groundContacts += contacts;
+    m_stats.threads = jobs.GetThreadCount();
+}
+
+bool HeadlessSimulation::WriteTrajectories(const char* pFilename) const
+{
+    FILE* file = fopen(pFilename, "w");
+    if (!file)
+    {
+        printf("%s:%d - cannot write %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    fprintf(file, "aircraft,time,x,y,z,qw,qx,qy,qz,vx,vy,vz,airspeed,aileron,elevator,rudder,throttle\n");
+    for (size_t i = 0; i < m_trajectories.size(); i++)
+    {
+        for (const TrajectorySample& s : m_trajectories[i])
+        {
+            fprintf(file, "%zu,%.4f,%.3f,%.3f,%.3f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", i,
+                s.time, s.position.x, s.position.y, s.position.z, s.orientation.w, s.orientation.x, s.orientation.y,
+                s.orientation.z, s.velocity.x, s.velocity.y, s.velocity.z, glm::length(s.velocity),
+                s.controls.leftAileron + s.controls.rightAileron, s.controls.elevator, s.controls.rudder,
+                s.controls.throttle);
+        }
+    }
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    if (!ok)
+        printf("%s:%d - error writing %s\n", __FILE__, __LINE__, pFilename);
+    return ok;
+}
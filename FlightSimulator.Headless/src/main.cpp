@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "control_script.h"
+#include "flight_recorder.h"
+#include "headless_simulation.h"
+#include "height_field.h"
+
+static void PrintUsage()
+{
+    printf("Usage: FlightSimulator.Headless [options]\n"
+        "\n"
+        "Flies aircraft through scripted control inputs as fast as possible, without a window or GL context.\n"
+        "\n"
+        "Options:\n"
+        "  --aircraft <n>               Number of aircraft (default 1)\n"
+        "  --duration <seconds>         Simulated time (default 60)\n"
+        "  --rate <hz>                  Physics steps per simulated second (default 240)\n"
+        "  --integrator <name>          semi_implicit_euler, verlet, rk4 or adaptive (default semi_implicit_euler)\n"
+        "  --script <name|path>         Built-in script (%s) or a file of\n"
+        "                               'time aileron elevator rudder throttle' lines (default level)\n"
+        "  --loop                       Start the script over after its last keyframe\n"
+        "  --script-offset <seconds>    How far each further aircraft is ahead in the script (default 0)\n"
+        "  --altitude <metres>          Start height above the ground (default 1500)\n"
+        "  --speed <m/s>                Start speed (default 55)\n"
+        "  --spacing <metres>           Distance between aircraft on the start grid (default 200)\n"
+        "  --variation <v>              Random start heading (radians) and speed (fraction) variation (default 0)\n"
+        "  --seed <n>                   Seed of the start variation and generated terrain (default 1)\n"
+        "  --heightmap <path> <scale>   Raw float heightmap and its post spacing in metres\n"
+        "  --database <path> <level>    Terrain database from FlightSimulator.DemImport and the LOD level to use\n"
+        "  --fault-terrain <size>       Generated fault formation terrain like the simulator's, 20 m posts\n"
+        "  --threads <n>                Worker threads (default: one per hardware thread)\n"
+        "  --trajectory <path>          Write the trajectories as CSV\n"
+        "  --sample-interval <seconds>  Time between trajectory samples (default 0.1)\n"
+        "  --replay <path>              Replay a flight recording of the simulator, check it stays in lockstep and\n"
+        "                               time seeking into it\n",
+        ControlScript::GetBuiltInNames());
+}
+
+// Compares the player state after a step with its recorded sample.
+static bool MatchesSample(const LockstepSimulation& simulation, const FlightSample& recorded)
+{
+    FlightSample replayed = FlightRecorder::MakeSample(simulation, recorded.input);
+    return memcmp(&replayed.position, &recorded.position, sizeof(replayed.position)) == 0 &&
+        memcmp(&replayed.orientation, &recorded.orientation, sizeof(replayed.orientation)) == 0 &&
+        memcmp(&replayed.velocity, &recorded.velocity, sizeof(replayed.velocity)) == 0 &&
+        memcmp(&replayed.angularVelocity, &recorded.angularVelocity, sizeof(replayed.angularVelocity)) == 0;
+}
+
+// Runs a recording through a LockstepSimulation of its own settings and compares every step with it, then seeks
+// to steps spread over the recording and checks it lands on the recorded state.
+static int Replay(const char* pFilename)
+{
+    FlightRecording recording;
+    if (!recording.Open(pFilename))
+        return 1;
+
+    const LockstepSettings& settings = recording.GetSettings();
+    const uint64_t firstStep = recording.GetFirstStep(), endStep = recording.GetEndStep();
+    printf("Replaying %llu steps at %.0f Hz with %s, %d traffic aircraft, %d keyframes\n",
+        (unsigned long long)(endStep - firstStep), 1.0f / settings.stepSize,
+        physics::get_integrator_name(settings.integrator), settings.trafficCount, recording.GetKeyframeCount());
+
+    HeightField ground;
+    LockstepSimulation::GenerateGround(settings.terrain, ground);
+    LockstepSimulation simulation(settings, ground);
+    if (!recording.Seek(simulation, firstStep))
+    {
+        printf("Recording does not start with a keyframe\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t matched = 0;
+    while (simulation.GetStepCount() < endStep)
+    {
+        const FlightSample* recorded = recording.GetSample(simulation.GetStepCount());
+        if (!recorded)
+        {
+            printf("Recording has no step %llu\n", (unsigned long long)simulation.GetStepCount());
+            break;
+        }
+
+        simulation.Step(recorded->input);
+        if (!MatchesSample(simulation, *recorded))
+        {
+            const glm::vec3& position = simulation.GetPlayer().position;
+            printf("Diverged at step %llu: position (%.3f, %.3f, %.3f), recorded (%.3f, %.3f, %.3f)\n",
+                (unsigned long long)recorded->step, position.x, position.y, position.z, recorded->position.x,
+                recorded->position.y, recorded->position.z);
+            break;
+        }
+        matched++;
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu of %llu steps in lockstep, %.1f simulated seconds in %.3f s wall time, checksum %016llx\n",
+        (unsigned long long)matched, (unsigned long long)(endStep - firstStep), matched * settings.stepSize,
+        wallSeconds, (unsigned long long)simulation.ComputeChecksum());
+    if (matched != endStep - firstStep)
+        return 2;
+
+    // Seek latency is bounded by the keyframe interval, not by where in the recording the step lies.
+    const int seekCount = 8;
+    double totalMilliseconds = 0.0, maxMilliseconds = 0.0;
+    for (int i = 1; i <= seekCount; i++)
+    {
+        uint64_t step = firstStep + (endStep - firstStep) * i / (seekCount + 1);
+        auto seekStart = std::chrono::steady_clock::now();
+        bool sought = recording.Seek(simulation, step);
+        double milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seekStart).count();
+        totalMilliseconds += milliseconds;
+        maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+
+        const FlightSample* recorded = step > firstStep ? recording.GetSample(step - 1) : nullptr;
+        if (!sought || (recorded && !MatchesSample(simulation, *recorded)))
+        {
+            printf("Seek to step %llu failed or landed off the recording\n", (unsigned long long)step);
+            return 2;
+        }
+    }
+    printf("%d seeks, %.2f ms mean, %.2f ms max, at most %u steps re-simulated\n", seekCount,
+        totalMilliseconds / seekCount, maxMilliseconds, recording.GetKeyframeInterval() - 1);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    HeadlessSettings settings;
+    settings.sampleInterval = 0.1f;
+    std::string scriptName = "level";
+    bool loop = false;
+    const char* trajectoryPath = nullptr;
+    const char* heightmapPath = nullptr;
+    const char* databasePath = nullptr;
+    float heightmapScale = 20.0f;
+    int databaseLevel = 0;
+    int faultTerrainSize = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto hasArgs = [&](int count) { return i + count < argc; };
+
+        if (strcmp(argv[i], "--aircraft") == 0 && hasArgs(1))
+            settings.aircraftCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--duration") == 0 && hasArgs(1))
+            settings.duration = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && hasArgs(1))
+            settings.step = 1.0f / (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--integrator") == 0 && hasArgs(1))
+        {
+            if (!physics::parse_integrator(argv[++i], settings.integrator))
+            {
+                printf("Unknown integrator %s\n\n", argv[i]);
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--script") == 0 && hasArgs(1))
+            scriptName = argv[++i];
+        else if (strcmp(argv[i], "--loop") == 0)
+            loop = true;
+        else if (strcmp(argv[i], "--script-offset") == 0 && hasArgs(1))
+            settings.scriptOffset = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--altitude") == 0 && hasArgs(1))
+            settings.startAltitude = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--speed") == 0 && hasArgs(1))
+            settings.startSpeed = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--spacing") == 0 && hasArgs(1))
+            settings.spacing = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--variation") == 0 && hasArgs(1))
+            settings.variation = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && hasArgs(1))
+            settings.seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--heightmap") == 0 && hasArgs(2))
+        {
+            heightmapPath = argv[i + 1];
+            heightmapScale = (float)atof(argv[i + 2]);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--database") == 0 && hasArgs(2))
+        {
+            databasePath = argv[i + 1];
+            databaseLevel = atoi(argv[i + 2]);
+            i += 2;
+        }
+        else if (strcmp(argv[i], "--fault-terrain") == 0 && hasArgs(1))
+            faultTerrainSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasArgs(1))
+            settings.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--trajectory") == 0 && hasArgs(1))
+            trajectoryPath = argv[++i];
+        else if (strcmp(argv[i], "--sample-interval") == 0 && hasArgs(1))
+            settings.sampleInterval = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--replay") == 0 && hasArgs(1))
+            return Replay(argv[++i]);
+        else
+        {
+            printf("Unknown or incomplete option %s\n\n", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (settings.aircraftCount <= 0 || settings.duration <= 0.0f || !(settings.step > 0.0f))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Trajectories are only kept in memory when they are written.
+    if (!trajectoryPath)
+        settings.sampleInterval = 0.0f;
+
+    ControlScript script;
+    if (!script.LoadBuiltIn(scriptName) && !script.Load(scriptName.c_str()))
+        return 1;
+    if (loop)
+        script.SetLooping(true);
+
+    HeightField ground;
+    if (heightmapPath && !ground.LoadRaw(heightmapPath, heightmapScale))
+        return 1;
+    if (databasePath && !ground.OpenDatabase(databasePath, databaseLevel))
+        return 1;
+    if (faultTerrainSize > 0)
+        ground.GenerateFaultFormation(faultTerrainSize, 500, 0.0f, 5000.0f, 0.8f, settings.seed, 20.0f);
+
+    printf("Flying %d aircraft for %.1f s at %.0f Hz with %s, script %s, %s\n", settings.aircraftCount,
+        settings.duration, 1.0f / settings.step, physics::get_integrator_name(settings.integrator), scriptName.c_str(),
+        ground.IsLoaded() ? "over terrain" : "over flat ground");
+
+    HeadlessSimulation simulation(settings, script, ground);
+    simulation.Run();
+
+    // Speed relative to real time, for the fleet and for a single aircraft.
+    const HeadlessStats& stats = simulation.GetStats();
+    printf("Wall time %.3f s on %d threads, %llu steps, %.2f M steps/s\n", stats.wallSeconds, stats.threads,
+        (unsigned long long)stats.steps, stats.steps / 1.0e6 / stats.wallSeconds);
+    printf("Simulated seconds per wall second: %.1f fleet, %.1f aircraft-seconds\n",
+        stats.simulatedSeconds / stats.wallSeconds, stats.simulatedSeconds * settings.aircraftCount / stats.wallSeconds);
+    printf("Ground contacts: %llu steps\n", (unsigned long long)stats.groundContacts);
+
+    // Final state of the first few aircraft as a quick check of the run.
+    const auto& aircraft = simulation.GetAircraft();
+    for (size_t i = 0; i < aircraft.size() && i < 8; i++)
+    {
+        const physics::Airplane& plane = *aircraft[i];
+        printf("  aircraft %zu: position (%.0f, %.0f, %.0f), airspeed %.1f m/s, %.0f m above ground\n", i,
+            plane.position.x, plane.position.y, plane.position.z, plane.get_airspeed(),
+            plane.position.y - ground.GetHeight(plane.position.x, plane.position.z));
+    }
+
+    if (trajectoryPath)
+    {
+        if (!simulation.WriteTrajectories(trajectoryPath))
+            return 1;
+        printf("Wrote trajectories to %s\n", trajectoryPath);
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef AERO_BATCH_H
+#define AERO_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "airfoil.h"
+
+namespace physics
+{
+	struct Wing;
+
+	// airfoil tables referenced by id from a batch, copied into one array so each lane can read from its own airfoil.
+	// all airfoils must share the alpha grid; the batch uses the first reynolds row of each
+	class AirfoilLibrary
+	{
+	public:
+		// @return: Id of the airfoil, or -1 if its alpha grid differs from the airfoils already added.
+		int add(const Airfoil& airfoil);
+
+		const float* get_table() const { return m_table.data(); }
+		const float* get_offsets() const { return m_offsets.data(); }  // float index of the first cl of each airfoil
+		const Airfoil& get_airfoil(int id) const { return *m_airfoils[id]; }
+		int get_alpha_count() const { return m_alpha_count; }
+		float get_alpha_scale() const { return m_alpha_scale; }
+
+	private:
+		std::vector<float> m_table;  // interleaved (cl, cd) pairs
+		std::vector<float> m_offsets;
+		std::vector<const Airfoil*> m_airfoils;
+		int m_alpha_count = 0;
+		float m_alpha_scale = 0.0f;
+	};
+
+	// structure of arrays of lifting surfaces, all vectors in the body space of the aircraft the surface belongs to.
+	// arrays are padded to a multiple of LANES with surfaces that produce no force
+	struct AeroSurfaces {
+		static constexpr size_t LANES = 16;
+
+		size_t count = 0;
+
+		// inputs
+		std::vector<float> velocity_x, velocity_y, velocity_z;  // velocity of the surface through the air, m/s
+		std::vector<float> normal_x, normal_y, normal_z;        // unit lift direction at zero angle of attack
+		std::vector<float> position_x, position_y, position_z;  // relative to the center of gravity, for the moment
+		std::vector<float> area;                   // m^2
+		std::vector<float> induced_drag;           // 1 / (pi * aspect ratio * oswald efficiency)
+		std::vector<float> control;                // control input, -1..1
+		std::vector<float> control_effectiveness;  // lift coefficient added at full control input
+		std::vector<float> density;                // kg/m^3
+		std::vector<int32_t> airfoil;              // id in the AirfoilLibrary
+
+		// outputs, body space
+		std::vector<float> force_x, force_y, force_z;     // N
+		std::vector<float> moment_x, moment_y, moment_z;  // Nm about the center of gravity
+
+		// resizes every array to hold n surfaces plus padding; new surfaces are zeroed
+		void resize(size_t n);
+
+		// copies the geometry of a wing into slot i. velocity, control and density are set per step
+		// @param airfoil_id: Id of the wing's airfoil in the library.
+		void set_surface(size_t i, const Wing& wing, int32_t airfoil_id);
+
+		// count rounded up to whole vectors
+		size_t padded_count() const { return (count + LANES - 1) / LANES * LANES; }
+	};
+
+	// instruction sets the kernel is compiled for
+	enum class AeroIsa {
+		Reference,  // scalar code with std::asin, the same math as Wing::apply_forces
+		Sse2,
+		Avx2,
+		Avx512,
+		Best,       // widest one the processor supports
+	};
+
+	// computes force and moment of surfaces [begin, end). begin and end must be multiples of AeroSurfaces::LANES,
+	// so chunks of one batch can be evaluated on different threads
+	void evaluate_aero(const AirfoilLibrary& library, AeroSurfaces& surfaces, size_t begin, size_t end,
+		AeroIsa isa = AeroIsa::Best);
+
+	// whether an instruction set is compiled in and supported by the processor
+	bool is_aero_isa_available(AeroIsa isa);
+
+	// name of an instruction set, for reports
+	const char* get_aero_isa_name(AeroIsa isa);
+};  // namespace physics
+
+#endif // AERO_BATCH_H
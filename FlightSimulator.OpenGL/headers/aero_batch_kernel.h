@@ -0,0 +1,111 @@
+#ifndef AERO_BATCH_KERNEL_H
+#define AERO_BATCH_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simd.h"
+
+// The aerodynamic kernel as a template over the simd vector types. It is instantiated once per instruction set in
+// aero_batch.cpp, aero_batch_avx2.cpp and aero_batch_avx512.cpp, each compiled for its own architecture. The kernel
+// only sees raw pointers and simd.h, so no inline function of another header gets compiled for a wider instruction
+// set than the code calling it and picked by the linker for everyone.
+namespace physics
+{
+	// one range of an AeroSurfaces batch and the airfoil library it refers to
+	struct AeroKernelArgs {
+		const float* table;
+		const float* offsets;
+		float alpha_scale;
+		float alpha_max;  // last valid fractional column
+		float epsilon;
+		const float *velocity_x, *velocity_y, *velocity_z;
+		const float *normal_x, *normal_y, *normal_z;
+		const float *position_x, *position_y, *position_z;
+		const float *area, *induced_drag, *control, *control_effectiveness, *density;
+		const int32_t* airfoil;
+		float *force_x, *force_y, *force_z;
+		float *moment_x, *moment_y, *moment_z;
+		size_t begin, end;
+	};
+
+	void evaluate_aero_sse2(const AeroKernelArgs& args);
+	void evaluate_aero_avx2(const AeroKernelArgs& args);
+	void evaluate_aero_avx512(const AeroKernelArgs& args);
+
+	// asin(x) in degrees, abramowitz and stegun 4.4.46, within 2e-8 rad over [-1, 1]
+	template <typename V>
+	inline V asin_degrees(V x)
+	{
+		V a = Abs(x);
+		V p = V(-0.0012624911f);
+		p = MulAdd(p, a, V(0.0066700901f));
+		p = MulAdd(p, a, V(-0.0170881256f));
+		p = MulAdd(p, a, V(0.0308918810f));
+		p = MulAdd(p, a, V(-0.0501743046f));
+		p = MulAdd(p, a, V(0.0889789874f));
+		p = MulAdd(p, a, V(-0.2145988016f));
+		p = MulAdd(p, a, V(1.5707963050f));
+		V r = (V(1.5707963268f) - Sqrt(Max(V(1.0f) - a, V(0.0f))) * p) * V(57.2957795f);
+		return Select(x < V(0.0f), -r, r);
+	}
+
+	template <typename V>
+	void evaluate_aero_kernel(const AeroKernelArgs& s)
+	{
+		const V alpha_scale(s.alpha_scale);
+		const V alpha_max(s.alpha_max);
+		const V epsilon(s.epsilon);
+
+		for (size_t i = s.begin; i < s.end; i += V::Width) {
+			V vx = V::Load(s.velocity_x + i), vy = V::Load(s.velocity_y + i), vz = V::Load(s.velocity_z + i);
+			V nx = V::Load(s.normal_x + i), ny = V::Load(s.normal_y + i), nz = V::Load(s.normal_z + i);
+
+			// drag opposes the velocity
+			V speed_sq = vx * vx + vy * vy + vz * vz;
+			V speed = Sqrt(speed_sq);
+			V inv_speed = V(1.0f) / Max(speed, epsilon);
+			V dx = -vx * inv_speed, dy = -vy * inv_speed, dz = -vz * inv_speed;
+
+			// angle of attack from the drag direction and the normal, lift perpendicular to the flow in their plane:
+			// (d x n) x d = n - d (d . n) for a unit d
+			V sin_alpha = Min(Max(dx * nx + dy * ny + dz * nz, V(-1.0f)), V(1.0f));
+			V cos_alpha_sq = V(1.0f) - sin_alpha * sin_alpha;
+			V inv_cos_alpha = V(1.0f) / Sqrt(Max(cos_alpha_sq, epsilon));
+			V lx = (nx - dx * sin_alpha) * inv_cos_alpha;
+			V ly = (ny - dy * sin_alpha) * inv_cos_alpha;
+			V lz = (nz - dz * sin_alpha) * inv_cos_alpha;
+
+			// airfoil table, same indexing as Airfoil::sample
+			V a = Min(Max((asin_degrees(sin_alpha) + V(180.0f)) * alpha_scale, V(0.0f)), alpha_max);
+			V column = Floor(a);
+			V t = a - column;
+			V index = V::Gather(s.offsets, V::LoadInt(s.airfoil + i)) + column * V(2.0f);
+			V cl0 = V::Gather(s.table, index), cd0 = V::Gather(s.table, index + V(1.0f));
+			V cl1 = V::Gather(s.table, index + V(2.0f)), cd1 = V::Gather(s.table, index + V(3.0f));
+
+			V cl = MulAdd(cl1 - cl0, t, cl0);
+			cl = MulAdd(V::Load(s.control + i), V::Load(s.control_effectiveness + i), cl);
+			V cd = MulAdd(cd1 - cd0, t, cd0);
+			cd = MulAdd(cl * cl, V::Load(s.induced_drag + i), cd);
+
+			// no force without flow or with the flow along the normal, like Wing::apply_forces
+			V q = V(0.5f) * V::Load(s.density + i) * speed_sq * V::Load(s.area + i);
+			q = Select(speed > epsilon, q, V(0.0f));
+			q = Select(cos_alpha_sq > V(0.0f), q, V(0.0f));
+
+			V lift = cl * q, drag = cd * q;
+			V fx = lx * lift + dx * drag, fy = ly * lift + dy * drag, fz = lz * lift + dz * drag;
+			fx.Store(s.force_x + i);
+			fy.Store(s.force_y + i);
+			fz.Store(s.force_z + i);
+
+			V px = V::Load(s.position_x + i), py = V::Load(s.position_y + i), pz = V::Load(s.position_z + i);
+			(py * fz - pz * fy).Store(s.moment_x + i);
+			(pz * fx - px * fz).Store(s.moment_y + i);
+			(px * fy - py * fx).Store(s.moment_z + i);
+		}
+	}
+};  // namespace physics
+
+#endif // AERO_BATCH_KERNEL_H
@@ -0,0 +1,232 @@
+#ifndef AIRFOIL_H
+#define AIRFOIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "physics.h"
+
+namespace physics
+{
+	// polar of an airfoil at one reynolds number, (alpha in degrees, cl, cd) samples sorted by alpha. the spacing of
+	// the samples may be irregular and have gaps
+	struct Polar {
+		float reynolds;
+		const std::vector<glm::vec3>* data;
+	};
+
+	// lift and drag coefficients resampled from one or more polars onto a uniform grid over the full circle of angle
+	// of attack and over log10 of the reynolds number. a lookup is two multiplies, a clamp and a bilinear blend of four
+	// table entries, independent of the number of source samples. outside of the sampled range the polar blends into a
+	// flat plate, so a stalled or tumbling surface still gets sensible coefficients
+	class Airfoil
+	{
+	public:
+		static constexpr float DEFAULT_ALPHA_STEP = 0.25f;  // degrees, the spacing of the xfoil polars in data.h
+		static constexpr float REYNOLDS_STEP = 0.05f;       // log10 units between resampled reynolds rows
+		static constexpr float FLAT_PLATE_CD_MAX = 1.98f;   // drag of a flat plate broadside to the flow
+		static constexpr float FLAT_PLATE_CD_MIN = 0.02f;   // skin friction of a flat plate edge on to the flow
+		static constexpr float STALL_BLEND = 15.0f;         // degrees over which the polar blends into the flat plate
+
+		float min_alpha, max_alpha;  // degrees, range covered by the source data
+		float cl_max;                // highest lift coefficient of the source data
+
+		// single polar, used at every reynolds number
+		explicit Airfoil(const std::vector<glm::vec3>& curve, float alpha_step = DEFAULT_ALPHA_STEP)
+			: Airfoil(std::vector<Polar>{ { 1.0e6f, &curve } }, alpha_step)
+		{
+		}
+
+		// multiple polars, linearly interpolated in log10 of the reynolds number and clamped to the outermost ones
+		Airfoil(std::vector<Polar> polars, float alpha_step = DEFAULT_ALPHA_STEP)
+		{
+			std::sort(polars.begin(), polars.end(), [](const Polar& a, const Polar& b) { return a.reynolds < b.reynolds; });
+
+			min_alpha = 180.0f;
+			max_alpha = -180.0f;
+			cl_max = 0.0f;
+			for (const auto& polar : polars) {
+				min_alpha = std::min(min_alpha, polar.data->front().x);
+				max_alpha = std::max(max_alpha, polar.data->back().x);
+				for (const auto& sample : *polar.data) {
+					cl_max = std::max(cl_max, sample.y);
+				}
+			}
+
+			m_alpha_count = (int)std::ceil(360.0f / alpha_step) + 1;
+			m_alpha_scale = (m_alpha_count - 1) / 360.0f;
+
+			// at least two rows so the reynolds blend never needs a special case
+			m_log_reynolds_min = std::log10(polars.front().reynolds);
+			float log_reynolds_range = std::log10(polars.back().reynolds) - m_log_reynolds_min;
+			m_reynolds_count = std::max(2, (int)std::ceil(log_reynolds_range / REYNOLDS_STEP) + 1);
+			m_reynolds_scale = log_reynolds_range > 0.0f ? (m_reynolds_count - 1) / log_reynolds_range : 0.0f;
+
+			// every polar on the alpha grid first, then rows interpolated between the two polars around them
+			std::vector<std::vector<glm::vec2>> resampled(polars.size());
+			for (size_t p = 0; p < polars.size(); p++) {
+				resampled[p].resize(m_alpha_count);
+				for (int i = 0; i < m_alpha_count; i++) {
+					resampled[p][i] = resample(*polars[p].data, i / m_alpha_scale - 180.0f);
+				}
+			}
+
+			m_table.resize((size_t)m_reynolds_count * m_alpha_count);
+			size_t upper = 0;
+			for (int r = 0; r < m_reynolds_count; r++) {
+				float log_reynolds = m_log_reynolds_min + (m_reynolds_scale > 0.0f ? r / m_reynolds_scale : 0.0f);
+				while (upper + 1 < polars.size() && std::log10(polars[upper].reynolds) < log_reynolds) {
+					upper++;
+				}
+				size_t lower = upper > 0 ? upper - 1 : 0;
+
+				float t = 0.0f;
+				if (upper != lower) {
+					float log_lower = std::log10(polars[lower].reynolds), log_upper = std::log10(polars[upper].reynolds);
+					t = glm::clamp((log_reynolds - log_lower) / (log_upper - log_lower), 0.0f, 1.0f);
+				}
+				for (int i = 0; i < m_alpha_count; i++) {
+					m_table[(size_t)r * m_alpha_count + i] = resampled[lower][i] + (resampled[upper][i] - resampled[lower][i]) * t;
+				}
+			}
+		}
+
+		// (cl, cd) at an angle of attack in degrees, at the lowest reynolds number of the table
+		glm::vec2 sample(float alpha) const
+		{
+			float a = alpha_coordinate(alpha);
+			int i = (int)a;
+			float t = a - i;
+			const glm::vec2* row = m_table.data();
+			return row[i] + (row[i + 1] - row[i]) * t;
+		}
+
+		// (cl, cd) at an angle of attack in degrees and a reynolds number
+		glm::vec2 sample(float alpha, float reynolds) const
+		{
+			float a = alpha_coordinate(alpha);
+			int i = (int)a;
+			float t = a - i;
+
+			float r = reynolds_coordinate(reynolds);
+			int j = (int)r;
+			float s = r - j;
+
+			const glm::vec2* row0 = m_table.data() + (size_t)j * m_alpha_count;
+			const glm::vec2* row1 = row0 + m_alpha_count;
+			glm::vec2 v0 = row0[i] + (row0[i + 1] - row0[i]) * t;
+			glm::vec2 v1 = row1[i] + (row1[i + 1] - row1[i]) * t;
+			return v0 + (v1 - v0) * s;
+		}
+
+		// coefficients for many angles of attack at the lowest reynolds number of the table
+		// @param alpha: Angles of attack in degrees.
+		// @param cl: Receives the lift coefficients.
+		// @param cd: Receives the drag coefficients.
+		// @param count: Number of queries.
+		void sample(const float* alpha, float* cl, float* cd, size_t count) const
+		{
+			const float* table = &m_table[0].x;
+			for (size_t k = 0; k < count; k++) {
+				float a = alpha_coordinate(alpha[k]);
+				int i = (int)a;
+				float t = a - i;
+				const float* e = table + 2 * i;
+				cl[k] = e[0] + (e[2] - e[0]) * t;
+				cd[k] = e[1] + (e[3] - e[1]) * t;
+			}
+		}
+
+		// coefficients for many angles of attack, each at its own reynolds number
+		void sample(const float* alpha, const float* reynolds, float* cl, float* cd, size_t count) const
+		{
+			for (size_t k = 0; k < count; k++) {
+				glm::vec2 coefficients = sample(alpha[k], reynolds[k]);
+				cl[k] = coefficients.x;
+				cd[k] = coefficients.y;
+			}
+		}
+
+		// resampled table, m_reynolds_count rows of m_alpha_count (cl, cd) pairs from -180 to +180 degrees
+		const std::vector<glm::vec2>& get_table() const { return m_table; }
+		int get_alpha_count() const { return m_alpha_count; }
+		int get_reynolds_count() const { return m_reynolds_count; }
+
+	private:
+		std::vector<glm::vec2> m_table;
+		int m_alpha_count = 0;
+		float m_alpha_scale = 0.0f;  // table entries per degree
+		int m_reynolds_count = 0;
+		float m_reynolds_scale = 0.0f;  // table rows per log10 unit
+		float m_log_reynolds_min = 0.0f;
+
+		// fractional table column of an angle of attack, clamped so the entry after it always exists
+		float alpha_coordinate(float alpha) const
+		{
+			float a = (alpha + 180.0f) * m_alpha_scale;
+			return std::min(std::max(a, 0.0f), m_alpha_count - 1.001f);
+		}
+
+		// fractional table row of a reynolds number
+		float reynolds_coordinate(float reynolds) const
+		{
+			float r = (fast_log10(std::max(reynolds, 1.0f)) - m_log_reynolds_min) * m_reynolds_scale;
+			return std::min(std::max(r, 0.0f), m_reynolds_count - 1.001f);
+		}
+
+		// log10 from the float exponent and a cubic in the mantissa, within 5e-4 of std::log10; a hundredth of a
+		// reynolds row, but several times cheaper than the library call
+		static float fast_log10(float x)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &x, sizeof(bits));
+			float exponent = (float)((int)(bits >> 23) - 127);
+			bits = (bits & 0x007fffffu) | 0x3f800000u;
+			float m;
+			std::memcpy(&m, &bits, sizeof(m));
+			float log2_mantissa = ((0.1539246f * m - 1.0295584f) * m + 3.0108510f) * m - 2.1338866f;
+			return (exponent + log2_mantissa) * 0.30103f;
+		}
+
+		// coefficients of a flat plate, what any airfoil tends to far beyond stall
+		static glm::vec2 flat_plate(float alpha)
+		{
+			float radians = glm::radians(alpha);
+			return { 0.5f * FLAT_PLATE_CD_MAX * std::sin(2.0f * radians), FLAT_PLATE_CD_MIN + (FLAT_PLATE_CD_MAX - FLAT_PLATE_CD_MIN) * sq(std::sin(radians)) };
+		}
+
+		// (cl, cd) of one polar at any angle of attack; the source data is searched, this only runs while the table
+		// is built
+		static glm::vec2 resample(const std::vector<glm::vec3>& data, float alpha)
+		{
+			const glm::vec3& first = data.front();
+			const glm::vec3& last = data.back();
+
+			// beyond the data, blend from the last sample into the flat plate with a smoothstep
+			if (alpha > last.x || alpha < first.x) {
+				const glm::vec3& edge = alpha > last.x ? last : first;
+				float t = glm::clamp(std::fabs(alpha - edge.x) / STALL_BLEND, 0.0f, 1.0f);
+				t = t * t * (3.0f - 2.0f * t);
+				glm::vec2 plate = flat_plate(alpha);
+				glm::vec2 polar = { edge.y, edge.z };
+				return polar + (plate - polar) * t;
+			}
+
+			auto upper = std::lower_bound(data.begin(), data.end(), alpha,
+				[](const glm::vec3& sample, float a) { return sample.x < a; });
+			if (upper == data.begin()) {
+				return { upper->y, upper->z };
+			}
+
+			auto lower = upper - 1;
+			float t = inverse_lerp(lower->x, upper->x, alpha);
+			return { lerp(lower->y, upper->y, t), lerp(lower->z, upper->z, t) };
+		}
+	};
+};  // namespace physics
+
+#endif // AIRFOIL_H
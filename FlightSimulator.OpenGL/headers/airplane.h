@@ -0,0 +1,158 @@
+#ifndef AIRPLANE_H
+#define AIRPLANE_H
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#include "airfoil.h"
+#include "joystick.h"
+#include "mass_properties.h"
+#include "physics.h"
+#include "rigid_body.h"
+
+namespace physics
+{
+	// lifting surface, evaluated at its center in body space
+	struct Wing {
+		glm::vec3 position;   // center of pressure relative to the center of gravity, body space
+		glm::vec3 normal;     // lift direction at zero angle of attack, body space
+		float area;           // m^2
+		float span;           // m
+		float chord;          // m
+		float aspect_ratio;
+		float flap_ratio;     // fraction of the chord that is control surface, 1 for all moving surfaces
+		float efficiency = 0.8f;  // oswald efficiency for the induced drag
+		const Airfoil* airfoil;
+		float control_input = 0.0f;  // -1..1
+
+		Wing(const glm::vec3& position, float span, float chord, const Airfoil* airfoil, const glm::vec3& normal = UP,
+			float flap_ratio = 0.25f)
+			: position(position), normal(normal), area(span * chord), span(span), chord(chord), aspect_ratio(sq(span) / (span * chord)),
+			  flap_ratio(flap_ratio), airfoil(airfoil)
+		{
+		}
+
+		// adds lift and drag of the surface to the body
+		void apply_forces(RigidBody& body, float air_density) const
+		{
+			glm::vec3 local_velocity = body.inverse_transform_direction(body.get_point_velocity(position));
+			float speed = glm::length(local_velocity);
+			if (speed <= EPSILON) {
+				return;
+			}
+
+			glm::vec3 drag_direction = -local_velocity / speed;
+			glm::vec3 lift_direction = glm::cross(glm::cross(drag_direction, normal), drag_direction);
+			float lift_direction_length = glm::length(lift_direction);
+			if (lift_direction_length <= EPSILON) {
+				return;
+			}
+			lift_direction /= lift_direction_length;
+
+			float angle_of_attack = glm::degrees(std::asin(glm::clamp(glm::dot(drag_direction, normal), -1.0f, 1.0f)));
+			float reynolds = air_density * speed * chord / isa::air_dynamic_viscosity;
+			glm::vec2 coefficients = airfoil->sample(angle_of_attack, reynolds);
+			float lift_coefficient = coefficients.x;
+
+			// a deflected control surface shifts the lift curve
+			if (flap_ratio > 0.0f) {
+				lift_coefficient += std::sqrt(flap_ratio) * airfoil->cl_max * control_input;
+			}
+
+			float induced_drag_coefficient = sq(lift_coefficient) / (PI * aspect_ratio * efficiency);
+			float drag_coefficient = coefficients.y + induced_drag_coefficient;
+
+			float dynamic_pressure = 0.5f * air_density * sq(speed) * area;
+			glm::vec3 lift = lift_direction * lift_coefficient * dynamic_pressure;
+			glm::vec3 drag = drag_direction * drag_coefficient * dynamic_pressure;
+
+			body.add_force_at_point(lift + drag, position);
+		}
+	};
+
+	// propeller modelled as thrust along the body forward axis
+	struct Engine {
+		float max_thrust;      // N
+		float throttle = 0.0f; // 0..1
+
+		explicit Engine(float max_thrust) : max_thrust(max_thrust) {}
+
+		void apply_forces(RigidBody& body) const { body.add_relative_force(FORWARD * (throttle * max_thrust)); }
+	};
+
+	// airframe of the Airplane below, mass is spread over the wings, fuselage and tail by volume
+	struct TrainerAirframe {
+		static constexpr float total_mass = 1100.0f;
+		static constexpr inertia::StaticElement elements[] = {
+			{ { -2.9f, 0.0f, 0.1f }, { 5.5f, 0.15f, 1.5f } },  // left wing
+			{ { +2.9f, 0.0f, 0.1f }, { 5.5f, 0.15f, 1.5f } },  // right wing
+			{ { 0.0f, 0.0f, 0.0f }, { 1.2f, 1.4f, 7.0f } },    // fuselage
+			{ { 0.0f, 0.0f, 4.6f }, { 3.4f, 0.1f, 0.7f } },    // elevator
+			{ { 0.0f, 0.6f, 4.6f }, { 0.1f, 1.4f, 1.0f } },    // fin
+		};
+	};
+
+	// light single engine airplane: two wings with ailerons, an all moving elevator and a rudder
+	class Airplane : public RigidBody
+	{
+	public:
+		Engine engine;
+		std::vector<Wing> wings;
+
+		// @param wing_airfoil: Airfoil of the main wings, must outlive the airplane.
+		// @param tail_airfoil: Airfoil of the elevator and rudder, must outlive the airplane.
+		Airplane(const Airfoil* wing_airfoil, const Airfoil* tail_airfoil) : engine(4000.0f)
+		{
+			const float wing_span = 5.5f, wing_chord = 1.5f, wing_offset = 2.9f;
+			const float tail_offset = 4.6f;
+
+			wings.push_back(Wing({ -wing_offset, 0.0f, 0.1f }, wing_span, wing_chord, wing_airfoil, UP, 0.2f));
+			wings.push_back(Wing({ +wing_offset, 0.0f, 0.1f }, wing_span, wing_chord, wing_airfoil, UP, 0.2f));
+			wings.push_back(Wing({ 0.0f, 0.0f, tail_offset }, 3.4f, 0.7f, tail_airfoil, UP, 1.0f));
+			wings.push_back(Wing({ 0.0f, 0.6f, tail_offset }, 1.4f, 1.0f, tail_airfoil, RIGHT, 1.0f));
+
+			const inertia::MassProperties& properties = inertia::mass_properties<TrainerAirframe>;
+			set_mass_properties(properties.mass, properties.get_tensor(), properties.get_inverse_tensor());
+		}
+
+		// maps the pilot input to the control surfaces and throttle
+		void set_controls(const Joystick& joystick)
+		{
+			float roll = joystick.leftAileron + joystick.rightAileron;
+			wings[0].control_input = +roll;
+			wings[1].control_input = -roll;
+			wings[2].control_input = -joystick.elevator;
+			wings[3].control_input = -joystick.rudder;
+			engine.throttle = glm::clamp(joystick.throttle, 0.0f, 1.0f);
+		}
+
+		// advances the airplane by one fixed step with the selected integrator
+		void update(float dt)
+		{
+			step(dt, [this]() { apply_forces(); });
+		}
+
+		// adds the aerodynamic and engine forces of the current state
+		void apply_forces()
+		{
+			float air_density = isa::get_air_density(position.y);
+			for (const auto& wing : wings) {
+				wing.apply_forces(*this, air_density);
+			}
+			engine.apply_forces(*this);
+		}
+
+		// rendering transform between the last two steps
+		glm::mat4 get_interpolated_transform(float alpha) const
+		{
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), get_interpolated_position(alpha));
+			return transform * glm::mat4_cast(get_interpolated_orientation(alpha));
+		}
+
+		float get_airspeed() const { return glm::length(velocity); }
+
+		float get_altitude() const { return position.y; }
+	};
+};  // namespace physics
+
+#endif // AIRPLANE_H
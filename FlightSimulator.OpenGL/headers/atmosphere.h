@@ -0,0 +1,191 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+//  International Standard Atmosphere (ISA), all seven layers from sea level to 84.852 km geopotential
+//  altitude (86 km geometric)
+namespace isa
+{
+	// state of the air at one altitude
+	struct AtmosphereSample {
+		float density;         // kg/m^3
+		float pressure;        // Pa
+		float temperature;     // K
+		float speed_of_sound;  // m/s
+	};
+
+	constexpr float SEA_LEVEL_PRESSURE = 101325.0f;
+	constexpr float SEA_LEVEL_TEMPERATURE = 288.15f;
+	constexpr float GAS_CONSTANT = 287.05287f;  // specific gas constant of dry air, J/(kg K)
+	constexpr float HEAT_CAPACITY_RATIO = 1.4f;
+	constexpr float STANDARD_GRAVITY = 9.80665f;
+
+	// base of each layer: geopotential altitude in m and temperature lapse rate in K/m
+	struct AtmosphereLayer {
+		float base_altitude;
+		float lapse_rate;
+	};
+
+	constexpr AtmosphereLayer ATMOSPHERE_LAYERS[] = {
+		{ 0.0f, -0.0065f },     // troposphere
+		{ 11000.0f, 0.0f },     // tropopause
+		{ 20000.0f, 0.001f },   // stratosphere
+		{ 32000.0f, 0.0028f },  // stratosphere
+		{ 47000.0f, 0.0f },     // stratopause
+		{ 51000.0f, -0.0028f }, // mesosphere
+		{ 71000.0f, -0.002f },  // mesosphere
+	};
+	constexpr float ATMOSPHERE_TOP = 84852.0f;
+
+	// exact standard atmosphere at a geopotential altitude, clamped to [-1000 m, ATMOSPHERE_TOP]. done in double precision and
+	// walking the layers from sea level, so it is the reference for the table below and not meant for hot paths
+	inline AtmosphereSample get_standard_atmosphere(float altitude)
+	{
+		double h = std::clamp((double)altitude, -1000.0, (double)ATMOSPHERE_TOP);
+		double temperature = SEA_LEVEL_TEMPERATURE;
+		double pressure = SEA_LEVEL_PRESSURE;
+
+		constexpr int layer_count = sizeof(ATMOSPHERE_LAYERS) / sizeof(ATMOSPHERE_LAYERS[0]);
+		for (int i = 0; i < layer_count; i++) {
+			const AtmosphereLayer& layer = ATMOSPHERE_LAYERS[i];
+			double top = i + 1 < layer_count ? ATMOSPHERE_LAYERS[i + 1].base_altitude : ATMOSPHERE_TOP;
+			// below sea level the troposphere is extended downwards
+			double dh = (i + 1 < layer_count && h > top ? top : h) - layer.base_altitude;
+			double lapse = layer.lapse_rate;
+
+			double layer_temperature = temperature + lapse * dh;
+			if (lapse == 0.0) {
+				pressure *= std::exp(-STANDARD_GRAVITY * dh / (GAS_CONSTANT * temperature));
+			}
+			else {
+				pressure *= std::pow(temperature / layer_temperature, STANDARD_GRAVITY / (GAS_CONSTANT * lapse));
+			}
+			temperature = layer_temperature;
+
+			if (h <= top) {
+				break;
+			}
+		}
+
+		AtmosphereSample sample;
+		sample.temperature = (float)temperature;
+		sample.pressure = (float)pressure;
+		sample.density = (float)(pressure / (GAS_CONSTANT * temperature));
+		sample.speed_of_sound = (float)std::sqrt(HEAT_CAPACITY_RATIO * GAS_CONSTANT * temperature);
+		return sample;
+	}
+
+	// the standard atmosphere tabulated every 50 m from -1000 m to the top of the model and linearly interpolated. layer boundaries
+	// fall on table entries, so temperature and speed of sound are exact up to rounding, and the interpolation error of
+	// the exponential pressure and density is step^2 / (8 H^2) for the local scale height H. measured against
+	// get_standard_atmosphere: at most 1.1e-5 relative error for density and pressure, 3e-7 for temperature and speed
+	// of sound (see the atmosphere benchmark suite)
+	class AtmosphereTable
+	{
+	public:
+		static constexpr float MIN_ALTITUDE = -1000.0f;
+		static constexpr float MAX_ALTITUDE = ATMOSPHERE_TOP;
+		static constexpr float STEP = 50.0f;
+
+		AtmosphereTable()
+		{
+			int count = (int)std::ceil((MAX_ALTITUDE - MIN_ALTITUDE) / STEP) + 1;
+			m_samples.resize(count + 1);
+			for (int i = 0; i < count - 1; i++) {
+				m_samples[i] = get_standard_atmosphere(MIN_ALTITUDE + i * STEP);
+			}
+
+			// the top is not a multiple of the step, so the last entry is extrapolated until interpolating it gives the top
+			const AtmosphereSample& a = m_samples[count - 2];
+			AtmosphereSample top = get_standard_atmosphere(MAX_ALTITUDE);
+			float scale = STEP / (MAX_ALTITUDE - (MIN_ALTITUDE + (count - 2) * STEP));
+			m_samples[count - 1] = { a.density + (top.density - a.density) * scale,
+				a.pressure + (top.pressure - a.pressure) * scale, a.temperature + (top.temperature - a.temperature) * scale,
+				a.speed_of_sound + (top.speed_of_sound - a.speed_of_sound) * scale };
+			// repeated last entry so the upper clamp never reads past the end
+			m_samples[count] = m_samples[count - 1];
+			m_max_coordinate = (MAX_ALTITUDE - MIN_ALTITUDE) / STEP;
+		}
+
+		// everything at once, clamped to the table range
+		AtmosphereSample sample(float altitude) const
+		{
+			int i;
+			float t = coordinate(altitude, i);
+			const AtmosphereSample& a = m_samples[i];
+			const AtmosphereSample& b = m_samples[i + 1];
+			return { a.density + (b.density - a.density) * t, a.pressure + (b.pressure - a.pressure) * t,
+				a.temperature + (b.temperature - a.temperature) * t,
+				a.speed_of_sound + (b.speed_of_sound - a.speed_of_sound) * t };
+		}
+
+		float get_density(float altitude) const
+		{
+			int i;
+			float t = coordinate(altitude, i);
+			return m_samples[i].density + (m_samples[i + 1].density - m_samples[i].density) * t;
+		}
+
+		float get_pressure(float altitude) const
+		{
+			int i;
+			float t = coordinate(altitude, i);
+			return m_samples[i].pressure + (m_samples[i + 1].pressure - m_samples[i].pressure) * t;
+		}
+
+		float get_temperature(float altitude) const
+		{
+			int i;
+			float t = coordinate(altitude, i);
+			return m_samples[i].temperature + (m_samples[i + 1].temperature - m_samples[i].temperature) * t;
+		}
+
+		float get_speed_of_sound(float altitude) const
+		{
+			int i;
+			float t = coordinate(altitude, i);
+			return m_samples[i].speed_of_sound + (m_samples[i + 1].speed_of_sound - m_samples[i].speed_of_sound) * t;
+		}
+
+		// densities of many altitudes
+		void get_density(const float* altitude, float* density, size_t count) const
+		{
+			for (size_t k = 0; k < count; k++) {
+				density[k] = get_density(altitude[k]);
+			}
+		}
+
+		// full samples of many altitudes
+		void sample(const float* altitude, AtmosphereSample* samples, size_t count) const
+		{
+			for (size_t k = 0; k < count; k++) {
+				samples[k] = sample(altitude[k]);
+			}
+		}
+
+	private:
+		std::vector<AtmosphereSample> m_samples;
+		float m_max_coordinate = 0.0f;
+
+		// table index and blend factor of an altitude, clamped without branches
+		float coordinate(float altitude, int& index) const
+		{
+			float c = std::min(std::max((altitude - MIN_ALTITUDE) * (1.0f / STEP), 0.0f), m_max_coordinate);
+			index = (int)c;
+			return c - index;
+		}
+	};
+
+	// shared table of the standard atmosphere, built on first use
+	inline const AtmosphereTable& get_atmosphere_table()
+	{
+		static const AtmosphereTable table;
+		return table;
+	}
+};  // namespace isa
+
+#endif // ATMOSPHERE_H
@@ -0,0 +1,98 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "aero_batch.h"
+#include "joystick.h"
+
+// Gains and update rates of the autopilot. Altitude errors become a climb rate, the climb rate error a pitch,
+// heading errors a bank angle; pitch and bank are then flown with proportional control damped by the body rates.
+struct AutopilotSettings {
+    float climbRatePerMetre = 0.1f;
+    float maxClimbRate = 5.0f; // m/s
+    float pitchPerClimbRate = 0.04f;
+    float maxPitch = 0.25f; // rad
+    float elevatorPerPitch = 2.0f;
+    float elevatorPerClimbRateIntegral = 0.02f;
+    float elevatorPerPitchRate = 0.5f;
+    float bankPerHeading = 1.5f;
+    float maxBank = 0.5f; // rad
+    float aileronPerBank = 1.0f;
+    float aileronPerRollRate = 0.3f;
+    float throttlePerSpeed = 0.3f;
+    float cruiseThrottle = 0.6f;
+
+    // Gain schedule: the surface gains hold at the reference speed at sea level and scale with the reference over the
+    // dynamic pressure elsewhere, within the bounds.
+    float referenceSpeed = 55.0f; // m/s
+    float minGainScale = 0.5f;
+    float maxGainScale = 2.0f;
+
+    // Aircraft closer to the view than the full rate distance run their autopilot on every step. Beyond it they run
+    // it every interval, doubling with every doubling of the distance up to the far levels.
+    float fullRateDistance = 2000.0f; // m
+    float interval = 0.05f; // s
+    int farLevels = 3;
+};
+
+// State of up to CAPACITY aircraft gathered for one run of the autopilot, one array per component. Entries past
+// count hold whatever was gathered before, whole vectors are run and their results are not read.
+struct AutopilotBatch {
+    static constexpr int CAPACITY = 64;
+
+    int count = 0;
+    int index[CAPACITY]; // Aircraft each entry was gathered from, for scattering the commands back.
+
+    // Inputs
+    alignas(64) float orientationW[CAPACITY];
+    alignas(64) float orientationX[CAPACITY];
+    alignas(64) float orientationY[CAPACITY];
+    alignas(64) float orientationZ[CAPACITY];
+    alignas(64) float velocityX[CAPACITY]; // m/s, world space
+    alignas(64) float velocityY[CAPACITY];
+    alignas(64) float velocityZ[CAPACITY];
+    alignas(64) float angularVelocityX[CAPACITY]; // rad/s, world space
+    alignas(64) float angularVelocityY[CAPACITY];
+    alignas(64) float angularVelocityZ[CAPACITY];
+    alignas(64) float positionY[CAPACITY]; // m
+    alignas(64) float density[CAPACITY]; // kg/m^3
+    alignas(64) float targetHeading[CAPACITY]; // Radians clockwise from the -Z axis seen from above.
+    alignas(64) float targetAltitude[CAPACITY]; // m
+    alignas(64) float targetSpeed[CAPACITY]; // m/s
+    alignas(64) float stepSize[CAPACITY]; // Seconds since the previous run for the aircraft.
+
+    // Integral of the climb rate error, read and written.
+    alignas(64) float pitchIntegral[CAPACITY];
+
+    // Commands, the same inputs as a Joystick with both ailerons in one.
+    alignas(64) float aileron[CAPACITY];
+    alignas(64) float elevator[CAPACITY];
+    alignas(64) float rudder[CAPACITY];
+    alignas(64) float throttle[CAPACITY];
+
+    // Gets the commands of an entry as the Joystick a pilot would give them with.
+    Joystick GetControls(int entry) const;
+};
+
+// Autopilot turns the state of many aircraft into surface and throttle commands at once, running its loops over a
+// batch with the widest vector instructions the processor has.
+class Autopilot
+{
+public:
+    explicit Autopilot(const AutopilotSettings& settings = AutopilotSettings());
+
+    // Runs the loops of the aircraft of a batch, writing their commands and pitch integrals.
+    // @param isa: Instruction set of the kernel, as for evaluate_aero. There is no scalar kernel, Reference runs SSE2.
+    void Run(AutopilotBatch& batch, physics::AeroIsa isa = physics::AeroIsa::Best) const;
+
+    // Gets the seconds between runs for an aircraft at a distance from the view, 0 to run on every step.
+    // @param distanceSquared: Squared distance to the view, m^2.
+    float GetInterval(float distanceSquared) const;
+
+    const AutopilotSettings& GetSettings() const { return m_settings; }
+
+private:
+    AutopilotSettings m_settings;
+    float m_referencePressure;
+};
+
+#endif // AUTOPILOT_H
@@ -0,0 +1,166 @@
+#ifndef AUTOPILOT_KERNEL_H
+#define AUTOPILOT_KERNEL_H
+
+#include <cstddef>
+
+#include "simd.h"
+
+// The autopilot loops as a template over the simd vector types, instantiated once per instruction set in
+// autopilot.cpp, autopilot_avx2.cpp and autopilot_avx512.cpp like the aero kernel.
+struct AutopilotArgs {
+    // Gains, see AutopilotSettings.
+    float climbRatePerMetre;
+    float maxClimbRate;
+    float pitchPerClimbRate;
+    float maxPitch;
+    float elevatorPerPitch;
+    float elevatorPerClimbRateIntegral;
+    float elevatorPerPitchRate;
+    float bankPerHeading;
+    float maxBank;
+    float aileronPerBank;
+    float aileronPerRollRate;
+    float throttlePerSpeed;
+    float cruiseThrottle;
+    float referencePressure; // Dynamic pressure the surface gains are tuned for, Pa.
+    float minGainScale;
+    float maxGainScale;
+
+    // One entry per aircraft.
+    const float* orientationW;
+    const float* orientationX;
+    const float* orientationY;
+    const float* orientationZ;
+    const float* velocityX;
+    const float* velocityY;
+    const float* velocityZ;
+    const float* angularVelocityX;
+    const float* angularVelocityY;
+    const float* angularVelocityZ;
+    const float* positionY;
+    const float* density; // kg/m^3
+    const float* targetHeading;
+    const float* targetAltitude;
+    const float* targetSpeed;
+    const float* stepSize; // Seconds since the previous run of the autopilot of the aircraft.
+    float* pitchIntegral; // Read and written.
+    float* aileron; // Receive the commands.
+    float* elevator;
+    float* rudder;
+    float* throttle;
+    size_t count; // Aircraft, whole vectors only.
+};
+
+void RunAutopilotSse2(const AutopilotArgs& args);
+void RunAutopilotAvx2(const AutopilotArgs& args);
+void RunAutopilotAvx512(const AutopilotArgs& args);
+
+template <typename V>
+V ClampAutopilot(V x, V low, V high)
+{
+    return Min(Max(x, low), high);
+}
+
+// atan2(y, x) in radians, the polynomial of abramowitz and stegun 4.4.49 on the octant, within 1e-5 rad.
+template <typename V>
+V Atan2Autopilot(V y, V x)
+{
+    const V zero(0.0f);
+    V ax = Abs(x), ay = Abs(y);
+    V high = Max(ax, ay);
+    V t = Min(ax, ay) / Select(high > zero, high, V(1.0f));
+    V t2 = t * t;
+    V p = V(0.0208351f);
+    p = MulAdd(p, t2, V(-0.0851330f));
+    p = MulAdd(p, t2, V(0.1801410f));
+    p = MulAdd(p, t2, V(-0.3302995f));
+    p = MulAdd(p, t2, V(0.9998660f));
+    V r = p * t;
+    r = Select(ay > ax, V(1.5707963268f) - r, r);
+    r = Select(x < zero, V(3.1415926536f) - r, r);
+    return Select(y < zero, -r, r);
+}
+
+// asin(x) in radians for x in [-1, 1], abramowitz and stegun 4.4.45, within 7e-5 rad.
+template <typename V>
+V AsinAutopilot(V x)
+{
+    V a = Abs(x);
+    V p = V(-0.0187293f);
+    p = MulAdd(p, a, V(0.0742610f));
+    p = MulAdd(p, a, V(-0.2121144f));
+    p = MulAdd(p, a, V(1.5707288f));
+    V r = V(1.5707963268f) - Sqrt(Max(V(1.0f) - a, V(0.0f))) * p;
+    return Select(x < V(0.0f), -r, r);
+}
+
+// Altitude through climb rate and pitch, heading through bank, speed through throttle, one lane per aircraft. The
+// surface gains are scaled by the reference over the dynamic pressure, as the surfaces bite harder the faster the
+// air flows over them, so the loops respond alike from the stall to full speed.
+template <typename V>
+void RunAutopilotKernel(const AutopilotArgs& a)
+{
+    const V zero(0.0f), one(1.0f), two(2.0f), half(0.5f);
+    const V pi(3.1415926536f), twoPi(6.2831853072f), inverseTwoPi(1.0f / 6.2831853072f);
+    const V climbRatePerMetre(a.climbRatePerMetre), maxClimbRate(a.maxClimbRate);
+    const V pitchPerClimbRate(a.pitchPerClimbRate), maxPitch(a.maxPitch);
+    const V elevatorPerPitch(a.elevatorPerPitch), elevatorPerClimbRateIntegral(a.elevatorPerClimbRateIntegral);
+    const V elevatorPerPitchRate(a.elevatorPerPitchRate);
+    const V bankPerHeading(a.bankPerHeading), maxBank(a.maxBank);
+    const V aileronPerBank(a.aileronPerBank), aileronPerRollRate(a.aileronPerRollRate);
+    const V throttlePerSpeed(a.throttlePerSpeed), cruiseThrottle(a.cruiseThrottle);
+    const V referencePressure(a.referencePressure), minGainScale(a.minGainScale), maxGainScale(a.maxGainScale);
+
+    for (size_t i = 0; i + V::Width <= a.count; i += V::Width)
+    {
+        V w = V::Load(a.orientationW + i), x = V::Load(a.orientationX + i);
+        V y = V::Load(a.orientationY + i), z = V::Load(a.orientationZ + i);
+
+        // Columns of the rotation matrix: right is the body x axis, up y and backward z
+        V rightX = one - two * (y * y + z * z), rightY = two * (x * y + w * z), rightZ = two * (x * z - w * y);
+        V upY = one - two * (x * x + z * z);
+        V backX = two * (x * z + w * y), backY = two * (y * z - w * x), backZ = one - two * (x * x + y * y);
+
+        V angularX = V::Load(a.angularVelocityX + i);
+        V angularY = V::Load(a.angularVelocityY + i);
+        V angularZ = V::Load(a.angularVelocityZ + i);
+        V pitchRate = rightX * angularX + rightY * angularY + rightZ * angularZ;
+        V rollRate = backX * angularX + backY * angularY + backZ * angularZ;
+
+        V pitch = AsinAutopilot(ClampAutopilot(-backY, -one, one));
+        V bank = Atan2Autopilot(-rightY, upY); // Positive with the right wing down.
+        V heading = Atan2Autopilot(-backX, backZ);
+
+        V velocityX = V::Load(a.velocityX + i), velocityY = V::Load(a.velocityY + i);
+        V velocityZ = V::Load(a.velocityZ + i);
+        V speedSquared = velocityX * velocityX + velocityY * velocityY + velocityZ * velocityZ;
+        V pressure = half * V::Load(a.density + i) * speedSquared;
+        V scale = ClampAutopilot(referencePressure / Max(pressure, V(1.0e-3f)), minGainScale, maxGainScale);
+        V dt = V::Load(a.stepSize + i);
+
+        // The integral of the climb rate error finds the elevator that trims the current speed, so level flight
+        // settles on the target altitude
+        V climbRate = ClampAutopilot((V::Load(a.targetAltitude + i) - V::Load(a.positionY + i)) * climbRatePerMetre,
+            -maxClimbRate, maxClimbRate);
+        V climbError = climbRate - velocityY;
+        V targetPitch = ClampAutopilot(climbError * pitchPerClimbRate, -maxPitch, maxPitch);
+        V pitchIntegral = ClampAutopilot(MulAdd(climbError * elevatorPerClimbRateIntegral * scale, dt,
+            V::Load(a.pitchIntegral + i)), -one, one);
+        pitchIntegral.Store(a.pitchIntegral + i);
+        V elevator = ((targetPitch - pitch) * elevatorPerPitch - pitchRate * elevatorPerPitchRate) * scale +
+            pitchIntegral;
+        ClampAutopilot(elevator, -one, one).Store(a.elevator + i);
+
+        V headingError = V::Load(a.targetHeading + i) - heading;
+        headingError = headingError - twoPi * Floor((headingError + pi) * inverseTwoPi);
+        V targetBank = ClampAutopilot(headingError * bankPerHeading, -maxBank, maxBank);
+        V aileron = ((targetBank - bank) * aileronPerBank + rollRate * aileronPerRollRate) * scale;
+        ClampAutopilot(aileron, -one, one).Store(a.aileron + i);
+        zero.Store(a.rudder + i);
+
+        V throttle = MulAdd(V::Load(a.targetSpeed + i) - Sqrt(speedSquared), throttlePerSpeed, cruiseThrottle);
+        ClampAutopilot(throttle, zero, one).Store(a.throttle + i);
+    }
+}
+
+#endif // AUTOPILOT_KERNEL_H
@@ -0,0 +1,125 @@
+#ifndef BIT_STREAM_H
+#define BIT_STREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// BitWriter appends values of any width up to 32 bits to a byte buffer, least significant bit first.
+class BitWriter
+{
+public:
+    // Appends the low count bits of value.
+    void Write(uint32_t value, int count)
+    {
+        if (count < 32)
+            value &= (1u << count) - 1;
+        m_accumulator |= (uint64_t)value << m_bits;
+        m_bits += count;
+        while (m_bits >= 8)
+        {
+            m_bytes.push_back((uint8_t)m_accumulator);
+            m_accumulator >>= 8;
+            m_bits -= 8;
+        }
+    }
+
+    // Pads the last byte with zero bits.
+    void Flush()
+    {
+        if (m_bits > 0)
+            m_bytes.push_back((uint8_t)m_accumulator);
+        m_accumulator = 0;
+        m_bits = 0;
+    }
+
+    // Starts over, keeping the allocation.
+    void Clear()
+    {
+        m_bytes.clear();
+        m_accumulator = 0;
+        m_bits = 0;
+    }
+
+    const std::vector<uint8_t>& GetBytes() const { return m_bytes; }
+
+    // Gets the number of bits written so far.
+    size_t GetBitCount() const { return m_bytes.size() * 8 + m_bits; }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    uint64_t m_accumulator = 0;
+    int m_bits = 0;
+};
+
+// BitReader reads what a BitWriter wrote. Reading past the end returns zero bits and sets the overrun flag.
+class BitReader
+{
+public:
+    BitReader(const uint8_t* pData, size_t size) : m_data(pData), m_size(size) {}
+
+    uint32_t Read(int count)
+    {
+        while (m_bits < count)
+        {
+            uint64_t byte = 0;
+            if (m_position < m_size)
+                byte = m_data[m_position];
+            else
+                m_overrun = true;
+            m_position++;
+            m_accumulator |= byte << m_bits;
+            m_bits += 8;
+        }
+        uint32_t value = (uint32_t)(count < 32 ? m_accumulator & ((1ull << count) - 1) : m_accumulator);
+        m_accumulator >>= count;
+        m_bits -= count;
+        return value;
+    }
+
+    // Returns true if a read went past the end of the data.
+    bool HasOverrun() const { return m_overrun; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+    uint64_t m_accumulator = 0;
+    int m_bits = 0;
+    bool m_overrun = false;
+};
+
+// Float bits for exact, lossless comparison and XOR deltas.
+inline uint32_t FloatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float BitsToFloat(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Appends raw bytes, for saving plain data state byte for byte.
+inline void WriteBytes(std::vector<uint8_t>& data, const void* pSource, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)pSource;
+    data.insert(data.end(), bytes, bytes + size);
+}
+
+// Copies the next size bytes and moves pData past them.
+// @return: False if fewer bytes are left before pEnd, nothing is copied then.
+inline bool ReadBytes(const uint8_t*& pData, const uint8_t* pEnd, void* pTarget, size_t size)
+{
+    if ((size_t)(pEnd - pData) < size)
+        return false;
+    memcpy(pTarget, pData, size);
+    pData += size;
+    return true;
+}
+
+#endif // BIT_STREAM_H
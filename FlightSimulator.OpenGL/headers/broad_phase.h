@@ -0,0 +1,90 @@
+#ifndef BROAD_PHASE_H
+#define BROAD_PHASE_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Two entities that came closer than the distance asked for, first < second.
+struct BroadPhasePair {
+    int first;
+    int second;
+    float distance; // Between the centres, m.
+};
+
+// BroadPhase finds entities near each other without testing every pair. Each entity goes into the cell of a uniform
+// 3D grid that holds its centre, and the cells are hashed into a table with about two buckets per entity, so the grid
+// is unbounded and costs memory only for the entities. The grid is loose: entities are not split across the cells
+// they overlap, queries reach out by the largest radius instead. A query only visits the cells around it and takes
+// the entities of each cell from its bucket, so building the table and finding every close pair both cost about
+// linear time in the number of entities, as long as a cell holds a few of them.
+//
+// Build runs in parallel: the buckets are counted with atomics, laid out by a prefix sum and filled in parallel, and
+// every bucket is then sorted by entity, so the results do not depend on thread timing and lockstep simulations can
+// act on them.
+class BroadPhase
+{
+public:
+    // @param cellSize: Edge of a grid cell in metres. About twice the reach of the usual query, its distance plus the
+    // radii, keeps it within 2x2x2 cells.
+    explicit BroadPhase(float cellSize = 250.0f);
+
+    // Replaces the entities.
+    // @param x, y, z: Centre arrays.
+    // @param radius: Radius array, or nullptr when every entity is a point.
+    void Build(const float* x, const float* y, const float* z, const float* radius, int count);
+
+    // Finds every pair of entities whose spheres come closer than a distance, in parallel.
+    // @param distance: Largest gap between the spheres, m.
+    // @param pairs: Receives the pairs ordered by first and then second entity.
+    void FindPairs(float distance, std::vector<BroadPhasePair>& pairs) const;
+
+    // Finds the entities whose sphere comes closer than a distance to a point.
+    // @param entities: Receives the entities in ascending order.
+    void Query(const glm::vec3& point, float distance, std::vector<int>& entities) const;
+
+    int GetCount() const { return m_count; }
+
+    float GetCellSize() const { return m_cellSize; }
+
+    // Gets the number of buckets of the hash table.
+    int GetBucketCount() const { return (int)m_mask + 1; }
+
+private:
+    float m_cellSize;
+    float m_inverseCellSize;
+    float m_maxRadius = 0.0f;
+    int m_count = 0;
+    uint32_t m_mask = 0;
+
+    std::vector<uint32_t> m_buckets; // Bucket of every entity.
+    std::unique_ptr<std::atomic<int>[]> m_counters; // Entities per bucket, then the next free slot of each.
+    std::vector<int> m_bucketStart; // First slot of every bucket, and the end of the last one.
+
+    // Entities by slot, so the entities of a bucket are contiguous, and their spheres and cells in the same order.
+    // Cells that hash to the same bucket share it, a query takes only the entities of the cell it visits.
+    std::vector<int> m_entities;
+    std::vector<glm::ivec3> m_cells;
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<float> m_radius;
+
+    // Gets the cell coordinate of a world coordinate.
+    int GetCell(float coordinate) const { return (int)std::floor(coordinate * m_inverseCellSize); }
+
+    // Hashes a cell into a bucket.
+    uint32_t GetBucket(int cx, int cy, int cz) const
+    {
+        return ((uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u ^ (uint32_t)cz * 83492791u) & m_mask;
+    }
+
+    // Calls func(slot) for every entity in the cells a box touches.
+    template <typename Func>
+    void ForEachSlot(const glm::vec3& min, const glm::vec3& max, Func&& func) const;
+};
+
+#endif // BROAD_PHASE_H
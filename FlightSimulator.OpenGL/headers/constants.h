@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstddef>
+
 constexpr char terrainVertexShaderPath[] = "./Shaders/terrain.vs";
 constexpr char terrainFragmentShaderPath[] = "./Shaders/terrain.fs";
 constexpr char planeModelVertexShaderPath[] = "./Shaders/modelLoading.vs";
@@ -19,6 +21,10 @@ constexpr char terrainShaderMaxHeightUniformName[] = "gMaxHeight";
 constexpr char heightMapFilePath[] = "data\\heightmap.save";
 constexpr char planeModelPath[] = "./Models/plane/Aereo O.obj";
 
+// Per frame budget for streaming a regenerated terrain mesh to the GPU.
+constexpr size_t terrainUploadBytesPerFrame = 8 * 1024 * 1024;
+constexpr float terrainUploadMillisecondsPerFrame = 2.0f;
+
 constexpr char terrainTexture1Path[] = "./terrain/textures/rock1.jpg";
 constexpr char terrainTexture2Path[] = "./terrain/textures/rock2.jpg";
 constexpr char terrainTexture4Path[] = "./terrain/textures/grass1.png";
@@ -5,7 +5,7 @@
 #include <vector>
 
 // NACA 2412 (naca2412-il) Xfoil prediction polar at RE=1,000,000 Ncrit=9
-const std::vector<glm::vec3> NACA_2412_data = {
+inline const std::vector<glm::vec3> NACA_2412_data = {
     {-17.500f, -1.1118f, 0.08608f}, {-17.250f, -1.1738f, 0.07238f}, {-17.000f, -1.2296f, 0.05928f},
     {-16.750f, -1.2629f, 0.04931f}, {-16.500f, -1.2790f, 0.04253f}, {-16.250f, -1.2852f, 0.03792f},
     {-16.000f, -1.2869f, 0.03455f}, {-15.750f, -1.2853f, 0.03207f}, {-15.500f, -1.2815f, 0.03016f},
@@ -58,7 +58,7 @@ const std::vector<glm::vec3> NACA_2412_data = {
 };
 
 // NACA 0012 (n0012-il) Xfoil prediction polar at RE=1,000,000 Ncrit=9
-const std::vector<glm::vec3> NACA_0012_data = {
+inline const std::vector<glm::vec3> NACA_0012_data = {
     {-18.500f, -1.2258f, 0.10236f}, {-18.250f, -1.2456f, 0.09505f}, {-18.000f, -1.2659f, 0.08782f},
     {-17.750f, -1.2852f, 0.08088f}, {-17.500f, -1.3031f, 0.07429f}, {-17.250f, -1.3193f, 0.06814f},
     {-17.000f, -1.3322f, 0.06256f}, {-16.750f, -1.3427f, 0.05745f}, {-16.500f, -1.3519f, 0.05263f},
@@ -109,7 +109,7 @@ const std::vector<glm::vec3> NACA_0012_data = {
     {17.250f, 1.3218f, 0.06802f},   {17.500f, 1.3059f, 0.07416f},   {17.750f, 1.2880f, 0.08075f},
     {18.000f, 1.2685f, 0.08773f},   {18.250f, 1.2485f, 0.09493f},   {18.500f, 1.2284f, 0.10229f} };
 
-float skyboxVertices[] = {
+inline float skyboxVertices[] = {
     // positions          
     -1.0f,  1.0f, -1.0f,
     -1.0f, -1.0f, -1.0f,
@@ -155,7 +155,7 @@ float skyboxVertices[] = {
 };
 
 // Skybox images
-std::vector<std::string> skyboxFaces = {
+inline std::vector<std::string> skyboxFaces = {
     "./images/skybox/Daylight Box_Right.bmp",
     "./images/skybox/Daylight Box_Left.bmp",
     "./images/skybox/Daylight Box_Top.bmp",
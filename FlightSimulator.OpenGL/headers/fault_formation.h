@@ -0,0 +1,55 @@
+#ifndef FAULT_FORMATION_H
+#define FAULT_FORMATION_H
+
+#include <random>
+#include <vector>
+#include <ogldev_array_2d.h>
+
+// Fault formation heightmap generation. Pure CPU code without any GL or terrain state, so it runs on worker threads
+// and in headless tools such as the benchmark, and every stage can be called on its own.
+class FaultFormation
+{
+public:
+	// Generates a complete fault formation heightmap: faults, FIR filter and normalization.
+	// @param heightMap: Heightmap of terrainSize x terrainSize posts, initialized to zero.
+	static void GenerateHeightMap(Array2D<float>& heightMap, int terrainSize, int iterations, float minHeight, float maxHeight,
+		float filter, unsigned int seed);
+
+	// Raises one side of `iterations` random fault lines, with the raise height decreasing every iteration.
+	static void ApplyFaults(Array2D<float>& heightMap, int terrainSize, int iterations, float minHeight, float maxHeight, unsigned int seed);
+
+	// Smooths the heightmap with a single pole FIR filter run in all four directions.
+	static void ApplyFIRFilter(Array2D<float>& heightMap, int terrainSize, float filter);
+
+private:
+	struct TerrainPoint
+	{
+		int x = 0;
+		int z = 0;
+
+		void Print()
+		{
+			printf("[%d, %d]", x, z);
+		}
+
+		bool IsEqual(TerrainPoint& p) const
+		{
+			return ((x == p.x) && (z == p.z));
+		}
+	};
+
+	// A fault line through p1 along (dirX, dirZ); every post on its left side is raised by height.
+	struct FaultLine
+	{
+		TerrainPoint p1;
+		int dirX = 0;
+		int dirZ = 0;
+		float height = 0.0f;
+	};
+
+	static void ApplyFaultsToRows(Array2D<float>& heightMap, int terrainSize, const std::vector<FaultLine>& faults, int firstRow, int lastRow);
+	static float FIRFilterSinglePoint(Array2D<float>& heightMap, int x, int z, float prevVal, float filter);
+	static void GenRandomTerrainPoints(std::mt19937& rng, int terrainSize, TerrainPoint& p1, TerrainPoint& p2);
+};
+
+#endif // FAULT_FORMATION_H
@@ -11,29 +11,14 @@ public:
 	FaultFormationTerrain(const GLchar* vShaderPath, const GLchar* fShaderPath)
 	: BaseTerrain(vShaderPath, fShaderPath) {}
 
-	void CreateFaultFormation(int terrainSize, int iterations, float minHeight, float maxHeight, float FIRfilter);
-private:
-	struct TerrainPoint
-	{
-		int x = 0;
-		int z = 0;
-
-		void Print()
-		{
-			printf("[%d, %d]", x, z);
-		}
+	void CreateFaultFormation(int terrainSize, int iterations, float minHeight, float maxHeight, float FIRfilter, unsigned int seed = 1);
 
-		bool IsEqual(TerrainPoint& p) const
-		{
-			return ((x == p.x) && (z == p.z));
-		}
-	};
+	// Same as CreateFaultFormation, but the heightmap and mesh are built on worker threads while the current terrain
+	// keeps rendering. The new terrain is swapped in by UpdateRegeneration() once it has been uploaded.
+	void CreateFaultFormationAsync(int terrainSize, int iterations, float minHeight, float maxHeight, float FIRfilter, unsigned int seed = 1);
 
+private:
 	void SetupShaderHeights(float minHeight, float maxHeight);
-	void CreateFaultFormationInternal(int iterations, float minHeight, float maxHeight, float filter);
-	float FIRFilterSinglePoint(int x, int z, float prevVal, float filter);
-	void ApplyFIRFilter(float filter);
-	void GenRandomTerrainPoints(TerrainPoint& p1, TerrainPoint& p2);
 };
 
-#endif
\ No newline at end of file
+#endif
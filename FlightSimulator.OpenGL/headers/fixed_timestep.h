@@ -0,0 +1,63 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+
+namespace physics
+{
+	// accumulates frame time and runs the simulation in steps of a fixed size, independent of the frame rate
+	class FixedTimestep
+	{
+	public:
+		// @param step_size: Simulated seconds per step, e.g. 1/240.
+		// @param max_steps: Steps run at most per frame, bounds the physics cost of a frame spike.
+		explicit FixedTimestep(float step_size = 1.0f / 240.0f, int max_steps = 8)
+			: m_step_size(step_size), m_max_steps(max_steps)
+		{
+		}
+
+		// adds the frame time and calls step(step_size) for every whole step that is due. time beyond max_steps is
+		// dropped so a long frame slows the simulation down instead of making the next frames even longer
+		// @param frame_time: Seconds since the last call.
+		// @param step: Callable advancing the simulation by the given number of seconds.
+		// @return: Number of steps run.
+		template <typename Step>
+		int advance(float frame_time, Step&& step)
+		{
+			m_accumulator += std::max(frame_time, 0.0f);
+
+			int steps = 0;
+			while (m_accumulator >= m_step_size && steps < m_max_steps) {
+				step(m_step_size);
+				m_accumulator -= m_step_size;
+				steps++;
+			}
+
+			if (m_accumulator >= m_step_size) {
+				float kept = m_step_size * 0.999f;
+				m_dropped_time += m_accumulator - kept;
+				m_accumulator = kept;
+			}
+
+			return steps;
+		}
+
+		// fraction of a step left in the accumulator, used to interpolate the rendered state between the last two steps
+		float alpha() const { return m_accumulator / m_step_size; }
+
+		float step_size() const { return m_step_size; }
+
+		int max_steps() const { return m_max_steps; }
+
+		// simulated seconds skipped because of the max_steps cap
+		float dropped_time() const { return m_dropped_time; }
+
+	private:
+		float m_step_size;
+		int m_max_steps;
+		float m_accumulator = 0.0f;
+		float m_dropped_time = 0.0f;
+	};
+};  // namespace physics
+
+#endif // FIXED_TIMESTEP_H
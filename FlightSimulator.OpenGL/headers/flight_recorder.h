@@ -0,0 +1,256 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "bit_stream.h"
+#include "joystick.h"
+#include "lockstep_simulation.h"
+#include "mapped_file.h"
+#include "spsc_ring_buffer.h"
+
+// On disk layout of a flight recording, as written by FlightRecorder.
+//
+//   FlightRecordingHeader
+//   FlightRecordingChunk       followed by byteCount bytes of samples or of a keyframe, repeated
+//   FlightRecordingIndexEntry  indexCount entries, one per chunk in file order, 8 byte aligned
+//
+// A sample chunk holds consecutive steps of a LockstepSimulation: the input each step ran with and the player state
+// after it. Each of its floats is stored as the XOR with the same float of the previous sample: a single 0 bit when
+// unchanged, otherwise a 1 bit, 5 bits of leading zeros, 5 bits of length - 1 and the bits in between. Inputs rarely
+// change and the state changes in the low bits, so a sample takes a fraction of its raw size, and nothing is rounded,
+// so a replay can compare its state bit for bit. The first sample of a chunk is stored against zero, so chunks decode
+// on their own.
+//
+// A keyframe chunk holds the whole simulation state, as saved by LockstepSimulation::SaveState, at the start of a step.
+// There is one every keyframeInterval steps from the first recorded step and a sample chunk starts at each, so seeking
+// restores the last keyframe before the target and re-simulates at most keyframeInterval steps, no matter how long
+// the recording is.
+//
+// The index is written last, when the recording stops, and its offset patched into the header. A recording cut short
+// has none and is read by walking the chunks instead. All values are little endian.
+constexpr char FLIGHT_RECORDING_MAGIC[8] = { 'F', 'S', 'F', 'L', 'T', 'R', 'E', 'C' };
+constexpr uint32_t FLIGHT_RECORDING_VERSION = 3;
+
+enum class FlightChunkType : uint32_t {
+    Samples = 1,
+    Keyframe = 2,
+};
+
+struct FlightRecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize; // sizeof(FlightRecordingHeader), the offset of the first chunk.
+    uint64_t indexOffset; // File offset of the index, 0 if the recording did not stop cleanly.
+    uint64_t indexCount;
+    uint32_t keyframeInterval; // Steps between keyframes.
+    uint32_t reserved;
+    LockstepSettings settings; // What the recorded simulation started from.
+};
+
+struct FlightRecordingChunk {
+    FlightChunkType type;
+    uint32_t sampleCount; // 0 for a keyframe.
+    uint64_t step; // Step of the first sample, or the step count of the keyframe state.
+    uint32_t byteCount; // Size of the data that follows.
+    uint32_t reserved;
+};
+
+struct FlightRecordingIndexEntry {
+    FlightChunkType type;
+    uint32_t sampleCount;
+    uint64_t step;
+    uint64_t offset; // File offset of the FlightRecordingChunk.
+};
+
+// One recorded step.
+struct FlightSample {
+    uint64_t step; // Index of the step, 0 for the first after a reset.
+    Joystick input; // Controls the step ran with.
+    glm::vec3 position; // Player state after the step.
+    glm::quat orientation;
+    glm::vec3 velocity;
+    glm::vec3 angularVelocity;
+};
+
+// Counters of a recording.
+struct FlightRecorderStats {
+    uint64_t samples = 0; // Samples written.
+    uint64_t dropped = 0; // Samples lost because the writer fell behind.
+    uint64_t keyframes = 0; // Keyframes written.
+    uint64_t droppedKeyframes = 0; // Keyframes lost because the writer fell behind.
+    uint64_t bytes = 0; // Bytes written, header included.
+};
+
+// FlightRecorder streams a LockstepSimulation to disk without slowing the simulation down. Record only copies the
+// sample into a lock-free ring buffer, and a due keyframe costs one copy of the simulation state into a second one; a
+// writer thread of its own encodes the samples into chunks and writes them and the keyframes. If the writer falls
+// behind far enough to fill a ring, samples or keyframes are dropped and counted instead of waiting.
+class FlightRecorder
+{
+public:
+    // Samples per chunk.
+    static constexpr int CHUNK_SAMPLES = 256;
+
+    // @param ringCapacity: Samples the ring buffer holds, 8192 are 34 s of steps at 240 Hz.
+    // @param keyframeInterval: Steps between keyframes, 2400 are 10 s at 240 Hz.
+    explicit FlightRecorder(size_t ringCapacity = 8192, uint32_t keyframeInterval = 2400);
+
+    // Stops a recording in progress.
+    ~FlightRecorder();
+
+    // Creates the file, starts the writer thread and records a keyframe of the simulation, so the recording starts
+    // at the current step.
+    // @param pFilename: Path of the recording.
+    // @param simulation: The simulation to record, between two steps.
+    // @return: False if a recording is in progress or the file cannot be created.
+    bool Start(const char* pFilename, const LockstepSimulation& simulation);
+
+    // Hands a sample to the writer thread. Called from the simulation thread, never blocks.
+    void Record(const FlightSample& sample);
+
+    // Hands a keyframe of the simulation to the writer thread when one is due at its step count. Called after every
+    // step and its Record, from the simulation thread, never blocks.
+    void RecordKeyframe(const LockstepSimulation& simulation);
+
+    // Writes what is left and the index, and closes the file.
+    void Stop();
+
+    // Returns true between Start and Stop.
+    bool IsRecording() const { return m_file != nullptr; }
+
+    // Gets the counters of the current or last recording.
+    FlightRecorderStats GetStats() const;
+
+    // Fills a sample from the input of a step and the player state after it.
+    static FlightSample MakeSample(const LockstepSimulation& simulation, const Joystick& input);
+
+private:
+    // Simulation state on its way to the writer thread.
+    struct Keyframe {
+        uint64_t step = 0;
+        std::vector<uint8_t> state;
+    };
+
+    SpscRingBuffer<FlightSample> m_ring;
+    SpscRingBuffer<Keyframe> m_keyframes;
+    uint32_t m_keyframeInterval;
+    uint64_t m_startStep = 0;
+    std::thread m_writer;
+    std::atomic<bool> m_stopping{ false };
+    FILE* m_file = nullptr;
+    FlightRecordingHeader m_header{};
+
+    // Owned by the writer thread while recording.
+    BitWriter m_chunk;
+    FlightSample m_previous{};
+    uint64_t m_chunkFirstStep = 0;
+    uint32_t m_chunkSamples = 0;
+    Keyframe m_pendingKeyframe; // Popped, but for a step not reached by the samples yet.
+    bool m_hasPendingKeyframe = false;
+    std::vector<FlightRecordingIndexEntry> m_index;
+
+    std::atomic<uint64_t> m_samples{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+    std::atomic<uint64_t> m_keyframeCount{ 0 };
+    std::atomic<uint64_t> m_droppedKeyframes{ 0 };
+    std::atomic<uint64_t> m_bytes{ 0 };
+
+    // Body of the writer thread.
+    void WriteSamples();
+
+    // Writes the keyframes due at or before a step, ending the current chunk first, so a chunk starts at each.
+    // @param all: Writes every keyframe left instead, when stopping.
+    void WriteKeyframes(uint64_t step, bool all);
+
+    // Appends a sample to the current chunk, starting a new one when it is full or the steps are not consecutive.
+    void Encode(const FlightSample& sample);
+
+    // Writes the current chunk.
+    void WriteChunk();
+
+    // Writes a chunk header and its data and adds it to the index.
+    void WriteChunk(FlightChunkType type, uint64_t step, uint32_t sampleCount, const uint8_t* pData, size_t size);
+};
+
+// FlightRecording reads a recording back from a memory-mapped file. Only the chunks actually touched are decoded, so
+// seeking into a long recording costs the same as into a short one.
+class FlightRecording
+{
+public:
+    // Maps a recording and reads its index, or rebuilds it if the recording was cut short.
+    // @param pFilename: Path of the recording.
+    // @return: False if the file is missing or not a flight recording of a supported version.
+    bool Open(const char* pFilename);
+
+    // Unmaps the recording.
+    void Close();
+
+    // Returns true while a recording is open.
+    bool IsOpen() const { return m_header != nullptr; }
+
+    // Gets the settings the recorded simulation started from.
+    const LockstepSettings& GetSettings() const { return m_header->settings; }
+
+    uint32_t GetKeyframeInterval() const { return m_header->keyframeInterval; }
+
+    int GetKeyframeCount() const { return (int)m_keyframes.size(); }
+
+    // Gets the first recorded step.
+    uint64_t GetFirstStep() const;
+
+    // Gets the step after the last recorded one.
+    uint64_t GetEndStep() const;
+
+    // Gets a recorded step, decoding its chunk unless it was the last one decoded.
+    // @return: nullptr if the step was not recorded or its chunk is corrupt, otherwise valid until the next call.
+    const FlightSample* GetSample(uint64_t step);
+
+    // Decodes every sample.
+    // @param samples: Receives the samples in step order.
+    // @return: False if a chunk is corrupt, the samples before it are kept.
+    bool ReadSamples(std::vector<FlightSample>& samples);
+
+    // Puts a simulation at a recorded step: restores the last keyframe at or before it and re-simulates the steps
+    // in between with their recorded inputs.
+    // @param simulation: Simulation with the settings of the recording.
+    // @param step: Step count to seek to, from GetFirstStep() to GetEndStep().
+    // @return: False if no keyframe precedes the step, its state does not load or a step in between is missing.
+    bool Seek(LockstepSimulation& simulation, uint64_t step);
+
+    // Decodes one sample chunk.
+    // @param pData: Bit packed samples of the chunk.
+    // @param samples: Receives the samples.
+    // @return: False if the data ends before the samples do.
+    static bool DecodeChunk(const FlightRecordingChunk& chunk, const uint8_t* pData, std::vector<FlightSample>& samples);
+
+private:
+    MappedFile m_file;
+    const FlightRecordingHeader* m_header = nullptr;
+    std::vector<FlightRecordingIndexEntry> m_sampleChunks; // In step order.
+    std::vector<FlightRecordingIndexEntry> m_keyframes; // In step order.
+
+    // The chunk GetSample decoded last.
+    std::vector<FlightSample> m_decoded;
+    size_t m_decodedChunk = SIZE_MAX;
+
+    // Reads the index the recorder wrote.
+    bool ReadIndex();
+
+    // Rebuilds the index by walking the chunks, up to the first incomplete one.
+    void ScanChunks();
+
+    // Adds a chunk to the index.
+    void AddToIndex(const FlightRecordingIndexEntry& entry);
+
+    // Gets a chunk header and its data.
+    const uint8_t* GetChunk(const FlightRecordingIndexEntry& entry, FlightRecordingChunk& chunk) const;
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,78 @@
+#ifndef GROUND_PROXIMITY_H
+#define GROUND_PROXIMITY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "height_field.h"
+#include "terrain_bounds.h"
+
+// Terrain alert of one aircraft, by severity.
+enum class TerrainAlert : uint8_t {
+    None = 0,
+    Caution = 1, // The predicted path breaks the floor within the look-ahead.
+    Warning = 2, // It does so within the warning time: pull up.
+};
+
+struct GroundProximitySettings {
+    float lookAheadSeconds = 30.0f; // How far ahead the path is predicted.
+    int samples = 16; // Points along the path, the first at the aircraft itself.
+    float floor = 100.0f; // Height above the ground the path must keep, m.
+    float warningSeconds = 12.0f; // Breaches sooner than this are warnings, later ones cautions.
+};
+
+// GroundProximity gives GPWS-style terrain alerts for many aircraft at once. Each aircraft's path is extrapolated
+// along its velocity, and the path is checked against the ground in three passes over all aircraft:
+//
+//  - the path is checked against the TerrainBounds of the ground, first its highest post anywhere and then the highest
+//    post under the box the path sweeps; an aircraft whose lowest point of the path stays above that by the floor is
+//    clear without sampling anything, which is most aircraft away from high ground.
+//  - the sample points of the remaining paths are gathered into one batch and sampled by HeightField::GetHeights in
+//    parallel chunks, a single vectorized terrain query for the whole update.
+//  - each path is scanned for its first sample below the floor.
+//
+// All passes run on the shared job system and write results in aircraft order, so the alerts do not depend on
+// thread timing.
+class GroundProximity
+{
+public:
+    explicit GroundProximity(const GroundProximitySettings& settings = GroundProximitySettings());
+
+    // Predicts the paths of every aircraft and checks them against the ground.
+    // @param x, y, z: Position arrays.
+    // @param vx, vy, vz: Velocity arrays, m/s.
+    // @param bounds: Bounds built from the ground.
+    void Update(const float* x, const float* y, const float* z, const float* vx, const float* vy, const float* vz,
+        int count, const TerrainBounds& bounds, const HeightField& ground);
+
+    // Gets the alert of an aircraft after the last update.
+    TerrainAlert GetAlert(int index) const { return (TerrainAlert)m_alerts[index]; }
+
+    // Gets the seconds until the path of an aircraft breaks the floor, or a negative value if it does not.
+    float GetTimeToBreach(int index) const { return m_timeToBreach[index]; }
+
+    int GetCount() const { return (int)m_alerts.size(); }
+
+    // Gets the number of aircraft whose path had to be sampled in the last update.
+    int GetSampledCount() const { return (int)m_sampled.size(); }
+
+    // Gets the number of aircraft with an alert of at least the given severity.
+    int CountAlerts(TerrainAlert alert) const;
+
+    const GroundProximitySettings& GetSettings() const { return m_settings; }
+
+private:
+    GroundProximitySettings m_settings;
+    std::vector<uint8_t> m_alerts;
+    std::vector<float> m_timeToBreach;
+
+    // Aircraft that failed the coarse check, and their path samples, samples per aircraft one after the other.
+    std::vector<uint8_t> m_needsSamples;
+    std::vector<int> m_sampled;
+    std::vector<float> m_sampleX;
+    std::vector<float> m_sampleZ;
+    std::vector<float> m_sampleHeight; // Of the aircraft.
+    std::vector<float> m_groundHeight;
+};
+
+#endif // GROUND_PROXIMITY_H
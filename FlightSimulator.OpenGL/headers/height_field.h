@@ -0,0 +1,78 @@
+#ifndef HEIGHT_FIELD_H
+#define HEIGHT_FIELD_H
+
+#include <memory>
+#include <ogldev_array_2d.h>
+
+#include "terrain_database.h"
+
+// HeightField answers ground height queries without any GL state, for headless tools and worker threads. The heights
+// come from a raw float heightmap, a generated fault formation terrain or a terrain database that stays memory
+// mapped, so only the tiles under the aircraft are paged in.
+class HeightField
+{
+public:
+    // Default constructor, the ground is flat at height 0 until something is loaded.
+    HeightField() = default;
+
+    // Loads a square heightmap of raw floats, the format read by BaseTerrain::LoadFromFile.
+    // @param pFilename: Path of the heightmap file.
+    // @param worldScale: Distance in metres between neighbouring posts.
+    // @return: False if the file cannot be read or is not a square float array.
+    bool LoadRaw(const char* pFilename, float worldScale);
+
+    // Opens a terrain database produced by the DEM import tool and queries one of its levels.
+    // @param pFilename: Path of the terrain database.
+    // @param level: LOD level to query, 0 being the finest.
+    // @return: False if the database cannot be opened or has no such level.
+    bool OpenDatabase(const char* pFilename, int level);
+
+    // Generates a fault formation terrain like FaultFormationTerrain::CreateFaultFormation.
+    void GenerateFaultFormation(int terrainSize, int iterations, float minHeight, float maxHeight, float filter,
+        unsigned int seed, float worldScale);
+
+    // Copies a heightmap, e.g. the one of a BaseTerrain, so the copy can be queried while the terrain changes.
+    // @param heightMap: terrainSize x terrainSize posts.
+    // @param worldScale: Distance in metres between neighbouring posts.
+    void CopyHeightMap(const Array2D<float>& heightMap, int terrainSize, float worldScale);
+
+    // Gets the bilinearly interpolated height at a world position, clamped to the edge of the terrain.
+    // @param worldX: X-coordinate in world space.
+    // @param worldZ: Z-coordinate in world space.
+    // @return: Ground height, 0 when nothing is loaded.
+    float GetHeight(float worldX, float worldZ) const;
+
+    // Gets the heights at many world positions at once, like GetHeight per position. Heightmaps are sampled by a vector
+    // kernel for the widest instruction set the processor has; the call is single threaded, so large batches can be
+    // split over jobs.
+    // @param x, z: World positions.
+    // @param heights: Receives one height per position.
+    void GetHeights(const float* x, const float* z, float* heights, size_t count) const;
+
+    // Returns true once a heightmap or database is loaded.
+    bool IsLoaded() const { return m_heightMap != nullptr || m_database.IsOpen(); }
+
+    // Gets the side length of the terrain in metres.
+    float GetExtent() const;
+
+    // Gets the number of posts along x and z, 0 when nothing is loaded.
+    int GetPostsX() const;
+    int GetPostsZ() const;
+
+    // Gets the distance in metres between neighbouring posts.
+    float GetPostSpacing() const { return m_worldScale; }
+
+    // Gets the height of a post. Posts outside the terrain have the height GetHeight uses there: the nearest edge
+    // post of a heightmap, the no data height of a database.
+    float GetPostHeight(int x, int z) const;
+
+private:
+    std::unique_ptr<Array2D<float>> m_heightMap;
+    int m_terrainSize = 0;
+    float m_worldScale = 1.0f;
+
+    TerrainDatabase m_database;
+    int m_level = 0;
+};
+
+#endif // HEIGHT_FIELD_H
@@ -0,0 +1,58 @@
+#ifndef HEIGHT_FIELD_KERNEL_H
+#define HEIGHT_FIELD_KERNEL_H
+
+#include <cstddef>
+
+#include "simd.h"
+
+// Batched bilinear height sampling as a template over the simd vector types, instantiated once per instruction set in
+// height_field.cpp, height_field_avx2.cpp and height_field_avx512.cpp like the aero kernel. It works on the raw
+// heightmap only, so nothing of HeightField gets compiled for a wider instruction set.
+struct HeightSampleArgs {
+    const float* heights; // size x size posts, row major by z.
+    int size;
+    float worldScale; // Metres between posts.
+    const float* x; // World positions to sample.
+    const float* z;
+    float* out; // Receives the heights.
+    size_t count; // Samples, whole vectors only; the caller samples the rest.
+};
+
+void SampleHeightsSse2(const HeightSampleArgs& args);
+void SampleHeightsAvx2(const HeightSampleArgs& args);
+void SampleHeightsAvx512(const HeightSampleArgs& args);
+
+// The same math as HeightField::GetHeight, one lane per sample. The four posts are gathered by a float index, exact
+// for heightmaps of up to 2^24 posts.
+template <typename V>
+void SampleHeightsKernel(const HeightSampleArgs& a)
+{
+    const V scale(a.worldScale);
+    const V last((float)(a.size - 1));
+    const V lastCell((float)(a.size - 2));
+    const V row((float)a.size);
+    const V zero(0.0f);
+    const V one(1.0f);
+
+    for (size_t i = 0; i + V::Width <= a.count; i += V::Width)
+    {
+        V x = Max(Min(V::Load(a.x + i) / scale, last), zero);
+        V z = Max(Min(V::Load(a.z + i) / scale, last), zero);
+        V ix = Min(Floor(x), lastCell);
+        V iz = Min(Floor(z), lastCell);
+        V u = x - ix;
+        V v = z - iz;
+
+        V index = MulAdd(iz, row, ix);
+        V h00 = V::Gather(a.heights, index);
+        V h10 = V::Gather(a.heights, index + one);
+        V h01 = V::Gather(a.heights, index + row);
+        V h11 = V::Gather(a.heights, index + row + one);
+
+        V h0 = h00 + (h10 - h00) * u;
+        V h1 = h01 + (h11 - h01) * u;
+        (h0 + (h1 - h0) * v).Store(a.out + i);
+    }
+}
+
+#endif // HEIGHT_FIELD_KERNEL_H
@@ -0,0 +1,214 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A unit of work. Jobs live in fixed pools owned by the JobSystem and are reused once finished, so code outside the
+// job system only refers to them through JobHandles.
+struct alignas(64) Job {
+    static constexpr size_t DATA_SIZE = 96;
+
+    void (*function)(Job& job) = nullptr; // Runs and destroys the callable stored in data.
+    Job* parent = nullptr;
+    std::atomic<int> unfinished{ 0 }; // 1 for the job itself plus one per unfinished child.
+    std::atomic<uint32_t> generation{ 0 }; // Incremented on every reuse, so stale handles read as finished.
+    alignas(16) unsigned char data[DATA_SIZE]; // The callable, or a pointer to it when it does not fit.
+};
+
+// Reference to a job that stays safe to query after the job finished and its slot was reused.
+struct JobHandle {
+    Job* job = nullptr;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return job != nullptr; }
+};
+
+// JobSystem is a work-stealing job scheduler. Every thread owns a deque of jobs: it pushes and pops jobs at the
+// bottom, idle threads steal from the top of the others, so work spreads out without a central queue. Jobs can have
+// a parent that only counts as finished once all of its children have; waiting on a job runs other jobs meanwhile
+// instead of blocking, so jobs may wait on children without tying up the thread.
+//
+// Besides the regular jobs there are:
+//  - background jobs for long work like terrain generation or asset decoding. Only worker threads run them, so a
+//    main thread that helps out while waiting never gets stuck in one of them.
+//  - main thread jobs, for GL calls. They run on the thread that created the job system when it calls
+//    ExecuteMainThreadJobs() or waits on a job.
+//
+// Threads that are neither the creating thread nor a worker, such as std::async threads, can submit and wait too;
+// their jobs go through a shared queue.
+class JobSystem
+{
+public:
+    static constexpr int MAX_THREADS = 64;
+    static constexpr int JOBS_PER_THREAD = 4096; // Jobs in flight per thread before allocation waits; power of two.
+
+    // Starts the worker threads. The creating thread becomes thread 0 of the system, the main thread.
+    // @param threadCount: Threads including the creating one, 0 for one per hardware thread and at least two, so
+    // background jobs always have a worker. With a single thread every job runs on the creating thread while it waits.
+    explicit JobSystem(int threadCount = 0);
+
+    // Stops and joins the workers. Jobs still queued are not run.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Creates a job without starting it, so children can be attached before it runs.
+    // @param func: Callable taking no arguments. Copied into the job; callables larger than Job::DATA_SIZE are heap allocated.
+    // @param parent: Job that does not finish before this one has, or an invalid handle.
+    template <typename Func>
+    JobHandle Create(Func&& func, JobHandle parent = {})
+    {
+        using Callable = std::decay_t<Func>;
+
+        Job* job = Allocate(parent);
+        if constexpr (sizeof(Callable) <= Job::DATA_SIZE && alignof(Callable) <= 16)
+        {
+            new (job->data) Callable(std::forward<Func>(func));
+            job->function = [](Job& j) {
+                Callable* callable = std::launder(reinterpret_cast<Callable*>(j.data));
+                (*callable)();
+                callable->~Callable();
+            };
+        }
+        else
+        {
+            Callable* callable = new Callable(std::forward<Func>(func));
+            memcpy(job->data, &callable, sizeof(callable));
+            job->function = [](Job& j) {
+                Callable* callable;
+                memcpy(&callable, j.data, sizeof(callable));
+                (*callable)();
+                delete callable;
+            };
+        }
+        return { job, job->generation.load(std::memory_order_relaxed) };
+    }
+
+    // Queues a created job on the calling thread.
+    void Submit(JobHandle job);
+
+    // Queues a created job for a worker thread only, for long running work.
+    void SubmitBackground(JobHandle job);
+
+    // Queues a created job for the main thread, for GL calls.
+    void SubmitMainThread(JobHandle job);
+
+    // Creates and queues a job.
+    template <typename Func>
+    JobHandle Run(Func&& func, JobHandle parent = {})
+    {
+        JobHandle job = Create(std::forward<Func>(func), parent);
+        Submit(job);
+        return job;
+    }
+
+    // Creates and queues a job for a worker thread only.
+    template <typename Func>
+    JobHandle RunBackground(Func&& func, JobHandle parent = {})
+    {
+        JobHandle job = Create(std::forward<Func>(func), parent);
+        SubmitBackground(job);
+        return job;
+    }
+
+    // Creates and queues a job for the main thread.
+    template <typename Func>
+    JobHandle RunOnMainThread(Func&& func, JobHandle parent = {})
+    {
+        JobHandle job = Create(std::forward<Func>(func), parent);
+        SubmitMainThread(job);
+        return job;
+    }
+
+    // Splits [begin, end) into chunks of chunkSize and runs func(chunkBegin, chunkEnd) for each as a child job.
+    // @param func: Callable taking (int chunkBegin, int chunkEnd), copied into every chunk. Must be safe to run
+    // concurrently on disjoint chunks.
+    // @return: Job that finishes once every chunk has.
+    template <typename Func>
+    JobHandle ParallelFor(int begin, int end, int chunkSize, Func&& func, JobHandle parent = {})
+    {
+        JobHandle root = Create([]() {}, parent);
+        chunkSize = std::max(chunkSize, 1);
+        for (int chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize)
+        {
+            int chunkEnd = std::min(end, chunkBegin + chunkSize);
+            Run([func, chunkBegin, chunkEnd]() { func(chunkBegin, chunkEnd); }, root);
+        }
+        Submit(root);
+        return root;
+    }
+
+    // Returns true once the job and all of its children have run.
+    bool IsFinished(JobHandle job) const
+    {
+        return !job.IsValid() || job.job->generation.load(std::memory_order_acquire) != job.generation ||
+            job.job->unfinished.load(std::memory_order_acquire) == 0;
+    }
+
+    // Runs other jobs until the job and all of its children have run.
+    void Wait(JobHandle job);
+
+    // Runs the main thread jobs queued so far. Call once per frame from the main thread.
+    // @return: Number of jobs run.
+    int ExecuteMainThreadJobs();
+
+    // Gets the number of threads including the main thread.
+    int GetThreadCount() const { return (int)m_workers.size(); }
+
+    // Gets the index of the calling thread in this system, 0 for the main thread and -1 for outside threads.
+    int GetThreadIndex() const;
+
+private:
+    struct Worker;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<bool> m_stop{ false };
+    JobSystem* m_previousSystem = nullptr;
+    int m_previousIndex = -1;
+
+    // Jobs queued in deques and the shared queues, for idle workers to decide whether to sleep.
+    std::atomic<int> m_queued{ 0 };
+    std::atomic<int> m_sleeping{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+
+    // Jobs of threads outside the system, allocated from a shared pool.
+    std::mutex m_externalMutex;
+    std::deque<Job*> m_externalQueue;
+    std::atomic<int> m_externalCount{ 0 };
+    std::unique_ptr<Job[]> m_externalPool;
+    uint32_t m_externalNext = 0;
+
+    std::mutex m_backgroundMutex;
+    std::deque<Job*> m_backgroundQueue;
+    std::atomic<int> m_backgroundCount{ 0 };
+
+    std::mutex m_mainMutex;
+    std::deque<Job*> m_mainQueue;
+
+    Job* Allocate(JobHandle parent);
+    Job* GetJob(int index, bool allowBackground);
+    Job* PopMainThreadJob();
+    void Execute(Job* job);
+    void Finish(Job* job);
+    void WakeWorker();
+    void WorkerLoop(int index);
+};
+
+// Gets the job system shared by the simulator and its tools, created on first use with one thread per hardware
+// thread. The thread calling this first becomes its main thread, so call it early from main().
+JobSystem& GetJobSystem();
+
+#endif // JOB_SYSTEM_H
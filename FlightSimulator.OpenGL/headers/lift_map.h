@@ -0,0 +1,104 @@
+#ifndef LIFT_MAP_H
+#define LIFT_MAP_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_field.h"
+#include "wind_field.h"
+
+struct LiftSettings {
+    float ridgeDepth = 300.0f; // Height above the ground over which ridge lift fades, m.
+    float thermalStrength = 3.0f; // Climb in the core of a thermal over ground facing the sun, m/s.
+    float thermalRadius = 250.0f; // m.
+    float thermalSpacing = 2000.0f; // Least distance between two thermals, m.
+    float thermalCeiling = 1500.0f; // Height above the ground where thermals die out, m.
+    glm::vec3 sunDirection{ 0.3f, 0.8f, 0.5f }; // Towards the sun, need not be unit length.
+    float tolerance = 0.05f; // Ridge lift error a tile may keep before SetWind refreshes it, m/s.
+};
+
+// LiftMap gives the vertical air movement that gliders soar in, baked into a grid of nodes over a HeightField so a
+// sample is a couple of bilinear lookups:
+//
+//  - ridge lift is the wind blown up the slope under a node, the wind along the rise of the ground, fading with the
+//    height above it. Lee slopes get sink.
+//  - thermals rise from the spots that face the sun most within their spacing, strongest over the core and leaning
+//    downwind with height. Where they start does not depend on the wind, so they are baked once per ground.
+//
+// Nodes are grouped into tiles that remember the wind their ridge lift was made for and their steepest slope, which
+// bounds how much a wind shift changes them. SetWind only refreshes the tiles where that bound exceeds the tolerance,
+// so a shift leaves flat ground and small changes leave everything alone.
+class LiftMap
+{
+public:
+    // Nodes along the edge of a tile.
+    static constexpr int TILE_SIZE = 16;
+
+    // Builds the map of a ground in parallel, whenever the ground changes.
+    // @param ground: Heights the lift comes from, only read during the call.
+    // @param wind: Wind the ridge lift is made for; its speed is taken as that along the slopes.
+    // @param postsPerNode: Post intervals between neighbouring nodes.
+    void Build(const HeightField& ground, const WindSettings& wind, const LiftSettings& settings = LiftSettings(),
+        int postsPerNode = 2);
+
+    // Refreshes the ridge lift of the tiles a new wind changes by more than the tolerance, in parallel.
+    // @return: Number of tiles refreshed.
+    int SetWind(const WindSettings& wind);
+
+    // Gets the vertical air speed at a world position, ridge lift and thermals together, m/s.
+    float GetLift(const glm::vec3& position) const;
+
+    // Gets the ridge lift at a world position, m/s.
+    float GetRidgeLift(const glm::vec3& position) const;
+
+    // Gets the climb of the thermals at a world position, m/s.
+    float GetThermalLift(const glm::vec3& position) const;
+
+    int GetNodesX() const { return m_nodesX; }
+    int GetNodesZ() const { return m_nodesZ; }
+    int GetTileCount() const { return (int)m_tiles.size(); }
+
+    // Gets the number of thermals found on the ground.
+    int GetThermalCount() const { return m_thermalCount; }
+
+    const LiftSettings& GetSettings() const { return m_settings; }
+
+private:
+    struct Tile {
+        glm::vec2 wind{ 0.0f }; // Horizontal wind the ridge lift was made for, m/s.
+        float maxSlope = 0.0f; // Steepest rise per metre of its nodes.
+    };
+
+    LiftSettings m_settings;
+    int m_nodesX = 0;
+    int m_nodesZ = 0;
+    int m_tilesX = 0;
+    float m_nodeSpacing = 1.0f;
+    glm::vec2 m_wind{ 0.0f };
+    int m_thermalCount = 0;
+
+    // Per node, row major by z
+    std::vector<float> m_height;
+    std::vector<glm::vec2> m_slope; // Rise per metre along x and z.
+    std::vector<float> m_ridge; // Lift at the ground for the wind of the tile, m/s.
+    std::vector<float> m_thermal; // Core climb of the thermals around, m/s.
+    std::vector<Tile> m_tiles;
+
+    // Makes the ridge lift of one tile for the current wind.
+    void RefreshTile(int tile);
+
+    // Finds the thermals and bakes their climb into m_thermal.
+    void BakeThermals();
+
+    // The lifts at a position some height above the ground.
+    float GetRidgeLift(const glm::vec3& position, float height) const;
+    float GetThermalLift(const glm::vec3& position, float height) const;
+
+    // Bilinear sample of a node value, clamped to the edge of the grid.
+    float Sample(const std::vector<float>& values, float x, float z) const;
+
+    static glm::vec2 GetHorizontalWind(const WindSettings& wind);
+};
+
+#endif // LIFT_MAP_H
@@ -0,0 +1,176 @@
+#ifndef LOCKSTEP_SIMULATION_H
+#define LOCKSTEP_SIMULATION_H
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "airplane.h"
+#include "broad_phase.h"
+#include "ground_proximity.h"
+#include "height_field.h"
+#include "joystick.h"
+#include "simulation_scheduler.h"
+#include "terrain_bounds.h"
+#include "traffic.h"
+
+// Fault formation terrain the simulation flies over, the parameters of FaultFormationTerrain::CreateFaultFormation.
+struct LockstepTerrain {
+    int32_t size = 1024; // Posts along one side.
+    int32_t iterations = 500;
+    float minHeight = 0.0f;
+    float maxHeight = 5000.0f;
+    float filter = 0.8f;
+    uint32_t seed = 1;
+    float worldScale = 20.0f; // Metres between posts.
+};
+
+// Everything besides the inputs that decides how a lockstep simulation runs. Plain data with fixed size fields, so
+// recordings store it as it is.
+struct LockstepSettings {
+    uint32_t seed = 1; // Seed of the traffic start variation.
+    float stepSize = 1.0f / 240.0f; // Seconds per step.
+    int32_t stepsPerTrafficTick = 2; // Traffic scheduler ticks every this many steps.
+    physics::Integrator integrator = physics::Integrator::semi_implicit_euler; // Of the player aircraft.
+    glm::vec3 startPosition{ 5000.0f, 5000.0f, 3000.0f };
+    float startSpeed = 55.0f; // m/s.
+    float startThrottle = 0.6f;
+    int32_t trafficCount = 256;
+    float trafficSpacing = 400.0f; // Metres between traffic aircraft on the start grid.
+    LockstepTerrain terrain;
+};
+
+static_assert(std::is_trivially_copyable<LockstepSettings>::value, "LockstepSettings is stored as raw bytes");
+
+// LockstepSimulation steps the player aircraft and the AI traffic in fixed steps, driven only by its settings and one
+// Joystick input per step. Nothing depends on the frame rate, the camera or the wall clock: traffic starts from the
+// seed, the traffic scheduler looks from the player instead of the camera and the ground is a HeightField generated
+// from the terrain settings. The same settings and inputs give the same state bit for bit with the same executable on
+// any processor, which is what a FlightRecorder recording is replayed with: the traffic kernels run with KERNEL_ISA
+// everywhere rather than the widest instruction set, whose fused multiply-adds round differently. Other builds may
+// round differently still, so a recording is only sure to replay on the build that made it.
+//
+// Every COLLISION_TICKS traffic ticks the aircraft are checked for conflicts, pairs closer than CONFLICT_DISTANCE
+// found through a BroadPhase, and for terrain contacts, found through the TerrainBounds of the ground. The predicted
+// paths of the player and the traffic get GroundProximity terrain alerts at the same time. All of it is recomputed
+// from the state, so none of it is part of SaveState: LoadState only clears the results, and the next Step finds
+// them again for the restored state.
+class LockstepSimulation
+{
+public:
+    // Instruction set of the vector kernels of the traffic, SSE2 as every x64 processor has it and it fuses nothing.
+    static constexpr physics::AeroIsa KERNEL_ISA = physics::AeroIsa::Sse2;
+
+    // Separation below which two aircraft are in conflict, m.
+    static constexpr float CONFLICT_DISTANCE = 150.0f;
+
+    // Height above the ground below which a traffic aircraft is in terrain contact, m.
+    static constexpr float TERRAIN_CLEARANCE = 30.0f;
+
+    // Traffic ticks between collision checks, 10 Hz at the default traffic rate.
+    static constexpr int COLLISION_TICKS = 12;
+
+    // @param settings: Start state and step sizes.
+    // @param ground: Generated from settings.terrain, e.g. with GenerateGround. Must outlive the simulation.
+    LockstepSimulation(const LockstepSettings& settings, const HeightField& ground);
+
+    // Generates the ground of a terrain, like FaultFormationTerrain::CreateFaultFormation does.
+    static void GenerateGround(const LockstepTerrain& terrain, HeightField& ground);
+
+    // Puts the player and traffic back to step 0.
+    void Reset();
+
+    // Records that the ground was regenerated for other terrain settings and rebuilds its bounds. Breaks the lockstep
+    // of a run in progress, so it belongs between runs.
+    void SetTerrain(const LockstepTerrain& terrain);
+
+    // Advances everything by one step.
+    // @param input: Controls of the player for this step.
+    void Step(const Joystick& input);
+
+    // Gets the number of steps since the last reset.
+    uint64_t GetStepCount() const { return m_step; }
+
+    // Gets the simulated seconds since the last reset.
+    double GetTime() const { return m_step * (double)m_settings.stepSize; }
+
+    // Gets the fraction of a traffic tick that has passed, for SimulationScheduler::GetElapsed.
+    // @param stepAlpha: Fraction of a step that has passed, e.g. FixedTimestep::alpha().
+    float GetTrafficAlpha(float stepAlpha) const;
+
+    // Appends everything the next steps depend on: the step count, the player, the traffic and its schedule.
+    void SaveState(std::vector<uint8_t>& data) const;
+
+    // Continues from a state written by SaveState of a simulation with the same settings, exactly as that simulation
+    // would have.
+    // @return: False if the state is truncated or from other settings, the simulation is reset then.
+    bool LoadState(const uint8_t* pData, size_t size);
+
+    // Hashes the player and traffic state and the step count, for telling diverged runs apart.
+    uint64_t ComputeChecksum() const;
+
+    // Gets the traffic aircraft pairs closer than CONFLICT_DISTANCE at the last collision check.
+    const std::vector<BroadPhasePair>& GetConflicts() const { return m_conflicts; }
+
+    // Gets the traffic aircraft closer than CONFLICT_DISTANCE to the player at the last collision check.
+    const std::vector<int>& GetPlayerConflicts() const { return m_playerConflicts; }
+
+    // Gets the traffic aircraft less than TERRAIN_CLEARANCE above the ground at the last collision check.
+    const std::vector<TerrainContact>& GetTerrainContacts() const { return m_terrainContacts; }
+
+    // Gets the terrain alert of the player at the last collision check.
+    TerrainAlert GetPlayerTerrainAlert() const
+    {
+        return m_collisionsStale ? TerrainAlert::None : m_playerProximity.GetAlert(0);
+    }
+
+    // Gets the terrain alerts of the traffic at the last collision check.
+    const GroundProximity& GetTrafficProximity() const { return m_trafficProximity; }
+
+    const physics::Airplane& GetPlayer() const { return m_player; }
+    const TrafficSystem& GetTraffic() const { return m_traffic; }
+    TrafficSystem& GetTraffic() { return m_traffic; }
+    const SimulationScheduler& GetScheduler() const { return m_scheduler; }
+    const BroadPhase& GetBroadPhase() const { return m_broadPhase; }
+    const TerrainBounds& GetTerrainBounds() const { return m_terrainBounds; }
+    const LockstepSettings& GetSettings() const { return m_settings; }
+
+private:
+    // Traffic aircraft whose rate is chosen again per traffic tick.
+    static constexpr int REBALANCE_PER_TICK = 64;
+
+    LockstepSettings m_settings;
+    const HeightField& m_ground;
+
+    physics::Airfoil m_wingAirfoil;
+    physics::Airfoil m_tailAirfoil;
+    physics::Airplane m_player;
+    TrafficSystem m_traffic;
+    SimulationScheduler m_scheduler;
+    uint64_t m_step = 0;
+
+    BroadPhase m_broadPhase;
+    TerrainBounds m_terrainBounds;
+    std::vector<BroadPhasePair> m_conflicts;
+    std::vector<int> m_playerConflicts;
+    std::vector<TerrainContact> m_terrainContacts;
+    GroundProximity m_playerProximity;
+    GroundProximity m_trafficProximity;
+    bool m_collisionsStale = false; // From before a LoadState, until the next Step detects them again.
+
+    // Places the traffic on its start grid.
+    void AddTraffic();
+
+    // Runs one tick of the traffic scheduler.
+    void StepTraffic();
+
+    // Finds the conflicts, terrain contacts and terrain alerts of the current state.
+    void DetectCollisions();
+
+    // Uniform float in [0, 1) from the raw generator output, which unlike the standard distributions is the same on
+    // every standard library.
+    static float Uniform(std::mt19937& rng) { return (rng() >> 8) * (1.0f / 16777216.0f); }
+};
+
+#endif // LOCKSTEP_SIMULATION_H
@@ -0,0 +1,53 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// MappedFile maps a whole file read-only into the address space. Pages are loaded by the OS on first access and can
+// be dropped again under memory pressure, so files far larger than the working set can be read without copying.
+class MappedFile
+{
+public:
+    // Default constructor. The file is not mapped until Open() succeeds.
+    MappedFile() = default;
+
+    // Unmaps the file.
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Maps a file, unmapping any previously mapped one.
+    // @param pFilename: Path of the file to map.
+    // @return: False if the file could not be opened or mapped.
+    bool Open(const char* pFilename);
+
+    // Unmaps the file.
+    void Close();
+
+    // Gets the first byte of the mapping.
+    // @return: Pointer to the mapped bytes, nullptr if no file is mapped.
+    const uint8_t* GetData() const { return m_data; }
+
+    // Gets the size of the mapped file.
+    // @return: Size in bytes.
+    size_t GetSize() const { return m_size; }
+
+    // Returns true while a file is mapped.
+    bool IsOpen() const { return m_data != nullptr; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr; // HANDLE of the file.
+    void* m_mapping = nullptr; // HANDLE of the file mapping object.
+#endif
+};
+
+#endif // MAPPED_FILE_H
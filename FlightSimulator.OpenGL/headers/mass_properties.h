@@ -0,0 +1,348 @@
+#ifndef MASS_PROPERTIES_H
+#define MASS_PROPERTIES_H
+
+#include <cstddef>
+#include <vector>
+
+#include "physics.h"
+
+// mass properties of fixed airframes, evaluated by the compiler. an airframe is a struct with a constexpr array of
+// cuboids and a total mass, the same description inertia::cube and inertia::set_uniform_density take at runtime:
+//
+//	struct Trainer {
+//		static constexpr float total_mass = 1100.0f;
+//		static constexpr inertia::StaticElement elements[] = { ... };
+//	};
+//	constexpr const inertia::MassProperties& trainer = inertia::mass_properties<Trainer>;
+//
+// mass, center of gravity, tensor and inverse tensor are then constants in the binary, no vector is allocated and
+// nothing is computed when an aircraft of the type is created
+namespace physics
+{
+	namespace inertia
+	{
+		// cuboid mass element with the mass left at 0 to be distributed by volume, like cube()
+		struct StaticElement {
+			float position[3];  // center in design coordinates
+			float size[3];
+			float mass = 0.0f;
+		};
+
+		// mass, center of gravity and inertia tensor about it, matrices row major (they are symmetric)
+		struct MassProperties {
+			float mass;
+			float center_of_gravity[3];
+			float tensor[9];
+			float inverse_tensor[9];
+
+			glm::vec3 get_center_of_gravity() const
+			{
+				return { center_of_gravity[0], center_of_gravity[1], center_of_gravity[2] };
+			}
+			glm::mat3 get_tensor() const { return to_mat3(tensor); }
+			glm::mat3 get_inverse_tensor() const { return to_mat3(inverse_tensor); }
+
+		private:
+			static glm::mat3 to_mat3(const float* m) { return { m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7], m[8] }; }
+		};
+
+		// same result as set_uniform_density, cuboid and tensor over the elements, in double precision
+		template <size_t N>
+		constexpr MassProperties compute_mass_properties(const StaticElement (&elements)[N], float total_mass)
+		{
+			double volume[N] = {};
+			double mass[N] = {};
+			double total_volume = 0.0, assigned_mass = 0.0;
+			for (size_t i = 0; i < N; i++) {
+				volume[i] = (double)elements[i].size[0] * elements[i].size[1] * elements[i].size[2];
+				if (elements[i].mass > 0.0f) {
+					assigned_mass += elements[i].mass;
+				}
+				else {
+					total_volume += volume[i];
+				}
+			}
+
+			// elements without a mass share what the others leave of the total
+			double m = 0.0, first_moment[3] = {};
+			for (size_t i = 0; i < N; i++) {
+				mass[i] = elements[i].mass > 0.0f ? elements[i].mass : volume[i] / total_volume * (total_mass - assigned_mass);
+				m += mass[i];
+				for (int k = 0; k < 3; k++) {
+					first_moment[k] += mass[i] * elements[i].position[k];
+				}
+			}
+
+			double cg[3] = { first_moment[0] / m, first_moment[1] / m, first_moment[2] / m };
+			double Ixx = 0, Iyy = 0, Izz = 0;
+			double Ixy = 0, Ixz = 0, Iyz = 0;
+			for (size_t i = 0; i < N; i++) {
+				const StaticElement& e = elements[i];
+				double x = e.position[0] - cg[0], y = e.position[1] - cg[1], z = e.position[2] - cg[2];
+				double sx = (double)e.size[0] * e.size[0], sy = (double)e.size[1] * e.size[1], sz = (double)e.size[2] * e.size[2];
+
+				Ixx += mass[i] * ((sy + sz) / 12.0 + y * y + z * z);
+				Iyy += mass[i] * ((sx + sz) / 12.0 + z * z + x * x);
+				Izz += mass[i] * ((sx + sy) / 12.0 + x * x + y * y);
+				Ixy += mass[i] * x * y;
+				Ixz += mass[i] * x * z;
+				Iyz += mass[i] * y * z;
+			}
+
+			// clang-format off
+			double t[9] = {
+				Ixx, -Ixy, -Ixz,
+				-Ixy, Iyy, -Iyz,
+				-Ixz, -Iyz, Izz
+			};
+			// clang-format on
+
+			// inverse from the adjugate, the tensor is symmetric so the cofactor matrix is its own transpose
+			double c[9] = {
+				t[4] * t[8] - t[5] * t[7], t[2] * t[7] - t[1] * t[8], t[1] * t[5] - t[2] * t[4],
+				t[5] * t[6] - t[3] * t[8], t[0] * t[8] - t[2] * t[6], t[2] * t[3] - t[0] * t[5],
+				t[3] * t[7] - t[4] * t[6], t[1] * t[6] - t[0] * t[7], t[0] * t[4] - t[1] * t[3],
+			};
+			double determinant = t[0] * c[0] + t[1] * c[3] + t[2] * c[6];
+
+			MassProperties result = {};
+			result.mass = (float)m;
+			for (int k = 0; k < 3; k++) {
+				result.center_of_gravity[k] = (float)cg[k];
+			}
+			for (int k = 0; k < 9; k++) {
+				result.tensor[k] = (float)t[k];
+				result.inverse_tensor[k] = (float)(c[k] / determinant);
+			}
+			return result;
+		}
+
+		// mass properties of an airframe type, a constant initialized during compilation
+		template <typename Airframe>
+		struct StaticMassProperties {
+			static constexpr MassProperties value = compute_mass_properties(Airframe::elements, Airframe::total_mass);
+
+			static_assert(value.mass > 0.0f, "airframe without mass");
+			static_assert(value.tensor[0] > 0.0f && value.tensor[4] > 0.0f && value.tensor[8] > 0.0f,
+				"airframe inertia tensor has a non-positive moment");
+		};
+
+		template <typename Airframe>
+		constexpr const MassProperties& mass_properties = StaticMassProperties<Airframe>::value;
+
+		// mass properties that change while flying: fuel burn, dropped stores, moving payload. keeps the mass, the first
+		// moment and the tensor about the design origin as running sums, so adding, removing, moving or re-massing one
+		// element is O(1). the tensor about the center of gravity and its inverse are derived from the sums when asked
+		// for and cached until the next change. sums are kept in double precision, the rounding that builds up over
+		// millions of updates stays far below float precision; recompute() starts over from the elements
+		class MassDistribution
+		{
+		public:
+			MassDistribution() = default;
+
+			// starts from a fixed airframe, e.g. mass_properties<TrainerAirframe>, which can not be changed afterwards
+			explicit MassDistribution(const MassProperties& base)
+			{
+				m_base_mass = base.mass;
+				for (int k = 0; k < 3; k++) {
+					m_base_moment[k] = (double)base.mass * base.center_of_gravity[k];
+				}
+				// parallel axis theorem moves the tensor from the center of gravity to the origin
+				double tensor[6];
+				origin_tensor(base.mass, base.center_of_gravity[0], base.center_of_gravity[1], base.center_of_gravity[2],
+					tensor);
+				const float* t = base.tensor;
+				m_base_tensor[0] = tensor[0] + t[0];
+				m_base_tensor[1] = tensor[1] + t[4];
+				m_base_tensor[2] = tensor[2] + t[8];
+				m_base_tensor[3] = tensor[3] + t[1];
+				m_base_tensor[4] = tensor[4] + t[2];
+				m_base_tensor[5] = tensor[5] + t[5];
+				recompute();
+			}
+
+			// @param element: Mass, position in design coordinates and moment of inertia about its own center, e.g. from cube().
+			// @return: Id of the element for the other calls, ids of removed elements are reused.
+			int add(const Element& element)
+			{
+				int id;
+				if (!m_free.empty()) {
+					id = m_free.back();
+					m_free.pop_back();
+					m_elements[id] = element;
+				}
+				else {
+					id = (int)m_elements.size();
+					m_elements.push_back(element);
+					m_unit_inertia.emplace_back(0.0f);
+					m_active.push_back(false);
+				}
+				// an element added without mass is taken to be a uniform cuboid of its size, like cube()
+				m_unit_inertia[id] = element.mass > 0.0f ? element.inertia / element.mass : cuboid(1.0f, element.size);
+				m_active[id] = true;
+				accumulate(m_elements[id], 1.0);
+				return id;
+			}
+
+			void remove(int id)
+			{
+				accumulate(m_elements[id], -1.0);
+				m_active[id] = false;
+				m_free.push_back(id);
+			}
+
+			// changes the mass of an element of unchanged shape, its own moment of inertia scales with it. the inertia per
+			// unit mass is kept apart, so an element emptied to 0 gets its inertia back when it is refilled
+			void set_mass(int id, float mass)
+			{
+				Element& element = m_elements[id];
+				accumulate(element, -1.0);
+				element.inertia = m_unit_inertia[id] * mass;
+				element.mass = mass;
+				accumulate(element, 1.0);
+			}
+
+			void set_position(int id, const glm::vec3& position)
+			{
+				Element& element = m_elements[id];
+				accumulate(element, -1.0);
+				element.position = position;
+				accumulate(element, 1.0);
+			}
+
+			const Element& get_element(int id) const { return m_elements[id]; }
+
+			float get_mass() const { return (float)m_mass; }
+
+			glm::vec3 get_center_of_gravity() const
+			{
+				update();
+				return m_center_of_gravity;
+			}
+
+			// tensor about the center of gravity
+			const glm::mat3& get_tensor() const
+			{
+				update();
+				return m_tensor;
+			}
+
+			const glm::mat3& get_inverse_tensor() const
+			{
+				update();
+				return m_inverse_tensor;
+			}
+
+			// rebuilds the sums from the base and the elements, O(n)
+			void recompute()
+			{
+				m_mass = m_base_mass;
+				for (int k = 0; k < 3; k++) {
+					m_moment[k] = m_base_moment[k];
+				}
+				for (int k = 0; k < 6; k++) {
+					m_origin_tensor[k] = m_base_tensor[k];
+				}
+				for (size_t i = 0; i < m_elements.size(); i++) {
+					if (m_active[i]) {
+						accumulate(m_elements[i], 1.0);
+					}
+				}
+				m_dirty = true;
+			}
+
+		private:
+			std::vector<Element> m_elements;
+			std::vector<glm::vec3> m_unit_inertia; // moment of inertia of each element per unit of its mass
+			std::vector<bool> m_active;
+			std::vector<int> m_free;
+
+			// running sums: mass, first moment and tensor about the origin as xx, yy, zz, xy, xz, yz
+			double m_mass = 0.0;
+			double m_moment[3] = {};
+			double m_origin_tensor[6] = {};
+
+			double m_base_mass = 0.0;
+			double m_base_moment[3] = {};
+			double m_base_tensor[6] = {};
+
+			mutable bool m_dirty = true;
+			mutable glm::vec3 m_center_of_gravity{ 0.0f };
+			mutable glm::mat3 m_tensor{ 1.0f };
+			mutable glm::mat3 m_inverse_tensor{ 1.0f };
+
+			// tensor of a point mass about the origin, same layout as m_origin_tensor
+			static void origin_tensor(double mass, double x, double y, double z, double* tensor)
+			{
+				tensor[0] = mass * (y * y + z * z);
+				tensor[1] = mass * (z * z + x * x);
+				tensor[2] = mass * (x * x + y * y);
+				tensor[3] = -mass * x * y;
+				tensor[4] = -mass * x * z;
+				tensor[5] = -mass * y * z;
+			}
+
+			// adds (sign 1) or takes away (sign -1) one element
+			void accumulate(const Element& element, double sign)
+			{
+				const glm::vec3& p = element.position;
+				double tensor[6];
+				origin_tensor(element.mass, p.x, p.y, p.z, tensor);
+				tensor[0] += element.inertia.x;
+				tensor[1] += element.inertia.y;
+				tensor[2] += element.inertia.z;
+
+				m_mass += sign * element.mass;
+				m_moment[0] += sign * element.mass * p.x;
+				m_moment[1] += sign * element.mass * p.y;
+				m_moment[2] += sign * element.mass * p.z;
+				for (int k = 0; k < 6; k++) {
+					m_origin_tensor[k] += sign * tensor[k];
+				}
+				m_dirty = true;
+			}
+
+			// center of gravity, tensor about it and its inverse from the sums
+			void update() const
+			{
+				if (!m_dirty) {
+					return;
+				}
+				m_dirty = false;
+
+				if (m_mass <= 0.0) {
+					m_center_of_gravity = glm::vec3(0.0f);
+					m_tensor = m_inverse_tensor = glm::mat3(1.0f);
+					return;
+				}
+
+				double cx = m_moment[0] / m_mass, cy = m_moment[1] / m_mass, cz = m_moment[2] / m_mass;
+				double shift[6];
+				origin_tensor(m_mass, cx, cy, cz, shift);
+				double t[6];
+				for (int k = 0; k < 6; k++) {
+					t[k] = m_origin_tensor[k] - shift[k];
+				}
+
+				// symmetric inverse from the adjugate
+				double c00 = t[1] * t[2] - t[5] * t[5], c01 = t[4] * t[5] - t[3] * t[2], c02 = t[3] * t[5] - t[4] * t[1];
+				double c11 = t[0] * t[2] - t[4] * t[4], c12 = t[3] * t[4] - t[0] * t[5], c22 = t[0] * t[1] - t[3] * t[3];
+				double inverse_determinant = 1.0 / (t[0] * c00 + t[3] * c01 + t[4] * c02);
+
+				m_center_of_gravity = glm::vec3((float)cx, (float)cy, (float)cz);
+				// clang-format off
+				m_tensor = glm::mat3(
+					(float)t[0], (float)t[3], (float)t[4],
+					(float)t[3], (float)t[1], (float)t[5],
+					(float)t[4], (float)t[5], (float)t[2]);
+				m_inverse_tensor = glm::mat3(
+					(float)(c00 * inverse_determinant), (float)(c01 * inverse_determinant), (float)(c02 * inverse_determinant),
+					(float)(c01 * inverse_determinant), (float)(c11 * inverse_determinant), (float)(c12 * inverse_determinant),
+					(float)(c02 * inverse_determinant), (float)(c12 * inverse_determinant), (float)(c22 * inverse_determinant));
+				// clang-format on
+			}
+		};
+	};  // namespace inertia
+};  // namespace physics
+
+#endif // MASS_PROPERTIES_H
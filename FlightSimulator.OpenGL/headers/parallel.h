@@ -0,0 +1,42 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+
+#include "job_system.h"
+
+// Splits the range [begin, end) into contiguous chunks, runs func(chunkBegin, chunkEnd) for each chunk on the shared
+// job system and returns once every chunk is done. There are a few chunks per thread so threads that finish early
+// steal the rest, and the calling thread runs chunks itself while it waits.
+// @param begin: First index of the range.
+// @param end: One past the last index of the range.
+// @param func: Callable taking (int chunkBegin, int chunkEnd). Must be safe to run concurrently on disjoint chunks.
+// @param minCount: Ranges shorter than this run on the calling thread, where handing them to jobs costs more than it
+// saves.
+template <typename Func>
+void ParallelForRange(int begin, int end, Func&& func, int minCount = 1)
+{
+    int count = end - begin;
+    if (count <= 0)
+        return;
+    if (count < minCount)
+    {
+        func(begin, end);
+        return;
+    }
+
+    JobSystem& jobs = GetJobSystem();
+    const int chunksPerThread = 4;
+    int chunkCount = std::min(count, jobs.GetThreadCount() * chunksPerThread);
+    int chunkSize = (count + chunkCount - 1) / chunkCount;
+    if (chunkSize >= count)
+    {
+        func(begin, end);
+        return;
+    }
+
+    // The chunks only refer to func, which outlives them because this call waits.
+    jobs.Wait(jobs.ParallelFor(begin, end, chunkSize, [&func](int chunkBegin, int chunkEnd) { func(chunkBegin, chunkEnd); }));
+}
+
+#endif // PARALLEL_H
@@ -10,27 +10,21 @@
 #include <variant>
 #include <vector>
 
+#include "atmosphere.h"
 
-//  International Standard Atmosphere (ISA)
+//  International Standard Atmosphere (ISA), see atmosphere.h for the full model
 namespace isa
 {
-	// get temperture in kelvin
-	inline float get_air_temperature(float altitude)
-	{
-		/*assert(0.0f <= altitude && altitude <= 11000.0f);*/
-		return 288.15f - 0.0065f * altitude;
-	}
+	// get temperture in kelvin, interpolated from the standard atmosphere table
+	inline float get_air_temperature(float altitude) { return get_atmosphere_table().get_temperature(altitude); }
 
-	// only accurate for altitudes < 11km
-	float get_air_density(float altitude)
-	{
-		/*assert(0.0f <= altitude && altitude <= 11000.0f);*/
-		float temperature = get_air_temperature(altitude);
-		float pressure = 101325.0f * std::pow(1 - 0.0065f * (altitude / 288.15f), 5.25f);
-		return 0.00348f * (pressure / temperature);
-	}
+	// get air density in kg/m^3, interpolated from the standard atmosphere table
+	inline float get_air_density(float altitude) { return get_atmosphere_table().get_density(altitude); }
+
+	inline const float sea_level_air_density = get_air_density(0.0f);
 
-	const float sea_level_air_density = get_air_density(0.0f);
+	// dynamic viscosity of air in Pa*s, taken as constant over the troposphere
+	constexpr float air_dynamic_viscosity = 1.81e-5f;
 };  // namespace isa
 
 namespace physics
@@ -0,0 +1,14 @@
+#ifndef PROCESS_MEMORY_H
+#define PROCESS_MEMORY_H
+
+#include <cstddef>
+
+// Gets the largest resident set (working set) the process has had so far.
+// @return: Peak resident memory in bytes, 0 if the platform does not report it.
+size_t GetPeakResidentBytes();
+
+// Gets the current resident set (working set) of the process.
+// @return: Resident memory in bytes, 0 if the platform does not report it.
+size_t GetCurrentResidentBytes();
+
+#endif // PROCESS_MEMORY_H
@@ -0,0 +1,412 @@
+#ifndef RIGID_BODY_H
+#define RIGID_BODY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "physics.h"
+
+namespace physics
+{
+	// numerical schemes a RigidBody can be stepped with, from cheapest to most accurate per step
+	enum class Integrator {
+		semi_implicit_euler,  // first order and symplectic, one force evaluation per step
+		verlet,               // velocity verlet, second order and symplectic for forces that depend on position only, two evaluations
+		rk4,                  // classic fourth order runge-kutta, four evaluations
+		adaptive,             // bogacki-shampine 3(2) with error control, substeps until within RigidBody::adaptive_tolerance
+	};
+
+	inline const char* get_integrator_name(Integrator integrator)
+	{
+		switch (integrator) {
+		case Integrator::semi_implicit_euler: return "semi_implicit_euler";
+		case Integrator::verlet: return "verlet";
+		case Integrator::rk4: return "rk4";
+		case Integrator::adaptive: return "adaptive";
+		}
+		return "unknown";
+	}
+
+	// @return: False if name is none of the names of get_integrator_name.
+	inline bool parse_integrator(const char* name, Integrator& integrator)
+	{
+		for (Integrator candidate : { Integrator::semi_implicit_euler, Integrator::verlet, Integrator::rk4, Integrator::adaptive }) {
+			if (std::strcmp(name, get_integrator_name(candidate)) == 0) {
+				integrator = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// brings a quaternion that drifted slightly off unit length back onto it without a square root, first order
+	// newton step of 1 / sqrt(|q|^2) around 1. the error left is the square of the drift, so calling it every step
+	// keeps the orientation unit length to float precision
+	inline glm::quat renormalize(const glm::quat& q)
+	{
+		return q * (1.5f - 0.5f * glm::dot(q, q));
+	}
+
+	// 6-DOF rigid body with quaternion orientation. position, velocity and angular_velocity are in world space,
+	// the inertia tensor is given in body space and rotated into world space on every step
+	class RigidBody
+	{
+	public:
+		float mass = 1.0f;
+		glm::vec3 position{ 0.0f };
+		glm::quat orientation{ 1.0f, 0.0f, 0.0f, 0.0f };
+		glm::vec3 velocity{ 0.0f };          // world space, m/s
+		glm::vec3 angular_velocity{ 0.0f };  // world space, rad/s
+		bool apply_gravity = true;
+		Integrator integrator = Integrator::semi_implicit_euler;  // used by step
+		float adaptive_tolerance = 1e-4f;  // largest error per adaptive substep, metres, and rad at 1 m for rotations
+		int adaptive_max_substeps = 64;    // bound on the work of one adaptive step
+
+		// force evaluations of the last step, for comparing integrators by cost
+		int get_evaluation_count() const { return m_evaluations; }
+
+		RigidBody() = default;
+
+		RigidBody(float mass, const glm::mat3& inertia) { set_mass_properties(mass, inertia); }
+
+		virtual ~RigidBody() = default;
+
+		// set mass and body space inertia tensor, e.g. from inertia::tensor()
+		void set_mass_properties(float new_mass, const glm::mat3& inertia)
+		{
+			mass = new_mass;
+			m_inertia = inertia;
+			m_inverse_inertia = glm::inverse(inertia);
+		}
+
+		// set mass, inertia tensor and its inverse when the inverse is known already, e.g. from inertia::mass_properties
+		void set_mass_properties(float new_mass, const glm::mat3& inertia, const glm::mat3& inverse_inertia)
+		{
+			mass = new_mass;
+			m_inertia = inertia;
+			m_inverse_inertia = inverse_inertia;
+		}
+
+		const glm::mat3& get_inertia() const { return m_inertia; }
+
+		// world space inertia tensor R * I * R^T
+		glm::mat3 get_world_inertia() const
+		{
+			glm::mat3 rotation = glm::mat3_cast(orientation);
+			return rotation * m_inertia * glm::transpose(rotation);
+		}
+
+		// world space inverse inertia tensor R * I^-1 * R^T
+		glm::mat3 get_world_inverse_inertia() const
+		{
+			glm::mat3 rotation = glm::mat3_cast(orientation);
+			return rotation * m_inverse_inertia * glm::transpose(rotation);
+		}
+
+		// transform direction from body space to world space
+		glm::vec3 transform_direction(const glm::vec3& direction) const { return orientation * direction; }
+
+		// transform direction from world space to body space
+		glm::vec3 inverse_transform_direction(const glm::vec3& direction) const
+		{
+			return glm::conjugate(orientation) * direction;
+		}
+
+		// velocity in body space
+		glm::vec3 get_body_velocity() const { return inverse_transform_direction(velocity); }
+
+		// angular velocity in body space
+		glm::vec3 get_body_angular_velocity() const { return inverse_transform_direction(angular_velocity); }
+
+		// world space velocity of a point given relative to the center of mass in body space
+		glm::vec3 get_point_velocity(const glm::vec3& body_point) const
+		{
+			return velocity + glm::cross(angular_velocity, transform_direction(body_point));
+		}
+
+		// force and torque in world space
+		void add_force(const glm::vec3& force) { m_force += force; }
+		void add_torque(const glm::vec3& torque) { m_torque += torque; }
+
+		// force and torque in body space
+		void add_relative_force(const glm::vec3& force) { m_force += transform_direction(force); }
+		void add_relative_torque(const glm::vec3& torque) { m_torque += transform_direction(torque); }
+
+		// force in body space applied at a point in body space relative to the center of mass
+		void add_force_at_point(const glm::vec3& force, const glm::vec3& body_point)
+		{
+			add_relative_force(force);
+			add_relative_torque(glm::cross(body_point, force));
+		}
+
+		// force and torque accumulated since the last step, world space. lets a trim solve read the forces of a state
+		// without stepping
+		const glm::vec3& get_force() const { return m_force; }
+		const glm::vec3& get_torque() const { return m_torque; }
+
+		void clear_forces()
+		{
+			m_force = glm::vec3(0.0f);
+			m_torque = glm::vec3(0.0f);
+		}
+
+		// semi-implicit euler step, consumes the accumulated force and torque
+		void integrate(float dt)
+		{
+			m_previous_position = position;
+			m_previous_orientation = orientation;
+
+			velocity += get_acceleration() * dt;
+			position += velocity * dt;
+			angular_velocity += get_angular_acceleration() * dt;
+
+			// dq/dt = 0.5 * w * q with w as a pure quaternion in world space
+			orientation = renormalize(orientation + (glm::quat(0.0f, angular_velocity) * orientation) * (0.5f * dt));
+
+			m_force = glm::vec3(0.0f);
+			m_torque = glm::vec3(0.0f);
+		}
+
+		// advances the body by dt with the selected integrator. apply_forces() adds the forces of the current state
+		// with add_force and friends and is called once per evaluation the integrator needs, with the body moved to
+		// the state of that evaluation. forces accumulated before the call count as constant over the step
+		template <typename ApplyForces>
+		void step(float dt, ApplyForces&& apply_forces)
+		{
+			m_evaluations = 0;
+			if (integrator == Integrator::semi_implicit_euler) {
+				m_evaluations = 1;
+				apply_forces();
+				integrate(dt);
+				return;
+			}
+
+			const glm::vec3 external_force = m_force, external_torque = m_torque;
+			auto evaluate = [&](const State& state) {
+				set_state(state);
+				m_force = external_force;
+				m_torque = external_torque;
+				apply_forces();
+				Derivative derivative = get_derivative();
+				m_force = glm::vec3(0.0f);
+				m_torque = glm::vec3(0.0f);
+				return derivative;
+			};
+
+			const State start = get_state();
+			State end = start;
+			if (integrator == Integrator::verlet) {
+				// kick, drift, kick; the second kick sees the drifted position and half step velocities
+				Derivative d1 = evaluate(start);
+				State half = start;
+				half.velocity += d1.acceleration * (0.5f * dt);
+				half.angular_velocity += d1.angular_acceleration * (0.5f * dt);
+				half.position += half.velocity * dt;
+				half.orientation = rotate(half.orientation, half.angular_velocity, dt);
+				Derivative d2 = evaluate(half);
+				end = half;
+				end.velocity += d2.acceleration * (0.5f * dt);
+				end.angular_velocity += d2.angular_acceleration * (0.5f * dt);
+			}
+			else if (integrator == Integrator::rk4) {
+				Derivative d1 = evaluate(start);
+				Derivative d2 = evaluate(advance(start, d1, 0.5f * dt));
+				Derivative d3 = evaluate(advance(start, d2, 0.5f * dt));
+				Derivative d4 = evaluate(advance(start, d3, dt));
+				end = advance(start, (d1 + (d2 + d3) * 2.0f + d4) * (1.0f / 6.0f), dt);
+			}
+			else {
+				end = step_adaptive(start, dt, evaluate);
+			}
+
+			set_state(end);
+			m_previous_position = start.position;
+			m_previous_orientation = start.orientation;
+		}
+
+		// forget the previous step, e.g. after teleporting the body
+		void reset_interpolation()
+		{
+			m_previous_position = position;
+			m_previous_orientation = orientation;
+		}
+
+		// position between the last two steps, alpha = 0 is the previous step and alpha = 1 the current one
+		glm::vec3 get_interpolated_position(float alpha) const
+		{
+			return m_previous_position + (position - m_previous_position) * alpha;
+		}
+
+		// orientation between the last two steps
+		glm::quat get_interpolated_orientation(float alpha) const
+		{
+			return glm::slerp(m_previous_orientation, orientation, alpha);
+		}
+
+		// everything the next steps depend on besides the mass properties and the forces, which are cleared every
+		// step. plain data, so it can be saved as it is
+		struct Snapshot {
+			glm::vec3 position;
+			glm::quat orientation;
+			glm::vec3 velocity;
+			glm::vec3 angular_velocity;
+			glm::vec3 previous_position;
+			glm::quat previous_orientation;
+			float adaptive_step;
+		};
+
+		Snapshot get_snapshot() const
+		{
+			return { position, orientation, velocity, angular_velocity, m_previous_position, m_previous_orientation,
+				m_adaptive_step };
+		}
+
+		// continues from a snapshot between two steps, exactly as the body it was taken from would
+		void set_snapshot(const Snapshot& snapshot)
+		{
+			position = snapshot.position;
+			orientation = snapshot.orientation;
+			velocity = snapshot.velocity;
+			angular_velocity = snapshot.angular_velocity;
+			m_previous_position = snapshot.previous_position;
+			m_previous_orientation = snapshot.previous_orientation;
+			m_adaptive_step = snapshot.adaptive_step;
+			m_force = glm::vec3(0.0f);
+			m_torque = glm::vec3(0.0f);
+		}
+
+	protected:
+		// what the integrators advance
+		struct State {
+			glm::vec3 position;
+			glm::quat orientation;
+			glm::vec3 velocity;
+			glm::vec3 angular_velocity;
+		};
+
+		// rate of change of a State
+		struct Derivative {
+			glm::vec3 velocity;
+			glm::quat spin;  // dq/dt
+			glm::vec3 acceleration;
+			glm::vec3 angular_acceleration;
+
+			Derivative operator+(const Derivative& other) const
+			{
+				return { velocity + other.velocity, spin + other.spin, acceleration + other.acceleration,
+					angular_acceleration + other.angular_acceleration };
+			}
+
+			Derivative operator*(float scale) const
+			{
+				return { velocity * scale, spin * scale, acceleration * scale, angular_acceleration * scale };
+			}
+		};
+
+		State get_state() const { return { position, orientation, velocity, angular_velocity }; }
+
+		void set_state(const State& state)
+		{
+			position = state.position;
+			orientation = state.orientation;
+			velocity = state.velocity;
+			angular_velocity = state.angular_velocity;
+		}
+
+		// linear acceleration from the accumulated force and gravity
+		glm::vec3 get_acceleration() const
+		{
+			glm::vec3 acceleration = m_force / mass;
+			if (apply_gravity) {
+				acceleration.y -= EARTH_GRAVITY;
+			}
+			return acceleration;
+		}
+
+		// euler's equations in world space: I * dw/dt = tau - w x (I * w)
+		glm::vec3 get_angular_acceleration() const
+		{
+			glm::mat3 rotation = glm::mat3_cast(orientation);
+			glm::mat3 rotation_t = glm::transpose(rotation);
+			glm::mat3 world_inertia = rotation * m_inertia * rotation_t;
+			glm::mat3 world_inverse_inertia = rotation * m_inverse_inertia * rotation_t;
+			return world_inverse_inertia * (m_torque - glm::cross(angular_velocity, world_inertia * angular_velocity));
+		}
+
+		// derivative of the current state under the accumulated force and torque
+		Derivative get_derivative()
+		{
+			m_evaluations++;
+			return { velocity, (glm::quat(0.0f, angular_velocity) * orientation) * 0.5f, get_acceleration(),
+				get_angular_acceleration() };
+		}
+
+		// state + derivative * h, orientation renormalized
+		static State advance(const State& state, const Derivative& derivative, float h)
+		{
+			return { state.position + derivative.velocity * h, renormalize(state.orientation + derivative.spin * h),
+				state.velocity + derivative.acceleration * h, state.angular_velocity + derivative.angular_acceleration * h };
+		}
+
+		// orientation turned by the constant world space angular velocity w for h seconds, exactly
+		static glm::quat rotate(const glm::quat& orientation, const glm::vec3& w, float h)
+		{
+			float angle = glm::length(w) * h;
+			if (angle < 1e-6f) {
+				return renormalize(orientation + (glm::quat(0.0f, w) * orientation) * (0.5f * h));
+			}
+			return renormalize(glm::angleAxis(angle, w / glm::length(w)) * orientation);
+		}
+
+		// bogacki-shampine substeps over dt. the last substep length carries over to the next call, and the last
+		// evaluation of an accepted substep is the first of the next one
+		template <typename Evaluate>
+		State step_adaptive(const State& start, float dt, Evaluate& evaluate)
+		{
+			State state = start;
+			Derivative d1 = evaluate(state);
+			float remaining = dt;
+			float h = m_adaptive_step > 0.0f ? std::min(m_adaptive_step, dt) : dt;
+			for (int substep = 0; remaining > 0.0f; substep++) {
+				// the last substep lands on dt, and so does any substep once the bound is reached
+				const bool forced = substep + 1 >= adaptive_max_substeps;
+				const float trial = forced || h >= 0.99f * remaining ? remaining : h;
+				Derivative d2 = evaluate(advance(state, d1, 0.5f * trial));
+				Derivative d3 = evaluate(advance(state, d2, 0.75f * trial));
+				State third = advance(state, d1 * (2.0f / 9.0f) + d2 * (1.0f / 3.0f) + d3 * (4.0f / 9.0f), trial);
+				Derivative d4 = evaluate(third);
+				State second = advance(state, d1 * (7.0f / 24.0f) + d2 * 0.25f + d3 * (1.0f / 3.0f) + d4 * 0.125f, trial);
+
+				float error = std::max(glm::length(third.position - second.position),
+					trial * std::max(glm::length(third.velocity - second.velocity),
+						glm::length(third.angular_velocity - second.angular_velocity)));
+				float ratio = error / std::max(adaptive_tolerance, EPSILON);
+				float scale = glm::clamp(0.9f * std::cbrt(1.0f / std::max(ratio, 1e-6f)), 0.2f, 5.0f);
+				if (ratio <= 1.0f || forced) {
+					state = third;
+					d1 = d4;
+					remaining = trial == remaining ? 0.0f : remaining - trial;
+					// a substep cut short to land on dt says little about the next one
+					h = trial < h ? h : trial * scale;
+					m_adaptive_step = h;
+				}
+				else {
+					h = trial * scale;
+				}
+			}
+			return state;
+		}
+
+		glm::mat3 m_inertia{ 1.0f };
+		glm::mat3 m_inverse_inertia{ 1.0f };
+		glm::vec3 m_force{ 0.0f };   // world space, cleared every step
+		glm::vec3 m_torque{ 0.0f };  // world space, cleared every step
+		glm::vec3 m_previous_position{ 0.0f };
+		glm::quat m_previous_orientation{ 1.0f, 0.0f, 0.0f, 0.0f };
+		float m_adaptive_step = 0.0f;  // next adaptive substep, 0 until the first step
+		int m_evaluations = 0;
+	};
+};  // namespace physics
+
+#endif // RIGID_BODY_H
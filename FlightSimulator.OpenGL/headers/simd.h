@@ -0,0 +1,203 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstdint>
+#include <emmintrin.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// Thin wrappers over SSE2, AVX2 and AVX-512 registers so batch kernels can be written once as templates over the
+// vector type. SSE2 is always available; the wider types exist only in translation units compiled for them
+// (/arch:AVX2 or /arch:AVX512 per file in the project), and callers pick one at runtime with the cpu queries below.
+// Every type offers the same operations: load/store of Width floats, broadcast, arithmetic, min/max, sqrt,
+// comparisons returning a Mask, Select(mask, a, b), LoadInt and Gather(base, index).
+namespace simd
+{
+    // Reads CPUID leaf and subleaf into eax, ebx, ecx, edx.
+    inline void Cpuid(int leaf, int subleaf, int info[4])
+    {
+#if defined(_MSC_VER)
+        __cpuidex(info, leaf, subleaf);
+#else
+        __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+    }
+
+    // Reads XCR0, the register state the operating system saves on a context switch. Only valid with OSXSAVE set.
+    inline uint64_t ReadXcr0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t low, high;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return ((uint64_t)high << 32) | low;
+#endif
+    }
+
+    // Checks OSXSAVE and the XCR0 bits of the given register state.
+    inline bool OsSavesState(uint64_t stateBits)
+    {
+        int info[4];
+        Cpuid(1, 0, info);
+        return (info[2] & (1 << 27)) && (ReadXcr0() & stateBits) == stateBits;
+    }
+
+    // Processor support, including the operating system saving the wide registers: XMM and YMM state (XCR0 bits 1-2)
+    // for AVX2, and on top of that opmask, ZMM_Hi256 and Hi16_ZMM state (bits 5-7) for AVX-512.
+    inline bool CpuSupportsAvx2()
+    {
+        int info[4];
+        Cpuid(0, 0, info);
+        if (info[0] < 7)
+            return false;
+        Cpuid(1, 0, info);
+        bool fma = (info[2] & (1 << 12)) != 0;
+        if (!fma || !OsSavesState(0x6))
+            return false;
+        Cpuid(7, 0, info);
+        return (info[1] & (1 << 5)) != 0;
+    }
+
+    inline bool CpuSupportsAvx512()
+    {
+        int info[4];
+        Cpuid(0, 0, info);
+        if (info[0] < 7 || !OsSavesState(0xe6))
+            return false;
+        Cpuid(7, 0, info);
+        return (info[1] & (1 << 16)) != 0;
+    }
+
+    // 4 lanes, SSE2.
+    struct Float4
+    {
+        static constexpr int Width = 4;
+        using Mask = __m128;
+        __m128 v;
+
+        Float4() = default;
+        Float4(__m128 value) : v(value) {}
+        Float4(float value) : v(_mm_set1_ps(value)) {}
+
+        static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+        void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+        // Loads 32 bit integers converted to float.
+        static Float4 LoadInt(const int32_t* p) { return _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)p)); }
+
+        // Reads base[index] per lane, index holding whole numbers. SSE2 has no gather, so the lanes are read one by one.
+        static Float4 Gather(const float* base, Float4 index)
+        {
+            alignas(16) int32_t i[4];
+            _mm_store_si128((__m128i*)i, _mm_cvttps_epi32(index.v));
+            return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+        }
+
+        friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+        friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+        friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+        friend Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+        friend Float4 operator-(Float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+        friend Float4 MulAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v); }
+        friend Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+        friend Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+        friend Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+        friend Float4 Abs(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+        friend Float4 Floor(Float4 a)
+        {
+            // truncation rounds towards zero, step back by one where that rounded up
+            __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+            return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+        }
+        friend Mask operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+        friend Mask operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+        friend Float4 Select(Mask mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v)); }
+    };
+
+#if defined(__AVX2__)
+    // 8 lanes, AVX2 and FMA.
+    struct Float8
+    {
+        static constexpr int Width = 8;
+        using Mask = __m256;
+        __m256 v;
+
+        Float8() = default;
+        Float8(__m256 value) : v(value) {}
+        Float8(float value) : v(_mm256_set1_ps(value)) {}
+
+        static Float8 Load(const float* p) { return _mm256_loadu_ps(p); }
+        void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+        static Float8 LoadInt(const int32_t* p) { return _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)p)); }
+
+        static Float8 Gather(const float* base, Float8 index)
+        {
+            return _mm256_i32gather_ps(base, _mm256_cvttps_epi32(index.v), 4);
+        }
+
+        friend Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+        friend Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+        friend Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+        friend Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+        friend Float8 operator-(Float8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+        friend Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+        friend Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+        friend Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+        friend Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+        friend Float8 Abs(Float8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+        friend Float8 Floor(Float8 a) { return _mm256_floor_ps(a.v); }
+        friend Mask operator<(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+        friend Mask operator>(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+        friend Float8 Select(Mask mask, Float8 a, Float8 b) { return _mm256_blendv_ps(b.v, a.v, mask); }
+    };
+#endif
+
+#if defined(__AVX512F__)
+    // 16 lanes, AVX-512F.
+    struct Float16
+    {
+        static constexpr int Width = 16;
+        using Mask = __mmask16;
+        __m512 v;
+
+        Float16() = default;
+        Float16(__m512 value) : v(value) {}
+        Float16(float value) : v(_mm512_set1_ps(value)) {}
+
+        static Float16 Load(const float* p) { return _mm512_loadu_ps(p); }
+        void Store(float* p) const { _mm512_storeu_ps(p, v); }
+
+        static Float16 LoadInt(const int32_t* p) { return _mm512_cvtepi32_ps(_mm512_loadu_si512(p)); }
+
+        static Float16 Gather(const float* base, Float16 index)
+        {
+            return _mm512_i32gather_ps(_mm512_cvttps_epi32(index.v), base, 4);
+        }
+
+        friend Float16 operator+(Float16 a, Float16 b) { return _mm512_add_ps(a.v, b.v); }
+        friend Float16 operator-(Float16 a, Float16 b) { return _mm512_sub_ps(a.v, b.v); }
+        friend Float16 operator*(Float16 a, Float16 b) { return _mm512_mul_ps(a.v, b.v); }
+        friend Float16 operator/(Float16 a, Float16 b) { return _mm512_div_ps(a.v, b.v); }
+        friend Float16 operator-(Float16 a) { return _mm512_sub_ps(_mm512_setzero_ps(), a.v); }
+        friend Float16 MulAdd(Float16 a, Float16 b, Float16 c) { return _mm512_fmadd_ps(a.v, b.v, c.v); }
+        friend Float16 Min(Float16 a, Float16 b) { return _mm512_min_ps(a.v, b.v); }
+        friend Float16 Max(Float16 a, Float16 b) { return _mm512_max_ps(a.v, b.v); }
+        friend Float16 Sqrt(Float16 a) { return _mm512_sqrt_ps(a.v); }
+        friend Float16 Abs(Float16 a) { return _mm512_abs_ps(a.v); }
+        friend Float16 Floor(Float16 a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        friend Mask operator<(Float16 a, Float16 b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+        friend Mask operator>(Float16 a, Float16 b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+        friend Float16 Select(Mask mask, Float16 a, Float16 b) { return _mm512_mask_blend_ps(mask, b.v, a.v); }
+    };
+#endif
+};
+
+#endif // SIMD_H
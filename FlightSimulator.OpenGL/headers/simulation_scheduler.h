@@ -0,0 +1,137 @@
+#ifndef SIMULATION_SCHEDULER_H
+#define SIMULATION_SCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Where the player watches the simulation from.
+struct SchedulerView {
+    glm::vec3 position{ 0.0f }; // e.g. Camera::Position.
+    glm::vec3 front{ 0.0f, 0.0f, -1.0f }; // Unit view direction.
+    float cosHalfFov = 0.5f; // Cosine of half the widest field of view angle; entities outside count as hidden.
+};
+
+// SimulationScheduler picks how often each simulated entity is stepped. The simulation runs in ticks of a fixed size
+// and an entity of level l steps every 2^l ticks, with a step as long as the time since its previous one. The level
+// follows from the distance to the view, scaled up for entities outside the field of view and down by the importance
+// of the entity, so the simulation cost follows what the player can actually see.
+//
+// Entities wait in a timing wheel with one bucket per tick of the longest period. A tick takes the due entities from
+// its bucket and puts each back into the bucket of its next step, so scheduling costs O(1) per step no matter how
+// many entities there are. Entities of one level are spread over the ticks of their period by index, so the work per
+// tick stays even. A bucket is a list linked through the entities themselves, so the whole schedule is the entity
+// array and two ints per bucket, and restoring it is a memcpy of each.
+//
+// Entities are dense indices that mirror the simulation arrays: Add appends and Remove moves the last entity into
+// the freed index, just like TrafficSystem::RemoveAircraft.
+class SimulationScheduler
+{
+public:
+    static constexpr int MAX_LEVELS = 8;
+
+    struct Settings {
+        float tickSeconds = 1.0f / 120.0f; // Step of level 0 entities.
+        int levelCount = 4; // Levels 0..levelCount-1, so the longest step is 2^(levelCount-1) ticks.
+        float fullRateDistance = 1500.0f; // Visible entities closer than this step every tick, m.
+        float hiddenDistanceScale = 4.0f; // Entities outside the view count as this much farther away.
+    };
+
+    SimulationScheduler();
+    explicit SimulationScheduler(const Settings& settings);
+
+    // Adds an entity at level 0, due on the next tick.
+    // @param importance: Divides the distance the level is chosen by, e.g. 4 for the aircraft the player follows.
+    // @return: Index of the entity.
+    int Add(float importance = 1.0f);
+
+    // Removes an entity by moving the last one into its index.
+    void Remove(int index);
+
+    // Sets the importance of an entity, it takes effect at the next rebalance.
+    void SetImportance(int index, float importance);
+
+    // Sets the level of an entity. A shorter period takes effect at once, a longer one after the next step.
+    void SetLevel(int index, int level);
+
+    // Chooses the levels of up to maxEntities entities from their distance and direction to the view. Successive
+    // calls continue where the previous one stopped, so every entity is revisited about every count / maxEntities calls.
+    // @param x, y, z: Position arrays of all entities.
+    // @return: Number of entities whose level changed.
+    int Rebalance(const SchedulerView& view, const float* x, const float* y, const float* z, int maxEntities);
+
+    // Gets the level an entity would have for its distance and direction, see Settings.
+    int ChooseLevel(const SchedulerView& view, const glm::vec3& position, float importance) const;
+
+    // Advances by one tick and collects the entities due.
+    // @return: Number of due entities, listed by GetDue and GetDueSteps.
+    int Tick();
+
+    // Gets the entities due in the last tick.
+    const std::vector<int>& GetDue() const { return m_due; }
+
+    // Gets the step in seconds of every due entity: the time since its previous step.
+    const std::vector<float>& GetDueSteps() const { return m_dueSteps; }
+
+    // Gets the seconds since the last step of every entity, for extrapolating them when rendering.
+    // @param alpha: Fraction of the current tick that has passed, e.g. FixedTimestep::alpha().
+    // @param elapsed: Receives one value per entity.
+    void GetElapsed(float alpha, std::vector<float>& elapsed) const;
+
+    int GetCount() const { return (int)m_entities.size(); }
+    int GetLevel(int index) const { return m_entities[index].level; }
+
+    // Gets the number of entities at a level.
+    int GetLevelPopulation(int level) const { return m_levelPopulation[level]; }
+
+    // Gets the entity steps per tick averaged over the period of the slowest level, what the current levels cost.
+    float GetStepsPerTick() const;
+
+    const Settings& GetSettings() const { return m_settings; }
+
+    // Appends the tick and the schedule of every entity, for continuing the schedule later with ReadState.
+    void WriteState(std::vector<uint8_t>& data) const;
+
+    // Replaces every entity with a schedule written by WriteState with the same settings. The buckets come back in
+    // the same order, so the same entities come due in the same order as they would have. Restoring no more entities
+    // than the scheduler had room for before allocates nothing.
+    // @param pData: Start of the state, moved past it.
+    // @param pEnd: End of the data.
+    // @return: False if the data ends early or does not fit the settings, the scheduler is emptied then.
+    bool ReadState(const uint8_t*& pData, const uint8_t* pEnd);
+
+private:
+    struct Entity {
+        int level = 0;
+        float importance = 1.0f;
+        int64_t lastTick = 0; // Tick of the previous step.
+        int64_t nextTick = 0; // Tick of the next step, selects the bucket.
+        int previous = -1; // Neighbours in the bucket, -1 at its ends.
+        int next = -1;
+    };
+
+    Settings m_settings;
+    std::vector<Entity> m_entities;
+    std::vector<int> m_bucketFirst; // First entity of every bucket, -1 when empty.
+    std::vector<int> m_bucketLast;
+    int64_t m_tick = 0;
+    int m_rebalanceCursor = 0;
+    int m_levelPopulation[MAX_LEVELS] = {};
+
+    std::vector<int> m_due;
+    std::vector<float> m_dueSteps;
+
+    // Gets the bucket of a tick.
+    size_t GetBucket(int64_t tick) const { return (size_t)tick & (m_bucketFirst.size() - 1); }
+
+    // Puts an entity at the end of the bucket of a tick.
+    void Schedule(int index, int64_t tick);
+
+    // Takes an entity out of its bucket.
+    void Unschedule(int index);
+
+    // First tick at or after from on which the entity's level lands by its index.
+    int64_t AlignedTick(int index, int64_t from) const;
+};
+
+#endif // SIMULATION_SCHEDULER_H
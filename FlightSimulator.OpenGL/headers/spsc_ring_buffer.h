@@ -0,0 +1,77 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// SpscRingBuffer passes items from one producer thread to one consumer thread without locks. Each side owns one
+// index and only reads the other's, so a push or pop is a copy or move and two atomic operations, and neither side
+// ever waits for the other. The indices sit on separate cache lines so the two threads do not share one.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    // @param capacity: Rounded up to a power of two.
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+
+    // Producer side: appends an item.
+    // @return: False if the buffer is full, the item is not added.
+    bool TryPush(const T& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+            return false;
+        m_items[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: appends an item by moving it, e.g. a buffer whose allocation the consumer takes over.
+    // @return: False if the buffer is full, the item is left as it was.
+    bool TryPush(T&& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+            return false;
+        m_items[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: takes the oldest item.
+    // @return: False if the buffer is empty.
+    bool TryPop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(m_items[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Gets the number of items waiting, exact only on the consumer side.
+    size_t GetSize() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+    std::vector<T> m_items;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{ 0 }; // Next item to pop, written by the consumer.
+    alignas(64) std::atomic<size_t> m_tail{ 0 }; // Next slot to push, written by the producer.
+};
+
+#endif // SPSC_RING_BUFFER_H
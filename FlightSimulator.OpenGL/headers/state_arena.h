@@ -0,0 +1,91 @@
+#ifndef STATE_ARENA_H
+#define STATE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// StateArena owns one block of plain data simulation state, aligned for vector loads. A system carves its arrays out
+// of a single arena instead of allocating each on its own, so its whole state sits in one place: saving it is a few
+// memcpys of contiguous arrays, and restoring it into an arena that is large enough allocates nothing.
+class StateArena
+{
+public:
+    // Alignment of the block, and the granularity systems should align their arrays to.
+    static constexpr size_t ALIGNMENT = 64;
+
+    StateArena() = default;
+
+    ~StateArena() { Free(); }
+
+    StateArena(const StateArena&) = delete;
+    StateArena& operator=(const StateArena&) = delete;
+
+    StateArena(StateArena&& other) noexcept { Swap(other); }
+
+    StateArena& operator=(StateArena&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Free();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    // Replaces the block with a zeroed one of size bytes. The old contents are lost.
+    // @param size: Size in bytes, rounded up to ALIGNMENT.
+    void Allocate(size_t size)
+    {
+        Free();
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (size == 0)
+            return;
+#ifdef _WIN32
+        m_data = (uint8_t*)_aligned_malloc(size, ALIGNMENT);
+#else
+        m_data = (uint8_t*)aligned_alloc(ALIGNMENT, size);
+#endif
+        if (m_data)
+        {
+            memset(m_data, 0, size);
+            m_size = size;
+        }
+    }
+
+    // Gets the start of an array at a byte offset into the block.
+    template <typename T>
+    T* Get(size_t offset) const { return (T*)(m_data + offset); }
+
+    uint8_t* GetData() const { return m_data; }
+
+    size_t GetSize() const { return m_size; }
+
+    void Swap(StateArena& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+    }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+    void Free()
+    {
+#ifdef _WIN32
+        _aligned_free(m_data);
+#else
+        free(m_data);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+};
+
+#endif // STATE_ARENA_H
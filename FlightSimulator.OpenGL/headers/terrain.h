@@ -1,8 +1,12 @@
 #ifndef TERRAIN_H
 #define TERRAIN_H
 
+#include <memory>
 #include <ogldev_array_2d.h>
 #include "terrain_grid.h"
+#include "terrain_detail.h"
+#include "terrain_lighting.h"
+#include "terrain_regenerator.h"
 #include "camera.h"
 #include "shader.h"
 #include "3rdParty/ogldev_texture.h"
@@ -46,11 +50,18 @@ public:
     // @param pFilename: File path to the terrain data file.
     void LoadFromFile(const char* pFilename);
 
+    // Loads one LOD level of a terrain database produced by the DEM import tool. The post spacing and height range
+    // of the database replace the world scale and heights set by InitTerrain.
+    // @param pFilename: Path of the terrain database.
+    // @param level: LOD level to load, 0 being the finest. Coarse levels keep the heightmap small.
+    // @return: False if the database cannot be opened or has no such level.
+    bool LoadFromDatabase(const char* pFilename, int level);
+
     // Gets the height at a specific (x, z) coordinate on the terrain.
     // @param x: X-coordinate on the terrain.
     // @param z: Z-coordinate on the terrain.
     // @return: Height at the specified coordinates.
-    float GetHeight(int x, int z) const { return m_heightMap.Get(x, z); }
+    float GetHeight(int x, int z) const { return m_heightMap->Get(x, z); }
 
     // Gets the interpolated height at a non-integer (x, z) position on the terrain.
     // Provides smoother height transitions between grid points.
@@ -59,6 +70,10 @@ public:
     // @return: Interpolated height at the specified position.
     float GetHeightInterpolated(float x, float z) const;
 
+    // Gets the heightmap backing the terrain.
+    // @return: Heightmap of m_terrainSize x m_terrainSize posts.
+    const Array2D<float>& GetHeightMap() const { return *m_heightMap; }
+
     // Gets the size of the terrain grid. Assumes the terrain is a square for simplicity.
     // @return: Size of one side of the terrain grid.
     float GetSize() const { return m_terrainSize; }
@@ -83,12 +98,52 @@ public:
     // @param tex3Height: Height for the fourth texture transition.
     void SetTextureHeights(float tex0Height, float tex1Height, float tex2Height, float tex3Height);
 
+    // Sets the direction towards the sun. Only the sun term of the baked lighting is recomputed, and the sun
+    // horizon is only swept again when the sun azimuth changed.
+    // @param sunDirection: Direction pointing towards the sun in world space.
+    void SetSunDirection(const glm::vec3& sunDirection);
+
+    // Advances a background regeneration started by a derived terrain. Uploads a bounded slice of the new mesh
+    // and, once it is fully resident, swaps the new heightmap and mesh in together. Call once per frame before Render.
+    void UpdateRegeneration();
+
+    // Stops a background regeneration, waiting for its build to finish; the current terrain stays. Call before the
+    // shared job system goes away, which is destroyed before global terrains.
+    void CancelRegeneration() { m_regenerator.Cancel(); }
+
+    // Returns true while a new terrain is being generated or uploaded in the background.
+    bool IsRegenerating() const { return m_regenerator.IsBusy(); }
+
+    // Refines the terrain around the camera with synthesized detail. Call once per frame before Render.
+    // @param cameraPosition: Position of the camera in world space.
+    void UpdateDetail(const glm::vec3& cameraPosition);
+
+    // Gets the height at a world position, including synthesized detail where it is currently refined.
+    // @param worldX: X-coordinate in world space.
+    // @param worldZ: Z-coordinate in world space.
+    // @return: Height of the rendered surface at the specified position.
+    float GetDetailedHeight(float worldX, float worldZ) const;
+
 protected:
+    // Starts generating a replacement terrain on worker threads. The current terrain keeps rendering and answering
+    // height queries until UpdateRegeneration() swaps the new one in.
+    // @param terrainSize: Number of posts along one side of the new terrain.
+    // @param minHeight: Minimum height of the new terrain.
+    // @param maxHeight: Maximum height of the new terrain.
+    // @param generate: Callback filling the new heightmap. Runs on a worker thread and must not touch GL.
+    void BeginRegeneration(int terrainSize, float minHeight, float maxHeight, TerrainRegenerator::GenerateFunc generate);
+
     // Loads heightmap data from a specified file.
     // The heightmap defines the elevation at different points on the terrain.
     // @param pFilename: Path to the heightmap file.
     void LoadHeightMapFile(const char* pFilename);
 
+    // Bakes ambient occlusion and sun visibility for the current heightmap and uploads them to the GPU.
+    void BakeLighting();
+
+    // Uploads the baked lighting texels into m_lightingTexture.
+    void UploadLightingTexture();
+
     // Sets the minimum and maximum height uniforms in the terrains fragment shader.
     // @param MinHeight: The minimum height of the terrain.
     // @param MaxHeight: The maximum height of the terrain.
@@ -100,8 +155,8 @@ protected:
     // Scaling factor for the terrain in world space.
     float m_worldScale = 1.0f;
 
-    // 2D array representing the heightmap of the terrain.
-    Array2D<float> m_heightMap;
+    // 2D array representing the heightmap of the terrain. Held by pointer so a regenerated heightmap can be swapped in without a copy.
+    std::unique_ptr<Array2D<float>> m_heightMap = std::make_unique<Array2D<float>>();
 
     // TerrainGrid object for managing and rendering the terrain geometry.
     TerrainGrid m_terrainGrid;
@@ -123,6 +178,21 @@ protected:
 
     // Maximum height of the terrain.
     float m_maxHeight = 0.0f;
+
+    // Precomputed ambient occlusion and sun visibility.
+    TerrainLighting m_lighting;
+
+    // RG8 texture holding the baked lighting, one texel per heightmap post.
+    GLuint m_lightingTexture = 0;
+
+    // Direction pointing towards the sun in world space.
+    glm::vec3 m_sunDirection = glm::normalize(glm::vec3(0.4f, 0.6f, 0.3f));
+
+    // Builds replacement terrains in the background.
+    TerrainRegenerator m_regenerator;
+
+    // Synthesized high resolution patches around the camera.
+    TerrainDetail m_detail;
 };
 
 #endif // TERRAIN_H
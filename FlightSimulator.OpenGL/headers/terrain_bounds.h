@@ -0,0 +1,66 @@
+#ifndef TERRAIN_BOUNDS_H
+#define TERRAIN_BOUNDS_H
+
+#include <vector>
+
+#include "height_field.h"
+
+// An entity whose sphere reaches down to the ground.
+struct TerrainContact {
+    int entity;
+    float clearance; // Height of the lowest point of the sphere above the ground, m; negative below it.
+};
+
+// TerrainBounds keeps the lowest and highest post of every cell of a grid laid over a HeightField. The ground is
+// interpolated between posts, so it never leaves the range of the posts around it, and the range of the cells under
+// an area bounds the ground there conservatively. Most aircraft fly far above the highest post of their cell, and are
+// cleared without sampling the ground at all.
+class TerrainBounds
+{
+public:
+    // Rebuilds the bounds of a ground in parallel, whenever it changes.
+    // @param ground: Heights to bound, only read during the call.
+    // @param postsPerCell: Post intervals along a cell edge; smaller cells give tighter bounds and more cells.
+    void Build(const HeightField& ground, int postsPerCell = 16);
+
+    // Gets heights that the ground under a rectangle never leaves.
+    // @param minX, minZ, maxX, maxZ: The rectangle in world space.
+    void GetBounds(float minX, float minZ, float maxX, float maxZ, float& minHeight, float& maxHeight) const;
+
+    // Finds the entities whose sphere comes closer to the ground than a margin, in parallel. Entities above the
+    // bounds of their footprint are cleared at once; the others sample the ground under their centre.
+    // @param x, y, z: Centre arrays.
+    // @param radius: Radius array, or nullptr when every entity is a point.
+    // @param margin: Clearance below which an entity counts as in contact, m.
+    // @param ground: The ground the bounds were built from.
+    // @param contacts: Receives the contacts in entity order.
+    // @return: Number of entities that had to sample the ground.
+    int FindContacts(const float* x, const float* y, const float* z, const float* radius, int count, float margin,
+        const HeightField& ground, std::vector<TerrainContact>& contacts) const;
+
+    // Gets the highest post of the whole ground, the bound of any area.
+    float GetMaxHeight() const { return m_maxHeight; }
+
+    int GetCellsX() const { return m_cellsX; }
+    int GetCellsZ() const { return m_cellsZ; }
+
+    // Gets the side length of a cell in metres.
+    float GetCellSize() const { return m_cellSize; }
+
+private:
+    struct Cell {
+        float minHeight;
+        float maxHeight;
+    };
+
+    std::vector<Cell> m_cells; // Row major, z rows of m_cellsX cells.
+    int m_cellsX = 0;
+    int m_cellsZ = 0;
+    float m_cellSize = 1.0f;
+    float m_extentX = 0.0f; // Extent of the posts, beyond it the ground is at m_outsideHeight.
+    float m_extentZ = 0.0f;
+    float m_outsideHeight = 0.0f;
+    float m_maxHeight = 0.0f;
+};
+
+#endif // TERRAIN_BOUNDS_H
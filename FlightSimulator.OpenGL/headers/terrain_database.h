@@ -0,0 +1,125 @@
+#ifndef TERRAIN_DATABASE_H
+#define TERRAIN_DATABASE_H
+
+#include <cstdint>
+#include <vector>
+#include <ogldev_array_2d.h>
+
+#include "mapped_file.h"
+
+// On disk layout of a terrain database, as written by the DEM import tool (FlightSimulator.DemImport).
+//
+//   TerrainDatabaseHeader
+//   tile payloads         tileSize x tileSize float heights each, row major, TERRAIN_DATABASE_ALIGNMENT aligned
+//   TerrainDatabaseLevel  levelCount entries, finest level first
+//   TerrainDatabaseTile   one entry per tile of every level, row major within a level
+//
+// The tables are written last so the tool can stream tiles out as they are produced. Neighbouring tiles share their
+// border row and column of posts, so tile (i, j) of a level starts at post (i, j) * (tileSize - 1). Every coarser
+// level halves the resolution by taking every second post, which keeps shared borders identical across tiles. When a
+// level spans an odd number of cells, the last post of the coarser level repeats the last post of the finer one.
+// All values are little endian.
+constexpr char TERRAIN_DATABASE_MAGIC[8] = { 'F', 'S', 'T', 'E', 'R', 'R', 'D', 'B' };
+constexpr uint32_t TERRAIN_DATABASE_VERSION = 1;
+constexpr uint64_t TERRAIN_DATABASE_ALIGNMENT = 64;
+
+struct TerrainDatabaseHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tileSize; // Posts along one side of a tile, including the shared border.
+    uint32_t levelCount;
+    uint32_t reserved;
+    float postSpacing; // Distance in metres between neighbouring posts of the finest level.
+    float minHeight;
+    float maxHeight;
+    float noDataHeight; // Height written for posts outside the source raster.
+    uint64_t levelTableOffset; // File offset of the TerrainDatabaseLevel table.
+    uint64_t tileTableOffset; // File offset of the TerrainDatabaseTile table.
+};
+
+struct TerrainDatabaseLevel {
+    uint32_t tilesX;
+    uint32_t tilesZ;
+    uint32_t postsX; // Posts covered by the source raster along x, at this level.
+    uint32_t postsZ;
+    uint64_t firstTile; // Index of the first tile of this level in the tile table.
+    float postSpacing;
+    uint32_t reserved;
+};
+
+struct TerrainDatabaseTile {
+    uint64_t offset; // File offset of the tile heights, 0 if the tile lies entirely outside the source raster.
+    float minHeight;
+    float maxHeight;
+};
+
+// TerrainDatabase gives read-only access to a memory-mapped terrain database. Only the tiles actually touched are
+// paged in, so databases far larger than memory can be opened and queried.
+class TerrainDatabase
+{
+public:
+    // Default constructor.
+    TerrainDatabase() = default;
+
+    // Maps and validates a database file.
+    // @param pFilename: Path of the database file.
+    // @return: False if the file is missing, truncated or not a terrain database of a supported version.
+    bool Open(const char* pFilename);
+
+    // Unmaps the database.
+    void Close();
+
+    // Returns true while a valid database is open.
+    bool IsOpen() const { return m_header != nullptr; }
+
+    // Gets the database header.
+    const TerrainDatabaseHeader& GetHeader() const { return *m_header; }
+
+    // Gets the number of LOD levels, 0 being the finest.
+    int GetLevelCount() const { return m_header ? (int)m_header->levelCount : 0; }
+
+    // Gets the description of a LOD level.
+    // @param level: Level index, 0 being the finest.
+    const TerrainDatabaseLevel& GetLevel(int level) const { return m_levels[level]; }
+
+    // Gets the table entry of a tile.
+    // @param level: Level index.
+    // @param tileX: Tile column.
+    // @param tileZ: Tile row.
+    const TerrainDatabaseTile& GetTileInfo(int level, int tileX, int tileZ) const;
+
+    // Gets the heights of a tile directly from the mapping.
+    // @param level: Level index.
+    // @param tileX: Tile column.
+    // @param tileZ: Tile row.
+    // @return: tileSize x tileSize heights, nullptr if the tile holds no data.
+    const float* GetTile(int level, int tileX, int tileZ) const;
+
+    // Gets the height of a single post of a level.
+    // @param level: Level index.
+    // @param x: Post column within the level.
+    // @param z: Post row within the level.
+    // @return: Height of the post, the no data height outside the raster.
+    float GetPostHeight(int level, int x, int z) const;
+
+    // Gets the bilinearly interpolated height at a position in metres from post (0, 0).
+    // @param level: Level index.
+    // @param x: X-coordinate in metres.
+    // @param z: Z-coordinate in metres.
+    // @return: Interpolated height.
+    float GetHeight(int level, float x, float z) const;
+
+    // Copies a whole level into a square heightmap, e.g. to hand a coarse level to BaseTerrain.
+    // @param level: Level index.
+    // @param heightMap: Receives size x size heights. Posts outside the level get the no data height.
+    // @param size: Receives the side length of the heightmap.
+    void ReadLevel(int level, Array2D<float>& heightMap, int& size) const;
+
+private:
+    MappedFile m_file;
+    const TerrainDatabaseHeader* m_header = nullptr;
+    const TerrainDatabaseLevel* m_levels = nullptr;
+    const TerrainDatabaseTile* m_tiles = nullptr;
+};
+
+#endif // TERRAIN_DATABASE_H
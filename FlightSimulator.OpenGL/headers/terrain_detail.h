@@ -0,0 +1,110 @@
+#ifndef TERRAIN_DETAIL_H
+#define TERRAIN_DETAIL_H
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <ogldev_array_2d.h>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// TerrainDetail synthesizes extra high frequency height close to the camera instead of raising the resolution of the
+// whole heightmap. The area around the camera is split into square patches of PATCH_CELLS heightmap cells. Each patch
+// is refined REFINEMENT times per cell using bicubic upsampling of the heightmap plus deterministic value noise, and
+// kept in a small LRU cache, so the cost of high detail follows the area around the camera and not the world size.
+//
+// Patch borders fall back to the exact height of the base mesh, so patches fit each other and the surrounding
+// base terrain without cracks. The base terrain skips fragments inside the region covered by refined patches.
+class TerrainDetail
+{
+public:
+    // Heightmap cells along one side of a patch.
+    static constexpr int PATCH_CELLS = 16;
+
+    // Refined cells per heightmap cell.
+    static constexpr int REFINEMENT = 8;
+
+    // Refined posts along one side of a patch.
+    static constexpr int PATCH_POSTS = PATCH_CELLS * REFINEMENT + 1;
+
+    // Patches around the camera patch that are refined in each direction.
+    static constexpr int ACTIVE_RADIUS = 2;
+
+    // Maximum number of refined patches kept, active or not.
+    static constexpr int CACHE_CAPACITY = 64;
+
+    // Maximum number of patches synthesized during a single Update.
+    static constexpr int MAX_BUILDS_PER_FRAME = 8;
+
+    // Default constructor.
+    TerrainDetail() = default;
+
+    // Refines the patches around the camera that are not cached yet and updates the LRU order.
+    // @param heightMap: Heightmap of the base terrain.
+    // @param terrainSize: Number of posts along one side of the base terrain.
+    // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+    // @param textureScale: Texture scale of the base terrain, so refined patches map textures identically.
+    // @param cameraPosition: Position of the camera in world space.
+    void Update(const Array2D<float>& heightMap, int terrainSize, float worldScale, float textureScale,
+        const glm::vec3& cameraPosition);
+
+    // Draws the active patches with the currently bound terrain shader.
+    void Render();
+
+    // Gets the world space region covered by active refined patches.
+    // @param region: Receives (minX, minZ, maxX, maxZ).
+    // @return: False if no complete region is refined yet and the base terrain must be drawn everywhere.
+    bool GetActiveRegion(glm::vec4& region) const;
+
+    // Gets the height of the refined mesh as drawn at a world position.
+    // @param worldX: X-coordinate in world space.
+    // @param worldZ: Z-coordinate in world space.
+    // @param height: Receives the refined height.
+    // @return: False if the position is not covered by a cached patch.
+    bool GetHeight(float worldX, float worldZ, float& height) const;
+
+    // Releases every cached patch and its GL objects, e.g. after the base heightmap changed.
+    void Clear();
+
+    // Synthesizes the refined height at a fractional heightmap position. Pure function of the heightmap and seed.
+    // @param x: X-coordinate in heightmap posts.
+    // @param z: Z-coordinate in heightmap posts.
+    // @param borderWeight: 0 returns the base mesh height, 1 the full synthesized detail.
+    static float SynthesizeHeight(const Array2D<float>& heightMap, int terrainSize, float worldScale, float x, float z,
+        float borderWeight);
+
+private:
+    // One refined patch.
+    struct Patch {
+        int patchX = 0;
+        int patchZ = 0;
+        std::vector<float> heights; // PATCH_POSTS x PATCH_POSTS refined heights.
+        GLuint vao = 0;
+        GLuint vb = 0;
+    };
+
+    // Key of a patch in the cache.
+    static long long PatchKey(int patchX, int patchZ) { return ((long long)patchX << 32) | (unsigned int)patchZ; }
+
+    // Fills the refined heights of a patch. Runs on worker threads.
+    static void SynthesizePatch(const Array2D<float>& heightMap, int terrainSize, float worldScale, Patch& patch);
+
+    // Uploads a synthesized patch, reusing the GL objects of an evicted patch when possible.
+    void UploadPatch(Patch& patch, float worldScale, float textureScale, int terrainSize);
+
+    // Creates the index buffer shared by all patches.
+    void CreateSharedIndexBuffer();
+
+    std::list<std::unique_ptr<Patch>> m_lru; // Most recently used first.
+    std::unordered_map<long long, std::list<std::unique_ptr<Patch>>::iterator> m_patches;
+    std::vector<Patch*> m_active; // Patches drawn this frame.
+    std::vector<GLuint> m_freeVaos; // GL objects of evicted patches, reused by new ones.
+    std::vector<GLuint> m_freeVbs;
+    GLuint m_ib = 0;
+    float m_worldScale = 1.0f;
+    bool m_regionValid = false;
+    glm::vec4 m_region = glm::vec4(0.0f);
+};
+
+#endif // TERRAIN_DETAIL_H
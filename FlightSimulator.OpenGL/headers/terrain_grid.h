@@ -1,6 +1,7 @@
 #ifndef TRIANGLE_LIST_H
 #define TRIANGLE_LIST_H
 
+#include <ogldev_array_2d.h>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 #include <vector>
@@ -11,6 +12,30 @@ class BaseTerrain;
 class TerrainGrid
 {
 public:
+    // Nested struct representing a vertex in the terrain mesh.
+    struct Vertex {
+        glm::fvec3 pos; // Position of the vertex in 3D space.
+        glm::fvec2 tex; // 2D Position of the texture coordinate.
+
+        // Initializes a vertex with position based on the heightmap and its coordinates.
+        // @param heightMap: Heightmap the vertex height is read from.
+        // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+        // @param textureScale: Number of texture repeats across the whole terrain.
+        // @param size: Number of posts along one side of the terrain.
+        // @param x: X-coordinate on the terrain.
+        // @param z: Z-coordinate on the terrain.
+        void InitVertex(const Array2D<float>& heightMap, float worldScale, float textureScale, int size, int x, int z);
+    };
+
+    // CPU side copy of a terrain mesh. Building it touches no GL state, so it can be done on a worker thread
+    // and handed to the render thread for upload afterwards.
+    struct MeshData {
+        int width = 0; // Width of the terrain in number of vertices.
+        int depth = 0; // Depth of the terrain in number of vertices.
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
     // Default constructor
     TerrainGrid() = default;
 
@@ -20,44 +45,84 @@ public:
     // @param pTerrain: Pointer to the terrain data used for generating the triangle list.
     void CreateTerrainGrid(int width, int depth, const BaseTerrain* pTerrain);
 
+    // Builds the vertices and indices for a terrain mesh without touching GL. Rows are built in parallel.
+    // @param heightMap: Heightmap providing the vertex heights.
+    // @param width: The width of the terrain in number of vertices.
+    // @param depth: The depth of the terrain in number of vertices.
+    // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+    // @param textureScale: Number of texture repeats across the whole terrain.
+    // @param meshData: Receives the generated mesh.
+    static void BuildMeshData(const Array2D<float>& heightMap, int width, int depth, float worldScale, float textureScale,
+        MeshData& meshData);
+
+    // Builds only the vertices of a terrain mesh, in parallel over rows. BuildMeshData does this fused with
+    // BuildIndices; the separate passes exist so both can be measured on their own.
+    static void BuildVertices(const Array2D<float>& heightMap, int width, int depth, float worldScale, float textureScale,
+        MeshData& meshData);
+
+    // Builds only the indices of a terrain mesh, in parallel over rows.
+    static void BuildIndices(int width, int depth, MeshData& meshData);
+
+    // Starts uploading a new mesh into a second set of GL buffers. The current buffers keep rendering until
+    // SwapStagedBuffers() is called, so a new terrain can be streamed in over several frames.
+    // @param meshData: Mesh to upload. Its contents are moved into the grid.
+    void BeginStagedUpload(MeshData&& meshData);
+
+    // Uploads the next slice of the staged mesh.
+    // @param maxBytes: Upper bound on the number of bytes sent to the GPU during this call.
+    // @return: True once the whole staged mesh is resident on the GPU.
+    bool ContinueStagedUpload(size_t maxBytes);
+
+    // Makes the fully uploaded staged buffers the rendered ones and releases the previous buffers.
+    void SwapStagedBuffers();
+
+    // Returns true while a staged upload has been started but not swapped in yet.
+    bool HasStagedUpload() const { return m_staged.vao != 0; }
+
     // Renders the triangle list, typically called every frame.
     void Render();
 
-private:
-    // Nested struct representing a vertex in the terrain mesh.
-    struct Vertex {
-        glm::fvec3 pos; // Position of the vertex in 3D space.
-        glm::fvec2 tex; // 2D Position of the texture coordinate.
+    // Describes the Vertex layout to the currently bound VAO, reading from the currently bound vertex buffer.
+    static void SetupVertexAttributes();
 
-        // Initializes a vertex with position based on the terrain data and its coordinates.
-        // @param pTerrain: Pointer to the terrain data used for vertex position calculations.
-        // @param x: X-coordinate on the terrain.
-        // @param z: Z-coordinate on the terrain.
-        void InitVertex(const BaseTerrain* pTerrain, int x, int z);
+private:
+    // Set of GL objects holding one terrain mesh.
+    struct GLBuffers {
+        GLuint vao = 0; // OpenGL Vertex Array Object handle.
+        GLuint vb = 0; // OpenGL Vertex Buffer handle.
+        GLuint ib = 0; // OpenGL Index Buffer handle.
+        int width = 0; // Width of the uploaded mesh in number of vertices.
+        int depth = 0; // Depth of the uploaded mesh in number of vertices.
     };
 
     // Initializes OpenGL state necessary for rendering the triangle list.
-    void CreateGLState(void);
-
-    // Populates the vertex buffer with data from the terrain.
-    // @param pTerrain: Pointer to the terrain data used for populating the vertex buffer.
-    void PopulateBuffers(const BaseTerrain* pTerrain);
-
-    // Initializes vertex positions for all vertices in the terrain mesh.
-    // @param pTerrain: Pointer to the terrain data used for vertex position calculations.
-    // @param vertices: Reference to a vector of vertices to be initialized.
-    void InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& vertices);
-
-    // Initializes the indices for the triangle list. This function should set up the `m_ib` buffer.
-    // @param indices: Reference to a vector of unsigned integers to store the indices.
-    void InitIndices(std::vector<unsigned int>& indices);
-
-    int m_width = 0; // Width of the terrain in number of vertices.
-    int m_depth = 0; // Depth of the terrain in number of vertices.
-    GLuint m_vao; // OpenGL Vertex Array Object handle.
-    GLuint m_vb; // OpenGL Vertex Buffer handle.
-    GLuint m_ib; // OpenGL Index Buffer handle.
+    // @param buffers: Receives the generated GL object handles. The VAO and both buffers are left bound.
+    static void CreateGLState(GLBuffers& buffers);
+
+    // Deletes the GL objects in the given set and resets its handles.
+    static void DestroyGLState(GLBuffers& buffers);
+
+    // Initializes vertex positions for a range of rows in the terrain mesh.
+    // @param heightMap: Heightmap providing the vertex heights.
+    // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+    // @param textureScale: Number of texture repeats across the whole terrain.
+    // @param firstRow: First row (z) to initialize.
+    // @param lastRow: One past the last row (z) to initialize.
+    // @param meshData: Mesh whose vertices are initialized.
+    static void InitVertices(const Array2D<float>& heightMap, float worldScale, float textureScale,
+        int firstRow, int lastRow, MeshData& meshData);
+
+    // Initializes the indices for a range of quad rows in the triangle list.
+    // @param firstRow: First quad row (z) to initialize.
+    // @param lastRow: One past the last quad row (z) to initialize.
+    // @param meshData: Mesh whose indices are initialized.
+    static void InitIndices(int firstRow, int lastRow, MeshData& meshData);
+
+    GLBuffers m_active; // Buffers currently used for rendering.
+    GLBuffers m_staged; // Buffers receiving a staged upload.
+    MeshData m_stagedMesh; // Mesh being uploaded into m_staged.
+    size_t m_stagedVertexBytesUploaded = 0; // Progress of the staged vertex upload.
+    size_t m_stagedIndexBytesUploaded = 0; // Progress of the staged index upload.
 };
 
 #endif
-
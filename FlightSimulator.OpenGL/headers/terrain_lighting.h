@@ -0,0 +1,67 @@
+#ifndef TERRAIN_LIGHTING_H
+#define TERRAIN_LIGHTING_H
+
+#include <ogldev_array_2d.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// TerrainLighting precomputes per post ambient occlusion and sun visibility from the terrain heightmap, so the
+// fragment shader only has to do a single texture fetch instead of tracing the heightmap.
+//
+// Both terms are derived from horizon angles: for a given azimuth, the horizon of a post is the highest elevation
+// angle at which any other post is seen in that direction. The horizon of every post along one direction is found
+// with a single sweep per grid line that keeps the upper convex hull of the posts already visited, which makes a
+// direction O(number of posts) regardless of terrain size or view distance. Grid lines are swept in parallel.
+//
+// Ambient occlusion uses a fixed set of directions and only depends on the heightmap, so it is baked once per
+// terrain. Sun visibility only depends on the single horizon in the sun's azimuth: when the sun moves in azimuth
+// only that one direction is swept again, and when it only changes elevation no sweep is needed at all.
+class TerrainLighting
+{
+public:
+    // Number of azimuth directions sampled for ambient occlusion.
+    static constexpr int NUM_AO_DIRECTIONS = 16;
+
+    // Default constructor.
+    TerrainLighting() = default;
+
+    // Bakes ambient occlusion and the sun term for a heightmap.
+    // @param heightMap: Heightmap of terrainSize x terrainSize posts.
+    // @param terrainSize: Number of posts along one side of the terrain.
+    // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+    // @param sunDirection: Direction pointing towards the sun in world space.
+    void Bake(const Array2D<float>& heightMap, int terrainSize, float worldScale, const glm::vec3& sunDirection);
+
+    // Updates the sun term for a new sun direction. Re-sweeps the sun horizon only if the sun azimuth moved.
+    // @param heightMap: Heightmap the lighting was baked from.
+    // @param sunDirection: Direction pointing towards the sun in world space.
+    // @return: True if the texels changed and need to be uploaded again.
+    bool UpdateSun(const Array2D<float>& heightMap, const glm::vec3& sunDirection);
+
+    // Gets the baked lighting as RG8 texels, one per post: R = ambient occlusion, G = direct sun light.
+    const std::vector<unsigned char>& GetTexels() const { return m_texels; }
+
+    // Gets the number of posts along one side of the baked terrain.
+    int GetSize() const { return m_terrainSize; }
+
+    // Returns true once Bake has been called.
+    bool IsBaked() const { return m_terrainSize > 0; }
+
+private:
+    // Computes the tangent of the horizon angle of every post when looking along an azimuth.
+    // @param azimuth: Direction in radians, measured in the xz plane from +x towards +z.
+    // @param horizons: Receives terrainSize * terrainSize horizon tangents, never negative.
+    void SweepHorizons(const Array2D<float>& heightMap, float azimuth, std::vector<float>& horizons) const;
+
+    // Recomputes the G channel from the sun horizon and the terrain normals.
+    void ComputeSunTerm(const Array2D<float>& heightMap);
+
+    int m_terrainSize = 0;
+    float m_worldScale = 1.0f;
+    glm::vec3 m_sunDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+    float m_sunAzimuth = 0.0f;
+    std::vector<float> m_sunHorizons;
+    std::vector<unsigned char> m_texels;
+};
+
+#endif // TERRAIN_LIGHTING_H
@@ -0,0 +1,103 @@
+#ifndef TERRAIN_REGENERATOR_H
+#define TERRAIN_REGENERATOR_H
+
+#include <functional>
+#include <memory>
+#include <ogldev_array_2d.h>
+
+#include "job_system.h"
+#include "terrain_grid.h"
+#include "terrain_lighting.h"
+
+// TerrainRegenerator builds a replacement terrain in the background while the current one keeps rendering.
+// The heightmap and mesh are generated in a background job, the mesh is then streamed to the GPU in bounded
+// slices over several frames, and the finished terrain is handed back to be swapped in between two frames.
+class TerrainRegenerator
+{
+public:
+    // Callback filling a heightmap that has already been sized to terrainSize x terrainSize. Runs on a worker thread
+    // and must therefore not touch GL or any state shared with the render thread.
+    using GenerateFunc = std::function<void(Array2D<float>& heightMap)>;
+
+    // Everything produced for one regenerated terrain.
+    struct Result {
+        std::unique_ptr<Array2D<float>> heightMap;
+        int terrainSize = 0;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        TerrainLighting lighting;
+    };
+
+    // Default constructor.
+    TerrainRegenerator() = default;
+
+    // Waits for an in-flight build so it never outlives the regenerator.
+    ~TerrainRegenerator();
+
+    TerrainRegenerator(TerrainRegenerator&&) = default;
+
+    // Cancels the regeneration of this regenerator before taking over the other one.
+    TerrainRegenerator& operator=(TerrainRegenerator&& other);
+
+    // Requests a new terrain. If a build is already running the request is queued and replaces any older queued request.
+    // @param terrainSize: Number of posts along one side of the new terrain.
+    // @param worldScale: Distance in world units between two neighbouring heightmap posts.
+    // @param textureScale: Number of texture repeats across the whole terrain.
+    // @param minHeight: Minimum height of the new terrain.
+    // @param maxHeight: Maximum height of the new terrain.
+    // @param sunDirection: Sun direction the lighting of the new terrain is baked for.
+    // @param generate: Callback producing the heightmap on a worker thread.
+    void Start(int terrainSize, float worldScale, float textureScale, float minHeight, float maxHeight,
+        const glm::vec3& sunDirection, GenerateFunc generate);
+
+    // Advances the regeneration by one frame. Must be called from the render thread.
+    // @param grid: Terrain grid receiving the staged upload.
+    // @param maxUploadBytes: Upper bound on the bytes uploaded to the GPU during this frame.
+    // @param maxUploadMilliseconds: Upper bound on the time spent uploading during this frame.
+    // @return: True when the staged mesh is fully resident and TakeResult() can be swapped in.
+    bool Update(TerrainGrid& grid, size_t maxUploadBytes, float maxUploadMilliseconds);
+
+    // Hands over the finished heightmap. Only valid right after Update() returned true.
+    Result TakeResult();
+
+    // Waits for a build still running on a worker and drops it together with any queued request, so no job is left
+    // behind, e.g. before the job system shuts down. A mesh being uploaded stays staged in its grid.
+    void Cancel();
+
+    // Returns true while a terrain is being generated or uploaded.
+    bool IsBusy() const { return m_state != State::Idle; }
+
+private:
+    // Parameters of one regeneration request.
+    struct Request {
+        int terrainSize = 0;
+        float worldScale = 1.0f;
+        float textureScale = 1.0f;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        glm::vec3 sunDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+        GenerateFunc generate;
+    };
+
+    // Data produced on the worker thread.
+    struct BuildOutput {
+        Result result;
+        TerrainGrid::MeshData meshData;
+    };
+
+    enum class State { Idle, Building, Uploading, Ready };
+
+    // Launches the background build for the given request.
+    void Launch(Request request);
+
+    // Heightmap and mesh generation, run on a worker thread.
+    static std::unique_ptr<BuildOutput> Build(Request request);
+
+    State m_state = State::Idle;
+    JobHandle m_build;
+    std::shared_ptr<std::unique_ptr<BuildOutput>> m_buildOutput; // Filled by the build job.
+    std::unique_ptr<BuildOutput> m_output;
+    std::unique_ptr<Request> m_queuedRequest;
+};
+
+#endif // TERRAIN_REGENERATOR_H
@@ -4,4 +4,7 @@
 #define COLOR_TEXTURE_UNIT_0         GL_TEXTURE0
 #define COLOR_TEXTURE_UNIT_INDEX_0   0
 
+#define LIGHTING_TEXTURE_UNIT        GL_TEXTURE4
+#define LIGHTING_TEXTURE_UNIT_INDEX  4
+
 #endif
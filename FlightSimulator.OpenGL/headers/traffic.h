@@ -0,0 +1,205 @@
+#ifndef TRAFFIC_H
+#define TRAFFIC_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "aero_batch.h"
+#include "airplane.h"
+#include "autopilot.h"
+#include "joystick.h"
+#include "state_arena.h"
+
+// State of every AI aircraft, one array per component so a step streams through memory and the lifting surfaces can
+// be evaluated in vector batches. Positions, velocities and angular velocities are in world space like in RigidBody.
+// The arrays are carved out of one StateArena of the TrafficSystem and move when it grows.
+struct TrafficState {
+    float* positionX = nullptr;
+    float* positionY = nullptr;
+    float* positionZ = nullptr;
+    float* orientationW = nullptr;
+    float* orientationX = nullptr;
+    float* orientationY = nullptr;
+    float* orientationZ = nullptr;
+    float* velocityX = nullptr; // m/s
+    float* velocityY = nullptr;
+    float* velocityZ = nullptr;
+    float* angularVelocityX = nullptr; // rad/s
+    float* angularVelocityY = nullptr;
+    float* angularVelocityZ = nullptr;
+
+    // State at the start of the last step, for rendering between steps.
+    float* previousPositionX = nullptr;
+    float* previousPositionY = nullptr;
+    float* previousPositionZ = nullptr;
+    float* previousOrientationW = nullptr;
+    float* previousOrientationX = nullptr;
+    float* previousOrientationY = nullptr;
+    float* previousOrientationZ = nullptr;
+
+    // Control inputs, set by the autopilot or from outside.
+    float* aileron = nullptr;
+    float* elevator = nullptr;
+    float* rudder = nullptr;
+    float* throttle = nullptr;
+
+    // Autopilot targets and the integral of its climb rate error, which finds the elevator trim.
+    float* targetHeading = nullptr; // rad
+    float* targetAltitude = nullptr; // m
+    float* targetSpeed = nullptr; // m/s
+    float* pitchIntegral = nullptr;
+    float* autopilotElapsed = nullptr; // Seconds since the autopilot last ran.
+    unsigned char* autopilot = nullptr; // 0 while controlled from outside.
+};
+
+// TrafficSystem flies thousands of AI aircraft of one type. Each step is split into chunks of CHUNK_AIRCRAFT aircraft
+// run as jobs: a chunk gathers the aircraft whose autopilot is due into a batch for the vector Autopilot, gathers the
+// body space velocities of its lifting surfaces into a batch, evaluates it with the vectorized aero kernel and
+// integrates the bodies. Chunks can be contiguous ranges or any list of aircraft with a step size each, so a
+// SimulationScheduler can step far aircraft less often. Rendering reads model matrices from one array refreshed once
+// per frame.
+class TrafficSystem
+{
+public:
+    // Aircraft per job.
+    static constexpr int CHUNK_AIRCRAFT = 64;
+
+    // @param prototype: Airplane whose wings, engine and mass properties every aircraft copies. Its airfoils must
+    // outlive the traffic and share their alpha grid, see AirfoilLibrary.
+    // @param autopilot: Gains and update rates of the autopilots.
+    explicit TrafficSystem(const physics::Airplane& prototype,
+        const AutopilotSettings& autopilot = AutopilotSettings());
+
+    // The state arrays point into the arena of the system.
+    TrafficSystem(const TrafficSystem&) = delete;
+    TrafficSystem& operator=(const TrafficSystem&) = delete;
+
+    // Adds an aircraft in level flight whose autopilot holds the initial heading, altitude and speed.
+    // @param position: World space position.
+    // @param heading: Radians clockwise from the -Z axis seen from above.
+    // @param speed: Airspeed in m/s.
+    // @return: Index of the aircraft.
+    int AddAircraft(const glm::vec3& position, float heading, float speed);
+
+    // Removes an aircraft by moving the last one into its slot, so indices above it change.
+    void RemoveAircraft(int index);
+
+    // Removes every aircraft.
+    void Clear();
+
+    // Sets what the autopilot of an aircraft holds and turns it on.
+    // @param heading: Radians clockwise from the -Z axis seen from above.
+    // @param altitude: Metres.
+    // @param speed: Airspeed in m/s.
+    void SetTarget(int index, float heading, float altitude, float speed);
+
+    // Flies an aircraft with the given inputs instead of its autopilot, until SetTarget is called.
+    void SetControls(int index, const Joystick& joystick);
+
+    // Gets the inputs an aircraft flies with, from its autopilot or SetControls.
+    Joystick GetControls(int index) const;
+
+    // Sets the instruction set of the vector kernels of a step, the widest the processor has by default. The kernels
+    // round differently per instruction set, so lockstep simulations pin one to step alike on every processor.
+    void SetKernelIsa(physics::AeroIsa isa) { m_kernelIsa = isa; }
+
+    // Sets where the autopilots measure their distance from to pick their update rate, see AutopilotSettings. Until
+    // it is set every autopilot runs on every step.
+    void SetAutopilotView(const glm::vec3& position);
+
+    // Advances every aircraft by one step on the shared job system.
+    // @param dt: Step in seconds.
+    void Step(float dt);
+
+    // Advances the aircraft [first, last) by one step on the calling thread.
+    void StepRange(int first, int last, float dt);
+
+    // Runs the autopilots of the aircraft [first, last) that are due after dt seconds on the calling thread, without
+    // moving the aircraft. Step does the same at the start of every chunk; this times the autopilot on its own.
+    void RunAutopilotRange(int first, int last, float dt);
+
+    // Advances the listed aircraft by one step each on the shared job system.
+    // @param indices: Aircraft to step, each at most once.
+    // @param stepSizes: Step in seconds of every listed aircraft.
+    void StepSelected(const int* indices, const float* stepSizes, int count);
+
+    // Refreshes the model matrices between the last two steps.
+    // @param alpha: 0 for the previous step, 1 for the current one.
+    // @param modelTransform: Applied to every aircraft before its own transform, e.g. the scale and rotation of the mesh.
+    void UpdateTransforms(float alpha, const glm::mat4& modelTransform = glm::mat4(1.0f));
+
+    // Refreshes the model matrices ahead of the last step of every aircraft, for aircraft stepped at different rates.
+    // Positions move on with the velocity and orientations turn with the angular velocity.
+    // @param elapsed: Seconds since the last step of every aircraft, e.g. from SimulationScheduler::GetElapsed.
+    void ExtrapolateTransforms(const float* elapsed, const glm::mat4& modelTransform = glm::mat4(1.0f));
+
+    // Gets the model matrices of the last UpdateTransforms or ExtrapolateTransforms, one per aircraft.
+    const std::vector<glm::mat4>& GetTransforms() const { return m_transforms; }
+
+    // Gets the number of aircraft.
+    int GetCount() const { return m_count; }
+
+    // Gets the state arrays.
+    const TrafficState& GetState() const { return m_state; }
+
+    const Autopilot& GetAutopilot() const { return m_autopilot; }
+
+    // Appends the state of every aircraft, for continuing the traffic later with ReadState.
+    void WriteState(std::vector<uint8_t>& data) const;
+
+    // Replaces every aircraft with a state written by WriteState.
+    // @param pData: Start of the state, moved past it.
+    // @param pEnd: End of the data.
+    // @return: False if the data ends early, the traffic is cleared then.
+    bool ReadState(const uint8_t*& pData, const uint8_t* pEnd);
+
+    glm::vec3 GetPosition(int index) const;
+    glm::quat GetOrientation(int index) const;
+    glm::vec3 GetVelocity(int index) const;
+
+private:
+    static constexpr int WING_COUNT = 4;
+
+    // Copied from the prototype.
+    std::vector<physics::Wing> m_wings;
+    std::vector<int> m_airfoilIds; // Library id of the airfoil of every wing.
+    float m_maxThrust = 0.0f;
+    float m_mass = 1.0f;
+    glm::mat3 m_inertia{ 1.0f };
+    glm::mat3 m_inverseInertia{ 1.0f };
+
+    Autopilot m_autopilot;
+    glm::vec3 m_autopilotView{ 0.0f };
+    bool m_hasAutopilotView = false;
+
+    physics::AirfoilLibrary m_library;
+    physics::AeroIsa m_kernelIsa = physics::AeroIsa::Best;
+    uint64_t m_id = 0; // Tells the per thread surface batches of different systems apart.
+
+    StateArena m_arena;
+    TrafficState m_state;
+    int m_count = 0;
+    int m_capacity = 0; // Aircraft the arrays have room for.
+    std::vector<glm::mat4> m_transforms;
+
+    // Resizes every state array to count aircraft, growing the arena when they do not fit. New aircraft are zeroed.
+    void Resize(int count);
+
+    // Moves every component of aircraft from into slot to.
+    void Copy(int from, int to);
+
+    // Gets the surface batch of the calling thread, filled with the wings of this system.
+    physics::AeroSurfaces& GetBatch() const;
+
+    // Steps count <= CHUNK_AIRCRAFT aircraft, index(j) and stepSize(j) giving the aircraft and step of the j-th.
+    template <typename Index, typename StepSize>
+    void StepBatch(int count, Index&& index, StepSize&& stepSize);
+
+    // Runs the autopilots of the aircraft of a chunk that are due, as one batch.
+    template <typename Index, typename StepSize>
+    void RunAutopilots(int count, Index&& index, StepSize&& stepSize);
+};
+
+#endif // TRAFFIC_H
@@ -0,0 +1,146 @@
+#ifndef WIND_FIELD_H
+#define WIND_FIELD_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_field.h"
+#include "job_system.h"
+
+struct WindSampleArgs;
+
+struct WindSettings {
+    float direction = 0.0f; // Heading the wind blows towards, rad; 0 along +x, pi/2 along +z.
+    float speed = 8.0f; // At the reference height above the ground, m/s.
+    float referenceHeight = 10.0f; // m.
+    float shearExponent = 0.143f; // Power law of the speed with the height above the ground.
+    float boundaryLayerHeight = 600.0f; // Above this height over the ground the speed stays the same, m.
+    float slopeDecayHeight = 300.0f; // Height over which the flow goes from following the slope to undisturbed, m.
+    float turbulenceIntensity = 0.15f; // Deviation of the gusts over the speed.
+};
+
+// WindField gives the wind anywhere over a HeightField as a mean wind plus turbulence, both precomputed so a sample
+// costs two trilinear lookups instead of running gust filters or 3D noise per aircraft and tick:
+//
+//  - the mean wind is a grid of nodes over the ground at a few hundred metres spacing and some levels of altitude.
+//    Every node has the wind of the settings with its speed shear over the ground, deflected along the slope below
+//    so it blows up windward and down lee slopes, fading to undisturbed with the height above the ground.
+//  - the turbulence is a tileable volume of smoothed noise with unit deviation, scaled by the intensity of the
+//    settings and drifting with the wind, so the gusts an aircraft meets change as it flies and as time passes.
+//
+// The wind turns and changes speed slowly towards the settings given to SetWind. Update moves it a little every
+// frame and rebuilds the mean grid for the new wind in a background job, handing the finished grid over at a later
+// Update. Nothing is rebuilt while the wind stays the same, which keeps the samples deterministic; a lockstep
+// simulation keeps its wind fixed.
+class WindField
+{
+public:
+    // Edge of the turbulence volume in voxels, and their spacing in metres; the pattern repeats every 1 km.
+    static constexpr int TURBULENCE_SIZE = 32;
+    static constexpr float TURBULENCE_SPACING = 32.0f;
+
+    // How fast the wind follows SetWind, rad/s and m/s^2.
+    static constexpr float VEER_RATE = 0.02f;
+    static constexpr float SPEED_RATE = 0.1f;
+
+    WindField() = default;
+
+    // Waits for a background rebuild so it never outlives the field.
+    ~WindField();
+
+    WindField(const WindField&) = delete;
+    WindField& operator=(const WindField&) = delete;
+
+    // Builds the turbulence and the mean wind over a ground in parallel, whenever the ground changes.
+    // @param ground: Heights the wind follows, only read during the call.
+    // @param settings: The wind, taken over at once.
+    // @param seed: Seed of the turbulence.
+    // @param cellSize: Metres between mean wind nodes along x and z.
+    // @param levelHeight: Metres between mean wind levels.
+    // @param ceiling: Altitude of the top level, the wind above it is that of the top level.
+    void Build(const HeightField& ground, const WindSettings& settings, uint32_t seed, float cellSize = 200.0f,
+        float levelHeight = 200.0f, float ceiling = 6000.0f);
+
+    // Sets the wind the field turns towards over the next Updates.
+    void SetWind(const WindSettings& settings) { m_target = settings; }
+
+    // Advances the wind by some time: the turbulence drifts, the wind moves towards the one of SetWind and a finished
+    // background rebuild of the mean grid is taken over.
+    void Update(float seconds);
+
+    // Gets the wind at a world position, m/s.
+    glm::vec3 GetWind(const glm::vec3& position) const;
+
+    // Gets the wind at many world positions at once, like GetWind per position, with a vector kernel for the widest
+    // instruction set the processor has. Single threaded, so large batches can be split over jobs.
+    // @param x, y, z: World positions.
+    // @param windX, windY, windZ: Receive the wind, m/s.
+    void GetWinds(const float* x, const float* y, const float* z, float* windX, float* windY, float* windZ,
+        size_t count) const;
+
+    // Gets the wind the field has reached.
+    const WindSettings& GetSettings() const { return m_settings; }
+
+    // Gets the wind the mean grid was last built for, which trails GetSettings while a rebuild runs.
+    const WindSettings& GetGridSettings() const { return m_grid->settings; }
+
+    // Returns true while the mean grid is rebuilt in the background.
+    bool IsRebuilding() const { return m_rebuild.IsValid(); }
+
+    // Gets the number of mean grids built so far, including the one of Build.
+    uint32_t GetGridCount() const { return m_gridCount; }
+
+    int GetNodesX() const { return m_nodesX; }
+    int GetNodesZ() const { return m_nodesZ; }
+    int GetLevels() const { return m_levels; }
+
+private:
+    // Ground under every column of nodes, kept so the mean grid can be rebuilt without the HeightField.
+    struct Columns {
+        std::vector<float> height;
+        std::vector<float> slopeX; // Rise per metre along x.
+        std::vector<float> slopeZ;
+    };
+
+    struct MeanGrid {
+        WindSettings settings;
+        std::vector<float> x, y, z;
+    };
+
+    int m_nodesX = 0;
+    int m_nodesZ = 0;
+    int m_levels = 0;
+    float m_cellSize = 200.0f;
+    float m_levelHeight = 200.0f;
+    float m_baseAltitude = 0.0f;
+    std::shared_ptr<const Columns> m_columns;
+    std::unique_ptr<MeanGrid> m_grid;
+    uint32_t m_gridCount = 0;
+
+    std::vector<float> m_turbulence[3];
+    glm::vec3 m_offset{ 0.0f }; // Drift of the turbulence, within one tile.
+
+    WindSettings m_settings;
+    WindSettings m_target;
+
+    JobHandle m_rebuild;
+    std::shared_ptr<std::unique_ptr<MeanGrid>> m_rebuildOutput; // Filled by the rebuild job.
+
+    // Sizes a grid for every node, before BuildRows fills it in parallel.
+    void ResizeGrid(MeanGrid& grid) const;
+
+    // Fills the nodes of rows [firstRow, lastRow) along z for the wind of the grid.
+    void BuildRows(const Columns& columns, MeanGrid& grid, int firstRow, int lastRow) const;
+
+    // Starts rebuilding the mean grid for the current wind in the background.
+    void StartRebuild();
+
+    void GenerateTurbulence(uint32_t seed);
+
+    void MakeArgs(WindSampleArgs& args) const;
+};
+
+#endif // WIND_FIELD_H
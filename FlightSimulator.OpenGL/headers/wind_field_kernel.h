@@ -0,0 +1,143 @@
+#ifndef WIND_FIELD_KERNEL_H
+#define WIND_FIELD_KERNEL_H
+
+#include <cstddef>
+
+#include "simd.h"
+
+// Batched wind sampling as a template over the simd vector types, instantiated once per instruction set in
+// wind_field.cpp, wind_field_avx2.cpp and wind_field_avx512.cpp like the height kernel.
+struct WindSampleArgs {
+    // Mean wind, nodesX x nodesZ nodes per level, index (level * nodesZ + z) * nodesX + x.
+    const float* mean[3];
+    int nodesX;
+    int nodesZ;
+    int levels;
+    float cellSize; // Metres between nodes along x and z.
+    float levelHeight; // Metres between levels.
+    float baseAltitude; // Altitude of level 0.
+
+    // Tileable turbulence of unit deviation, size^3 voxels, index (z * size + y) * size + x.
+    const float* turbulence[3];
+    int turbulenceSize;
+    float turbulenceSpacing; // Metres between voxels.
+    float offsetX, offsetY, offsetZ; // Drift of the turbulence with the wind, m.
+    float turbulenceSigma; // Deviation of the gusts, m/s.
+
+    const float* x; // World positions to sample.
+    const float* y;
+    const float* z;
+    float* outX; // Receive the wind, m/s.
+    float* outY;
+    float* outZ;
+    size_t count; // Samples, whole vectors only.
+};
+
+void SampleWindSse2(const WindSampleArgs& args);
+void SampleWindAvx2(const WindSampleArgs& args);
+void SampleWindAvx512(const WindSampleArgs& args);
+
+template <typename V>
+V LerpWind(V a, V b, V t)
+{
+    return a + (b - a) * t;
+}
+
+// Blends the eight corners of a cell, corner k at index[k] with bit 0 stepping x, bit 1 y and bit 2 z.
+template <typename V>
+V TrilinearWind(const float* values, const V (&index)[8], V fx, V fy, V fz)
+{
+    V c[8];
+    for (int k = 0; k < 8; k++)
+        c[k] = V::Gather(values, index[k]);
+    V y0 = LerpWind(LerpWind(c[0], c[1], fx), LerpWind(c[2], c[3], fx), fy);
+    V y1 = LerpWind(LerpWind(c[4], c[5], fx), LerpWind(c[6], c[7], fx), fy);
+    return LerpWind(y0, y1, fz);
+}
+
+// Mean wind clamped to the grid plus turbulence wrapped around its tile, one lane per sample. Indices are floats like
+// in the height kernel, exact for grids of up to 2^24 nodes.
+template <typename V>
+void SampleWindKernel(const WindSampleArgs& a)
+{
+    const V zero(0.0f);
+    const V one(1.0f);
+
+    const V inverseCell(1.0f / a.cellSize);
+    const V inverseLevel(1.0f / a.levelHeight);
+    const V baseAltitude(a.baseAltitude);
+    const V lastX((float)(a.nodesX - 1)), lastLevel((float)(a.levels - 1)), lastZ((float)(a.nodesZ - 1));
+    const V lastCellX((float)(a.nodesX - 2)), lastCellLevel((float)(a.levels - 2)), lastCellZ((float)(a.nodesZ - 2));
+    const V row((float)a.nodesX);
+    const V layer((float)a.nodesX * a.nodesZ);
+
+    const V size((float)a.turbulenceSize);
+    const V inverseSize(1.0f / a.turbulenceSize);
+    const V inverseSpacing(1.0f / a.turbulenceSpacing);
+    const V offsetX(a.offsetX), offsetY(a.offsetY), offsetZ(a.offsetZ);
+    const V sigma(a.turbulenceSigma);
+
+    for (size_t i = 0; i + V::Width <= a.count; i += V::Width)
+    {
+        const V x = V::Load(a.x + i);
+        const V y = V::Load(a.y + i);
+        const V z = V::Load(a.z + i);
+
+        // Mean wind
+        V gx = Max(Min(x * inverseCell, lastX), zero);
+        V gy = Max(Min((y - baseAltitude) * inverseLevel, lastLevel), zero);
+        V gz = Max(Min(z * inverseCell, lastZ), zero);
+        V ix = Min(Floor(gx), lastCellX);
+        V iy = Min(Floor(gy), lastCellLevel);
+        V iz = Min(Floor(gz), lastCellZ);
+        V fx = gx - ix, fy = gy - iy, fz = gz - iz;
+
+        V index[8];
+        index[0] = MulAdd(iy, layer, MulAdd(iz, row, ix));
+        index[1] = index[0] + one;
+        index[2] = index[0] + layer;
+        index[3] = index[2] + one;
+        index[4] = index[0] + row;
+        index[5] = index[4] + one;
+        index[6] = index[4] + layer;
+        index[7] = index[6] + one;
+        V windX = TrilinearWind(a.mean[0], index, fx, fy, fz);
+        V windY = TrilinearWind(a.mean[1], index, fx, fy, fz);
+        V windZ = TrilinearWind(a.mean[2], index, fx, fy, fz);
+
+        // Turbulence, every voxel coordinate wrapped into [0, size)
+        V tx = (x + offsetX) * inverseSpacing;
+        V ty = (y + offsetY) * inverseSpacing;
+        V tz = (z + offsetZ) * inverseSpacing;
+        V jx = Floor(tx), jy = Floor(ty), jz = Floor(tz);
+        fx = tx - jx;
+        fy = ty - jy;
+        fz = tz - jz;
+        jx = jx - Floor(jx * inverseSize) * size;
+        jy = jy - Floor(jy * inverseSize) * size;
+        jz = jz - Floor(jz * inverseSize) * size;
+        V jx1 = Select(jx + one < size, jx + one, zero);
+        V jy1 = Select(jy + one < size, jy + one, zero);
+        V jz1 = Select(jz + one < size, jz + one, zero);
+
+        V row0 = jy * size, row1 = jy1 * size;
+        V layer0 = jz * size * size, layer1 = jz1 * size * size;
+        index[0] = layer0 + row0 + jx;
+        index[1] = layer0 + row0 + jx1;
+        index[2] = layer0 + row1 + jx;
+        index[3] = layer0 + row1 + jx1;
+        index[4] = layer1 + row0 + jx;
+        index[5] = layer1 + row0 + jx1;
+        index[6] = layer1 + row1 + jx;
+        index[7] = layer1 + row1 + jx1;
+        windX = MulAdd(TrilinearWind(a.turbulence[0], index, fx, fy, fz), sigma, windX);
+        windY = MulAdd(TrilinearWind(a.turbulence[1], index, fx, fy, fz), sigma, windY);
+        windZ = MulAdd(TrilinearWind(a.turbulence[2], index, fx, fy, fz), sigma, windZ);
+
+        windX.Store(a.outX + i);
+        windY.Store(a.outY + i);
+        windZ.Store(a.outZ + i);
+    }
+}
+
+#endif // WIND_FIELD_KERNEL_H
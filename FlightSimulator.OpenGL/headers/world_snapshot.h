@@ -0,0 +1,91 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "joystick.h"
+#include "lockstep_simulation.h"
+
+// On disk layout of a world snapshot, as written by WorldSnapshot::Save.
+//
+//   WorldSnapshotHeader
+//   stateSize bytes of simulation state, as saved by LockstepSimulation::SaveState
+//
+// The terrain is not stored: it is generated from the seed and parameters in settings.terrain, so a snapshot loaded
+// over another terrain regenerates it first. All values are little endian.
+constexpr char WORLD_SNAPSHOT_MAGIC[8] = { 'F', 'S', 'S', 'N', 'A', 'P', 'S', 'H' };
+constexpr uint32_t WORLD_SNAPSHOT_VERSION = 2;
+
+// What the player saw and held when the snapshot was taken, besides the simulation itself.
+struct WorldSnapshotView {
+    glm::vec3 cameraPosition;
+    glm::vec3 cameraFront;
+    glm::vec3 cameraUp;
+    glm::vec3 cameraRight;
+    float cameraYaw; // degrees
+    float cameraPitch;
+    float cameraRoll;
+    float cameraZoom;
+    uint32_t chaseCamera; // 1 while the camera follows the player.
+    Joystick controls;
+};
+
+static_assert(std::is_trivially_copyable<WorldSnapshotView>::value, "WorldSnapshotView is stored as raw bytes");
+
+struct WorldSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize; // sizeof(WorldSnapshotHeader), the offset of the state.
+    uint64_t stateSize;
+    LockstepSettings settings; // Of the simulation, a restored one must have the same.
+    WorldSnapshotView view;
+};
+
+// WorldSnapshot holds the whole state of a LockstepSimulation between two steps, and the view of it. The traffic
+// keeps its state in plain arrays of one arena, so capturing and restoring are a memcpy per array, a few milliseconds
+// for thousands of aircraft, and a snapshot can be restored any number of times to fly different branches from the
+// same instant. The state buffer is kept between captures, so only the first one allocates.
+class WorldSnapshot
+{
+public:
+    // Copies the state of a simulation.
+    // @param simulation: The simulation, between two steps.
+    // @param view: Camera and controls to restore with it.
+    void Capture(const LockstepSimulation& simulation, const WorldSnapshotView& view);
+
+    // Puts a simulation back to the captured state.
+    // @param simulation: Simulation with the settings of the snapshot, see GetSettings.
+    // @param view: Receives the captured camera and controls.
+    // @return: False if nothing was captured or the settings differ.
+    bool Restore(LockstepSimulation& simulation, WorldSnapshotView& view) const;
+
+    // Writes the snapshot to a file.
+    // @return: False if nothing was captured or the file cannot be written.
+    bool Save(const char* pFilename) const;
+
+    // Reads a snapshot written by Save.
+    // @return: False if the file is missing, truncated or not a snapshot of a supported version.
+    bool Load(const char* pFilename);
+
+    // Returns true once a state was captured or loaded.
+    bool IsValid() const { return m_valid; }
+
+    // Gets the settings of the captured simulation, which a simulation must have to be restored.
+    const LockstepSettings& GetSettings() const { return m_header.settings; }
+
+    // Gets the step count of the captured simulation.
+    uint64_t GetStepCount() const;
+
+    // Gets the size of the captured state in bytes.
+    size_t GetSize() const { return m_state.size(); }
+
+private:
+    WorldSnapshotHeader m_header{};
+    std::vector<uint8_t> m_state;
+    bool m_valid = false;
+};
+
+#endif // WORLD_SNAPSHOT_H
@@ -16,6 +16,18 @@ uniform float gHeight1;
 uniform float gHeight2;
 uniform float gHeight3;
 
+// Baked lighting, one texel per heightmap post: r = ambient occlusion, g = direct sun light.
+uniform sampler2D gLightingMap;
+uniform bool gUseBakedLighting;
+uniform float gLightingScale;
+uniform float gLightingOffset;
+
+// World space (minX, minZ, maxX, maxZ) drawn by refined detail patches instead. Empty when all zero.
+uniform vec4 gDetailRegion;
+
+const float ambientIntensity = 0.45;
+const float sunIntensity = 0.75;
+
 vec4 CalcTexColorRealistic() {
     vec4 TexColor;
     float height = worldPos.y;
@@ -92,8 +104,19 @@ vec4 CalcTexColor()
     return TexColor;
 }
 
+vec4 CalcBakedLighting()
+{
+    vec2 lighting = texture(gLightingMap, worldPos.xz * gLightingScale + gLightingOffset).rg;
+    float light = ambientIntensity * lighting.r + sunIntensity * lighting.g;
+    return vec4(light, light, light, 1.0);
+}
+
 void main()
 {
+    if (worldPos.x > gDetailRegion.x && worldPos.z > gDetailRegion.y && worldPos.x < gDetailRegion.z && worldPos.z < gDetailRegion.w)
+        discard;
+
     vec4 TexColor = CalcTexColorRealistic();
-    FragColor = Color * TexColor;
+    vec4 LightColor = gUseBakedLighting ? CalcBakedLighting() : Color;
+    FragColor = LightColor * TexColor;
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include <cstdio>
+
+#include "aero_batch.h"
+#include "aero_batch_kernel.h"
+#include "airplane.h"
+
+namespace physics
+{
+	int AirfoilLibrary::add(const Airfoil& airfoil)
+	{
+		if (!m_airfoils.empty() && airfoil.get_alpha_count() != m_alpha_count) {
+			printf("%s:%d - airfoil alpha grid differs from the library\n", __FILE__, __LINE__);
+			return -1;
+		}
+
+		m_alpha_count = airfoil.get_alpha_count();
+		m_alpha_scale = (m_alpha_count - 1) / 360.0f;
+
+		m_offsets.push_back((float)m_table.size());
+		const auto& table = airfoil.get_table();
+		for (int i = 0; i < m_alpha_count; i++) {
+			m_table.push_back(table[i].x);
+			m_table.push_back(table[i].y);
+		}
+		m_airfoils.push_back(&airfoil);
+		return (int)m_airfoils.size() - 1;
+	}
+
+	void AeroSurfaces::resize(size_t n)
+	{
+		count = n;
+		size_t padded = padded_count();
+		for (auto* array : { &velocity_x, &velocity_y, &velocity_z, &normal_x, &normal_y, &normal_z, &position_x,
+				 &position_y, &position_z, &area, &induced_drag, &control, &control_effectiveness, &density, &force_x,
+				 &force_y, &force_z, &moment_x, &moment_y, &moment_z }) {
+			array->resize(padded, 0.0f);
+		}
+		airfoil.resize(padded, 0);
+	}
+
+	void AeroSurfaces::set_surface(size_t i, const Wing& wing, int32_t airfoil_id)
+	{
+		normal_x[i] = wing.normal.x;
+		normal_y[i] = wing.normal.y;
+		normal_z[i] = wing.normal.z;
+		position_x[i] = wing.position.x;
+		position_y[i] = wing.position.y;
+		position_z[i] = wing.position.z;
+		area[i] = wing.area;
+		induced_drag[i] = 1.0f / (PI * wing.aspect_ratio * wing.efficiency);
+		control_effectiveness[i] = wing.flap_ratio > 0.0f ? std::sqrt(wing.flap_ratio) * wing.airfoil->cl_max : 0.0f;
+		airfoil[i] = airfoil_id;
+	}
+
+	// scalar evaluation with the library functions, the baseline the vector kernels are checked against
+	static void evaluate_aero_reference(const AirfoilLibrary& library, AeroSurfaces& s, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++) {
+			s.force_x[i] = s.force_y[i] = s.force_z[i] = 0.0f;
+			s.moment_x[i] = s.moment_y[i] = s.moment_z[i] = 0.0f;
+
+			glm::vec3 velocity(s.velocity_x[i], s.velocity_y[i], s.velocity_z[i]);
+			glm::vec3 normal(s.normal_x[i], s.normal_y[i], s.normal_z[i]);
+			float speed = glm::length(velocity);
+			if (speed <= EPSILON) {
+				continue;
+			}
+
+			glm::vec3 drag_direction = -velocity / speed;
+			glm::vec3 lift_direction = glm::cross(glm::cross(drag_direction, normal), drag_direction);
+			float lift_direction_length = glm::length(lift_direction);
+			if (lift_direction_length <= EPSILON) {
+				continue;
+			}
+			lift_direction /= lift_direction_length;
+
+			float angle_of_attack = glm::degrees(std::asin(glm::clamp(glm::dot(drag_direction, normal), -1.0f, 1.0f)));
+			glm::vec2 coefficients = library.get_airfoil(s.airfoil[i]).sample(angle_of_attack);
+			float lift_coefficient = coefficients.x + s.control[i] * s.control_effectiveness[i];
+			float drag_coefficient = coefficients.y + sq(lift_coefficient) * s.induced_drag[i];
+
+			float dynamic_pressure = 0.5f * s.density[i] * sq(speed) * s.area[i];
+			glm::vec3 force = (lift_direction * lift_coefficient + drag_direction * drag_coefficient) * dynamic_pressure;
+			glm::vec3 moment = glm::cross(glm::vec3(s.position_x[i], s.position_y[i], s.position_z[i]), force);
+
+			s.force_x[i] = force.x;
+			s.force_y[i] = force.y;
+			s.force_z[i] = force.z;
+			s.moment_x[i] = moment.x;
+			s.moment_y[i] = moment.y;
+			s.moment_z[i] = moment.z;
+		}
+	}
+
+	void evaluate_aero_sse2(const AeroKernelArgs& args)
+	{
+		evaluate_aero_kernel<simd::Float4>(args);
+	}
+
+	bool is_aero_isa_available(AeroIsa isa)
+	{
+		static const bool avx2 = simd::CpuSupportsAvx2();
+		static const bool avx512 = simd::CpuSupportsAvx512();
+
+		switch (isa) {
+		case AeroIsa::Avx2:
+			return avx2;
+		case AeroIsa::Avx512:
+			return avx512;
+		default:
+			return true;
+		}
+	}
+
+	const char* get_aero_isa_name(AeroIsa isa)
+	{
+		switch (isa) {
+		case AeroIsa::Reference:
+			return "reference";
+		case AeroIsa::Sse2:
+			return "sse2";
+		case AeroIsa::Avx2:
+			return "avx2";
+		case AeroIsa::Avx512:
+			return "avx512";
+		default:
+			return "best";
+		}
+	}
+
+	void evaluate_aero(const AirfoilLibrary& library, AeroSurfaces& surfaces, size_t begin, size_t end, AeroIsa isa)
+	{
+		if (isa == AeroIsa::Best) {
+			isa = is_aero_isa_available(AeroIsa::Avx512) ? AeroIsa::Avx512
+				: is_aero_isa_available(AeroIsa::Avx2)    ? AeroIsa::Avx2
+														  : AeroIsa::Sse2;
+		}
+
+		if (isa == AeroIsa::Reference) {
+			evaluate_aero_reference(library, surfaces, begin, end);
+			return;
+		}
+
+		AeroSurfaces& s = surfaces;
+		AeroKernelArgs args = { library.get_table(), library.get_offsets(), library.get_alpha_scale(),
+			library.get_alpha_count() - 1.001f, EPSILON, s.velocity_x.data(), s.velocity_y.data(), s.velocity_z.data(),
+			s.normal_x.data(), s.normal_y.data(), s.normal_z.data(), s.position_x.data(), s.position_y.data(),
+			s.position_z.data(), s.area.data(), s.induced_drag.data(), s.control.data(), s.control_effectiveness.data(),
+			s.density.data(), s.airfoil.data(), s.force_x.data(), s.force_y.data(), s.force_z.data(), s.moment_x.data(),
+			s.moment_y.data(), s.moment_z.data(), begin, end };
+
+		switch (isa) {
+		case AeroIsa::Avx2:
+			evaluate_aero_avx2(args);
+			break;
+		case AeroIsa::Avx512:
+			evaluate_aero_avx512(args);
+			break;
+		default:
+			evaluate_aero_sse2(args);
+			break;
+		}
+	}
+};  // namespace physics
@@ -0,0 +1,10 @@
+// Compiled with /arch:AVX2; only called after is_aero_isa_available checked the processor.
+#include "aero_batch_kernel.h"
+
+namespace physics
+{
+	void evaluate_aero_avx2(const AeroKernelArgs& args)
+	{
+		evaluate_aero_kernel<simd::Float8>(args);
+	}
+};  // namespace physics
@@ -0,0 +1,110 @@
+#include "autopilot.h"
+#include "autopilot_kernel.h"
+#include "physics.h"
+
+void RunAutopilotSse2(const AutopilotArgs& args)
+{
+    RunAutopilotKernel<simd::Float4>(args);
+}
+
+Joystick AutopilotBatch::GetControls(int entry) const
+{
+    // Airplane::set_controls sums the two ailerons
+    Joystick joystick;
+    joystick.leftAileron = 0.5f * aileron[entry];
+    joystick.rightAileron = 0.5f * aileron[entry];
+    joystick.elevator = elevator[entry];
+    joystick.rudder = rudder[entry];
+    joystick.throttle = throttle[entry];
+    return joystick;
+}
+
+Autopilot::Autopilot(const AutopilotSettings& settings)
+    : m_settings(settings),
+      m_referencePressure(0.5f * isa::sea_level_air_density * physics::sq(settings.referenceSpeed))
+{
+}
+
+void Autopilot::Run(AutopilotBatch& batch, physics::AeroIsa isa) const
+{
+    if (isa == physics::AeroIsa::Best)
+    {
+        isa = physics::is_aero_isa_available(physics::AeroIsa::Avx512) ? physics::AeroIsa::Avx512
+            : physics::is_aero_isa_available(physics::AeroIsa::Avx2) ? physics::AeroIsa::Avx2
+            : physics::AeroIsa::Sse2;
+    }
+
+    const AutopilotSettings& s = m_settings;
+    AutopilotArgs args;
+    args.climbRatePerMetre = s.climbRatePerMetre;
+    args.maxClimbRate = s.maxClimbRate;
+    args.pitchPerClimbRate = s.pitchPerClimbRate;
+    args.maxPitch = s.maxPitch;
+    args.elevatorPerPitch = s.elevatorPerPitch;
+    args.elevatorPerClimbRateIntegral = s.elevatorPerClimbRateIntegral;
+    args.elevatorPerPitchRate = s.elevatorPerPitchRate;
+    args.bankPerHeading = s.bankPerHeading;
+    args.maxBank = s.maxBank;
+    args.aileronPerBank = s.aileronPerBank;
+    args.aileronPerRollRate = s.aileronPerRollRate;
+    args.throttlePerSpeed = s.throttlePerSpeed;
+    args.cruiseThrottle = s.cruiseThrottle;
+    args.referencePressure = m_referencePressure;
+    args.minGainScale = s.minGainScale;
+    args.maxGainScale = s.maxGainScale;
+
+    args.orientationW = batch.orientationW;
+    args.orientationX = batch.orientationX;
+    args.orientationY = batch.orientationY;
+    args.orientationZ = batch.orientationZ;
+    args.velocityX = batch.velocityX;
+    args.velocityY = batch.velocityY;
+    args.velocityZ = batch.velocityZ;
+    args.angularVelocityX = batch.angularVelocityX;
+    args.angularVelocityY = batch.angularVelocityY;
+    args.angularVelocityZ = batch.angularVelocityZ;
+    args.positionY = batch.positionY;
+    args.density = batch.density;
+    args.targetHeading = batch.targetHeading;
+    args.targetAltitude = batch.targetAltitude;
+    args.targetSpeed = batch.targetSpeed;
+    args.stepSize = batch.stepSize;
+    args.pitchIntegral = batch.pitchIntegral;
+    args.aileron = batch.aileron;
+    args.elevator = batch.elevator;
+    args.rudder = batch.rudder;
+    args.throttle = batch.throttle;
+
+    // Whole vectors, the capacity being a multiple of every width
+    if (isa == physics::AeroIsa::Avx512)
+    {
+        args.count = ((size_t)batch.count + 15) / 16 * 16;
+        RunAutopilotAvx512(args);
+    }
+    else if (isa == physics::AeroIsa::Avx2)
+    {
+        args.count = ((size_t)batch.count + 7) / 8 * 8;
+        RunAutopilotAvx2(args);
+    }
+    else
+    {
+        args.count = ((size_t)batch.count + 3) / 4 * 4;
+        RunAutopilotSse2(args);
+    }
+}
+
+float Autopilot::GetInterval(float distanceSquared) const
+{
+    const float fullRateSquared = physics::sq(m_settings.fullRateDistance);
+    if (distanceSquared < fullRateSquared)
+        return 0.0f;
+
+    float interval = m_settings.interval;
+    float threshold = 4.0f * fullRateSquared;
+    for (int level = 1; level < m_settings.farLevels && distanceSquared >= threshold; level++)
+    {
+        interval *= 2.0f;
+        threshold *= 4.0f;
+    }
+    return interval;
+}
@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX2; only called after Autopilot checked the processor.
+#include "autopilot_kernel.h"
+
+void RunAutopilotAvx2(const AutopilotArgs& args)
+{
+    RunAutopilotKernel<simd::Float8>(args);
+}
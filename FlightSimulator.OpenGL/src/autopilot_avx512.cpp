@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX512; only called after Autopilot checked the processor.
+#include "autopilot_kernel.h"
+
+void RunAutopilotAvx512(const AutopilotArgs& args)
+{
+    RunAutopilotKernel<simd::Float16>(args);
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+
+#include "broad_phase.h"
+#include "job_system.h"
+#include "parallel.h"
+
+// Entities per pair finding job, each job collects its pairs on its own.
+static const int PAIR_CHUNK = 256;
+
+// Smallest hash table, so small scenes do not rehash when entities come and go.
+static const uint32_t MIN_BUCKETS = 1024;
+
+// Entities or buckets below which a pass runs on the calling thread.
+static const int PARALLEL_MIN = 4096;
+
+BroadPhase::BroadPhase(float cellSize)
+    : m_cellSize(cellSize), m_inverseCellSize(1.0f / cellSize)
+{
+}
+
+void BroadPhase::Build(const float* x, const float* y, const float* z, const float* radius, int count)
+{
+    m_count = std::max(count, 0);
+    if (m_count == 0)
+        return;
+
+    // About two buckets per entity keeps unrelated cells from sharing buckets
+    uint32_t bucketCount = MIN_BUCKETS;
+    while (bucketCount < 2u * (uint32_t)m_count)
+        bucketCount *= 2;
+    if (!m_counters || bucketCount != m_mask + 1)
+    {
+        m_counters.reset(new std::atomic<int>[bucketCount]);
+        m_bucketStart.resize(bucketCount + 1);
+        m_mask = bucketCount - 1;
+    }
+
+    m_buckets.resize(m_count);
+    m_entities.resize(m_count);
+    m_cells.resize(m_count);
+    m_x.resize(m_count);
+    m_y.resize(m_count);
+    m_z.resize(m_count);
+    m_radius.resize(m_count);
+    m_maxRadius = radius ? std::max(*std::max_element(radius, radius + m_count), 0.0f) : 0.0f;
+
+    // Count the entities of every bucket
+    ParallelForRange(0, (int)bucketCount, [this](int first, int last) {
+        for (int b = first; b < last; b++)
+            m_counters[b].store(0, std::memory_order_relaxed);
+    }, PARALLEL_MIN);
+    ParallelForRange(0, m_count, [&](int first, int last) {
+        for (int i = first; i < last; i++)
+        {
+            uint32_t bucket = GetBucket(GetCell(x[i]), GetCell(y[i]), GetCell(z[i]));
+            m_buckets[i] = bucket;
+            m_counters[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+    }, PARALLEL_MIN);
+
+    // Lay the buckets out one after the other; the counters become the next free slot of each
+    int start = 0;
+    for (uint32_t b = 0; b < bucketCount; b++)
+    {
+        m_bucketStart[b] = start;
+        start += m_counters[b].load(std::memory_order_relaxed);
+        m_counters[b].store(m_bucketStart[b], std::memory_order_relaxed);
+    }
+    m_bucketStart[bucketCount] = start;
+
+    ParallelForRange(0, m_count, [this](int first, int last) {
+        for (int i = first; i < last; i++)
+            m_entities[m_counters[m_buckets[i]].fetch_add(1, std::memory_order_relaxed)] = i;
+    }, PARALLEL_MIN);
+
+    // The slots within a bucket went to whichever thread came first, sorting them makes the layout repeatable
+    ParallelForRange(0, (int)bucketCount, [&](int first, int last) {
+        for (int b = first; b < last; b++)
+        {
+            const int begin = m_bucketStart[b], end = m_bucketStart[b + 1];
+            std::sort(m_entities.begin() + begin, m_entities.begin() + end);
+            for (int slot = begin; slot < end; slot++)
+            {
+                const int i = m_entities[slot];
+                m_x[slot] = x[i];
+                m_y[slot] = y[i];
+                m_z[slot] = z[i];
+                m_radius[slot] = radius ? radius[i] : 0.0f;
+                m_cells[slot] = { GetCell(x[i]), GetCell(y[i]), GetCell(z[i]) };
+            }
+        }
+    }, PARALLEL_MIN);
+}
+
+template <typename Func>
+void BroadPhase::ForEachSlot(const glm::vec3& min, const glm::vec3& max, Func&& func) const
+{
+    const int x0 = GetCell(min.x), x1 = GetCell(max.x);
+    const int y0 = GetCell(min.y), y1 = GetCell(max.y);
+    const int z0 = GetCell(min.z), z1 = GetCell(max.z);
+
+    // A box over more cells than there are entities is cheaper to answer by testing every entity
+    const int64_t cells = (int64_t)(x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1);
+    if (cells > m_count)
+    {
+        for (int slot = 0; slot < m_count; slot++)
+            func(slot);
+        return;
+    }
+
+    for (int cz = z0; cz <= z1; cz++)
+    {
+        for (int cy = y0; cy <= y1; cy++)
+        {
+            for (int cx = x0; cx <= x1; cx++)
+            {
+                const glm::ivec3 cell(cx, cy, cz);
+                const uint32_t bucket = GetBucket(cx, cy, cz);
+                for (int slot = m_bucketStart[bucket]; slot < m_bucketStart[bucket + 1]; slot++)
+                {
+                    if (m_cells[slot] == cell)
+                        func(slot);
+                }
+            }
+        }
+    }
+}
+
+void BroadPhase::FindPairs(float distance, std::vector<BroadPhasePair>& pairs) const
+{
+    pairs.clear();
+    if (m_count == 0)
+        return;
+
+    // Entities are visited by slot, so neighbours are close in memory; each pair is found from both of its entities
+    // and kept by the one with the lower index.
+    const int chunkCount = (m_count + PAIR_CHUNK - 1) / PAIR_CHUNK;
+    std::vector<std::vector<BroadPhasePair>> chunkPairs(chunkCount);
+    auto findChunk = [&](int first, int last) {
+        std::vector<BroadPhasePair>& found = chunkPairs[first / PAIR_CHUNK];
+        for (int slot = first; slot < last; slot++)
+        {
+            const int entity = m_entities[slot];
+            const glm::vec3 centre(m_x[slot], m_y[slot], m_z[slot]);
+            const float reach = distance + m_radius[slot];
+            const glm::vec3 extent(reach + m_maxRadius);
+            ForEachSlot(centre - extent, centre + extent, [&](int other) {
+                const int otherEntity = m_entities[other];
+                if (otherEntity <= entity)
+                    return;
+                const float dx = m_x[other] - centre.x, dy = m_y[other] - centre.y, dz = m_z[other] - centre.z;
+                const float limit = reach + m_radius[other];
+                const float squared = dx * dx + dy * dy + dz * dz;
+                if (squared < limit * limit)
+                    found.push_back({ entity, otherEntity, std::sqrt(squared) });
+            });
+        }
+    };
+    if (chunkCount == 1)
+    {
+        findChunk(0, m_count);
+    }
+    else
+    {
+        JobSystem& jobs = GetJobSystem();
+        jobs.Wait(jobs.ParallelFor(0, m_count, PAIR_CHUNK, findChunk));
+    }
+
+    for (const std::vector<BroadPhasePair>& found : chunkPairs)
+        pairs.insert(pairs.end(), found.begin(), found.end());
+    std::sort(pairs.begin(), pairs.end(), [](const BroadPhasePair& a, const BroadPhasePair& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+}
+
+void BroadPhase::Query(const glm::vec3& point, float distance, std::vector<int>& entities) const
+{
+    entities.clear();
+    if (m_count == 0)
+        return;
+
+    const glm::vec3 extent(distance + m_maxRadius);
+    ForEachSlot(point - extent, point + extent, [&](int slot) {
+        const float dx = m_x[slot] - point.x, dy = m_y[slot] - point.y, dz = m_z[slot] - point.z;
+        const float limit = distance + m_radius[slot];
+        if (dx * dx + dy * dy + dz * dz < limit * limit)
+            entities.push_back(m_entities[slot]);
+    });
+    std::sort(entities.begin(), entities.end());
+}
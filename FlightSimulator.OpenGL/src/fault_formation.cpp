@@ -0,0 +1,160 @@
+#include <assert.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#include "fault_formation.h"
+#include "parallel.h"
+
+// Integer division rounding towards negative infinity.
+static int FloorDiv(int a, int b)
+{
+	int q = a / b;
+	return ((a % b != 0) && ((a < 0) != (b < 0))) ? q - 1 : q;
+}
+
+// Integer division rounding towards positive infinity.
+static int CeilDiv(int a, int b)
+{
+	int q = a / b;
+	return ((a % b != 0) && ((a < 0) == (b < 0))) ? q + 1 : q;
+}
+
+void FaultFormation::GenerateHeightMap(Array2D<float>& heightMap, int terrainSize, int iterations, float minHeight, float maxHeight,
+	float filter, unsigned int seed)
+{
+	ApplyFaults(heightMap, terrainSize, iterations, minHeight, maxHeight, seed);
+	ApplyFIRFilter(heightMap, terrainSize, filter);
+	heightMap.Normalize(minHeight, maxHeight);
+}
+
+void FaultFormation::ApplyFaults(Array2D<float>& heightMap, int terrainSize, int iterations, float minHeight, float maxHeight, unsigned int seed)
+{
+	float deltaHeight = maxHeight - minHeight;
+
+	// Draw every fault line up front from a single generator, so the result does not depend on how rows are
+	// later distributed over threads.
+	std::mt19937 rng(seed);
+	std::vector<FaultLine> faults(iterations);
+
+	for (int curIter = 0; curIter < iterations; curIter++)
+	{
+		float iterationRatio = ((float)curIter / (float)iterations);
+
+		TerrainPoint p2;
+		GenRandomTerrainPoints(rng, terrainSize, faults[curIter].p1, p2);
+
+		faults[curIter].dirX = p2.x - faults[curIter].p1.x;
+		faults[curIter].dirZ = p2.z - faults[curIter].p1.z;
+		faults[curIter].height = maxHeight - iterationRatio * deltaHeight;
+	}
+
+	ParallelForRange(0, terrainSize, [&](int firstRow, int lastRow) {
+		ApplyFaultsToRows(heightMap, terrainSize, faults, firstRow, lastRow);
+	});
+}
+
+void FaultFormation::ApplyFaultsToRows(Array2D<float>& heightMap, int terrainSize, const std::vector<FaultLine>& faults, int firstRow, int lastRow)
+{
+	// Within one row the raised side of a fault is a single run of posts, so instead of testing every post
+	// against every fault we mark where each run starts and ends and resolve the row with one prefix sum.
+	std::vector<float> delta(terrainSize + 1);
+
+	for (int z = firstRow; z < lastRow; z++)
+	{
+		std::fill(delta.begin(), delta.end(), 0.0f);
+
+		for (const FaultLine& fault : faults)
+		{
+			// A post is raised when (x - p1.x) * dirZ - dirX * (z - p1.z) > 0, i.e. when x * dirZ > c.
+			int c = fault.p1.x * fault.dirZ + fault.dirX * (z - fault.p1.z);
+			int xBegin = 0;
+			int xEnd = terrainSize;
+
+			if (fault.dirZ > 0)
+				xBegin = FloorDiv(c, fault.dirZ) + 1;
+			else if (fault.dirZ < 0)
+				xEnd = CeilDiv(c, fault.dirZ);
+			else if (c >= 0)
+				continue;
+
+			xBegin = std::max(xBegin, 0);
+			xEnd = std::min(xEnd, terrainSize);
+
+			if (xBegin < xEnd)
+			{
+				delta[xBegin] += fault.height;
+				delta[xEnd] -= fault.height;
+			}
+		}
+
+		float raise = 0.0f;
+		for (int x = 0; x < terrainSize; x++)
+		{
+			raise += delta[x];
+			heightMap.Set(x, z, heightMap.Get(x, z) + raise);
+		}
+	}
+}
+
+void FaultFormation::GenRandomTerrainPoints(std::mt19937& rng, int terrainSize, TerrainPoint& p1, TerrainPoint& p2)
+{
+	p1.x = rng() % terrainSize;
+	p1.z = rng() % terrainSize;
+
+	int counter = 0;
+
+	do {
+		p2.x = rng() % terrainSize;
+		p2.z = rng() % terrainSize;
+
+		if (counter++ == 1000)
+		{
+			printf("Endless loop detected in %s:%d\n", __FILE__, __LINE__);
+			assert(0);
+		}
+	} while (p1.IsEqual(p2));
+}
+
+void FaultFormation::ApplyFIRFilter(Array2D<float>& heightMap, int terrainSize, float filter)
+{
+	// Rows are independent of each other in the horizontal passes
+	ParallelForRange(0, terrainSize, [&](int firstRow, int lastRow) {
+		for (int z = firstRow; z < lastRow; z++)
+		{
+			// left to right
+			float prevVal = heightMap.Get(0, z);
+			for (int x = 1; x < terrainSize; x++)
+				prevVal = FIRFilterSinglePoint(heightMap, x, z, prevVal, filter);
+
+			// right to left
+			prevVal = heightMap.Get(0, z);
+			for (int x = terrainSize - 2; x >= 0; x--)
+				prevVal = FIRFilterSinglePoint(heightMap, x, z, prevVal, filter);
+		}
+	});
+
+	// and columns are independent of each other in the vertical passes
+	ParallelForRange(0, terrainSize, [&](int firstColumn, int lastColumn) {
+		for (int x = firstColumn; x < lastColumn; x++)
+		{
+			// bottom to top
+			float prevVal = heightMap.Get(x, 0);
+			for (int z = 1; z < terrainSize; z++)
+				prevVal = FIRFilterSinglePoint(heightMap, x, z, prevVal, filter);
+
+			// top to bottom
+			prevVal = heightMap.Get(x, terrainSize - 1);
+			for (int z = terrainSize - 2; z >= 0; z--)
+				prevVal = FIRFilterSinglePoint(heightMap, x, z, prevVal, filter);
+		}
+	});
+}
+
+float FaultFormation::FIRFilterSinglePoint(Array2D<float>& heightMap, int x, int z, float prevVal, float filter)
+{
+	float curVal = heightMap.Get(x, z);
+	float newVal = filter * prevVal + (1 - filter) * curVal;
+	heightMap.Set(x, z, newVal);
+	return newVal;
+}
@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "flight_recorder.h"
+
+// Floats of a sample in the order they are encoded.
+static constexpr int SAMPLE_FIELDS = 18;
+
+static void GetFields(const FlightSample& sample, float fields[SAMPLE_FIELDS])
+{
+    const float values[SAMPLE_FIELDS] = {
+        sample.input.leftAileron, sample.input.rightAileron, sample.input.elevator, sample.input.rudder,
+        sample.input.throttle,
+        sample.position.x, sample.position.y, sample.position.z,
+        sample.orientation.w, sample.orientation.x, sample.orientation.y, sample.orientation.z,
+        sample.velocity.x, sample.velocity.y, sample.velocity.z,
+        sample.angularVelocity.x, sample.angularVelocity.y, sample.angularVelocity.z,
+    };
+    memcpy(fields, values, sizeof(values));
+}
+
+static void SetFields(FlightSample& sample, const float fields[SAMPLE_FIELDS])
+{
+    sample.input.leftAileron = fields[0];
+    sample.input.rightAileron = fields[1];
+    sample.input.elevator = fields[2];
+    sample.input.rudder = fields[3];
+    sample.input.throttle = fields[4];
+    sample.position = { fields[5], fields[6], fields[7] };
+    sample.orientation = glm::quat(fields[8], fields[9], fields[10], fields[11]);
+    sample.velocity = { fields[12], fields[13], fields[14] };
+    sample.angularVelocity = { fields[15], fields[16], fields[17] };
+}
+
+static int CountLeadingZeros(uint32_t x)
+{
+    int count = 0;
+    for (uint32_t bit = 0x80000000u; bit && !(x & bit); bit >>= 1)
+        count++;
+    return count;
+}
+
+static int CountTrailingZeros(uint32_t x)
+{
+    int count = 0;
+    for (uint32_t bit = 1; bit && !(x & bit); bit <<= 1)
+        count++;
+    return count;
+}
+
+// XOR with the previous value, see the layout in flight_recorder.h
+static void EncodeFloat(BitWriter& writer, uint32_t previous, uint32_t bits)
+{
+    uint32_t x = bits ^ previous;
+    if (x == 0)
+    {
+        writer.Write(0, 1);
+        return;
+    }
+    int leading = CountLeadingZeros(x);
+    int length = 32 - leading - CountTrailingZeros(x);
+    writer.Write(1, 1);
+    writer.Write(leading, 5);
+    writer.Write(length - 1, 5);
+    writer.Write(x >> (32 - leading - length), length);
+}
+
+static uint32_t DecodeFloat(BitReader& reader, uint32_t previous)
+{
+    if (reader.Read(1) == 0)
+        return previous;
+    int leading = reader.Read(5);
+    int length = reader.Read(5) + 1;
+    uint32_t meaningful = reader.Read(length);
+    // a corrupt length can point past bit 0, such a block fails on overrun or its checks anyway
+    int shift = std::max(32 - leading - length, 0);
+    return previous ^ (meaningful << shift);
+}
+
+FlightRecorder::FlightRecorder(size_t ringCapacity, uint32_t keyframeInterval)
+    : m_ring(ringCapacity), m_keyframes(4), m_keyframeInterval(std::max(keyframeInterval, 1u))
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    Stop();
+}
+
+bool FlightRecorder::Start(const char* pFilename, const LockstepSimulation& simulation)
+{
+    if (m_file)
+        return false;
+
+    m_file = fopen(pFilename, "wb");
+    if (!m_file)
+    {
+        printf("%s:%d - cannot create %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    // The index offset stays 0 until Stop patches it in.
+    m_header = FlightRecordingHeader{};
+    memcpy(m_header.magic, FLIGHT_RECORDING_MAGIC, sizeof(m_header.magic));
+    m_header.version = FLIGHT_RECORDING_VERSION;
+    m_header.headerSize = sizeof(FlightRecordingHeader);
+    m_header.keyframeInterval = m_keyframeInterval;
+    m_header.settings = simulation.GetSettings();
+    fwrite(&m_header, sizeof(m_header), 1, m_file);
+
+    m_samples = 0;
+    m_dropped = 0;
+    m_keyframeCount = 0;
+    m_droppedKeyframes = 0;
+    m_bytes = sizeof(m_header);
+    m_chunk.Clear();
+    m_chunkSamples = 0;
+    m_hasPendingKeyframe = false;
+    m_index.clear();
+    m_startStep = simulation.GetStepCount();
+    m_stopping = false;
+    m_writer = std::thread([this]() { WriteSamples(); });
+
+    RecordKeyframe(simulation);
+    return true;
+}
+
+void FlightRecorder::Record(const FlightSample& sample)
+{
+    if (m_file && !m_ring.TryPush(sample))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightRecorder::RecordKeyframe(const LockstepSimulation& simulation)
+{
+    const uint64_t step = simulation.GetStepCount();
+    if (!m_file || step < m_startStep || (step - m_startStep) % m_keyframeInterval != 0)
+        return;
+
+    Keyframe keyframe;
+    keyframe.step = step;
+    simulation.SaveState(keyframe.state);
+    if (!m_keyframes.TryPush(std::move(keyframe)))
+        m_droppedKeyframes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FlightRecorder::Stop()
+{
+    if (!m_file)
+        return;
+
+    m_stopping = true;
+    m_writer.join();
+
+    // The index goes after the last chunk, 8 byte aligned, and its place into the header.
+    static const uint8_t padding[8] = {};
+    uint64_t offset = m_bytes.load(std::memory_order_relaxed);
+    size_t paddingSize = (size_t)((8 - offset % 8) % 8);
+    fwrite(padding, 1, paddingSize, m_file);
+    offset += paddingSize;
+    fwrite(m_index.data(), sizeof(FlightRecordingIndexEntry), m_index.size(), m_file);
+    m_bytes = offset + m_index.size() * sizeof(FlightRecordingIndexEntry);
+
+    m_header.indexOffset = offset;
+    m_header.indexCount = m_index.size();
+    fseek(m_file, 0, SEEK_SET);
+    fwrite(&m_header, sizeof(m_header), 1, m_file);
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+FlightRecorderStats FlightRecorder::GetStats() const
+{
+    FlightRecorderStats stats;
+    stats.samples = m_samples.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.keyframes = m_keyframeCount.load(std::memory_order_relaxed);
+    stats.droppedKeyframes = m_droppedKeyframes.load(std::memory_order_relaxed);
+    stats.bytes = m_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+FlightSample FlightRecorder::MakeSample(const LockstepSimulation& simulation, const Joystick& input)
+{
+    const physics::Airplane& player = simulation.GetPlayer();
+    FlightSample sample;
+    sample.step = simulation.GetStepCount() - 1;
+    sample.input = input;
+    sample.position = player.position;
+    sample.orientation = player.orientation;
+    sample.velocity = player.velocity;
+    sample.angularVelocity = player.angular_velocity;
+    return sample;
+}
+
+void FlightRecorder::WriteSamples()
+{
+    for (;;)
+    {
+        // Everything recorded before Stop is in the rings once the flag is seen, so one more pass drains them. A
+        // keyframe is pushed before the sample of its step, so it is always there by the time that sample is.
+        const bool stopping = m_stopping.load(std::memory_order_acquire);
+        bool any = false;
+        FlightSample sample;
+        while (m_ring.TryPop(sample))
+        {
+            WriteKeyframes(sample.step, false);
+            Encode(sample);
+            any = true;
+        }
+        if (stopping)
+            break;
+        if (!any)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (m_chunkSamples > 0)
+        WriteChunk();
+    WriteKeyframes(0, true);
+    fflush(m_file);
+}
+
+void FlightRecorder::WriteKeyframes(uint64_t step, bool all)
+{
+    for (;;)
+    {
+        if (!m_hasPendingKeyframe)
+            m_hasPendingKeyframe = m_keyframes.TryPop(m_pendingKeyframe);
+        if (!m_hasPendingKeyframe || (!all && m_pendingKeyframe.step > step))
+            return;
+
+        if (m_chunkSamples > 0)
+            WriteChunk();
+        WriteChunk(FlightChunkType::Keyframe, m_pendingKeyframe.step, 0, m_pendingKeyframe.state.data(),
+            m_pendingKeyframe.state.size());
+        m_keyframeCount.fetch_add(1, std::memory_order_relaxed);
+        m_hasPendingKeyframe = false;
+    }
+}
+
+void FlightRecorder::Encode(const FlightSample& sample)
+{
+    if (m_chunkSamples > 0 && (m_chunkSamples == CHUNK_SAMPLES || sample.step != m_chunkFirstStep + m_chunkSamples))
+        WriteChunk();
+
+    float fields[SAMPLE_FIELDS] = {};
+    float previous[SAMPLE_FIELDS] = {};
+    GetFields(sample, fields);
+    if (m_chunkSamples == 0)
+        m_chunkFirstStep = sample.step;
+    else
+        GetFields(m_previous, previous);
+
+    for (int i = 0; i < SAMPLE_FIELDS; i++)
+        EncodeFloat(m_chunk, FloatBits(previous[i]), FloatBits(fields[i]));
+
+    m_previous = sample;
+    m_chunkSamples++;
+}
+
+void FlightRecorder::WriteChunk()
+{
+    m_chunk.Flush();
+    WriteChunk(FlightChunkType::Samples, m_chunkFirstStep, m_chunkSamples, m_chunk.GetBytes().data(),
+        m_chunk.GetBytes().size());
+    m_samples.fetch_add(m_chunkSamples, std::memory_order_relaxed);
+    m_chunk.Clear();
+    m_chunkSamples = 0;
+}
+
+void FlightRecorder::WriteChunk(FlightChunkType type, uint64_t step, uint32_t sampleCount, const uint8_t* pData,
+    size_t size)
+{
+    FlightRecordingIndexEntry entry;
+    entry.type = type;
+    entry.sampleCount = sampleCount;
+    entry.step = step;
+    entry.offset = m_bytes.load(std::memory_order_relaxed);
+    m_index.push_back(entry);
+
+    FlightRecordingChunk chunk;
+    chunk.type = type;
+    chunk.sampleCount = sampleCount;
+    chunk.step = step;
+    chunk.byteCount = (uint32_t)size;
+    chunk.reserved = 0;
+    fwrite(&chunk, sizeof(chunk), 1, m_file);
+    fwrite(pData, 1, size, m_file);
+    m_bytes.fetch_add(sizeof(chunk) + size, std::memory_order_relaxed);
+}
+
+bool FlightRecording::DecodeChunk(const FlightRecordingChunk& chunk, const uint8_t* pData,
+    std::vector<FlightSample>& samples)
+{
+    BitReader reader(pData, chunk.byteCount);
+    uint32_t previous[SAMPLE_FIELDS] = {};
+    for (uint32_t i = 0; i < chunk.sampleCount; i++)
+    {
+        float fields[SAMPLE_FIELDS];
+        for (int f = 0; f < SAMPLE_FIELDS; f++)
+        {
+            previous[f] = DecodeFloat(reader, previous[f]);
+            fields[f] = BitsToFloat(previous[f]);
+        }
+
+        FlightSample sample;
+        sample.step = chunk.step + i;
+        SetFields(sample, fields);
+        samples.push_back(sample);
+    }
+    return !reader.HasOverrun();
+}
+
+bool FlightRecording::Open(const char* pFilename)
+{
+    Close();
+
+    if (!m_file.Open(pFilename))
+    {
+        printf("%s:%d - cannot open %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    const FlightRecordingHeader* header = (const FlightRecordingHeader*)m_file.GetData();
+    if (m_file.GetSize() < sizeof(FlightRecordingHeader) ||
+        memcmp(header->magic, FLIGHT_RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FLIGHT_RECORDING_VERSION || header->headerSize != sizeof(FlightRecordingHeader))
+    {
+        printf("%s:%d - %s is not a flight recording of version %u\n", __FILE__, __LINE__, pFilename,
+            FLIGHT_RECORDING_VERSION);
+        m_file.Close();
+        return false;
+    }
+    m_header = header;
+
+    if (!ReadIndex())
+    {
+        printf("%s:%d - %s has no index, it was cut short\n", __FILE__, __LINE__, pFilename);
+        ScanChunks();
+    }
+    return true;
+}
+
+void FlightRecording::Close()
+{
+    m_file.Close();
+    m_header = nullptr;
+    m_sampleChunks.clear();
+    m_keyframes.clear();
+    m_decoded.clear();
+    m_decodedChunk = SIZE_MAX;
+}
+
+bool FlightRecording::ReadIndex()
+{
+    const uint64_t offset = m_header->indexOffset, count = m_header->indexCount;
+    const uint64_t size = m_file.GetSize();
+    if (offset < sizeof(FlightRecordingHeader) || offset > size ||
+        count > (size - offset) / sizeof(FlightRecordingIndexEntry))
+        return false;
+
+    const uint8_t* pEntries = m_file.GetData() + offset;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        FlightRecordingIndexEntry entry;
+        memcpy(&entry, pEntries + i * sizeof(entry), sizeof(entry));
+        AddToIndex(entry);
+    }
+    return true;
+}
+
+void FlightRecording::ScanChunks()
+{
+    const uint8_t* pData = m_file.GetData();
+    const uint64_t size = m_file.GetSize();
+    uint64_t offset = sizeof(FlightRecordingHeader);
+    FlightRecordingChunk chunk;
+    while (offset + sizeof(chunk) <= size)
+    {
+        memcpy(&chunk, pData + offset, sizeof(chunk));
+        if ((chunk.type != FlightChunkType::Samples && chunk.type != FlightChunkType::Keyframe) ||
+            chunk.byteCount > size - offset - sizeof(chunk))
+            break;
+
+        FlightRecordingIndexEntry entry;
+        entry.type = chunk.type;
+        entry.sampleCount = chunk.sampleCount;
+        entry.step = chunk.step;
+        entry.offset = offset;
+        AddToIndex(entry);
+        offset += sizeof(chunk) + chunk.byteCount;
+    }
+}
+
+void FlightRecording::AddToIndex(const FlightRecordingIndexEntry& entry)
+{
+    // Chunks are written in step order, anything else is corrupt.
+    if (entry.type != FlightChunkType::Samples && entry.type != FlightChunkType::Keyframe)
+        return;
+    std::vector<FlightRecordingIndexEntry>& entries =
+        entry.type == FlightChunkType::Keyframe ? m_keyframes : m_sampleChunks;
+    if (!entries.empty() && entry.step < entries.back().step + entries.back().sampleCount)
+        return;
+    entries.push_back(entry);
+}
+
+const uint8_t* FlightRecording::GetChunk(const FlightRecordingIndexEntry& entry, FlightRecordingChunk& chunk) const
+{
+    const uint64_t size = m_file.GetSize();
+    if (entry.offset > size || size - entry.offset < sizeof(chunk))
+        return nullptr;
+    memcpy(&chunk, m_file.GetData() + entry.offset, sizeof(chunk));
+    if (chunk.type != entry.type || chunk.byteCount > size - entry.offset - sizeof(chunk))
+        return nullptr;
+    return m_file.GetData() + entry.offset + sizeof(chunk);
+}
+
+uint64_t FlightRecording::GetFirstStep() const
+{
+    if (!m_keyframes.empty())
+        return m_keyframes.front().step;
+    return m_sampleChunks.empty() ? 0 : m_sampleChunks.front().step;
+}
+
+uint64_t FlightRecording::GetEndStep() const
+{
+    return m_sampleChunks.empty() ? GetFirstStep() : m_sampleChunks.back().step + m_sampleChunks.back().sampleCount;
+}
+
+const FlightSample* FlightRecording::GetSample(uint64_t step)
+{
+    // The last chunk starting at or before the step.
+    auto it = std::upper_bound(m_sampleChunks.begin(), m_sampleChunks.end(), step,
+        [](uint64_t value, const FlightRecordingIndexEntry& entry) { return value < entry.step; });
+    if (it == m_sampleChunks.begin())
+        return nullptr;
+    --it;
+    if (step >= it->step + it->sampleCount)
+        return nullptr;
+
+    const size_t chunkIndex = it - m_sampleChunks.begin();
+    if (chunkIndex != m_decodedChunk)
+    {
+        m_decoded.clear();
+        m_decodedChunk = SIZE_MAX;
+        FlightRecordingChunk chunk;
+        const uint8_t* pData = GetChunk(*it, chunk);
+        if (!pData || chunk.sampleCount != it->sampleCount || !DecodeChunk(chunk, pData, m_decoded))
+            return nullptr;
+        m_decodedChunk = chunkIndex;
+    }
+    return &m_decoded[step - it->step];
+}
+
+bool FlightRecording::ReadSamples(std::vector<FlightSample>& samples)
+{
+    samples.clear();
+    for (const FlightRecordingIndexEntry& entry : m_sampleChunks)
+    {
+        FlightRecordingChunk chunk;
+        const uint8_t* pData = GetChunk(entry, chunk);
+        if (!pData || !DecodeChunk(chunk, pData, samples))
+        {
+            printf("%s:%d - recording is corrupt after step %llu\n", __FILE__, __LINE__, (unsigned long long)entry.step);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlightRecording::Seek(LockstepSimulation& simulation, uint64_t step)
+{
+    // The last keyframe at or before the step.
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), step,
+        [](uint64_t value, const FlightRecordingIndexEntry& entry) { return value < entry.step; });
+    if (it == m_keyframes.begin())
+        return false;
+    --it;
+
+    FlightRecordingChunk chunk;
+    const uint8_t* pData = GetChunk(*it, chunk);
+    if (!pData || !simulation.LoadState(pData, chunk.byteCount))
+        return false;
+
+    while (simulation.GetStepCount() < step)
+    {
+        const FlightSample* sample = GetSample(simulation.GetStepCount());
+        if (!sample)
+            return false;
+        simulation.Step(sample->input);
+    }
+    return true;
+}
@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include "ground_proximity.h"
+#include "parallel.h"
+
+// Aircraft below which a pass runs on the calling thread.
+static const int PARALLEL_MIN = 1024;
+
+// Path samples per block of the terrain query. A multiple of every vector width, so only the last block has a tail
+// that is sampled one by one.
+static const int SAMPLE_BLOCK = 256;
+
+GroundProximity::GroundProximity(const GroundProximitySettings& settings)
+    : m_settings(settings)
+{
+    m_settings.samples = std::max(m_settings.samples, 2);
+}
+
+void GroundProximity::Update(const float* x, const float* y, const float* z, const float* vx, const float* vy,
+    const float* vz, int count, const TerrainBounds& bounds, const HeightField& ground)
+{
+    const float lookAhead = m_settings.lookAheadSeconds;
+    const float floor = m_settings.floor;
+    m_alerts.assign(count, (uint8_t)TerrainAlert::None);
+    m_timeToBreach.assign(count, -1.0f);
+    m_needsSamples.resize(count);
+
+    // Coarse pass: the path against the highest post of the ground, then against the highest post under the box it
+    // sweeps
+    const float maxHeight = bounds.GetMaxHeight();
+    ParallelForRange(0, count, [&](int first, int last) {
+        for (int i = first; i < last; i++)
+        {
+            const float lowest = std::min(y[i], y[i] + vy[i] * lookAhead);
+            if (lowest - maxHeight >= floor)
+            {
+                m_needsSamples[i] = false;
+                continue;
+            }
+
+            const float endX = x[i] + vx[i] * lookAhead;
+            const float endZ = z[i] + vz[i] * lookAhead;
+            float minHeight, boxHeight;
+            bounds.GetBounds(std::min(x[i], endX), std::min(z[i], endZ), std::max(x[i], endX), std::max(z[i], endZ),
+                minHeight, boxHeight);
+            m_needsSamples[i] = lowest - boxHeight < floor;
+        }
+    }, PARALLEL_MIN);
+
+    m_sampled.clear();
+    for (int i = 0; i < count; i++)
+    {
+        if (m_needsSamples[i])
+            m_sampled.push_back(i);
+    }
+    const int sampledCount = (int)m_sampled.size();
+    if (sampledCount == 0)
+        return;
+
+    // The sample points of every remaining path, evenly spaced in time from the aircraft to the end of the look-ahead
+    const int samples = m_settings.samples;
+    const int sampleCount = sampledCount * samples;
+    const float sampleSeconds = lookAhead / (samples - 1);
+    m_sampleX.resize(sampleCount);
+    m_sampleZ.resize(sampleCount);
+    m_sampleHeight.resize(sampleCount);
+    m_groundHeight.resize(sampleCount);
+    ParallelForRange(0, sampledCount, [&](int first, int last) {
+        for (int j = first; j < last; j++)
+        {
+            const int i = m_sampled[j];
+            for (int k = 0; k < samples; k++)
+            {
+                const float t = k * sampleSeconds;
+                m_sampleX[j * samples + k] = x[i] + vx[i] * t;
+                m_sampleZ[j * samples + k] = z[i] + vz[i] * t;
+                m_sampleHeight[j * samples + k] = y[i] + vy[i] * t;
+            }
+        }
+    }, PARALLEL_MIN);
+
+    // One terrain query for all of them, in blocks of whole vectors
+    const int blockCount = (sampleCount + SAMPLE_BLOCK - 1) / SAMPLE_BLOCK;
+    ParallelForRange(0, blockCount, [&](int firstBlock, int lastBlock) {
+        const int first = firstBlock * SAMPLE_BLOCK;
+        const int last = std::min(lastBlock * SAMPLE_BLOCK, sampleCount);
+        ground.GetHeights(m_sampleX.data() + first, m_sampleZ.data() + first, m_groundHeight.data() + first,
+            last - first);
+    }, PARALLEL_MIN * samples / SAMPLE_BLOCK);
+
+    // The first sample below the floor decides the alert
+    ParallelForRange(0, sampledCount, [&](int first, int last) {
+        for (int j = first; j < last; j++)
+        {
+            const float* height = m_sampleHeight.data() + j * samples;
+            const float* groundHeight = m_groundHeight.data() + j * samples;
+            for (int k = 0; k < samples; k++)
+            {
+                if (height[k] - groundHeight[k] < floor)
+                {
+                    const int i = m_sampled[j];
+                    const float t = k * sampleSeconds;
+                    m_timeToBreach[i] = t;
+                    m_alerts[i] = (uint8_t)(t <= m_settings.warningSeconds ? TerrainAlert::Warning
+                        : TerrainAlert::Caution);
+                    break;
+                }
+            }
+        }
+    }, PARALLEL_MIN);
+}
+
+int GroundProximity::CountAlerts(TerrainAlert alert) const
+{
+    int alerts = 0;
+    for (uint8_t a : m_alerts)
+        alerts += a >= (uint8_t)alert;
+    return alerts;
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "height_field.h"
+#include "height_field_kernel.h"
+#include "fault_formation.h"
+
+// Loads a raw float heightmap
+bool HeightField::LoadRaw(const char* pFilename, float worldScale)
+{
+    FILE* file = fopen(pFilename, "rb");
+    if (!file)
+    {
+        printf("%s:%d - cannot open %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    int terrainSize = (int)std::sqrt((double)(fileSize / sizeof(float)));
+    if (fileSize <= 0 || (size_t)terrainSize * terrainSize * sizeof(float) != (size_t)fileSize)
+    {
+        printf("%s:%d - %s is not a square float heightmap\n", __FILE__, __LINE__, pFilename);
+        fclose(file);
+        return false;
+    }
+
+    // Array2D takes ownership of malloc'd data and frees it.
+    float* heights = (float*)malloc(fileSize);
+    size_t read = fread(heights, 1, fileSize, file);
+    fclose(file);
+    if (read != (size_t)fileSize)
+    {
+        printf("%s:%d - cannot read %s\n", __FILE__, __LINE__, pFilename);
+        free(heights);
+        return false;
+    }
+
+    m_database.Close();
+    m_heightMap = std::make_unique<Array2D<float>>();
+    m_heightMap->InitArray2D(terrainSize, terrainSize, heights);
+    m_terrainSize = terrainSize;
+    m_worldScale = worldScale;
+    return true;
+}
+
+// Keeps a terrain database mapped for queries
+bool HeightField::OpenDatabase(const char* pFilename, int level)
+{
+    if (!m_database.Open(pFilename))
+    {
+        printf("%s:%d - %s is not a valid terrain database\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    if (level < 0 || level >= m_database.GetLevelCount())
+    {
+        printf("%s:%d - %s has no level %d\n", __FILE__, __LINE__, pFilename, level);
+        m_database.Close();
+        return false;
+    }
+
+    m_heightMap.reset();
+    m_level = level;
+    m_worldScale = m_database.GetLevel(level).postSpacing;
+    return true;
+}
+
+// Generates a fault formation heightmap
+void HeightField::GenerateFaultFormation(int terrainSize, int iterations, float minHeight, float maxHeight, float filter,
+    unsigned int seed, float worldScale)
+{
+    m_database.Close();
+    m_heightMap = std::make_unique<Array2D<float>>();
+    m_heightMap->InitArray2D(terrainSize, terrainSize, 0.0f);
+    FaultFormation::GenerateHeightMap(*m_heightMap, terrainSize, iterations, minHeight, maxHeight, filter, seed);
+    m_terrainSize = terrainSize;
+    m_worldScale = worldScale;
+}
+
+// Copies a heightmap
+void HeightField::CopyHeightMap(const Array2D<float>& heightMap, int terrainSize, float worldScale)
+{
+    m_database.Close();
+    m_heightMap = std::make_unique<Array2D<float>>();
+    m_heightMap->InitArray2D(terrainSize, terrainSize);
+    memcpy(m_heightMap->GetBaseAddr(), heightMap.GetBaseAddr(), (size_t)terrainSize * terrainSize * sizeof(float));
+    m_terrainSize = terrainSize;
+    m_worldScale = worldScale;
+}
+
+// Interpolates the height between the four surrounding posts
+float HeightField::GetHeight(float worldX, float worldZ) const
+{
+    if (m_database.IsOpen())
+        return m_database.GetHeight(m_level, worldX, worldZ);
+
+    if (!m_heightMap)
+        return 0.0f;
+
+    float x = std::clamp(worldX / m_worldScale, 0.0f, (float)(m_terrainSize - 1));
+    float z = std::clamp(worldZ / m_worldScale, 0.0f, (float)(m_terrainSize - 1));
+    int ix = std::min((int)x, m_terrainSize - 2);
+    int iz = std::min((int)z, m_terrainSize - 2);
+    float u = x - ix;
+    float v = z - iz;
+
+    float h00 = m_heightMap->Get(ix, iz);
+    float h10 = m_heightMap->Get(ix + 1, iz);
+    float h01 = m_heightMap->Get(ix, iz + 1);
+    float h11 = m_heightMap->Get(ix + 1, iz + 1);
+
+    float h0 = h00 + (h10 - h00) * u;
+    float h1 = h01 + (h11 - h01) * u;
+    return h0 + (h1 - h0) * v;
+}
+
+void SampleHeightsSse2(const HeightSampleArgs& args)
+{
+    SampleHeightsKernel<simd::Float4>(args);
+}
+
+// Samples whole vectors with the widest kernel and the rest one by one
+void HeightField::GetHeights(const float* x, const float* z, float* heights, size_t count) const
+{
+    size_t done = 0;
+    if (m_heightMap && (size_t)m_terrainSize * m_terrainSize <= (1u << 24))
+    {
+        static const bool avx2 = simd::CpuSupportsAvx2();
+        static const bool avx512 = simd::CpuSupportsAvx512();
+        const size_t width = avx512 ? 16 : avx2 ? 8 : 4;
+        HeightSampleArgs args = { m_heightMap->GetBaseAddr(), m_terrainSize, m_worldScale, x, z, heights,
+            count / width * width };
+        if (avx512)
+            SampleHeightsAvx512(args);
+        else if (avx2)
+            SampleHeightsAvx2(args);
+        else
+            SampleHeightsSse2(args);
+        done = args.count;
+    }
+
+    for (size_t i = done; i < count; i++)
+        heights[i] = GetHeight(x[i], z[i]);
+}
+
+// Side length of the terrain
+float HeightField::GetExtent() const
+{
+    if (m_database.IsOpen())
+    {
+        const TerrainDatabaseLevel& level = m_database.GetLevel(m_level);
+        return (float)(std::max(level.postsX, level.postsZ) - 1) * level.postSpacing;
+    }
+    return m_heightMap ? (m_terrainSize - 1) * m_worldScale : 0.0f;
+}
+
+// Posts of the heightmap or of the queried database level
+int HeightField::GetPostsX() const
+{
+    if (m_database.IsOpen())
+        return (int)m_database.GetLevel(m_level).postsX;
+    return m_heightMap ? m_terrainSize : 0;
+}
+
+int HeightField::GetPostsZ() const
+{
+    if (m_database.IsOpen())
+        return (int)m_database.GetLevel(m_level).postsZ;
+    return m_heightMap ? m_terrainSize : 0;
+}
+
+// One post, clamped like GetHeight
+float HeightField::GetPostHeight(int x, int z) const
+{
+    if (m_database.IsOpen())
+        return m_database.GetPostHeight(m_level, x, z);
+
+    if (!m_heightMap)
+        return 0.0f;
+
+    x = std::clamp(x, 0, m_terrainSize - 1);
+    z = std::clamp(z, 0, m_terrainSize - 1);
+    return m_heightMap->Get(x, z);
+}
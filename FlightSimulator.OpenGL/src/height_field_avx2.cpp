@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX2; only called after HeightField checked the processor.
+#include "height_field_kernel.h"
+
+void SampleHeightsAvx2(const HeightSampleArgs& args)
+{
+    SampleHeightsKernel<simd::Float8>(args);
+}
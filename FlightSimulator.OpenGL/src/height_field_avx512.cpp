@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX512; only called after HeightField checked the processor.
+#include "height_field_kernel.h"
+
+void SampleHeightsAvx512(const HeightSampleArgs& args)
+{
+    SampleHeightsKernel<simd::Float16>(args);
+}
@@ -0,0 +1,399 @@
+#include <chrono>
+#include <thread>
+
+#include "job_system.h"
+
+// Thread the calling code runs on, as seen by the job system it belongs to.
+static thread_local JobSystem* t_jobSystem = nullptr;
+static thread_local int t_threadIndex = -1;
+
+// State of the victim selection of the calling thread.
+static thread_local uint32_t t_random = 0;
+
+// Lock-free work-stealing deque of Chase and Lev, in the C11 formulation of Le et al. 2013. The owning thread pushes
+// and pops at the bottom, any thread steals from the top. Fixed capacity; a full deque makes Push fail.
+class JobDeque
+{
+public:
+    // Half the job pool, so at most half the jobs of a thread wait in its deque and the others stay free for the jobs
+    // it is running or waiting on. Otherwise a thread that queued a full pool could not allocate anything else.
+    static constexpr int64_t CAPACITY = JobSystem::JOBS_PER_THREAD / 2;
+
+    bool Push(Job* job)
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= CAPACITY)
+            return false;
+
+        m_jobs[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Job* Pop()
+    {
+        int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_jobs[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // Last job, race the thieves for it.
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job* Steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+
+        Job* job = m_jobs[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> m_top{ 0 };
+    alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+    alignas(64) std::atomic<Job*> m_jobs[CAPACITY] = {};
+};
+
+struct JobSystem::Worker {
+    JobDeque deque;
+    std::unique_ptr<Job[]> pool{ new Job[JOBS_PER_THREAD] };
+    uint32_t next = 0; // Next pool slot to try.
+    std::thread thread;
+};
+
+// Picks the next free slot of a ring of jobs. Jobs mostly finish in about the order they were created, so only a few
+// slots past the last one are tried; nullptr means the pool is (nearly) full and the caller should help out first.
+static Job* FindFreeJob(Job* pool, uint32_t& next)
+{
+    const int attempts = 32;
+    for (int attempt = 0; attempt < attempts; attempt++)
+    {
+        Job* job = &pool[next++ & (JobSystem::JOBS_PER_THREAD - 1)];
+        if (job->unfinished.load(std::memory_order_acquire) == 0)
+            return job;
+    }
+    return nullptr;
+}
+
+JobSystem::JobSystem(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = (int)std::max(2u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, MAX_THREADS);
+
+    m_externalPool.reset(new Job[JOBS_PER_THREAD]);
+    for (int i = 0; i < threadCount; i++)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    // A job system created while another one is in use on this thread takes over until it is destroyed.
+    m_previousSystem = t_jobSystem;
+    m_previousIndex = t_threadIndex;
+    t_jobSystem = this;
+    t_threadIndex = 0;
+    for (int i = 1; i < threadCount; i++)
+        m_workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (size_t i = 1; i < m_workers.size(); i++)
+        m_workers[i]->thread.join();
+
+    if (t_jobSystem == this)
+    {
+        t_jobSystem = m_previousSystem;
+        t_threadIndex = m_previousIndex;
+    }
+}
+
+int JobSystem::GetThreadIndex() const
+{
+    return t_jobSystem == this ? t_threadIndex : -1;
+}
+
+// Takes a free job from the pool of the calling thread and ties it to its parent
+Job* JobSystem::Allocate(JobHandle parent)
+{
+    const int index = GetThreadIndex();
+
+    Job* pool = index >= 0 ? m_workers[index]->pool.get() : m_externalPool.get();
+
+    Job* job = nullptr;
+    while (!job)
+    {
+        if (index >= 0)
+        {
+            job = FindFreeJob(pool, m_workers[index]->next);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(m_externalMutex);
+            job = FindFreeJob(pool, m_externalNext);
+        }
+
+        // Every job of this thread is in flight, so help finishing them.
+        if (!job)
+        {
+            Job* other = GetJob(index, index > 0 || GetThreadCount() == 1);
+            if (!other)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            Execute(other);
+            // Mostly the job just run was one of ours, take its slot instead of scanning the whole pool again.
+            // External threads share their pool, so they always search it under the lock.
+            if (index >= 0 && other >= pool && other < pool + JOBS_PER_THREAD &&
+                other->unfinished.load(std::memory_order_acquire) == 0)
+                job = other;
+        }
+    }
+
+    // Mark the job busy before publishing the new generation, so a stale handle never sees it finished too early.
+    job->unfinished.store(1, std::memory_order_relaxed);
+    job->generation.fetch_add(1, std::memory_order_release);
+    job->parent = parent.job;
+    if (parent.job)
+        parent.job->unfinished.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::Submit(JobHandle handle)
+{
+    const int index = GetThreadIndex();
+    if (index >= 0)
+    {
+        // A full deque means thousands of jobs are waiting already; running this one right away is just as good.
+        if (!m_workers[index]->deque.Push(handle.job))
+        {
+            Execute(handle.job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        m_externalQueue.push_back(handle.job);
+        m_externalCount.fetch_add(1, std::memory_order_release);
+    }
+
+    m_queued.fetch_add(1, std::memory_order_release);
+    WakeWorker();
+}
+
+void JobSystem::SubmitBackground(JobHandle handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_backgroundMutex);
+        m_backgroundQueue.push_back(handle.job);
+        m_backgroundCount.fetch_add(1, std::memory_order_release);
+    }
+
+    m_queued.fetch_add(1, std::memory_order_release);
+    WakeWorker();
+}
+
+void JobSystem::SubmitMainThread(JobHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_mainMutex);
+    m_mainQueue.push_back(handle.job);
+}
+
+// Finds a job for a thread: its own newest job first, then shared jobs, then the oldest job of another thread
+Job* JobSystem::GetJob(int index, bool allowBackground)
+{
+    Job* job = nullptr;
+
+    if (index >= 0)
+        job = m_workers[index]->deque.Pop();
+
+    if (!job && m_externalCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_externalMutex);
+        if (!m_externalQueue.empty())
+        {
+            job = m_externalQueue.front();
+            m_externalQueue.pop_front();
+            m_externalCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!job)
+    {
+        // Victims in a random order, so thieves do not all line up behind the same thread.
+        const int count = GetThreadCount();
+        if (t_random == 0)
+            t_random = 0x9E3779B9u * (uint32_t)(index + 2);
+        t_random ^= t_random << 13;
+        t_random ^= t_random >> 17;
+        t_random ^= t_random << 5;
+        int start = (int)(t_random % (uint32_t)count);
+        for (int i = 0; i < count && !job; i++)
+        {
+            int victim = (start + i) % count;
+            if (victim != index)
+                job = m_workers[victim]->deque.Steal();
+        }
+    }
+
+    if (!job && allowBackground && m_backgroundCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_backgroundMutex);
+        if (!m_backgroundQueue.empty())
+        {
+            job = m_backgroundQueue.front();
+            m_backgroundQueue.pop_front();
+            m_backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (job)
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+Job* JobSystem::PopMainThreadJob()
+{
+    std::lock_guard<std::mutex> lock(m_mainMutex);
+    if (m_mainQueue.empty())
+        return nullptr;
+
+    Job* job = m_mainQueue.front();
+    m_mainQueue.pop_front();
+    return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->function(*job);
+    Finish(job);
+}
+
+// Counts a job or one of its children as done, and the parent once its last child is
+void JobSystem::Finish(Job* job)
+{
+    // Read before the count drops, the job can be reused right after.
+    Job* parent = job->parent;
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent)
+        Finish(parent);
+}
+
+void JobSystem::Wait(JobHandle handle)
+{
+    const int index = GetThreadIndex();
+    const bool allowBackground = index > 0 || GetThreadCount() == 1;
+
+    while (!IsFinished(handle))
+    {
+        Job* job = GetJob(index, allowBackground);
+
+        // The job may be waiting for GL work of its own.
+        if (!job && index == 0)
+            job = PopMainThreadJob();
+
+        if (job)
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+int JobSystem::ExecuteMainThreadJobs()
+{
+    // Only the jobs queued so far, so jobs queueing further main thread jobs can not stall the frame.
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(m_mainMutex);
+        count = m_mainQueue.size();
+    }
+
+    int executed = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        Job* job = PopMainThreadJob();
+        if (!job)
+            break;
+        Execute(job);
+        executed++;
+    }
+    return executed;
+}
+
+void JobSystem::WakeWorker()
+{
+    if (m_sleeping.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+void JobSystem::WorkerLoop(int index)
+{
+    t_jobSystem = this;
+    t_threadIndex = index;
+
+    // Spin a little before sleeping, jobs often come in bursts.
+    const int spinsBeforeSleep = 64;
+    int idleSpins = 0;
+
+    while (!m_stop.load(std::memory_order_acquire))
+    {
+        Job* job = GetJob(index, true);
+        if (job)
+        {
+            Execute(job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < spinsBeforeSleep)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleeping.fetch_add(1, std::memory_order_acq_rel);
+        // The timeout bounds the delay if a wake up slips in between the check and the wait.
+        m_wake.wait_for(lock, std::chrono::milliseconds(1),
+            [this]() { return m_stop.load() || m_queued.load(std::memory_order_acquire) > 0; });
+        m_sleeping.fetch_sub(1, std::memory_order_acq_rel);
+        idleSpins = 0;
+    }
+}
+
+JobSystem& GetJobSystem()
+{
+    static JobSystem system;
+    return system;
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "lift_map.h"
+#include "parallel.h"
+
+// Least share of the sunlight a spot must get to start a thermal.
+static const float MIN_HEATING = 0.5f;
+
+// Up to this share of the heating is noise, so flat ground still has spots that stand out.
+static const float HEATING_NOISE = 0.05f;
+
+// Part of the way up to the ceiling over which a thermal gathers its strength near the ground.
+static const float THERMAL_GATHER = 0.1f;
+
+// Hash of a node in [0, 1), the same on every platform.
+static float HashNode(int x, int z)
+{
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)z * 19349663u;
+    h ^= h >> 16;
+    h *= 0x45d9f3bu;
+    h ^= h >> 16;
+    return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec2 LiftMap::GetHorizontalWind(const WindSettings& wind)
+{
+    return glm::vec2(std::cos(wind.direction), std::sin(wind.direction)) * wind.speed;
+}
+
+void LiftMap::Build(const HeightField& ground, const WindSettings& wind, const LiftSettings& settings,
+    int postsPerNode)
+{
+    m_settings = settings;
+    postsPerNode = std::max(postsPerNode, 1);
+    m_nodeSpacing = postsPerNode * ground.GetPostSpacing();
+    m_nodesX = std::max(std::max(ground.GetPostsX() - 1, 0) / postsPerNode + 1, 2);
+    m_nodesZ = std::max(std::max(ground.GetPostsZ() - 1, 0) / postsPerNode + 1, 2);
+    m_wind = GetHorizontalWind(wind);
+
+    const size_t nodes = (size_t)m_nodesX * m_nodesZ;
+    m_height.resize(nodes);
+    m_slope.resize(nodes);
+    m_ridge.resize(nodes);
+    m_thermal.assign(nodes, 0.0f);
+
+    // The ground and its slope across one node spacing
+    const float half = 0.5f * m_nodeSpacing;
+    ParallelForRange(0, m_nodesZ, [&](int firstRow, int lastRow) {
+        for (int iz = firstRow; iz < lastRow; iz++)
+        {
+            for (int ix = 0; ix < m_nodesX; ix++)
+            {
+                const float x = ix * m_nodeSpacing, z = iz * m_nodeSpacing;
+                const size_t node = (size_t)iz * m_nodesX + ix;
+                m_height[node] = ground.GetHeight(x, z);
+                m_slope[node] = glm::vec2(ground.GetHeight(x + half, z) - ground.GetHeight(x - half, z),
+                    ground.GetHeight(x, z + half) - ground.GetHeight(x, z - half)) / m_nodeSpacing;
+            }
+        }
+    });
+
+    m_tilesX = (m_nodesX + TILE_SIZE - 1) / TILE_SIZE;
+    const int tilesZ = (m_nodesZ + TILE_SIZE - 1) / TILE_SIZE;
+    m_tiles.assign((size_t)m_tilesX * tilesZ, Tile());
+    ParallelForRange(0, (int)m_tiles.size(), [&](int first, int last) {
+        for (int tile = first; tile < last; tile++)
+        {
+            const int x0 = (tile % m_tilesX) * TILE_SIZE, z0 = (tile / m_tilesX) * TILE_SIZE;
+            const int x1 = std::min(x0 + TILE_SIZE, m_nodesX), z1 = std::min(z0 + TILE_SIZE, m_nodesZ);
+            float maxSlope = 0.0f;
+            for (int iz = z0; iz < z1; iz++)
+            {
+                for (int ix = x0; ix < x1; ix++)
+                    maxSlope = std::max(maxSlope, glm::length(m_slope[(size_t)iz * m_nodesX + ix]));
+            }
+            m_tiles[tile].maxSlope = maxSlope;
+            RefreshTile(tile);
+        }
+    });
+
+    BakeThermals();
+}
+
+int LiftMap::SetWind(const WindSettings& wind)
+{
+    m_wind = GetHorizontalWind(wind);
+
+    // The lift of a node changes by the change of the wind along its slope, which the steepest slope of the tile bounds
+    std::vector<int> changed;
+    for (int tile = 0; tile < (int)m_tiles.size(); tile++)
+    {
+        if (glm::length(m_wind - m_tiles[tile].wind) * m_tiles[tile].maxSlope > m_settings.tolerance)
+            changed.push_back(tile);
+    }
+
+    ParallelForRange(0, (int)changed.size(), [&](int first, int last) {
+        for (int i = first; i < last; i++)
+            RefreshTile(changed[i]);
+    });
+    return (int)changed.size();
+}
+
+void LiftMap::RefreshTile(int tile)
+{
+    const int x0 = (tile % m_tilesX) * TILE_SIZE, z0 = (tile / m_tilesX) * TILE_SIZE;
+    const int x1 = std::min(x0 + TILE_SIZE, m_nodesX), z1 = std::min(z0 + TILE_SIZE, m_nodesZ);
+    for (int iz = z0; iz < z1; iz++)
+    {
+        for (int ix = x0; ix < x1; ix++)
+        {
+            const size_t node = (size_t)iz * m_nodesX + ix;
+            m_ridge[node] = glm::dot(m_wind, m_slope[node]);
+        }
+    }
+    m_tiles[tile].wind = m_wind;
+}
+
+void LiftMap::BakeThermals()
+{
+    // How much sun every node gets
+    const glm::vec3 sun = glm::normalize(m_settings.sunDirection);
+    const size_t nodes = (size_t)m_nodesX * m_nodesZ;
+    std::vector<float> heating(nodes);
+    ParallelForRange(0, m_nodesZ, [&](int firstRow, int lastRow) {
+        for (int iz = firstRow; iz < lastRow; iz++)
+        {
+            for (int ix = 0; ix < m_nodesX; ix++)
+            {
+                const size_t node = (size_t)iz * m_nodesX + ix;
+                const glm::vec3 normal = glm::normalize(glm::vec3(-m_slope[node].x, 1.0f, -m_slope[node].y));
+                heating[node] = std::max(glm::dot(normal, sun), 0.0f) * (1.0f - HEATING_NOISE) +
+                    HashNode(ix, iz) * HEATING_NOISE;
+            }
+        }
+    });
+
+    // A thermal starts where the heating is highest within half the spacing
+    const int radius = std::max((int)std::lround(0.5f * m_settings.thermalSpacing / m_nodeSpacing), 1);
+    std::vector<uint8_t> isCore(nodes, 0);
+    ParallelForRange(0, m_nodesZ, [&](int firstRow, int lastRow) {
+        for (int iz = firstRow; iz < lastRow; iz++)
+        {
+            for (int ix = 0; ix < m_nodesX; ix++)
+            {
+                const float h = heating[(size_t)iz * m_nodesX + ix];
+                bool highest = h >= MIN_HEATING;
+                for (int z = std::max(iz - radius, 0); z <= std::min(iz + radius, m_nodesZ - 1) && highest; z++)
+                {
+                    for (int x = std::max(ix - radius, 0); x <= std::min(ix + radius, m_nodesX - 1); x++)
+                    {
+                        if ((x != ix || z != iz) && heating[(size_t)z * m_nodesX + x] >= h)
+                        {
+                            highest = false;
+                            break;
+                        }
+                    }
+                }
+                isCore[(size_t)iz * m_nodesX + ix] = highest;
+            }
+        }
+    });
+
+    // The few thermals spread their climb over the nodes around them
+    const float thermalRadius = m_settings.thermalRadius;
+    const int reach = (int)std::ceil(2.0f * thermalRadius / m_nodeSpacing);
+    m_thermalCount = 0;
+    for (int iz = 0; iz < m_nodesZ; iz++)
+    {
+        for (int ix = 0; ix < m_nodesX; ix++)
+        {
+            const size_t core = (size_t)iz * m_nodesX + ix;
+            if (!isCore[core])
+                continue;
+
+            m_thermalCount++;
+            const float strength = m_settings.thermalStrength * heating[core];
+            for (int z = std::max(iz - reach, 0); z <= std::min(iz + reach, m_nodesZ - 1); z++)
+            {
+                for (int x = std::max(ix - reach, 0); x <= std::min(ix + reach, m_nodesX - 1); x++)
+                {
+                    const float distance = glm::length(glm::vec2(x - ix, z - iz)) * m_nodeSpacing / thermalRadius;
+                    m_thermal[(size_t)z * m_nodesX + x] += strength * std::exp(-distance * distance);
+                }
+            }
+        }
+    }
+}
+
+float LiftMap::Sample(const std::vector<float>& values, float worldX, float worldZ) const
+{
+    float x = std::clamp(worldX / m_nodeSpacing, 0.0f, (float)(m_nodesX - 1));
+    float z = std::clamp(worldZ / m_nodeSpacing, 0.0f, (float)(m_nodesZ - 1));
+    int ix = std::min((int)x, m_nodesX - 2);
+    int iz = std::min((int)z, m_nodesZ - 2);
+    float u = x - ix;
+    float v = z - iz;
+
+    const float* row = values.data() + (size_t)iz * m_nodesX + ix;
+    float h0 = row[0] + (row[1] - row[0]) * u;
+    float h1 = row[m_nodesX] + (row[m_nodesX + 1] - row[m_nodesX]) * u;
+    return h0 + (h1 - h0) * v;
+}
+
+float LiftMap::GetRidgeLift(const glm::vec3& position, float height) const
+{
+    return Sample(m_ridge, position.x, position.z) * std::exp(-std::max(height, 0.0f) / m_settings.ridgeDepth);
+}
+
+float LiftMap::GetThermalLift(const glm::vec3& position, float height) const
+{
+    const float ceiling = m_settings.thermalCeiling;
+    if (height <= 0.0f || height >= ceiling)
+        return 0.0f;
+
+    // The rising air drifts with the wind, so higher up the thermal is found further downwind of where it started
+    const glm::vec2 source = glm::vec2(position.x, position.z) - m_wind * (height / m_settings.thermalStrength);
+    const float profile = std::min(height / (THERMAL_GATHER * ceiling), 1.0f) * (1.0f - height / ceiling);
+    return Sample(m_thermal, source.x, source.y) * profile;
+}
+
+float LiftMap::GetRidgeLift(const glm::vec3& position) const
+{
+    if (m_height.empty())
+        return 0.0f;
+    return GetRidgeLift(position, position.y - Sample(m_height, position.x, position.z));
+}
+
+float LiftMap::GetThermalLift(const glm::vec3& position) const
+{
+    if (m_height.empty())
+        return 0.0f;
+    return GetThermalLift(position, position.y - Sample(m_height, position.x, position.z));
+}
+
+float LiftMap::GetLift(const glm::vec3& position) const
+{
+    if (m_height.empty())
+        return 0.0f;
+    const float height = position.y - Sample(m_height, position.x, position.z);
+    return GetRidgeLift(position, height) + GetThermalLift(position, height);
+}
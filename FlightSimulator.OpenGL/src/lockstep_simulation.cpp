@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "lockstep_simulation.h"
+#include "bit_stream.h"
+#include "data.h"
+
+// The scheduler ticks at the traffic rate, every stepsPerTrafficTick steps.
+static SimulationScheduler::Settings GetSchedulerSettings(const LockstepSettings& settings)
+{
+    SimulationScheduler::Settings scheduler;
+    scheduler.tickSeconds = settings.stepSize * std::max(settings.stepsPerTrafficTick, 1);
+    return scheduler;
+}
+
+LockstepSimulation::LockstepSimulation(const LockstepSettings& settings, const HeightField& ground)
+    : m_settings(settings), m_ground(ground), m_wingAirfoil(NACA_2412_data), m_tailAirfoil(NACA_0012_data),
+    m_player(&m_wingAirfoil, &m_tailAirfoil), m_traffic(m_player), m_scheduler(GetSchedulerSettings(settings)),
+    m_broadPhase(2.0f * CONFLICT_DISTANCE)
+{
+    m_settings.stepsPerTrafficTick = std::max(m_settings.stepsPerTrafficTick, 1);
+    m_traffic.SetKernelIsa(KERNEL_ISA);
+    m_terrainBounds.Build(m_ground);
+    Reset();
+}
+
+void LockstepSimulation::GenerateGround(const LockstepTerrain& terrain, HeightField& ground)
+{
+    ground.GenerateFaultFormation(terrain.size, terrain.iterations, terrain.minHeight, terrain.maxHeight,
+        terrain.filter, terrain.seed, terrain.worldScale);
+}
+
+void LockstepSimulation::SetTerrain(const LockstepTerrain& terrain)
+{
+    m_settings.terrain = terrain;
+    m_terrainBounds.Build(m_ground);
+    DetectCollisions();
+}
+
+void LockstepSimulation::Reset()
+{
+    // A new airplane also forgets the adaptive step and the force accumulators of the old one.
+    m_player = physics::Airplane(&m_wingAirfoil, &m_tailAirfoil);
+    m_player.integrator = m_settings.integrator;
+    m_player.position = m_settings.startPosition;
+    m_player.velocity = physics::FORWARD * m_settings.startSpeed;
+    m_player.reset_interpolation();
+
+    m_traffic.Clear();
+    m_scheduler = SimulationScheduler(GetSchedulerSettings(m_settings));
+    AddTraffic();
+    m_step = 0;
+    DetectCollisions();
+}
+
+void LockstepSimulation::AddTraffic()
+{
+    // A square grid centred on the player, on random headings a little above or below the player.
+    std::mt19937 rng(m_settings.seed);
+    const int columns = (int)std::ceil(std::sqrt((float)m_settings.trafficCount));
+    for (int i = 0; i < m_settings.trafficCount; i++)
+    {
+        int column = i % columns, row = i / columns;
+        glm::vec3 offset((column - columns / 2) * m_settings.trafficSpacing, (Uniform(rng) - 0.5f) * 400.0f,
+            (row - columns / 2) * m_settings.trafficSpacing);
+        // the centre of the grid is where the player starts
+        if (column == columns / 2 && row == columns / 2)
+            offset.y += 300.0f;
+
+        float heading = (Uniform(rng) * 2.0f - 1.0f) * physics::PI;
+        float speed = 50.0f + Uniform(rng) * 20.0f;
+        m_traffic.AddAircraft(m_settings.startPosition + offset, heading, speed);
+        m_scheduler.Add();
+    }
+}
+
+void LockstepSimulation::Step(const Joystick& input)
+{
+    m_player.set_controls(input);
+    m_player.update(m_settings.stepSize);
+
+    float groundHeight = m_ground.GetHeight(m_player.position.x, m_player.position.z);
+    if (m_player.position.y < groundHeight)
+    {
+        m_player.position.y = groundHeight;
+        m_player.velocity.y = std::max(m_player.velocity.y, 0.0f);
+    }
+
+    m_step++;
+    if (m_step % m_settings.stepsPerTrafficTick == 0)
+        StepTraffic();
+    if (m_collisionsStale)
+        DetectCollisions();
+}
+
+void LockstepSimulation::StepTraffic()
+{
+    // Rates follow the distance to the player rather than to the camera, which the simulation knows nothing of.
+    SchedulerView view;
+    view.position = m_player.position;
+    view.front = m_player.transform_direction(physics::FORWARD);
+    view.cosHalfFov = 0.5f;
+
+    const TrafficState& state = m_traffic.GetState();
+    m_scheduler.Rebalance(view, state.positionX, state.positionY, state.positionZ,
+        REBALANCE_PER_TICK);
+
+    m_traffic.SetAutopilotView(view.position);
+    int due = m_scheduler.Tick();
+    m_traffic.StepSelected(m_scheduler.GetDue().data(), m_scheduler.GetDueSteps().data(), due);
+
+    const uint64_t tick = m_step / m_settings.stepsPerTrafficTick;
+    if (tick % COLLISION_TICKS == 0)
+        DetectCollisions();
+}
+
+void LockstepSimulation::DetectCollisions()
+{
+    // The cells are twice the conflict distance, so a query visits at most 2x2x2 of them
+    m_collisionsStale = false;
+    const TrafficState& state = m_traffic.GetState();
+    const int count = m_traffic.GetCount();
+    m_broadPhase.Build(state.positionX, state.positionY, state.positionZ, nullptr, count);
+    m_broadPhase.FindPairs(CONFLICT_DISTANCE, m_conflicts);
+    m_broadPhase.Query(m_player.position, CONFLICT_DISTANCE, m_playerConflicts);
+    m_terrainBounds.FindContacts(state.positionX, state.positionY, state.positionZ, nullptr, count, TERRAIN_CLEARANCE,
+        m_ground, m_terrainContacts);
+    m_trafficProximity.Update(state.positionX, state.positionY, state.positionZ, state.velocityX, state.velocityY,
+        state.velocityZ, count, m_terrainBounds, m_ground);
+
+    const glm::vec3& position = m_player.position;
+    const glm::vec3& velocity = m_player.velocity;
+    m_playerProximity.Update(&position.x, &position.y, &position.z, &velocity.x, &velocity.y, &velocity.z, 1,
+        m_terrainBounds, m_ground);
+}
+
+float LockstepSimulation::GetTrafficAlpha(float stepAlpha) const
+{
+    return ((m_step % m_settings.stepsPerTrafficTick) + stepAlpha) / m_settings.stepsPerTrafficTick;
+}
+
+void LockstepSimulation::SaveState(std::vector<uint8_t>& data) const
+{
+    const physics::RigidBody::Snapshot player = m_player.get_snapshot();
+    WriteBytes(data, &m_step, sizeof(m_step));
+    WriteBytes(data, &player, sizeof(player));
+    m_traffic.WriteState(data);
+    m_scheduler.WriteState(data);
+}
+
+bool LockstepSimulation::LoadState(const uint8_t* pData, size_t size)
+{
+    const uint8_t* pEnd = pData + size;
+    uint64_t step = 0;
+    physics::RigidBody::Snapshot player;
+    if (!ReadBytes(pData, pEnd, &step, sizeof(step)) || !ReadBytes(pData, pEnd, &player, sizeof(player)) ||
+        !m_traffic.ReadState(pData, pEnd) || !m_scheduler.ReadState(pData, pEnd) ||
+        m_traffic.GetCount() != m_scheduler.GetCount())
+    {
+        printf("%s:%d - simulation state is truncated or from other settings\n", __FILE__, __LINE__);
+        Reset();
+        return false;
+    }
+
+    // Restoring stays a copy of the state, the broadphase is rebuilt on the next step instead
+    m_player.set_snapshot(player);
+    m_step = step;
+    m_conflicts.clear();
+    m_playerConflicts.clear();
+    m_terrainContacts.clear();
+    m_collisionsStale = true;
+    return true;
+}
+
+// FNV-1a over raw bytes
+static void HashBytes(uint64_t& hash, const void* pData, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)pData;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static void HashArray(uint64_t& hash, const float* values, int count)
+{
+    HashBytes(hash, values, count * sizeof(float));
+}
+
+uint64_t LockstepSimulation::ComputeChecksum() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    HashBytes(hash, &m_step, sizeof(m_step));
+    HashBytes(hash, &m_player.position, sizeof(m_player.position));
+    HashBytes(hash, &m_player.orientation, sizeof(m_player.orientation));
+    HashBytes(hash, &m_player.velocity, sizeof(m_player.velocity));
+    HashBytes(hash, &m_player.angular_velocity, sizeof(m_player.angular_velocity));
+
+    const TrafficState& state = m_traffic.GetState();
+    for (float* const* values : { &state.positionX, &state.positionY, &state.positionZ,
+        &state.orientationW, &state.orientationX, &state.orientationY, &state.orientationZ,
+        &state.velocityX, &state.velocityY, &state.velocityZ,
+        &state.angularVelocityX, &state.angularVelocityY, &state.angularVelocityZ })
+        HashArray(hash, *values, m_traffic.GetCount());
+    return hash;
+}
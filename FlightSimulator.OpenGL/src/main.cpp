@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <vector>
+#include <cstring>
+#include <memory>
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 
@@ -12,11 +14,18 @@
 #include "skybox.h"
 #include "data.h"
 #include "physics.h"
+#include "airplane.h"
+#include "fixed_timestep.h"
 #include "terrain.h"
 #include "fault_formation_terrain.h"
 
 #include "constants.h"
 #include "joystick.h"
+#include "job_system.h"
+#include "height_field.h"
+#include "lockstep_simulation.h"
+#include "flight_recorder.h"
+#include "world_snapshot.h"
 
 // Callback function declarations
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -36,6 +45,40 @@ Camera aircraftCamera;
 Model planeModel;
 FaultFormationTerrain m_terrain;
 
+// Player and AI traffic in lockstep, stepped at a fixed rate independent of the frame rate
+LockstepSettings simulationSettings;
+HeightField simulationGround;
+std::unique_ptr<LockstepSimulation> simulation;
+physics::FixedTimestep simulationClock(simulationSettings.stepSize, 8);
+std::vector<float> trafficElapsed;
+bool terrainRegenerating = false;
+bool trafficConflict = false;
+TerrainAlert terrainAlert = TerrainAlert::None;
+
+// Recording with F5, or replaying a recording given with --replay at 1x to 64x, seeking 30 s with [ and ]
+FlightRecorder recorder;
+const char* recordingPath = "flight.fsr";
+bool recordKeyDown = false;
+FlightRecording replay;
+bool replaying = false;
+float replaySpeed = 1.0f;
+const float maxReplaySpeed = 64.0f;
+const float replaySeekSeconds = 30.0f;
+bool replaySlowerKeyDown = false;
+bool replayFasterKeyDown = false;
+bool replayBackKeyDown = false;
+bool replayForwardKeyDown = false;
+
+// Snapshot of the whole world taken with F6 and restored with F9 any number of times, or given with --snapshot
+WorldSnapshot snapshot;
+const char* snapshotPath = "snapshot.fss";
+bool snapshotKeyDown = false;
+bool restoreKeyDown = false;
+bool snapshotPending = false;
+
+bool chaseCamera = true;
+bool chaseCameraKeyDown = false;
+
 // Terrain global variables
 float worldScale = 20.0f;
 float textureScale = 40.0;
@@ -44,20 +87,141 @@ int iterations = 500;
 float minHeight = 0;
 float maxHeight = 5000.0f;
 float filter = 0.80f;
+unsigned int terrainSeed = 1;
+bool regenerateKeyDown = false;
 
 // Function declartions
 void InitializeOpenGLState();
+void InitializeSimulation();
+void StepSimulation();
+void ToggleRecording();
+void SeekReplay(float seconds);
+void UseTerrainSettings(const LockstepTerrain& terrain);
+void CaptureSnapshot();
+void RestoreSnapshot();
 void RenderScene(Skybox& skybox);
-FaultFormationTerrain InitializeTerrain(float minHeight, float maxHeight);
-FaultFormationTerrain InitTerrainMultiTextures(FaultFormationTerrain& terrain, float minHeight, float maxHeight);
+// Takes over the terrain parameters of a recording or snapshot, before the terrain is generated
+void UseTerrainSettings(const LockstepTerrain& terrain)
+{
+	terrainSize = terrain.size;
+	iterations = terrain.iterations;
+	minHeight = terrain.minHeight;
+	maxHeight = terrain.maxHeight;
+	filter = terrain.filter;
+	terrainSeed = terrain.seed;
+	worldScale = terrain.worldScale;
+}
+
+// Captures the simulation, the camera and the controls, and writes them to the snapshot file
+void CaptureSnapshot()
+{
+	WorldSnapshotView view;
+	view.cameraPosition = aircraftCamera.Position;
+	view.cameraFront = aircraftCamera.Front;
+	view.cameraUp = aircraftCamera.Up;
+	view.cameraRight = aircraftCamera.Right;
+	view.cameraYaw = aircraftCamera.Yaw;
+	view.cameraPitch = aircraftCamera.Pitch;
+	view.cameraRoll = aircraftCamera.Roll;
+	view.cameraZoom = aircraftCamera.Zoom;
+	view.chaseCamera = chaseCamera;
+	view.controls = joystick;
+
+	snapshot.Capture(*simulation, view);
+	snapshotPending = false;
+	if (snapshot.Save(snapshotPath))
+		printf("Snapshot of step %llu saved to %s, %zu bytes\n", (unsigned long long)snapshot.GetStepCount(),
+			snapshotPath, snapshot.GetSize());
+}
+
+// Puts the world back to the snapshot, after regenerating the terrain it was taken over if that has another seed
+void RestoreSnapshot()
+{
+	// restoring would break the lockstep of the recording
+	if (!snapshot.IsValid() || recorder.IsRecording())
+		return;
+
+	replaying = false;
+	const LockstepSettings& settings = snapshot.GetSettings();
+	LockstepTerrain terrain = simulationSettings.terrain;
+	terrain.seed = settings.terrain.seed;
+	if (memcmp(&terrain, &settings.terrain, sizeof(terrain)) != 0)
+	{
+		printf("%s:%d - snapshot was taken over terrain of another size\n", __FILE__, __LINE__);
+		snapshotPending = false;
+		return;
+	}
+	if (terrainRegenerating || settings.terrain.seed != simulationSettings.terrain.seed)
+	{
+		// restored when the main loop has the terrain
+		if (!terrainRegenerating)
+		{
+			terrainSeed = settings.terrain.seed;
+			m_terrain.CreateFaultFormationAsync(terrainSize, iterations, minHeight, maxHeight, filter, terrainSeed);
+			terrainRegenerating = true;
+		}
+		snapshotPending = true;
+		return;
+	}
+	snapshotPending = false;
+
+	// a simulation with other settings, e.g. from a --snapshot file, is replaced by one with those of the snapshot
+	if (memcmp(&settings, &simulation->GetSettings(), sizeof(LockstepSettings)) != 0)
+	{
+		simulationSettings = settings;
+		simulation = std::make_unique<LockstepSimulation>(simulationSettings, simulationGround);
+	}
+
+	WorldSnapshotView view;
+	if (!snapshot.Restore(*simulation, view))
+		return;
+	aircraftCamera.Position = view.cameraPosition;
+	aircraftCamera.Front = view.cameraFront;
+	aircraftCamera.Up = view.cameraUp;
+	aircraftCamera.Right = view.cameraRight;
+	aircraftCamera.Yaw = view.cameraYaw;
+	aircraftCamera.Pitch = view.cameraPitch;
+	aircraftCamera.Roll = view.cameraRoll;
+	aircraftCamera.Zoom = view.cameraZoom;
+	chaseCamera = view.chaseCamera != 0;
+	joystick = view.controls;
+	simulationClock = physics::FixedTimestep(simulationSettings.stepSize, simulationClock.max_steps());
+	printf("Restored the snapshot of step %llu\n", (unsigned long long)snapshot.GetStepCount());
+}
+
+void InitializeTerrain(FaultFormationTerrain& terrain, float minHeight, float maxHeight);
+void InitTerrainMultiTextures(FaultFormationTerrain& terrain, float minHeight, float maxHeight);
 
 // Main Application
-int main()
+int main(int argc, char** argv)
 {
+	// a replay or a snapshot starts from the settings and terrain it was taken with
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc && replay.Open(argv[++i]))
+		{
+			simulationSettings = replay.GetSettings();
+			UseTerrainSettings(simulationSettings.terrain);
+			initial_position = simulationSettings.startPosition;
+			simulationClock = physics::FixedTimestep(simulationSettings.stepSize, 8 * (int)maxReplaySpeed);
+			replaying = replay.GetEndStep() > replay.GetFirstStep();
+		}
+		else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc && snapshot.Load(argv[++i]))
+		{
+			simulationSettings = snapshot.GetSettings();
+			UseTerrainSettings(simulationSettings.terrain);
+			initial_position = simulationSettings.startPosition;
+			snapshotPending = true;
+		}
+	}
+
+	// the render thread becomes the main thread of the shared job system
+	GetJobSystem();
+
 	InitializeOpenGLState();
 
 	// Initializes the terrain generation.
-	m_terrain = InitializeTerrain(minHeight, maxHeight);
+	InitializeTerrain(m_terrain, minHeight, maxHeight);
 
 	// Initializing skybox.
 	Skybox skybox;
@@ -66,6 +230,17 @@ int main()
 	//load models
 	planeModel = Model(planeModelPath, planeModelVertexShaderPath, planeModelFragmentShaderPath);
 
+	// start in level flight at cruise speed
+	InitializeSimulation();
+	joystick.throttle = simulationSettings.startThrottle;
+	if (replaying && !replay.Seek(*simulation, replay.GetFirstStep()))
+	{
+		printf("%s:%d - replay does not start with a keyframe\n", __FILE__, __LINE__);
+		replaying = false;
+	}
+	if (snapshotPending && !replaying)
+		RestoreSnapshot();
+
 	while (!glfwWindowShouldClose(gameDisplay.GetWindow()))
 	{
 		// Initialize new frame times
@@ -74,11 +249,31 @@ int main()
 		// input
 		processInput(gameDisplay.GetWindow());
 
-		/*plane.update(gameDisplay.DeltaTime());*/
+		simulationClock.advance(gameDisplay.DeltaTime() * (replaying ? replaySpeed : 1.0f), [](float) { StepSimulation(); });
+
+		// GL work handed back by jobs, then stream in a terrain that is being regenerated in the background
+		GetJobSystem().ExecuteMainThreadJobs();
+		m_terrain.UpdateRegeneration();
+		if (terrainRegenerating && !m_terrain.IsRegenerating())
+		{
+			// the simulation flies over the new terrain from here on
+			terrainRegenerating = false;
+			simulationGround.CopyHeightMap(m_terrain.GetHeightMap(), terrainSize, worldScale);
+			simulationSettings.terrain.seed = terrainSeed;
+			simulation->SetTerrain(simulationSettings.terrain);
+
+			// a snapshot waiting for its terrain
+			if (snapshotPending)
+				RestoreSnapshot();
+		}
+		m_terrain.UpdateDetail(aircraftCamera.Position);
 
 		RenderScene(skybox);
 	}
 
+	// the terrain is a global and outlives the job system its background build runs on
+	m_terrain.CancelRegeneration();
+	recorder.Stop();
 	planeModel.DeleteBuffers();
 	skybox.Cleanup();
 	glfwTerminate();
@@ -90,16 +285,35 @@ void RenderScene(Skybox& skybox)
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	const physics::Airplane& plane = simulation->GetPlayer();
+	if (chaseCamera)
+	{
+		float alpha = simulationClock.alpha();
+		glm::quat orientation = plane.get_interpolated_orientation(alpha);
+		aircraftCamera.UpdateFromAircraft(plane.get_interpolated_position(alpha), orientation * physics::FORWARD,
+			orientation * physics::UP, glm::degrees(glm::eulerAngles(orientation).z));
+	}
+
 	// view/projection transformations
 	glm::mat4 viewProjMatrix = aircraftCamera.GetViewProjMatrix();
 
-	// render the loaded model
-	glm::mat4 planeModelMatrix = glm::mat4(1.0f);
-	planeModelMatrix = glm::translate(planeModelMatrix, initial_position);
+	// render the loaded model between the last two physics steps
+	glm::mat4 planeModelMatrix = plane.get_interpolated_transform(simulationClock.alpha());
 	planeModelMatrix = glm::scale(planeModelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
 	planeModelMatrix = glm::rotate(planeModelMatrix, glm::radians(-90.0f), physics::UP);
 	planeModel.Render(planeModelMatrix, aircraftCamera);
 
+	// render the traffic with the same mesh
+	glm::mat4 trafficModelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
+	trafficModelMatrix = glm::rotate(trafficModelMatrix, glm::radians(-90.0f), physics::UP);
+	TrafficSystem& traffic = simulation->GetTraffic();
+	simulation->GetScheduler().GetElapsed(simulation->GetTrafficAlpha(simulationClock.alpha()), trafficElapsed);
+	traffic.ExtrapolateTransforms(trafficElapsed.data(), trafficModelMatrix);
+	for (const glm::mat4& transform : traffic.GetTransforms())
+	{
+		planeModel.Render(transform, aircraftCamera);
+	}
+
 	// render terrain.
 	m_terrain.Render(aircraftCamera);
 
@@ -132,14 +346,110 @@ void InitializeOpenGLState()
 	glEnable(GL_DEPTH_TEST);
 }
 
-FaultFormationTerrain InitializeTerrain(float minHeight, float maxHeight)
+void InitializeSimulation()
+{
+	// the simulation flies over a GL free copy of the rendered terrain
+	simulationSettings.startPosition = initial_position;
+	simulationSettings.terrain = { terrainSize, iterations, minHeight, maxHeight, filter, terrainSeed, worldScale };
+	simulationGround.CopyHeightMap(m_terrain.GetHeightMap(), terrainSize, worldScale);
+	simulation = std::make_unique<LockstepSimulation>(simulationSettings, simulationGround);
+}
+
+// Advances the simulation by one fixed step with the controls or the replayed input, and records it
+void StepSimulation()
+{
+	Joystick input = joystick;
+	const FlightSample* recorded = nullptr;
+	if (replaying)
+	{
+		recorded = replay.GetSample(simulation->GetStepCount());
+		if (recorded)
+		{
+			input = recorded->input;
+		}
+		else
+		{
+			// past the end, or a step that was dropped while recording: the controls take over
+			printf("Replay finished in lockstep at step %llu\n", (unsigned long long)simulation->GetStepCount());
+			replaying = false;
+		}
+	}
+
+	simulation->Step(input);
+
+	// traffic coming close is announced once, when it does
+	bool conflict = !simulation->GetPlayerConflicts().empty();
+	if (conflict && !trafficConflict)
+		printf("Traffic within %.0f m\n", LockstepSimulation::CONFLICT_DISTANCE);
+	trafficConflict = conflict;
+
+	// and so is a terrain alert, when it starts or gets worse
+	TerrainAlert alert = simulation->GetPlayerTerrainAlert();
+	if (alert > terrainAlert)
+		printf(alert == TerrainAlert::Warning ? "Terrain, pull up\n" : "Caution terrain\n");
+	terrainAlert = alert;
+
+	FlightSample sample = FlightRecorder::MakeSample(*simulation, input);
+
+	// the state is compared bit for bit, the first difference is where the lockstep broke
+	if (recorded && (memcmp(&sample.position, &recorded->position, sizeof(glm::vec3)) != 0 ||
+		memcmp(&sample.orientation, &recorded->orientation, sizeof(glm::quat)) != 0 ||
+		memcmp(&sample.velocity, &recorded->velocity, sizeof(glm::vec3)) != 0 ||
+		memcmp(&sample.angularVelocity, &recorded->angularVelocity, sizeof(glm::vec3)) != 0))
+	{
+		printf("%s:%d - replay diverged at step %llu\n", __FILE__, __LINE__, (unsigned long long)sample.step);
+		replaying = false;
+	}
+
+	if (recorder.IsRecording())
+	{
+		recorder.Record(sample);
+		recorder.RecordKeyframe(*simulation);
+	}
+}
+
+// Moves the replay by whole seconds from the current step, within the recording
+void SeekReplay(float seconds)
+{
+	int64_t offset = (int64_t)(seconds / simulationSettings.stepSize);
+	int64_t step = (int64_t)simulation->GetStepCount() + offset;
+	step = std::max(step, (int64_t)replay.GetFirstStep());
+	step = std::min(step, (int64_t)replay.GetEndStep() - 1);
+	if (!replay.Seek(*simulation, (uint64_t)step))
+	{
+		printf("%s:%d - cannot seek the replay to step %lld\n", __FILE__, __LINE__, (long long)step);
+		replaying = false;
+	}
+	simulationClock = physics::FixedTimestep(simulationSettings.stepSize, simulationClock.max_steps());
+}
+
+// Stops the recording in progress, or restarts the simulation and records it from its first step
+void ToggleRecording()
+{
+	if (recorder.IsRecording())
+	{
+		recorder.Stop();
+		FlightRecorderStats stats = recorder.GetStats();
+		printf("Recorded %llu steps and %llu keyframes to %s, %llu bytes, %llu steps dropped\n",
+			(unsigned long long)stats.samples, (unsigned long long)stats.keyframes, recordingPath,
+			(unsigned long long)stats.bytes, (unsigned long long)stats.dropped);
+		return;
+	}
+
+	// the recording starts with a keyframe of the current state, so it can start mid-flight
+	replaying = false;
+	if (recorder.Start(recordingPath, *simulation))
+		printf("Recording to %s\n", recordingPath);
+}
+
+void InitializeTerrain(FaultFormationTerrain& terrain, float minHeight, float maxHeight)
 {
-	FaultFormationTerrain terrain(terrainVertexShaderPath, terrainFragmentShaderPath);
-	FaultFormationTerrain m_terrain = InitTerrainMultiTextures(terrain, minHeight, maxHeight);
-	return terrain;
+	// Build the terrain in place; its heightmap is owned by the terrain and must not be shared between copies.
+	terrain = FaultFormationTerrain(terrainVertexShaderPath, terrainFragmentShaderPath);
+	InitTerrainMultiTextures(terrain, minHeight, maxHeight);
 }
 
-FaultFormationTerrain InitTerrainMultiTextures(FaultFormationTerrain& terrain, float minHeight, float maxHeight)
+void InitTerrainMultiTextures(FaultFormationTerrain& terrain, float minHeight, float maxHeight)
 {
 	std::vector<string> textureFileNames;
 	textureFileNames.push_back(terrainTexture1Path);
@@ -147,8 +457,16 @@ FaultFormationTerrain InitTerrainMultiTextures(FaultFormationTerrain& terrain, f
 	textureFileNames.push_back(terrainTexture3Path);
 	textureFileNames.push_back(terrainTexture4Path);
 	terrain.InitTerrain(worldScale, textureScale, minHeight, maxHeight, textureFileNames);
-	terrain.CreateFaultFormation(terrainSize, iterations, minHeight, maxHeight, filter);
-	return terrain;
+	terrain.CreateFaultFormation(terrainSize, iterations, minHeight, maxHeight, filter, terrainSeed);
+}
+
+// returns true on the frame a key goes down, keyDown remembers it between frames
+bool KeyPressedOnce(GLFWwindow* window, int key, bool& keyDown)
+{
+	bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+	bool once = pressed && !keyDown;
+	keyDown = pressed;
+	return once;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -158,32 +476,82 @@ void processInput(GLFWwindow* window)
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		aircraftCamera.ProcessKeyboard(FORWARD, gameDisplay.DeltaTime());
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		aircraftCamera.ProcessKeyboard(BACKWARD, gameDisplay.DeltaTime());
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		aircraftCamera.ProcessKeyboard(LEFT, gameDisplay.DeltaTime());
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		aircraftCamera.ProcessKeyboard(RIGHT, gameDisplay.DeltaTime());
+	// the free camera only moves when it is not chasing the airplane
+	if (!chaseCamera)
+	{
+		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+			aircraftCamera.ProcessKeyboard(FORWARD, gameDisplay.DeltaTime());
+		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+			aircraftCamera.ProcessKeyboard(BACKWARD, gameDisplay.DeltaTime());
+		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+			aircraftCamera.ProcessKeyboard(LEFT, gameDisplay.DeltaTime());
+		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+			aircraftCamera.ProcessKeyboard(RIGHT, gameDisplay.DeltaTime());
+	}
+
+	// toggle between the chase camera and the free camera, once per key press
+	if (KeyPressedOnce(window, GLFW_KEY_C, chaseCameraKeyDown))
+		chaseCamera = !chaseCamera;
 
-	/*if (glfwJoystickPresent(GLFW_JOYSTICK_1) && glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+	// regenerate the terrain with a new seed in the background, once per key press
+	// but not while recording or replaying, which would break the lockstep
+	if (KeyPressedOnce(window, GLFW_KEY_R, regenerateKeyDown) && !recorder.IsRecording() && !replaying &&
+		!terrainRegenerating)
 	{
-		GLFWgamepadstate gamepadState;
-		if (glfwGetGamepadState(GLFW_JOYSTICK_1, &gamepadState))
-		{
-			float leftAxisX = 0.0f, leftAxisY = 0.0f;;
+		m_terrain.CreateFaultFormationAsync(terrainSize, iterations, minHeight, maxHeight, filter, ++terrainSeed);
+		terrainRegenerating = true;
+	}
 
-			leftAxisX = gamepadState.axes[GLFW_GAMEPAD_AXIS_LEFT_X];
-			leftAxisY = gamepadState.axes[GLFW_GAMEPAD_AXIS_LEFT_Y];
+	// start or stop recording the flight, once per key press
+	if (KeyPressedOnce(window, GLFW_KEY_F5, recordKeyDown))
+		ToggleRecording();
 
-			if (leftAxisX < 0)
-				joystick.leftAileron = leftAxisX;
-			else
-				joystick.rightAileron = leftAxisX;
-			joystick.elevator = leftAxisY;
-		}
-	}*/
+	// capture the world, and go back to it as often as wanted to fly another branch from there
+	if (KeyPressedOnce(window, GLFW_KEY_F6, snapshotKeyDown))
+		CaptureSnapshot();
+	if (KeyPressedOnce(window, GLFW_KEY_F9, restoreKeyDown))
+		RestoreSnapshot();
+
+	// replay speed and seeking, once per key press
+	if (replaying)
+	{
+		if (KeyPressedOnce(window, GLFW_KEY_MINUS, replaySlowerKeyDown))
+			replaySpeed = std::max(replaySpeed * 0.5f, 1.0f);
+		if (KeyPressedOnce(window, GLFW_KEY_EQUAL, replayFasterKeyDown))
+			replaySpeed = std::min(replaySpeed * 2.0f, maxReplaySpeed);
+		if (KeyPressedOnce(window, GLFW_KEY_LEFT_BRACKET, replayBackKeyDown))
+			SeekReplay(-replaySeekSeconds);
+		if (KeyPressedOnce(window, GLFW_KEY_RIGHT_BRACKET, replayForwardKeyDown))
+			SeekReplay(replaySeekSeconds);
+	}
+
+	// flight controls from the gamepad, or from the keyboard when none is connected
+	gamepadConnected = glfwJoystickPresent(GLFW_JOYSTICK_1) && glfwJoystickIsGamepad(GLFW_JOYSTICK_1);
+	GLFWgamepadstate gamepadState;
+	if (gamepadConnected && glfwGetGamepadState(GLFW_JOYSTICK_1, &gamepadState))
+	{
+		float leftAxisX = gamepadState.axes[GLFW_GAMEPAD_AXIS_LEFT_X];
+		float leftAxisY = gamepadState.axes[GLFW_GAMEPAD_AXIS_LEFT_Y];
+
+		joystick.leftAileron = std::min(leftAxisX, 0.0f);
+		joystick.rightAileron = std::max(leftAxisX, 0.0f);
+		joystick.elevator = leftAxisY;
+		joystick.rudder = gamepadState.axes[GLFW_GAMEPAD_AXIS_RIGHT_X];
+	}
+	else
+	{
+		float roll = (float)(glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) - (float)(glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS);
+		joystick.leftAileron = std::min(roll, 0.0f);
+		joystick.rightAileron = std::max(roll, 0.0f);
+		joystick.elevator = (float)(glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) - (float)(glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS);
+		joystick.rudder = (float)(glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) - (float)(glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS);
+	}
+
+	// throttle changes at 50% per second
+	if (glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS)
+		joystick.throttle = std::min(joystick.throttle + 0.5f * gameDisplay.DeltaTime(), 1.0f);
+	if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS)
+		joystick.throttle = std::max(joystick.throttle - 0.5f * gameDisplay.DeltaTime(), 0.0f);
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -0,0 +1,55 @@
+#include "process_memory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <stdio.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+size_t GetPeakResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+size_t GetCurrentResidentBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+#else
+    // The second field of statm is the resident page count.
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+
+    unsigned long pages = 0;
+    unsigned long residentPages = 0;
+    int fields = fscanf(f, "%lu %lu", &pages, &residentPages);
+    fclose(f);
+
+    if (fields != 2)
+        return 0;
+    return (size_t)residentPages * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cmath>
+
+#include "simulation_scheduler.h"
+#include "bit_stream.h"
+
+SimulationScheduler::SimulationScheduler() : SimulationScheduler(Settings())
+{
+}
+
+SimulationScheduler::SimulationScheduler(const Settings& settings) : m_settings(settings)
+{
+    m_settings.levelCount = std::max(1, std::min(m_settings.levelCount, MAX_LEVELS));
+    m_bucketFirst.assign((size_t)1 << (m_settings.levelCount - 1), -1);
+    m_bucketLast.assign(m_bucketFirst.size(), -1);
+}
+
+int SimulationScheduler::Add(float importance)
+{
+    int index = (int)m_entities.size();
+    Entity entity;
+    entity.importance = importance;
+    entity.lastTick = m_tick;
+    m_entities.push_back(entity);
+    m_levelPopulation[0]++;
+
+    Schedule(index, m_tick + 1);
+    return index;
+}
+
+void SimulationScheduler::Remove(int index)
+{
+    if (index < 0 || index >= GetCount())
+        return;
+
+    Unschedule(index);
+    m_levelPopulation[m_entities[index].level]--;
+
+    // The last entity takes over the index, its neighbours in the bucket have to follow.
+    int last = GetCount() - 1;
+    if (index != last)
+    {
+        m_entities[index] = m_entities[last];
+        const Entity& moved = m_entities[index];
+        const size_t bucket = GetBucket(moved.nextTick);
+        (moved.previous >= 0 ? m_entities[moved.previous].next : m_bucketFirst[bucket]) = index;
+        (moved.next >= 0 ? m_entities[moved.next].previous : m_bucketLast[bucket]) = index;
+    }
+    m_entities.pop_back();
+    if (m_rebalanceCursor >= GetCount())
+        m_rebalanceCursor = 0;
+}
+
+void SimulationScheduler::SetImportance(int index, float importance)
+{
+    m_entities[index].importance = importance;
+}
+
+void SimulationScheduler::SetLevel(int index, int level)
+{
+    Entity& entity = m_entities[index];
+    level = std::max(0, std::min(level, m_settings.levelCount - 1));
+    if (level == entity.level)
+        return;
+
+    m_levelPopulation[entity.level]--;
+    m_levelPopulation[level]++;
+    entity.level = level;
+
+    // Sooner if the shorter period is due before the step already scheduled; a longer period starts after it.
+    int64_t tick = AlignedTick(index, std::max(m_tick + 1, entity.lastTick + 1));
+    if (tick < entity.nextTick)
+    {
+        Unschedule(index);
+        Schedule(index, tick);
+    }
+}
+
+int SimulationScheduler::ChooseLevel(const SchedulerView& view, const glm::vec3& position, float importance) const
+{
+    glm::vec3 offset = position - view.position;
+    float distance = glm::length(offset);
+    if (distance > 0.0f && glm::dot(offset, view.front) < view.cosHalfFov * distance)
+        distance *= m_settings.hiddenDistanceScale;
+    distance /= std::max(importance, 1e-3f);
+
+    // Every doubling of the distance beyond the full rate distance halves the rate.
+    if (distance <= m_settings.fullRateDistance)
+        return 0;
+    int level = (int)std::ceil(std::log2(distance / m_settings.fullRateDistance));
+    return std::min(level, m_settings.levelCount - 1);
+}
+
+int SimulationScheduler::Rebalance(const SchedulerView& view, const float* x, const float* y, const float* z,
+    int maxEntities)
+{
+    const int count = GetCount();
+    if (count == 0)
+        return 0;
+
+    int changed = 0;
+    int visits = std::min(maxEntities, count);
+    for (int n = 0; n < visits; n++)
+    {
+        int i = m_rebalanceCursor;
+        m_rebalanceCursor = m_rebalanceCursor + 1 < count ? m_rebalanceCursor + 1 : 0;
+
+        int level = ChooseLevel(view, glm::vec3(x[i], y[i], z[i]), m_entities[i].importance);
+        if (level != m_entities[i].level)
+        {
+            SetLevel(i, level);
+            changed++;
+        }
+    }
+    return changed;
+}
+
+int SimulationScheduler::Tick()
+{
+    m_tick++;
+    m_due.clear();
+    m_dueSteps.clear();
+
+    // Detach the bucket first, entities of the longest period go right back into it.
+    const size_t bucket = GetBucket(m_tick);
+    int index = m_bucketFirst[bucket];
+    m_bucketFirst[bucket] = m_bucketLast[bucket] = -1;
+
+    while (index >= 0)
+    {
+        Entity& entity = m_entities[index];
+        const int next = entity.next;
+        m_due.push_back(index);
+        m_dueSteps.push_back((float)(m_tick - entity.lastTick) * m_settings.tickSeconds);
+        entity.lastTick = m_tick;
+        Schedule(index, AlignedTick(index, m_tick + 1));
+        index = next;
+    }
+    return (int)m_due.size();
+}
+
+void SimulationScheduler::GetElapsed(float alpha, std::vector<float>& elapsed) const
+{
+    elapsed.resize(m_entities.size());
+    for (size_t i = 0; i < m_entities.size(); i++)
+        elapsed[i] = ((float)(m_tick - m_entities[i].lastTick) + alpha) * m_settings.tickSeconds;
+}
+
+float SimulationScheduler::GetStepsPerTick() const
+{
+    float steps = 0.0f;
+    for (int level = 0; level < m_settings.levelCount; level++)
+        steps += m_levelPopulation[level] / (float)(1 << level);
+    return steps;
+}
+
+void SimulationScheduler::WriteState(std::vector<uint8_t>& data) const
+{
+    // The bucket count follows from the settings, which a restored scheduler must share.
+    const int32_t count = GetCount();
+    const int32_t cursor = m_rebalanceCursor;
+    WriteBytes(data, &m_tick, sizeof(m_tick));
+    WriteBytes(data, &cursor, sizeof(cursor));
+    WriteBytes(data, &count, sizeof(count));
+    WriteBytes(data, m_entities.data(), m_entities.size() * sizeof(Entity));
+    WriteBytes(data, m_bucketFirst.data(), m_bucketFirst.size() * sizeof(int));
+    WriteBytes(data, m_bucketLast.data(), m_bucketLast.size() * sizeof(int));
+}
+
+bool SimulationScheduler::ReadState(const uint8_t*& pData, const uint8_t* pEnd)
+{
+    // A count the data can not hold is corrupt, and would allocate before failing.
+    int64_t tick = 0;
+    int32_t cursor = 0, count = 0;
+    if (!ReadBytes(pData, pEnd, &tick, sizeof(tick)) || !ReadBytes(pData, pEnd, &cursor, sizeof(cursor)) ||
+        !ReadBytes(pData, pEnd, &count, sizeof(count)) || count < 0 ||
+        (size_t)count > (size_t)(pEnd - pData) / sizeof(Entity))
+    {
+        *this = SimulationScheduler(m_settings);
+        return false;
+    }
+
+    // Within the capacity of the entity array this allocates nothing, the buckets never change size.
+    m_entities.resize(count);
+    if (!ReadBytes(pData, pEnd, m_entities.data(), m_entities.size() * sizeof(Entity)) ||
+        !ReadBytes(pData, pEnd, m_bucketFirst.data(), m_bucketFirst.size() * sizeof(int)) ||
+        !ReadBytes(pData, pEnd, m_bucketLast.data(), m_bucketLast.size() * sizeof(int)))
+    {
+        *this = SimulationScheduler(m_settings);
+        return false;
+    }
+
+    // Every entity must be in the bucket of its next tick exactly once, with links that agree both ways.
+    std::fill(m_levelPopulation, m_levelPopulation + MAX_LEVELS, 0);
+    int listed = 0;
+    bool valid = true;
+    for (size_t bucket = 0; bucket < m_bucketFirst.size() && valid; bucket++)
+    {
+        int previous = -1;
+        int index = m_bucketFirst[bucket];
+        while (valid && index >= 0)
+        {
+            valid = index < count && ++listed <= count && m_entities[index].previous == previous;
+            if (!valid)
+                break;
+
+            const Entity& entity = m_entities[index];
+            valid = entity.next >= -1 && GetBucket(entity.nextTick) == bucket && entity.level >= 0 &&
+                entity.level < m_settings.levelCount;
+            if (valid)
+                m_levelPopulation[entity.level]++;
+            previous = index;
+            index = entity.next;
+        }
+        valid = valid && index == -1 && m_bucketLast[bucket] == previous;
+    }
+    if (!valid || listed != count)
+    {
+        *this = SimulationScheduler(m_settings);
+        return false;
+    }
+
+    m_tick = tick;
+    m_rebalanceCursor = (cursor >= 0 && cursor < count) ? cursor : 0;
+    return true;
+}
+
+void SimulationScheduler::Schedule(int index, int64_t tick)
+{
+    Entity& entity = m_entities[index];
+    const size_t bucket = GetBucket(tick);
+    entity.nextTick = tick;
+    entity.previous = m_bucketLast[bucket];
+    entity.next = -1;
+    (entity.previous >= 0 ? m_entities[entity.previous].next : m_bucketFirst[bucket]) = index;
+    m_bucketLast[bucket] = index;
+}
+
+void SimulationScheduler::Unschedule(int index)
+{
+    const Entity& entity = m_entities[index];
+    const size_t bucket = GetBucket(entity.nextTick);
+    (entity.previous >= 0 ? m_entities[entity.previous].next : m_bucketFirst[bucket]) = entity.next;
+    (entity.next >= 0 ? m_entities[entity.next].previous : m_bucketLast[bucket]) = entity.previous;
+}
+
+int64_t SimulationScheduler::AlignedTick(int index, int64_t from) const
+{
+    const int64_t mask = ((int64_t)1 << m_entities[index].level) - 1;
+    return from + ((index - from) & mask);
+}
@@ -5,11 +5,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <cerrno>
+#include <algorithm>
 #include <glm/glm.hpp>
 
 #include "utils.h"
 #include "constants.h"
 #include "terrain.h"
+#include "terrain_database.h"
 #include "texture_config.h"
 #include "utils.h"
 
@@ -22,6 +24,38 @@ void BaseTerrain::LoadFromFile(const char* pFilename)
     // Create a terrain grid using the terrain size and this terrain instance.
     // The grid is used for rendering the terrain.
     m_terrainGrid.CreateTerrainGrid(m_terrainSize, m_terrainSize, this);
+
+    BakeLighting();
+    m_detail.Clear();
+}
+
+// Loads a level of a memory-mapped terrain database
+bool BaseTerrain::LoadFromDatabase(const char* pFilename, int level)
+{
+    TerrainDatabase database;
+    if (!database.Open(pFilename))
+    {
+        printf("%s:%d - %s is not a valid terrain database\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    if (level < 0 || level >= database.GetLevelCount())
+    {
+        printf("%s:%d - %s has no level %d\n", __FILE__, __LINE__, pFilename, level);
+        return false;
+    }
+
+    // Only the tiles of the requested level are paged in from the mapping.
+    database.ReadLevel(level, *m_heightMap, m_terrainSize);
+    m_worldScale = database.GetLevel(level).postSpacing;
+    m_minHeight = database.GetHeader().minHeight;
+    m_maxHeight = database.GetHeader().maxHeight;
+
+    m_terrainGrid.CreateTerrainGrid(m_terrainSize, m_terrainSize, this);
+
+    BakeLighting();
+    m_detail.Clear();
+    return true;
 }
 
 // Initializes the terrain with world and texture scales and multiple textures
@@ -111,7 +145,95 @@ void BaseTerrain::LoadHeightMapFile(const char* pFilename)
     m_terrainSize = sqrtf(FileSize / sizeof(float));
 
     // Initialize the heightmap array with data read from the file.
-    m_heightMap.InitArray2D(m_terrainSize, m_terrainSize, p);
+    m_heightMap->InitArray2D(m_terrainSize, m_terrainSize, p);
+}
+
+// Starts building a replacement terrain in the background
+void BaseTerrain::BeginRegeneration(int terrainSize, float minHeight, float maxHeight, TerrainRegenerator::GenerateFunc generate)
+{
+    m_regenerator.Start(terrainSize, m_worldScale, m_textureScale, minHeight, maxHeight, m_sunDirection, std::move(generate));
+}
+
+// Advances the background regeneration and swaps the new terrain in once it is ready
+void BaseTerrain::UpdateRegeneration()
+{
+    if (!m_regenerator.Update(m_terrainGrid, terrainUploadBytesPerFrame, terrainUploadMillisecondsPerFrame))
+        return;
+
+    // Heightmap, size, height range and GPU mesh change together between two frames, so physics queries and
+    // rendering never see a mix of the old and the new terrain.
+    TerrainRegenerator::Result result = m_regenerator.TakeResult();
+    m_heightMap = std::move(result.heightMap);
+    m_terrainSize = result.terrainSize;
+    m_minHeight = result.minHeight;
+    m_maxHeight = result.maxHeight;
+    m_lighting = std::move(result.lighting);
+    m_terrainGrid.SwapStagedBuffers();
+
+    // Cached detail patches were refined from the old heightmap.
+    m_detail.Clear();
+
+    // The lighting was baked for the sun direction at the time of the request.
+    m_lighting.UpdateSun(*m_heightMap, m_sunDirection);
+    UploadLightingTexture();
+}
+
+// Refines the patches around the camera
+void BaseTerrain::UpdateDetail(const glm::vec3& cameraPosition)
+{
+    m_detail.Update(*m_heightMap, m_terrainSize, m_worldScale, m_textureScale, cameraPosition);
+}
+
+// Retrieves the height of the rendered surface, refined or not, at a world position
+float BaseTerrain::GetDetailedHeight(float worldX, float worldZ) const
+{
+    float height;
+    if (m_detail.GetHeight(worldX, worldZ, height))
+        return height;
+
+    float x = std::clamp(worldX / m_worldScale, 0.0f, (float)(m_terrainSize - 1));
+    float z = std::clamp(worldZ / m_worldScale, 0.0f, (float)(m_terrainSize - 1));
+    return TerrainDetail::SynthesizeHeight(*m_heightMap, m_terrainSize, m_worldScale, x, z, 0.0f);
+}
+
+// Bakes the lighting of the current heightmap and uploads it
+void BaseTerrain::BakeLighting()
+{
+    m_lighting.Bake(*m_heightMap, m_terrainSize, m_worldScale, m_sunDirection);
+    UploadLightingTexture();
+}
+
+// Updates the sun term of the baked lighting
+void BaseTerrain::SetSunDirection(const glm::vec3& sunDirection)
+{
+    m_sunDirection = glm::normalize(sunDirection);
+
+    if (m_lighting.UpdateSun(*m_heightMap, m_sunDirection))
+        UploadLightingTexture();
+}
+
+// Uploads the baked lighting texels into the lighting texture
+void BaseTerrain::UploadLightingTexture()
+{
+    if (!m_lighting.IsBaked())
+        return;
+
+    if (m_lightingTexture == 0)
+        glGenTextures(1, &m_lightingTexture);
+
+    int size = m_lighting.GetSize();
+    glBindTexture(GL_TEXTURE_2D, m_lightingTexture);
+
+    // Rows of two byte texels are not necessarily 4 byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, size, size, 0, GL_RG, GL_UNSIGNED_BYTE, m_lighting.GetTexels().data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 // Renders the terrain using the provided camera
@@ -128,6 +250,16 @@ void BaseTerrain::Render(Camera& camera)
     terrainShader.setInt("gTextureHeight2", 2);
     terrainShader.setInt("gTextureHeight3", 3);
 
+    // Baked lighting is looked up per post: post x sits at texel center (x + 0.5) / size.
+    terrainShader.setInt("gLightingMap", LIGHTING_TEXTURE_UNIT_INDEX);
+    terrainShader.setBool("gUseBakedLighting", m_lightingTexture != 0);
+    if (m_lightingTexture != 0)
+    {
+        float lightingSize = (float)m_lighting.GetSize();
+        terrainShader.setFloat("gLightingScale", 1.0f / (m_worldScale * lightingSize));
+        terrainShader.setFloat("gLightingOffset", 0.5f / lightingSize);
+    }
+
     // Set texture heights and min/max heights for the shader.
     SetTextureHeights((m_maxHeight - m_minHeight) / MAX_TEXTURES, (m_maxHeight - m_minHeight) / 2,
         3 * (m_maxHeight - m_minHeight) / 4, m_maxHeight - m_minHeight);
@@ -142,9 +274,24 @@ void BaseTerrain::Render(Camera& camera)
         }
     }
 
+    if (m_lightingTexture != 0)
+    {
+        glActiveTexture(LIGHTING_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, m_lightingTexture);
+    }
+
+    // The base terrain leaves out the region covered by refined patches, which are drawn right after it.
+    glm::vec4 detailRegion;
+    if (!m_detail.GetActiveRegion(detailRegion))
+        detailRegion = glm::vec4(0.0f);
+    terrainShader.setVec4("gDetailRegion", detailRegion);
+
     // Render the terrain triangle list.
     m_terrainGrid.Render();
 
+    terrainShader.setVec4("gDetailRegion", glm::vec4(0.0f));
+    m_detail.Render();
+
     glBindVertexArray(0);
 }
 
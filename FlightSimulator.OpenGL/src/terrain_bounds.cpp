@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+
+#include "terrain_bounds.h"
+#include "job_system.h"
+#include "parallel.h"
+
+// Entities per contact job, the results of a job are appended in order.
+static const int CONTACT_CHUNK = 256;
+
+void TerrainBounds::Build(const HeightField& ground, int postsPerCell)
+{
+    const int postsX = ground.GetPostsX();
+    const int postsZ = ground.GetPostsZ();
+    postsPerCell = std::max(postsPerCell, 1);
+    m_cellSize = postsPerCell * ground.GetPostSpacing();
+    m_extentX = std::max(postsX - 1, 0) * ground.GetPostSpacing();
+    m_extentZ = std::max(postsZ - 1, 0) * ground.GetPostSpacing();
+    m_outsideHeight = ground.GetPostHeight(-1, -1);
+
+    // Nothing loaded, the ground is flat at 0
+    if (postsX < 2 || postsZ < 2)
+    {
+        m_cellsX = m_cellsZ = 1;
+        m_cells.assign(1, { m_outsideHeight, m_outsideHeight });
+        m_maxHeight = m_outsideHeight;
+        return;
+    }
+
+    // Neighbouring cells share their border posts, every interpolated height lies within one cell.
+    m_cellsX = (postsX - 2) / postsPerCell + 1;
+    m_cellsZ = (postsZ - 2) / postsPerCell + 1;
+    m_cells.resize((size_t)m_cellsX * m_cellsZ);
+    ParallelForRange(0, m_cellsZ, [&](int firstRow, int lastRow) {
+        for (int cz = firstRow; cz < lastRow; cz++)
+        {
+            const int z0 = cz * postsPerCell, z1 = std::min(z0 + postsPerCell, postsZ - 1);
+            for (int cx = 0; cx < m_cellsX; cx++)
+            {
+                const int x0 = cx * postsPerCell, x1 = std::min(x0 + postsPerCell, postsX - 1);
+                Cell cell = { INFINITY, -INFINITY };
+                for (int z = z0; z <= z1; z++)
+                {
+                    for (int x = x0; x <= x1; x++)
+                    {
+                        float height = ground.GetPostHeight(x, z);
+                        cell.minHeight = std::min(cell.minHeight, height);
+                        cell.maxHeight = std::max(cell.maxHeight, height);
+                    }
+                }
+                m_cells[(size_t)cz * m_cellsX + cx] = cell;
+            }
+        }
+    });
+
+    m_maxHeight = m_outsideHeight;
+    for (const Cell& cell : m_cells)
+        m_maxHeight = std::max(m_maxHeight, cell.maxHeight);
+}
+
+void TerrainBounds::GetBounds(float minX, float minZ, float maxX, float maxZ, float& minHeight,
+    float& maxHeight) const
+{
+    // Cells beyond the edge clamp to it, like the heights do
+    const float inverseCellSize = 1.0f / m_cellSize;
+    const int cx0 = std::clamp((int)std::floor(minX * inverseCellSize), 0, m_cellsX - 1);
+    const int cx1 = std::clamp((int)std::floor(maxX * inverseCellSize), 0, m_cellsX - 1);
+    const int cz0 = std::clamp((int)std::floor(minZ * inverseCellSize), 0, m_cellsZ - 1);
+    const int cz1 = std::clamp((int)std::floor(maxZ * inverseCellSize), 0, m_cellsZ - 1);
+
+    minHeight = INFINITY;
+    maxHeight = -INFINITY;
+    for (int cz = cz0; cz <= cz1; cz++)
+    {
+        const Cell* row = m_cells.data() + (size_t)cz * m_cellsX;
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            minHeight = std::min(minHeight, row[cx].minHeight);
+            maxHeight = std::max(maxHeight, row[cx].maxHeight);
+        }
+    }
+
+    if (minX < 0.0f || minZ < 0.0f || maxX > m_extentX || maxZ > m_extentZ)
+    {
+        minHeight = std::min(minHeight, m_outsideHeight);
+        maxHeight = std::max(maxHeight, m_outsideHeight);
+    }
+}
+
+int TerrainBounds::FindContacts(const float* x, const float* y, const float* z, const float* radius, int count,
+    float margin, const HeightField& ground, std::vector<TerrainContact>& contacts) const
+{
+    contacts.clear();
+    if (count <= 0)
+        return 0;
+
+    // One result list per chunk, so the contacts come out in entity order whatever thread ran which chunk.
+    const int chunkCount = (count + CONTACT_CHUNK - 1) / CONTACT_CHUNK;
+    std::vector<std::vector<TerrainContact>> chunkContacts(chunkCount);
+    std::vector<int> chunkSamples(chunkCount, 0);
+    auto findChunk = [&](int first, int last) {
+        const int chunk = first / CONTACT_CHUNK;
+        int samples = 0;
+        for (int i = first; i < last; i++)
+        {
+            const float r = radius ? radius[i] : 0.0f;
+            float minHeight, maxHeight;
+            GetBounds(x[i] - r, z[i] - r, x[i] + r, z[i] + r, minHeight, maxHeight);
+            const float bottom = y[i] - r;
+            if (bottom - maxHeight >= margin)
+                continue;
+
+            // Near the ground: the exact height under the centre decides
+            samples++;
+            const float clearance = bottom - ground.GetHeight(x[i], z[i]);
+            if (clearance < margin)
+                chunkContacts[chunk].push_back({ i, clearance });
+        }
+        chunkSamples[chunk] = samples;
+    };
+    if (chunkCount == 1)
+    {
+        findChunk(0, count);
+    }
+    else
+    {
+        JobSystem& jobs = GetJobSystem();
+        jobs.Wait(jobs.ParallelFor(0, count, CONTACT_CHUNK, findChunk));
+    }
+
+    int samples = 0;
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        contacts.insert(contacts.end(), chunkContacts[chunk].begin(), chunkContacts[chunk].end());
+        samples += chunkSamples[chunk];
+    }
+    return samples;
+}
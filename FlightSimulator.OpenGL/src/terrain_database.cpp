@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "terrain_database.h"
+
+bool TerrainDatabase::Open(const char* pFilename)
+{
+    Close();
+
+    if (!m_file.Open(pFilename))
+        return false;
+
+    const uint8_t* data = m_file.GetData();
+    const uint64_t size = m_file.GetSize();
+    if (size < sizeof(TerrainDatabaseHeader))
+    {
+        Close();
+        return false;
+    }
+
+    const TerrainDatabaseHeader* header = reinterpret_cast<const TerrainDatabaseHeader*>(data);
+    if (memcmp(header->magic, TERRAIN_DATABASE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TERRAIN_DATABASE_VERSION || header->tileSize < 2 || header->levelCount == 0)
+    {
+        Close();
+        return false;
+    }
+
+    // The tables must lie inside the file, and so must every tile they reference.
+    if (header->levelTableOffset < sizeof(TerrainDatabaseHeader) || header->levelTableOffset > size ||
+        (size - header->levelTableOffset) / sizeof(TerrainDatabaseLevel) < header->levelCount)
+    {
+        Close();
+        return false;
+    }
+
+    // Every level must follow the previous one in the tile table and its posts must fit in its tiles.
+    const TerrainDatabaseLevel* levels = reinterpret_cast<const TerrainDatabaseLevel*>(data + header->levelTableOffset);
+    const uint64_t tileCells = header->tileSize - 1;
+    uint64_t tileCount = 0;
+    for (uint32_t level = 0; level < header->levelCount; level++)
+    {
+        const TerrainDatabaseLevel& info = levels[level];
+        if (info.firstTile != tileCount || info.tilesX == 0 || info.tilesZ == 0 || info.postsX == 0 ||
+            info.postsZ == 0 || info.postsX > info.tilesX * tileCells + 1 || info.postsZ > info.tilesZ * tileCells + 1 ||
+            !(info.postSpacing > 0.0f))
+        {
+            Close();
+            return false;
+        }
+        tileCount += (uint64_t)info.tilesX * info.tilesZ;
+    }
+
+    if (header->tileTableOffset < sizeof(TerrainDatabaseHeader) || header->tileTableOffset > size ||
+        (size - header->tileTableOffset) / sizeof(TerrainDatabaseTile) < tileCount)
+    {
+        Close();
+        return false;
+    }
+
+    const TerrainDatabaseTile* tiles = reinterpret_cast<const TerrainDatabaseTile*>(data + header->tileTableOffset);
+    const uint64_t tilePosts = (uint64_t)header->tileSize * header->tileSize;
+    const uint64_t tileBytes = tilePosts * sizeof(float);
+    for (uint64_t i = 0; i < tileCount; i++)
+    {
+        if (tiles[i].offset != 0 && (tilePosts > size / sizeof(float) || tiles[i].offset > size - tileBytes))
+        {
+            Close();
+            return false;
+        }
+    }
+
+    m_header = header;
+    m_levels = levels;
+    m_tiles = tiles;
+    return true;
+}
+
+void TerrainDatabase::Close()
+{
+    m_file.Close();
+    m_header = nullptr;
+    m_levels = nullptr;
+    m_tiles = nullptr;
+}
+
+const TerrainDatabaseTile& TerrainDatabase::GetTileInfo(int level, int tileX, int tileZ) const
+{
+    const TerrainDatabaseLevel& info = m_levels[level];
+    return m_tiles[info.firstTile + (uint64_t)tileZ * info.tilesX + tileX];
+}
+
+const float* TerrainDatabase::GetTile(int level, int tileX, int tileZ) const
+{
+    const TerrainDatabaseLevel& info = m_levels[level];
+    if (tileX < 0 || tileZ < 0 || tileX >= (int)info.tilesX || tileZ >= (int)info.tilesZ)
+        return nullptr;
+
+    const TerrainDatabaseTile& tile = GetTileInfo(level, tileX, tileZ);
+    if (tile.offset == 0)
+        return nullptr;
+
+    return reinterpret_cast<const float*>(m_file.GetData() + tile.offset);
+}
+
+float TerrainDatabase::GetPostHeight(int level, int x, int z) const
+{
+    const int tileCells = (int)m_header->tileSize - 1;
+
+    // The last post of a tile is shared with the next one, so posts on a border resolve to the lower tile.
+    int tileX = std::min(x / tileCells, (int)m_levels[level].tilesX - 1);
+    int tileZ = std::min(z / tileCells, (int)m_levels[level].tilesZ - 1);
+    const float* tile = (x >= 0 && z >= 0) ? GetTile(level, tileX, tileZ) : nullptr;
+
+    int localX = x - tileX * tileCells;
+    int localZ = z - tileZ * tileCells;
+    if (!tile || localX > tileCells || localZ > tileCells)
+        return m_header->noDataHeight;
+
+    return tile[localZ * m_header->tileSize + localX];
+}
+
+float TerrainDatabase::GetHeight(int level, float x, float z) const
+{
+    const float spacing = m_levels[level].postSpacing;
+    float fx = x / spacing;
+    float fz = z / spacing;
+    int ix = (int)std::floor(fx);
+    int iz = (int)std::floor(fz);
+    float u = fx - ix;
+    float v = fz - iz;
+
+    float h00 = GetPostHeight(level, ix, iz);
+    float h10 = GetPostHeight(level, ix + 1, iz);
+    float h01 = GetPostHeight(level, ix, iz + 1);
+    float h11 = GetPostHeight(level, ix + 1, iz + 1);
+
+    float h0 = h00 + (h10 - h00) * u;
+    float h1 = h01 + (h11 - h01) * u;
+    return h0 + (h1 - h0) * v;
+}
+
+void TerrainDatabase::ReadLevel(int level, Array2D<float>& heightMap, int& size) const
+{
+    const TerrainDatabaseLevel& info = m_levels[level];
+    const int tileSize = (int)m_header->tileSize;
+    const int tileCells = tileSize - 1;
+
+    size = (int)std::max(info.tilesX, info.tilesZ) * tileCells + 1;
+    heightMap.InitArray2D(size, size, m_header->noDataHeight);
+
+    // Copy tile rows straight out of the mapping.
+    for (int tileZ = 0; tileZ < (int)info.tilesZ; tileZ++)
+        for (int tileX = 0; tileX < (int)info.tilesX; tileX++)
+        {
+            const float* tile = GetTile(level, tileX, tileZ);
+            if (!tile)
+                continue;
+
+            for (int z = 0; z < tileSize; z++)
+            {
+                float* dst = heightMap.GetBaseAddr() + (size_t)(tileZ * tileCells + z) * size + tileX * tileCells;
+                memcpy(dst, tile + (size_t)z * tileSize, tileSize * sizeof(float));
+            }
+        }
+}
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cmath>
+
+#include "terrain_detail.h"
+#include "terrain_grid.h"
+#include "parallel.h"
+
+// Seed of the detail noise. Fixed, so the same heightmap always refines to the same surface.
+static constexpr unsigned int DETAIL_NOISE_SEED = 0x9E3779B9u;
+
+// Detail amplitude relative to the heightmap post spacing.
+static constexpr float DETAIL_AMPLITUDE_SCALE = 0.1f;
+
+// Pseudo random value in [-1, 1] for an integer lattice point.
+static float LatticeValue(int x, int z)
+{
+    unsigned int h = (unsigned int)x * 374761393u + (unsigned int)z * 668265263u + DETAIL_NOISE_SEED;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+    return (float)(h & 0xFFFFFF) / (float)0xFFFFFF * 2.0f - 1.0f;
+}
+
+// Smoothly interpolated value noise.
+static float ValueNoise(float x, float z)
+{
+    int ix = (int)std::floor(x);
+    int iz = (int)std::floor(z);
+    float u = x - ix;
+    float v = z - iz;
+    u = u * u * (3.0f - 2.0f * u);
+    v = v * v * (3.0f - 2.0f * v);
+
+    float a = LatticeValue(ix, iz) + (LatticeValue(ix + 1, iz) - LatticeValue(ix, iz)) * u;
+    float b = LatticeValue(ix, iz + 1) + (LatticeValue(ix + 1, iz + 1) - LatticeValue(ix, iz + 1)) * u;
+    return a + (b - a) * v;
+}
+
+// Catmull-Rom spline through p1 and p2.
+static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+{
+    return p1 + 0.5f * t * (p2 - p0 + t * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 + t * (3.0f * (p1 - p2) + p3 - p0)));
+}
+
+float TerrainDetail::SynthesizeHeight(const Array2D<float>& heightMap, int terrainSize, float worldScale, float x, float z,
+    float borderWeight)
+{
+    int ix = std::clamp((int)std::floor(x), 0, terrainSize - 2);
+    int iz = std::clamp((int)std::floor(z), 0, terrainSize - 2);
+    float u = std::clamp(x - ix, 0.0f, 1.0f);
+    float v = std::clamp(z - iz, 0.0f, 1.0f);
+
+    // Height of the base mesh, matching the triangle split used by TerrainGrid.
+    float h00 = heightMap.Get(ix, iz);
+    float h10 = heightMap.Get(ix + 1, iz);
+    float h01 = heightMap.Get(ix, iz + 1);
+    float h11 = heightMap.Get(ix + 1, iz + 1);
+    float baseHeight = (v >= u) ? h00 + v * (h01 - h00) + u * (h11 - h01)
+                                : h00 + u * (h10 - h00) + v * (h11 - h10);
+
+    if (borderWeight <= 0.0f)
+        return baseHeight;
+
+    // Bicubic upsampling of the surrounding 4x4 posts.
+    float rows[4];
+    for (int j = 0; j < 4; j++)
+    {
+        int row = std::clamp(iz + j - 1, 0, terrainSize - 1);
+        rows[j] = CatmullRom(heightMap.Get(std::max(ix - 1, 0), row), heightMap.Get(ix, row),
+            heightMap.Get(ix + 1, row), heightMap.Get(std::min(ix + 2, terrainSize - 1), row), u);
+    }
+    float smoothHeight = CatmullRom(rows[0], rows[1], rows[2], rows[3], v);
+
+    // Three octaves of noise below the post spacing. Steep terrain gets rougher detail than flat terrain.
+    float slope = std::sqrt((h10 - h00) * (h10 - h00) + (h01 - h00) * (h01 - h00)) / worldScale;
+    float amplitude = DETAIL_AMPLITUDE_SCALE * worldScale * (0.3f + std::min(slope, 1.0f));
+    float noise = ValueNoise(x * 2.0f, z * 2.0f) + 0.5f * ValueNoise(x * 4.0f, z * 4.0f) + 0.25f * ValueNoise(x * 8.0f, z * 8.0f);
+
+    float detailHeight = smoothHeight + amplitude * noise;
+    return baseHeight + (detailHeight - baseHeight) * borderWeight;
+}
+
+void TerrainDetail::SynthesizePatch(const Array2D<float>& heightMap, int terrainSize, float worldScale, Patch& patch)
+{
+    patch.heights.resize(PATCH_POSTS * PATCH_POSTS);
+
+    const float originX = (float)(patch.patchX * PATCH_CELLS);
+    const float originZ = (float)(patch.patchZ * PATCH_CELLS);
+
+    for (int j = 0; j < PATCH_POSTS; j++)
+        for (int i = 0; i < PATCH_POSTS; i++)
+        {
+            // Fade the detail out over the outermost heightmap cell so the patch border equals the base mesh.
+            float borderDistance = (float)std::min(std::min(i, j), std::min(PATCH_POSTS - 1 - i, PATCH_POSTS - 1 - j)) / REFINEMENT;
+            float t = std::min(borderDistance, 1.0f);
+            float borderWeight = t * t * (3.0f - 2.0f * t);
+
+            float x = originX + (float)i / REFINEMENT;
+            float z = originZ + (float)j / REFINEMENT;
+            patch.heights[j * PATCH_POSTS + i] = SynthesizeHeight(heightMap, terrainSize, worldScale, x, z, borderWeight);
+        }
+}
+
+void TerrainDetail::Update(const Array2D<float>& heightMap, int terrainSize, float worldScale, float textureScale,
+    const glm::vec3& cameraPosition)
+{
+    m_worldScale = worldScale;
+    m_active.clear();
+    m_regionValid = false;
+
+    // Only whole patches are refined; a partial strip at the far edges keeps the base resolution.
+    const int numPatches = (terrainSize - 1) / PATCH_CELLS;
+    if (numPatches <= 0)
+        return;
+
+    if (m_ib == 0)
+        CreateSharedIndexBuffer();
+
+    const float patchWorldSize = worldScale * PATCH_CELLS;
+    const int cameraPatchX = (int)std::floor(cameraPosition.x / patchWorldSize);
+    const int cameraPatchZ = (int)std::floor(cameraPosition.z / patchWorldSize);
+    const int minX = std::max(0, cameraPatchX - ACTIVE_RADIUS);
+    const int maxX = std::min(numPatches - 1, cameraPatchX + ACTIVE_RADIUS);
+    const int minZ = std::max(0, cameraPatchZ - ACTIVE_RADIUS);
+    const int maxZ = std::min(numPatches - 1, cameraPatchZ + ACTIVE_RADIUS);
+    if (minX > maxX || minZ > maxZ)
+        return;
+
+    // Synthesize the missing patches nearest to the camera first, a bounded number per frame.
+    std::vector<std::unique_ptr<Patch>> builds;
+    for (int patchZ = minZ; patchZ <= maxZ; patchZ++)
+        for (int patchX = minX; patchX <= maxX; patchX++)
+        {
+            if (m_patches.count(PatchKey(patchX, patchZ)) == 0)
+            {
+                builds.push_back(std::make_unique<Patch>());
+                builds.back()->patchX = patchX;
+                builds.back()->patchZ = patchZ;
+            }
+        }
+
+    std::sort(builds.begin(), builds.end(), [&](const std::unique_ptr<Patch>& a, const std::unique_ptr<Patch>& b) {
+        int distanceA = std::max(std::abs(a->patchX - cameraPatchX), std::abs(a->patchZ - cameraPatchZ));
+        int distanceB = std::max(std::abs(b->patchX - cameraPatchX), std::abs(b->patchZ - cameraPatchZ));
+        return distanceA < distanceB;
+    });
+    if ((int)builds.size() > MAX_BUILDS_PER_FRAME)
+        builds.resize(MAX_BUILDS_PER_FRAME);
+
+    ParallelForRange(0, (int)builds.size(), [&](int first, int last) {
+        for (int i = first; i < last; i++)
+            SynthesizePatch(heightMap, terrainSize, worldScale, *builds[i]);
+    });
+
+    for (auto& patch : builds)
+    {
+        UploadPatch(*patch, worldScale, textureScale, terrainSize);
+        long long key = PatchKey(patch->patchX, patch->patchZ);
+        m_lru.push_front(std::move(patch));
+        m_patches[key] = m_lru.begin();
+    }
+
+    // Mark the active patches as most recently used.
+    bool complete = true;
+    for (int patchZ = minZ; patchZ <= maxZ; patchZ++)
+        for (int patchX = minX; patchX <= maxX; patchX++)
+        {
+            auto it = m_patches.find(PatchKey(patchX, patchZ));
+            if (it == m_patches.end())
+            {
+                complete = false;
+                continue;
+            }
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            m_active.push_back(it->second->get());
+        }
+
+    // Evict the least recently used patches and keep their GL objects for reuse.
+    while ((int)m_lru.size() > CACHE_CAPACITY)
+    {
+        Patch& patch = *m_lru.back();
+        m_freeVaos.push_back(patch.vao);
+        m_freeVbs.push_back(patch.vb);
+        m_patches.erase(PatchKey(patch.patchX, patch.patchZ));
+        m_lru.pop_back();
+    }
+
+    // Until every active patch is refined the base terrain is drawn everywhere, so nothing is drawn twice.
+    if (!complete)
+    {
+        m_active.clear();
+        return;
+    }
+
+    m_regionValid = true;
+    m_region = glm::vec4(minX * patchWorldSize, minZ * patchWorldSize, (maxX + 1) * patchWorldSize, (maxZ + 1) * patchWorldSize);
+}
+
+void TerrainDetail::UploadPatch(Patch& patch, float worldScale, float textureScale, int terrainSize)
+{
+    std::vector<TerrainGrid::Vertex> vertices(PATCH_POSTS * PATCH_POSTS);
+    for (int j = 0; j < PATCH_POSTS; j++)
+        for (int i = 0; i < PATCH_POSTS; i++)
+        {
+            float x = patch.patchX * PATCH_CELLS + (float)i / REFINEMENT;
+            float z = patch.patchZ * PATCH_CELLS + (float)j / REFINEMENT;
+            TerrainGrid::Vertex& vertex = vertices[j * PATCH_POSTS + i];
+            vertex.pos = glm::fvec3(worldScale * x, patch.heights[j * PATCH_POSTS + i], worldScale * z);
+            vertex.tex = glm::fvec2(textureScale * x / (float)terrainSize, textureScale * z / (float)terrainSize);
+        }
+
+    const GLsizeiptr vertexBytes = sizeof(vertices[0]) * vertices.size();
+    if (!m_freeVaos.empty())
+    {
+        // All patches have the same size, so the buffers of an evicted patch can simply be overwritten.
+        patch.vao = m_freeVaos.back();
+        patch.vb = m_freeVbs.back();
+        m_freeVaos.pop_back();
+        m_freeVbs.pop_back();
+        glBindBuffer(GL_ARRAY_BUFFER, patch.vb);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    glGenVertexArrays(1, &patch.vao);
+    glBindVertexArray(patch.vao);
+
+    glGenBuffers(1, &patch.vb);
+    glBindBuffer(GL_ARRAY_BUFFER, patch.vb);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    TerrainGrid::SetupVertexAttributes();
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TerrainDetail::CreateSharedIndexBuffer()
+{
+    // Same topology and diagonal as TerrainGrid; PATCH_POSTS^2 vertices fit into 16 bit indices.
+    std::vector<unsigned short> indices;
+    indices.reserve((PATCH_POSTS - 1) * (PATCH_POSTS - 1) * 6);
+    for (int z = 0; z < PATCH_POSTS - 1; z++)
+        for (int x = 0; x < PATCH_POSTS - 1; x++)
+        {
+            unsigned short indexBottomLeft = (unsigned short)(z * PATCH_POSTS + x);
+            unsigned short indexTopLeft = (unsigned short)((z + 1) * PATCH_POSTS + x);
+            unsigned short indexTopRight = (unsigned short)((z + 1) * PATCH_POSTS + x + 1);
+            unsigned short indexBottomRight = (unsigned short)(z * PATCH_POSTS + x + 1);
+
+            indices.push_back(indexBottomLeft);
+            indices.push_back(indexTopLeft);
+            indices.push_back(indexTopRight);
+
+            indices.push_back(indexBottomLeft);
+            indices.push_back(indexTopRight);
+            indices.push_back(indexBottomRight);
+        }
+
+    glGenBuffers(1, &m_ib);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void TerrainDetail::Render()
+{
+    const GLsizei indexCount = (PATCH_POSTS - 1) * (PATCH_POSTS - 1) * 6;
+    for (Patch* patch : m_active)
+    {
+        glBindVertexArray(patch->vao);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, NULL);
+    }
+    glBindVertexArray(0);
+}
+
+bool TerrainDetail::GetActiveRegion(glm::vec4& region) const
+{
+    if (m_regionValid)
+        region = m_region;
+    return m_regionValid;
+}
+
+bool TerrainDetail::GetHeight(float worldX, float worldZ, float& height) const
+{
+    const float patchWorldSize = m_worldScale * PATCH_CELLS;
+    int patchX = (int)std::floor(worldX / patchWorldSize);
+    int patchZ = (int)std::floor(worldZ / patchWorldSize);
+
+    auto it = m_patches.find(PatchKey(patchX, patchZ));
+    if (it == m_patches.end())
+        return false;
+
+    // Interpolation on the triangle of the refined mesh under the position, split like the shared index buffer.
+    const Patch& patch = **it->second;
+    float fx = (worldX / m_worldScale - patchX * PATCH_CELLS) * REFINEMENT;
+    float fz = (worldZ / m_worldScale - patchZ * PATCH_CELLS) * REFINEMENT;
+    int i = std::clamp((int)fx, 0, PATCH_POSTS - 2);
+    int j = std::clamp((int)fz, 0, PATCH_POSTS - 2);
+    float u = std::clamp(fx - i, 0.0f, 1.0f);
+    float v = std::clamp(fz - j, 0.0f, 1.0f);
+
+    const float* row0 = &patch.heights[j * PATCH_POSTS + i];
+    const float* row1 = row0 + PATCH_POSTS;
+    height = (v >= u) ? row0[0] + v * (row1[0] - row0[0]) + u * (row1[1] - row1[0])
+                      : row0[0] + u * (row0[1] - row0[0]) + v * (row1[1] - row0[1]);
+    return true;
+}
+
+void TerrainDetail::Clear()
+{
+    for (auto& patch : m_lru)
+    {
+        m_freeVaos.push_back(patch->vao);
+        m_freeVbs.push_back(patch->vb);
+    }
+
+    if (!m_freeVaos.empty())
+    {
+        glDeleteVertexArrays((GLsizei)m_freeVaos.size(), m_freeVaos.data());
+        glDeleteBuffers((GLsizei)m_freeVbs.size(), m_freeVbs.data());
+    }
+
+    m_freeVaos.clear();
+    m_freeVbs.clear();
+    m_patches.clear();
+    m_lru.clear();
+    m_active.clear();
+    m_regionValid = false;
+}
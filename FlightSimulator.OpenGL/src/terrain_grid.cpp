@@ -1,20 +1,30 @@
+
 #include <stdio.h>
+#include <assert.h>
+#include <algorithm>
 #include <vector>
 
 #include "terrain_grid.h"
 #include "terrain.h"
+#include "parallel.h"
 
 void TerrainGrid::CreateTerrainGrid(int width, int depth, const BaseTerrain* pTerrain)
 {
-    // Set the dimensions of the terrain.
-    m_width = width;
-    m_depth = depth;
+    // Build the mesh on the CPU from the terrain heightmap.
+    MeshData meshData;
+    BuildMeshData(pTerrain->GetHeightMap(), width, depth, pTerrain->GetWorldScale(), pTerrain->GetTextureScale(), meshData);
+
+    // Release the buffers of any previously created grid.
+    DestroyGLState(m_active);
 
     // Initialize OpenGL state for rendering.
-    CreateGLState();
+    CreateGLState(m_active);
+    m_active.width = width;
+    m_active.depth = depth;
 
-    // Populate the buffer with vertex data based on the terrain.
-    PopulateBuffers(pTerrain);
+    // Upload the vertex and index data to the GPU.
+    glBufferData(GL_ARRAY_BUFFER, sizeof(meshData.vertices[0]) * meshData.vertices.size(), &meshData.vertices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(meshData.indices[0]) * meshData.indices.size(), &meshData.indices[0], GL_STATIC_DRAW);
 
     // Unbind the VAO and VBOs to prevent accidental modification.
     glBindVertexArray(0);
@@ -22,19 +32,66 @@ void TerrainGrid::CreateTerrainGrid(int width, int depth, const BaseTerrain* pTe
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void TerrainGrid::CreateGLState()
+void TerrainGrid::BuildMeshData(const Array2D<float>& heightMap, int width, int depth, float worldScale, float textureScale,
+    MeshData& meshData)
+{
+    meshData.width = width;
+    meshData.depth = depth;
+
+    // Create a vector of vertices sized based on the terrain dimensions.
+    meshData.vertices.resize(width * depth);
+
+    int numQuads = (width - 1) * (depth - 1);
+    meshData.indices.resize(numQuads * 6);
+
+    // Every row writes to its own slice of the vertex and index arrays, so rows can be built concurrently.
+    ParallelForRange(0, depth, [&](int firstRow, int lastRow) {
+        InitVertices(heightMap, worldScale, textureScale, firstRow, lastRow, meshData);
+        InitIndices(firstRow, std::min(lastRow, depth - 1), meshData);
+    });
+}
+
+void TerrainGrid::BuildVertices(const Array2D<float>& heightMap, int width, int depth, float worldScale, float textureScale,
+    MeshData& meshData)
+{
+    meshData.width = width;
+    meshData.depth = depth;
+    meshData.vertices.resize(width * depth);
+
+    ParallelForRange(0, depth, [&](int firstRow, int lastRow) {
+        InitVertices(heightMap, worldScale, textureScale, firstRow, lastRow, meshData);
+    });
+}
+
+void TerrainGrid::BuildIndices(int width, int depth, MeshData& meshData)
+{
+    meshData.width = width;
+    meshData.depth = depth;
+    meshData.indices.resize((width - 1) * (depth - 1) * 6);
+
+    ParallelForRange(0, depth - 1, [&](int firstRow, int lastRow) {
+        InitIndices(firstRow, lastRow, meshData);
+    });
+}
+
+void TerrainGrid::CreateGLState(GLBuffers& buffers)
 {
     // Generate a Vertex Array Object (VAO) and bind it.
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    glGenVertexArrays(1, &buffers.vao);
+    glBindVertexArray(buffers.vao);
 
     // Generate a Vertex Buffer Object (VBO) and bind it.
-    glGenBuffers(1, &m_vb);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vb);
+    glGenBuffers(1, &buffers.vb);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vb);
 
-    glGenBuffers(1, &m_ib);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ib);
+    glGenBuffers(1, &buffers.ib);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ib);
+
+    SetupVertexAttributes();
+}
 
+void TerrainGrid::SetupVertexAttributes()
+{
     // Define the location of the position attribute in the vertex shader.
     int POS_LOC = 0;
     int TEX_LOC = 1;
@@ -51,87 +108,145 @@ void TerrainGrid::CreateGLState()
     NumFloats += 2;
 }
 
-void TerrainGrid::PopulateBuffers(const BaseTerrain* pTerrain)
+void TerrainGrid::DestroyGLState(GLBuffers& buffers)
 {
-    // Create a vector of vertices sized based on the terrain dimensions.
-    std::vector<TerrainGrid::Vertex> vertices;
-    vertices.resize(m_width * m_depth);
+    if (buffers.vao == 0)
+        return;
 
-    // Initialize the vertices based on the terrain data.
-    InitVertices(pTerrain, vertices);
+    glDeleteVertexArrays(1, &buffers.vao);
+    glDeleteBuffers(1, &buffers.vb);
+    glDeleteBuffers(1, &buffers.ib);
+    buffers = GLBuffers();
+}
+
+void TerrainGrid::BeginStagedUpload(MeshData&& meshData)
+{
+    // Drop a previous staged upload that never got swapped in.
+    DestroyGLState(m_staged);
 
-    std::vector<unsigned int> indices;
-    int numQuads = (m_width - 1) * (m_depth - 1);
-    indices.resize(numQuads * 6);
-    InitIndices(indices);
+    m_stagedMesh = std::move(meshData);
+    m_stagedVertexBytesUploaded = 0;
+    m_stagedIndexBytesUploaded = 0;
 
-    // Upload the vertex data to the GPU.
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+    // Allocate the GPU storage up front; the contents are streamed in by ContinueStagedUpload().
+    CreateGLState(m_staged);
+    m_staged.width = m_stagedMesh.width;
+    m_staged.depth = m_stagedMesh.depth;
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * m_stagedMesh.vertices.size(), NULL, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * m_stagedMesh.indices.size(), NULL, GL_STATIC_DRAW);
 
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void TerrainGrid::Vertex::InitVertex(const BaseTerrain* pTerrain, int x, int z)
+bool TerrainGrid::ContinueStagedUpload(size_t maxBytes)
 {
-    float y = pTerrain->GetHeight(x, z);
+    assert(HasStagedUpload());
+
+    const size_t vertexBytes = sizeof(Vertex) * m_stagedMesh.vertices.size();
+    const size_t indexBytes = sizeof(unsigned int) * m_stagedMesh.indices.size();
+
+    // Vertices first, then indices, never sending more than maxBytes in total.
+    if (m_stagedVertexBytesUploaded < vertexBytes)
+    {
+        size_t sliceBytes = std::min(maxBytes, vertexBytes - m_stagedVertexBytesUploaded);
+        const char* pSource = reinterpret_cast<const char*>(m_stagedMesh.vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, m_staged.vb);
+        glBufferSubData(GL_ARRAY_BUFFER, m_stagedVertexBytesUploaded, sliceBytes, pSource + m_stagedVertexBytesUploaded);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_stagedVertexBytesUploaded += sliceBytes;
+        maxBytes -= sliceBytes;
+    }
+
+    if (maxBytes > 0 && m_stagedIndexBytesUploaded < indexBytes)
+    {
+        // The element array binding is VAO state, so bind the staged VAO while writing its index buffer.
+        size_t sliceBytes = std::min(maxBytes, indexBytes - m_stagedIndexBytesUploaded);
+        const char* pSource = reinterpret_cast<const char*>(m_stagedMesh.indices.data());
+        glBindVertexArray(m_staged.vao);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_stagedIndexBytesUploaded, sliceBytes, pSource + m_stagedIndexBytesUploaded);
+        glBindVertexArray(0);
+        m_stagedIndexBytesUploaded += sliceBytes;
+    }
+
+    return m_stagedVertexBytesUploaded == vertexBytes && m_stagedIndexBytesUploaded == indexBytes;
+}
+
+void TerrainGrid::SwapStagedBuffers()
+{
+    assert(HasStagedUpload());
+
+    DestroyGLState(m_active);
+    m_active = m_staged;
+    m_staged = GLBuffers();
+
+    // The CPU copy is no longer needed once the GPU owns the data.
+    m_stagedMesh = MeshData();
+}
+
+void TerrainGrid::Vertex::InitVertex(const Array2D<float>& heightMap, float worldScale, float textureScale, int size, int x, int z)
+{
+    float y = heightMap.Get(x, z);
 
-    float worldScale = pTerrain->GetWorldScale();
     // Set the position of the vertex in the terrain.
     pos = glm::fvec3(worldScale * x, y, worldScale* z);
 
-    float size = (float)pTerrain->GetSize();
-    float textureScale = pTerrain->GetTextureScale();
-
-    tex = glm::fvec2(textureScale * (float)x / size, textureScale * (float)z / size);
+    tex = glm::fvec2(textureScale * (float)x / (float)size, textureScale * (float)z / (float)size);
 }
 
-void TerrainGrid::InitIndices(std::vector<unsigned int>& indices)
+void TerrainGrid::InitIndices(int firstRow, int lastRow, MeshData& meshData)
 {
-    int index = 0;
-    for (int z = 0; z < m_depth - 1; z++)
-        for (int x = 0; x < m_width - 1; x++)
+    const int width = meshData.width;
+    int index = firstRow * (width - 1) * 6;
+    for (int z = firstRow; z < lastRow; z++)
+        for (int x = 0; x < width - 1; x++)
         {
-            unsigned int indexBottomLeft = z * m_width + x;
-            unsigned int indexTopLeft = (z + 1) * m_width + x;
-            unsigned int indexTopRight = (z + 1) * m_width + x + 1;
-            unsigned int indexBottomRight = z * m_width + x + 1;
+            unsigned int indexBottomLeft = z * width + x;
+            unsigned int indexTopLeft = (z + 1) * width + x;
+            unsigned int indexTopRight = (z + 1) * width + x + 1;
+            unsigned int indexBottomRight = z * width + x + 1;
 
             // Add top left triangle
-            indices[index++] = indexBottomLeft;
-            indices[index++] = indexTopLeft;
-            indices[index++] = indexTopRight;
+            meshData.indices[index++] = indexBottomLeft;
+            meshData.indices[index++] = indexTopLeft;
+            meshData.indices[index++] = indexTopRight;
 
             // Add top right triangle
-            indices[index++] = indexBottomLeft;
-            indices[index++] = indexTopRight;
-            indices[index++] = indexBottomRight;
+            meshData.indices[index++] = indexBottomLeft;
+            meshData.indices[index++] = indexTopRight;
+            meshData.indices[index++] = indexBottomRight;
         }
 }
 
-void TerrainGrid::InitVertices(const BaseTerrain* pTerrain, std::vector<Vertex>& vertices)
+void TerrainGrid::InitVertices(const Array2D<float>& heightMap, float worldScale, float textureScale,
+    int firstRow, int lastRow, MeshData& meshData)
 {
-    // Iterate over each point in the terrain grid.
-    int index = 0;
-    for (int z = 0; z < m_depth; z++)
-        for (int x = 0; x < m_width; x++)
+    // Iterate over each point in the given rows of the terrain grid.
+    int index = firstRow * meshData.width;
+    for (int z = firstRow; z < lastRow; z++)
+        for (int x = 0; x < meshData.width; x++)
         {
             // Ensure the current index is valid.
-            assert(index < vertices.size());
+            assert(index < (int)meshData.vertices.size());
 
             // Initialize each vertex with its position.
-            vertices[index].InitVertex(pTerrain, x, z);
+            meshData.vertices[index].InitVertex(heightMap, worldScale, textureScale, meshData.width, x, z);
             index++;
         }
 }
 
 void TerrainGrid::Render()
 {
+    if (m_active.vao == 0)
+        return;
+
     // Bind the VAO associated with this object.
-    glBindVertexArray(m_vao);
+    glBindVertexArray(m_active.vao);
 
     // Render the vertices as points.
-    glDrawElements(GL_TRIANGLES, (m_depth - 1) * (m_width - 1) * 6, GL_UNSIGNED_INT, NULL);
+    glDrawElements(GL_TRIANGLES, (m_active.depth - 1) * (m_active.width - 1) * 6, GL_UNSIGNED_INT, NULL);
 
     // Unbind the VAO to prevent accidental modification.
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+
+#include "terrain_lighting.h"
+#include "parallel.h"
+
+// Sun azimuth change below which the previous sun horizon sweep is reused.
+static constexpr float SUN_AZIMUTH_TOLERANCE = 0.0044f; // ~0.25 degrees
+
+// Angular width over which a post fades from lit to shadowed, so shadow edges do not alias.
+static constexpr float SUN_PENUMBRA = 0.035f; // ~2 degrees
+
+static float SmoothStep(float edge0, float edge1, float x)
+{
+    float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+void TerrainLighting::Bake(const Array2D<float>& heightMap, int terrainSize, float worldScale, const glm::vec3& sunDirection)
+{
+    m_terrainSize = terrainSize;
+    m_worldScale = worldScale;
+    m_texels.assign(2 * terrainSize * terrainSize, 0);
+
+    // Ambient occlusion: average the unoccluded fraction of the cosine weighted sky over all directions.
+    // For a horizon at elevation angle a that fraction is cos^2(a) = 1 / (1 + tan^2(a)).
+    std::vector<float> horizons;
+    std::vector<float> openness(terrainSize * terrainSize, 0.0f);
+    for (int direction = 0; direction < NUM_AO_DIRECTIONS; direction++)
+    {
+        float azimuth = 2.0f * 3.14159265f * (float)direction / (float)NUM_AO_DIRECTIONS;
+        SweepHorizons(heightMap, azimuth, horizons);
+
+        ParallelForRange(0, terrainSize * terrainSize, [&](int first, int last) {
+            for (int i = first; i < last; i++)
+                openness[i] += 1.0f / (1.0f + horizons[i] * horizons[i]);
+        });
+    }
+
+    ParallelForRange(0, terrainSize * terrainSize, [&](int first, int last) {
+        for (int i = first; i < last; i++)
+            m_texels[2 * i] = (unsigned char)(255.0f * openness[i] / (float)NUM_AO_DIRECTIONS + 0.5f);
+    });
+
+    // Force the sun horizon to be swept for the new heightmap.
+    m_sunHorizons.clear();
+    UpdateSun(heightMap, sunDirection);
+}
+
+bool TerrainLighting::UpdateSun(const Array2D<float>& heightMap, const glm::vec3& sunDirection)
+{
+    if (!IsBaked())
+        return false;
+
+    glm::vec3 direction = glm::normalize(sunDirection);
+    if (!m_sunHorizons.empty() && direction == m_sunDirection)
+        return false;
+
+    // Only the horizon in the sun's azimuth matters for sun visibility, so that is the only direction swept again.
+    float azimuth = std::atan2(direction.z, direction.x);
+    float azimuthDelta = std::fabs(std::remainder(azimuth - m_sunAzimuth, 2.0f * 3.14159265f));
+    if (m_sunHorizons.empty() || azimuthDelta > SUN_AZIMUTH_TOLERANCE)
+    {
+        SweepHorizons(heightMap, azimuth, m_sunHorizons);
+        m_sunAzimuth = azimuth;
+    }
+
+    m_sunDirection = direction;
+    ComputeSunTerm(heightMap);
+    return true;
+}
+
+void TerrainLighting::SweepHorizons(const Array2D<float>& heightMap, float azimuth, std::vector<float>& horizons) const
+{
+    const int size = m_terrainSize;
+    const float dirX = std::cos(azimuth);
+    const float dirZ = std::sin(azimuth);
+    horizons.assign(size * size, 0.0f);
+
+    // Walk the grid along the major axis of the direction; the minor axis coordinate of a post on line `offset` is
+    // offset + round(slope * major). Every post belongs to exactly one such line.
+    const bool xMajor = std::fabs(dirX) >= std::fabs(dirZ);
+    const float majorDir = xMajor ? dirX : dirZ;
+    const float minorDir = xMajor ? dirZ : dirX;
+    const float slope = minorDir / majorDir;
+    const int minorShift = (int)std::lround(slope * (size - 1));
+    const int firstOffset = -std::max(minorShift, 0);
+    const int lastOffset = size - 1 - std::min(minorShift, 0);
+
+    // Start each line at the far end of the direction, so the posts seen from the current post are the ones already visited.
+    const int majorStart = majorDir > 0.0f ? size - 1 : 0;
+    const int majorStep = majorDir > 0.0f ? -1 : 1;
+
+    ParallelForRange(firstOffset, lastOffset + 1, [&](int firstLine, int lastLine) {
+        // Upper convex hull of the visited posts as (distance along direction, height), nearest post last.
+        std::vector<glm::vec2> hull;
+        hull.reserve(size);
+
+        for (int offset = firstLine; offset < lastLine; offset++)
+        {
+            hull.clear();
+
+            for (int major = majorStart; major >= 0 && major < size; major += majorStep)
+            {
+                int minor = offset + (int)std::lround(slope * major);
+                if (minor < 0 || minor >= size)
+                    continue;
+
+                int x = xMajor ? major : minor;
+                int z = xMajor ? minor : major;
+                glm::vec2 post((x * dirX + z * dirZ) * m_worldScale, heightMap.Get(x, z));
+
+                // Drop hull points hidden behind the segment from this post to the next hull point; they can not be
+                // the horizon of this post or of any post visited later on the line.
+                while (hull.size() >= 2)
+                {
+                    const glm::vec2& nearest = hull[hull.size() - 1];
+                    const glm::vec2& next = hull[hull.size() - 2];
+                    float nearSlope = (nearest.y - post.y) / std::max(nearest.x - post.x, 1e-3f);
+                    float nextSlope = (next.y - post.y) / std::max(next.x - post.x, 1e-3f);
+                    if (nearSlope > nextSlope)
+                        break;
+                    hull.pop_back();
+                }
+
+                float horizon = 0.0f;
+                if (!hull.empty())
+                {
+                    const glm::vec2& nearest = hull.back();
+                    horizon = std::max(0.0f, (nearest.y - post.y) / std::max(nearest.x - post.x, 1e-3f));
+                }
+
+                horizons[z * size + x] = horizon;
+                hull.push_back(post);
+            }
+        }
+    });
+}
+
+void TerrainLighting::ComputeSunTerm(const Array2D<float>& heightMap)
+{
+    const int size = m_terrainSize;
+    const float sunElevation = std::asin(std::clamp(m_sunDirection.y, -1.0f, 1.0f));
+
+    ParallelForRange(0, size, [&](int firstRow, int lastRow) {
+        for (int z = firstRow; z < lastRow; z++)
+            for (int x = 0; x < size; x++)
+            {
+                // Normal from central differences of the heightmap.
+                float dx = heightMap.Get(std::min(x + 1, size - 1), z) - heightMap.Get(std::max(x - 1, 0), z);
+                float dz = heightMap.Get(x, std::min(z + 1, size - 1)) - heightMap.Get(x, std::max(z - 1, 0));
+                glm::vec3 normal = glm::normalize(glm::vec3(-dx, 2.0f * m_worldScale, -dz));
+
+                float diffuse = std::max(0.0f, glm::dot(normal, m_sunDirection));
+                float horizonElevation = std::atan(m_sunHorizons[z * size + x]);
+                float visibility = SmoothStep(-SUN_PENUMBRA, SUN_PENUMBRA, sunElevation - horizonElevation);
+
+                m_texels[2 * (z * size + x) + 1] = (unsigned char)(255.0f * diffuse * visibility + 0.5f);
+            }
+    });
+}
@@ -0,0 +1,159 @@
+#include <chrono>
+
+#include "terrain_regenerator.h"
+
+TerrainRegenerator::~TerrainRegenerator()
+{
+    if (m_build.IsValid())
+        GetJobSystem().Wait(m_build);
+}
+
+TerrainRegenerator& TerrainRegenerator::operator=(TerrainRegenerator&& other)
+{
+    if (this != &other)
+    {
+        // A build of this regenerator would write into a slot nobody reads any more
+        Cancel();
+        m_state = other.m_state;
+        m_build = other.m_build;
+        m_buildOutput = std::move(other.m_buildOutput);
+        m_output = std::move(other.m_output);
+        m_queuedRequest = std::move(other.m_queuedRequest);
+        other.m_state = State::Idle;
+        other.m_build = {};
+    }
+    return *this;
+}
+
+void TerrainRegenerator::Cancel()
+{
+    if (m_build.IsValid())
+        GetJobSystem().Wait(m_build);
+
+    m_build = {};
+    m_buildOutput.reset();
+    m_output.reset();
+    m_queuedRequest.reset();
+    m_state = State::Idle;
+}
+
+void TerrainRegenerator::Start(int terrainSize, float worldScale, float textureScale, float minHeight, float maxHeight,
+    const glm::vec3& sunDirection, GenerateFunc generate)
+{
+    Request request;
+    request.terrainSize = terrainSize;
+    request.worldScale = worldScale;
+    request.textureScale = textureScale;
+    request.minHeight = minHeight;
+    request.maxHeight = maxHeight;
+    request.sunDirection = sunDirection;
+    request.generate = std::move(generate);
+
+    // Only the most recent request matters, so a busy regenerator just remembers it for later.
+    if (IsBusy())
+    {
+        m_queuedRequest = std::make_unique<Request>(std::move(request));
+        return;
+    }
+
+    Launch(std::move(request));
+}
+
+void TerrainRegenerator::Launch(Request request)
+{
+    m_state = State::Building;
+
+    // The job writes into its own slot, so it stays valid even if the regenerator is moved meanwhile.
+    auto output = std::make_shared<std::unique_ptr<BuildOutput>>();
+    m_buildOutput = output;
+    m_build = GetJobSystem().RunBackground([output, request = std::move(request)]() mutable {
+        *output = Build(std::move(request));
+    });
+}
+
+std::unique_ptr<TerrainRegenerator::BuildOutput> TerrainRegenerator::Build(Request request)
+{
+    auto output = std::make_unique<BuildOutput>();
+    output->result.terrainSize = request.terrainSize;
+    output->result.minHeight = request.minHeight;
+    output->result.maxHeight = request.maxHeight;
+
+    // Generate the heightmap into storage owned by the worker until it is swapped in.
+    output->result.heightMap = std::make_unique<Array2D<float>>();
+    output->result.heightMap->InitArray2D(request.terrainSize, request.terrainSize, 0.0f);
+    request.generate(*output->result.heightMap);
+
+    TerrainGrid::BuildMeshData(*output->result.heightMap, request.terrainSize, request.terrainSize,
+        request.worldScale, request.textureScale, output->meshData);
+
+    output->result.lighting.Bake(*output->result.heightMap, request.terrainSize, request.worldScale, request.sunDirection);
+
+    return output;
+}
+
+bool TerrainRegenerator::Update(TerrainGrid& grid, size_t maxUploadBytes, float maxUploadMilliseconds)
+{
+    if (m_state == State::Building)
+    {
+        // Poll the build without blocking the frame.
+        if (!GetJobSystem().IsFinished(m_build))
+            return false;
+
+        m_output = std::move(*m_buildOutput);
+        m_buildOutput.reset();
+        m_build = {};
+
+        // A newer request arrived while this one was building, so this result is already stale.
+        if (m_queuedRequest)
+        {
+            m_output.reset();
+            Launch(std::move(*m_queuedRequest));
+            m_queuedRequest.reset();
+            return false;
+        }
+
+        grid.BeginStagedUpload(std::move(m_output->meshData));
+        m_state = State::Uploading;
+    }
+
+    if (m_state == State::Uploading)
+    {
+        // Upload in small slices until either the byte or the time budget for this frame is used up.
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        const size_t sliceBytes = maxUploadBytes / 4 > 0 ? maxUploadBytes / 4 : maxUploadBytes;
+        size_t uploadedBytes = 0;
+        bool done = false;
+
+        while (!done && uploadedBytes < maxUploadBytes)
+        {
+            done = grid.ContinueStagedUpload(sliceBytes);
+            uploadedBytes += sliceBytes;
+
+            std::chrono::duration<float, std::milli> elapsed = Clock::now() - start;
+            if (elapsed.count() >= maxUploadMilliseconds)
+                break;
+        }
+
+        if (done)
+            m_state = State::Ready;
+    }
+
+    return m_state == State::Ready;
+}
+
+TerrainRegenerator::Result TerrainRegenerator::TakeResult()
+{
+    Result result = std::move(m_output->result);
+    m_output.reset();
+    m_state = State::Idle;
+
+    // Kick off whatever was requested while this terrain was being uploaded.
+    if (m_queuedRequest)
+    {
+        Launch(std::move(*m_queuedRequest));
+        m_queuedRequest.reset();
+    }
+
+    return result;
+}
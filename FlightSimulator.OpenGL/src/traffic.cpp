@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "traffic.h"
+#include "bit_stream.h"
+#include "job_system.h"
+
+// Source of TrafficSystem ids.
+static std::atomic<uint64_t> s_nextId{ 1 };
+
+TrafficSystem::TrafficSystem(const physics::Airplane& prototype, const AutopilotSettings& autopilot)
+    : m_wings(prototype.wings), m_maxThrust(prototype.engine.max_thrust), m_mass(prototype.mass),
+      m_inertia(prototype.get_inertia()), m_inverseInertia(glm::inverse(prototype.get_inertia())),
+      m_autopilot(autopilot), m_id(s_nextId++)
+{
+    if ((int)m_wings.size() != WING_COUNT)
+        printf("%s:%d - traffic aircraft need %d wings, the prototype has %d\n", __FILE__, __LINE__, WING_COUNT,
+            (int)m_wings.size());
+    m_wings.resize(WING_COUNT, m_wings.back());
+
+    // Airfoils shared by several wings are added once.
+    std::vector<const physics::Airfoil*> airfoils;
+    for (const physics::Wing& wing : m_wings)
+    {
+        auto found = std::find(airfoils.begin(), airfoils.end(), wing.airfoil);
+        if (found == airfoils.end())
+        {
+            airfoils.push_back(wing.airfoil);
+            m_airfoilIds.push_back(m_library.add(*wing.airfoil));
+        }
+        else
+        {
+            m_airfoilIds.push_back(m_airfoilIds[found - airfoils.begin()]);
+        }
+    }
+}
+
+int TrafficSystem::AddAircraft(const glm::vec3& position, float heading, float speed)
+{
+    int index = m_count;
+    Resize(m_count + 1);
+
+    TrafficState& s = m_state;
+    glm::quat orientation = glm::angleAxis(-heading, physics::UP);
+    glm::vec3 velocity = orientation * physics::FORWARD * speed;
+
+    s.positionX[index] = s.previousPositionX[index] = position.x;
+    s.positionY[index] = s.previousPositionY[index] = position.y;
+    s.positionZ[index] = s.previousPositionZ[index] = position.z;
+    s.orientationW[index] = s.previousOrientationW[index] = orientation.w;
+    s.orientationX[index] = s.previousOrientationX[index] = orientation.x;
+    s.orientationY[index] = s.previousOrientationY[index] = orientation.y;
+    s.orientationZ[index] = s.previousOrientationZ[index] = orientation.z;
+    s.velocityX[index] = velocity.x;
+    s.velocityY[index] = velocity.y;
+    s.velocityZ[index] = velocity.z;
+    s.angularVelocityX[index] = s.angularVelocityY[index] = s.angularVelocityZ[index] = 0.0f;
+    s.aileron[index] = s.elevator[index] = s.rudder[index] = 0.0f;
+    s.throttle[index] = m_autopilot.GetSettings().cruiseThrottle;
+    s.pitchIntegral[index] = 0.0f;
+    s.autopilotElapsed[index] = 0.0f;
+
+    SetTarget(index, heading, position.y, speed);
+    return index;
+}
+
+void TrafficSystem::RemoveAircraft(int index)
+{
+    if (index < 0 || index >= m_count)
+        return;
+
+    Copy(m_count - 1, index);
+    Resize(m_count - 1);
+}
+
+void TrafficSystem::Clear()
+{
+    Resize(0);
+}
+
+void TrafficSystem::SetTarget(int index, float heading, float altitude, float speed)
+{
+    m_state.targetHeading[index] = heading;
+    m_state.targetAltitude[index] = altitude;
+    m_state.targetSpeed[index] = speed;
+    m_state.autopilot[index] = 1;
+}
+
+void TrafficSystem::SetControls(int index, const Joystick& joystick)
+{
+    m_state.aileron[index] = joystick.leftAileron + joystick.rightAileron;
+    m_state.elevator[index] = joystick.elevator;
+    m_state.rudder[index] = joystick.rudder;
+    m_state.throttle[index] = glm::clamp(joystick.throttle, 0.0f, 1.0f);
+    m_state.autopilotElapsed[index] = 0.0f;
+    m_state.autopilot[index] = 0;
+}
+
+Joystick TrafficSystem::GetControls(int index) const
+{
+    // SetControls sums the two ailerons
+    Joystick joystick;
+    joystick.leftAileron = 0.5f * m_state.aileron[index];
+    joystick.rightAileron = 0.5f * m_state.aileron[index];
+    joystick.elevator = m_state.elevator[index];
+    joystick.rudder = m_state.rudder[index];
+    joystick.throttle = m_state.throttle[index];
+    return joystick;
+}
+
+void TrafficSystem::SetAutopilotView(const glm::vec3& position)
+{
+    m_autopilotView = position;
+    m_hasAutopilotView = true;
+}
+
+// Surfaces of one chunk of aircraft. Every thread keeps its own, so chunks run without allocating, and refills the
+// geometry only when it steps a different traffic system than before.
+struct TrafficBatch {
+    physics::AeroSurfaces surfaces;
+    uint64_t owner = 0;
+    AutopilotBatch autopilot;
+};
+static thread_local TrafficBatch t_batch;
+
+physics::AeroSurfaces& TrafficSystem::GetBatch() const
+{
+    if (t_batch.owner != m_id)
+    {
+        t_batch.surfaces.resize((size_t)CHUNK_AIRCRAFT * WING_COUNT);
+        for (size_t k = 0; k < t_batch.surfaces.count; k++)
+            t_batch.surfaces.set_surface(k, m_wings[k % WING_COUNT], m_airfoilIds[k % WING_COUNT]);
+        t_batch.owner = m_id;
+    }
+    return t_batch.surfaces;
+}
+
+static_assert(TrafficSystem::CHUNK_AIRCRAFT <= AutopilotBatch::CAPACITY, "a chunk must fit one autopilot batch");
+
+template <typename Index, typename StepSize>
+void TrafficSystem::RunAutopilots(int count, Index&& index, StepSize&& stepSize)
+{
+    TrafficState& s = m_state;
+    AutopilotBatch& batch = t_batch.autopilot;
+
+    // Far aircraft hold their commands between runs, their next run integrates over the whole time since
+    batch.count = 0;
+    for (int j = 0; j < count; j++)
+    {
+        const int i = index(j);
+        if (!s.autopilot[i])
+            continue;
+
+        s.autopilotElapsed[i] += stepSize(j);
+        if (m_hasAutopilotView)
+        {
+            const glm::vec3 offset = glm::vec3(s.positionX[i], s.positionY[i], s.positionZ[i]) - m_autopilotView;
+            if (s.autopilotElapsed[i] < m_autopilot.GetInterval(glm::dot(offset, offset)))
+                continue;
+        }
+
+        const int e = batch.count++;
+        batch.index[e] = i;
+        batch.orientationW[e] = s.orientationW[i];
+        batch.orientationX[e] = s.orientationX[i];
+        batch.orientationY[e] = s.orientationY[i];
+        batch.orientationZ[e] = s.orientationZ[i];
+        batch.velocityX[e] = s.velocityX[i];
+        batch.velocityY[e] = s.velocityY[i];
+        batch.velocityZ[e] = s.velocityZ[i];
+        batch.angularVelocityX[e] = s.angularVelocityX[i];
+        batch.angularVelocityY[e] = s.angularVelocityY[i];
+        batch.angularVelocityZ[e] = s.angularVelocityZ[i];
+        batch.positionY[e] = s.positionY[i];
+        batch.density[e] = isa::get_air_density(s.positionY[i]);
+        batch.targetHeading[e] = s.targetHeading[i];
+        batch.targetAltitude[e] = s.targetAltitude[i];
+        batch.targetSpeed[e] = s.targetSpeed[i];
+        batch.stepSize[e] = s.autopilotElapsed[i];
+        batch.pitchIntegral[e] = s.pitchIntegral[i];
+        s.autopilotElapsed[i] = 0.0f;
+    }
+    if (batch.count == 0)
+        return;
+
+    m_autopilot.Run(batch, m_kernelIsa);
+    for (int e = 0; e < batch.count; e++)
+    {
+        const int i = batch.index[e];
+        s.aileron[i] = batch.aileron[e];
+        s.elevator[i] = batch.elevator[e];
+        s.rudder[i] = batch.rudder[e];
+        s.throttle[i] = batch.throttle[e];
+        s.pitchIntegral[i] = batch.pitchIntegral[e];
+    }
+}
+
+template <typename Index, typename StepSize>
+void TrafficSystem::StepBatch(int count, Index&& index, StepSize&& stepSize)
+{
+    TrafficState& s = m_state;
+    physics::AeroSurfaces& surfaces = GetBatch();
+    RunAutopilots(count, index, stepSize);
+
+    // Velocity of every surface through the air in body space: R^T * (v + w x R * p) = R^T * v + (R^T * w) x p.
+    for (int j = 0; j < count; j++)
+    {
+        const int i = index(j);
+
+        glm::quat inverse(s.orientationW[i], -s.orientationX[i], -s.orientationY[i], -s.orientationZ[i]);
+        glm::vec3 velocity = inverse * glm::vec3(s.velocityX[i], s.velocityY[i], s.velocityZ[i]);
+        glm::vec3 angularVelocity = inverse * glm::vec3(s.angularVelocityX[i], s.angularVelocityY[i], s.angularVelocityZ[i]);
+        float density = isa::get_air_density(s.positionY[i]);
+
+        // The same mapping as Airplane::set_controls.
+        const float controls[WING_COUNT] = { s.aileron[i], -s.aileron[i], -s.elevator[i], -s.rudder[i] };
+        for (int w = 0; w < WING_COUNT; w++)
+        {
+            size_t k = (size_t)j * WING_COUNT + w;
+            glm::vec3 surfaceVelocity = velocity + glm::cross(angularVelocity, m_wings[w].position);
+            surfaces.velocity_x[k] = surfaceVelocity.x;
+            surfaces.velocity_y[k] = surfaceVelocity.y;
+            surfaces.velocity_z[k] = surfaceVelocity.z;
+            surfaces.control[k] = controls[w];
+            surfaces.density[k] = density;
+        }
+    }
+
+    // Whole vectors only; surfaces past the chunk hold whatever the last chunk left and their results are not read.
+    const size_t lanes = physics::AeroSurfaces::LANES;
+    physics::evaluate_aero(m_library, surfaces, 0, ((size_t)count * WING_COUNT + lanes - 1) / lanes * lanes,
+        m_kernelIsa);
+
+    // The same semi-implicit Euler step as RigidBody::integrate.
+    for (int j = 0; j < count; j++)
+    {
+        const int i = index(j);
+        const float dt = stepSize(j);
+
+        glm::vec3 force(0.0f), torque(0.0f);
+        for (int w = 0; w < WING_COUNT; w++)
+        {
+            size_t k = (size_t)j * WING_COUNT + w;
+            force += glm::vec3(surfaces.force_x[k], surfaces.force_y[k], surfaces.force_z[k]);
+            torque += glm::vec3(surfaces.moment_x[k], surfaces.moment_y[k], surfaces.moment_z[k]);
+        }
+        force += physics::FORWARD * (s.throttle[i] * m_maxThrust);
+        glm::quat orientation(s.orientationW[i], s.orientationX[i], s.orientationY[i], s.orientationZ[i]);
+        glm::mat3 rotation = glm::mat3_cast(orientation);
+        glm::mat3 rotationT = glm::transpose(rotation);
+
+        s.previousPositionX[i] = s.positionX[i];
+        s.previousPositionY[i] = s.positionY[i];
+        s.previousPositionZ[i] = s.positionZ[i];
+        s.previousOrientationW[i] = orientation.w;
+        s.previousOrientationX[i] = orientation.x;
+        s.previousOrientationY[i] = orientation.y;
+        s.previousOrientationZ[i] = orientation.z;
+
+        glm::vec3 acceleration = rotation * force / m_mass;
+        acceleration.y -= physics::EARTH_GRAVITY;
+        glm::vec3 velocity = glm::vec3(s.velocityX[i], s.velocityY[i], s.velocityZ[i]) + acceleration * dt;
+        s.velocityX[i] = velocity.x;
+        s.velocityY[i] = velocity.y;
+        s.velocityZ[i] = velocity.z;
+        s.positionX[i] += velocity.x * dt;
+        s.positionY[i] += velocity.y * dt;
+        s.positionZ[i] += velocity.z * dt;
+
+        // Euler's equations in body space, I * dw/dt = tau - w x (I * w), which is the world space form of RigidBody
+        // rotated by R^T.
+        glm::vec3 angularVelocity(s.angularVelocityX[i], s.angularVelocityY[i], s.angularVelocityZ[i]);
+        glm::vec3 bodyAngularVelocity = rotationT * angularVelocity;
+        glm::vec3 bodyAcceleration = m_inverseInertia *
+            (torque - glm::cross(bodyAngularVelocity, m_inertia * bodyAngularVelocity));
+        angularVelocity += rotation * bodyAcceleration * dt;
+        s.angularVelocityX[i] = angularVelocity.x;
+        s.angularVelocityY[i] = angularVelocity.y;
+        s.angularVelocityZ[i] = angularVelocity.z;
+
+        orientation = physics::renormalize(orientation + (glm::quat(0.0f, angularVelocity) * orientation) * (0.5f * dt));
+        s.orientationW[i] = orientation.w;
+        s.orientationX[i] = orientation.x;
+        s.orientationY[i] = orientation.y;
+        s.orientationZ[i] = orientation.z;
+    }
+}
+
+void TrafficSystem::Step(float dt)
+{
+    JobSystem& jobs = GetJobSystem();
+    jobs.Wait(jobs.ParallelFor(0, m_count, CHUNK_AIRCRAFT, [this, dt](int first, int last) { StepRange(first, last, dt); }));
+}
+
+void TrafficSystem::StepRange(int first, int last, float dt)
+{
+    for (int chunk = first; chunk < last; chunk += CHUNK_AIRCRAFT)
+    {
+        StepBatch(std::min(last - chunk, CHUNK_AIRCRAFT), [chunk](int j) { return chunk + j; }, [dt](int) { return dt; });
+    }
+}
+
+void TrafficSystem::RunAutopilotRange(int first, int last, float dt)
+{
+    for (int chunk = first; chunk < last; chunk += CHUNK_AIRCRAFT)
+    {
+        RunAutopilots(std::min(last - chunk, CHUNK_AIRCRAFT), [chunk](int j) { return chunk + j; },
+            [dt](int) { return dt; });
+    }
+}
+
+void TrafficSystem::StepSelected(const int* indices, const float* stepSizes, int count)
+{
+    JobSystem& jobs = GetJobSystem();
+    jobs.Wait(jobs.ParallelFor(0, count, CHUNK_AIRCRAFT, [this, indices, stepSizes](int first, int last) {
+        StepBatch(last - first, [indices, first](int j) { return indices[first + j]; },
+            [stepSizes, first](int j) { return stepSizes[first + j]; });
+    }));
+}
+
+void TrafficSystem::UpdateTransforms(float alpha, const glm::mat4& modelTransform)
+{
+    m_transforms.resize(m_count);
+
+    const TrafficState& s = m_state;
+    JobSystem& jobs = GetJobSystem();
+    jobs.Wait(jobs.ParallelFor(0, m_count, CHUNK_AIRCRAFT * 4, [&](int first, int last) {
+        for (int i = first; i < last; i++)
+        {
+            glm::vec3 previous(s.previousPositionX[i], s.previousPositionY[i], s.previousPositionZ[i]);
+            glm::vec3 current(s.positionX[i], s.positionY[i], s.positionZ[i]);
+            glm::quat previousOrientation(s.previousOrientationW[i], s.previousOrientationX[i],
+                s.previousOrientationY[i], s.previousOrientationZ[i]);
+            glm::quat orientation(s.orientationW[i], s.orientationX[i], s.orientationY[i], s.orientationZ[i]);
+
+            // Normalized lerp, steps are short enough that slerp would not be visibly different.
+            if (glm::dot(previousOrientation, orientation) < 0.0f)
+                orientation = -orientation;
+            orientation = glm::normalize(previousOrientation + (orientation - previousOrientation) * alpha);
+
+            glm::mat4 transform = glm::mat4_cast(orientation);
+            transform[3] = glm::vec4(previous + (current - previous) * alpha, 1.0f);
+            m_transforms[i] = transform * modelTransform;
+        }
+    }));
+}
+
+void TrafficSystem::ExtrapolateTransforms(const float* elapsed, const glm::mat4& modelTransform)
+{
+    m_transforms.resize(m_count);
+
+    const TrafficState& s = m_state;
+    JobSystem& jobs = GetJobSystem();
+    jobs.Wait(jobs.ParallelFor(0, m_count, CHUNK_AIRCRAFT * 4, [&](int first, int last) {
+        for (int i = first; i < last; i++)
+        {
+            float t = elapsed[i];
+            glm::vec3 position(s.positionX[i] + s.velocityX[i] * t, s.positionY[i] + s.velocityY[i] * t,
+                s.positionZ[i] + s.velocityZ[i] * t);
+
+            // One Euler step of dq/dt = 0.5 * w * q, like the integration itself.
+            glm::quat orientation(s.orientationW[i], s.orientationX[i], s.orientationY[i], s.orientationZ[i]);
+            glm::vec3 angularVelocity(s.angularVelocityX[i], s.angularVelocityY[i], s.angularVelocityZ[i]);
+            orientation = glm::normalize(orientation + (glm::quat(0.0f, angularVelocity) * orientation) * (0.5f * t));
+
+            glm::mat4 transform = glm::mat4_cast(orientation);
+            transform[3] = glm::vec4(position, 1.0f);
+            m_transforms[i] = transform * modelTransform;
+        }
+    }));
+}
+
+glm::vec3 TrafficSystem::GetPosition(int index) const
+{
+    return { m_state.positionX[index], m_state.positionY[index], m_state.positionZ[index] };
+}
+
+glm::quat TrafficSystem::GetOrientation(int index) const
+{
+    return { m_state.orientationW[index], m_state.orientationX[index], m_state.orientationY[index],
+        m_state.orientationZ[index] };
+}
+
+glm::vec3 TrafficSystem::GetVelocity(int index) const
+{
+    return { m_state.velocityX[index], m_state.velocityY[index], m_state.velocityZ[index] };
+}
+
+// Float arrays in TrafficState.
+static constexpr int ARRAY_COUNT = 29;
+
+// Every float array of the state, so resizing and moving aircraft can not miss a component. The arrays are laid out
+// in the arena in this order, followed by the autopilot flags.
+template <typename State, typename Func>
+static void ForEachArray(State& s, Func&& func)
+{
+    for (auto* array : { &s.positionX, &s.positionY, &s.positionZ, &s.orientationW, &s.orientationX, &s.orientationY,
+             &s.orientationZ, &s.velocityX, &s.velocityY, &s.velocityZ, &s.angularVelocityX, &s.angularVelocityY,
+             &s.angularVelocityZ, &s.previousPositionX, &s.previousPositionY, &s.previousPositionZ,
+             &s.previousOrientationW, &s.previousOrientationX, &s.previousOrientationY, &s.previousOrientationZ,
+             &s.aileron, &s.elevator, &s.rudder, &s.throttle, &s.targetHeading, &s.targetAltitude, &s.targetSpeed,
+             &s.pitchIntegral, &s.autopilotElapsed })
+        func(*array);
+}
+
+void TrafficSystem::Resize(int count)
+{
+    if (count > m_capacity)
+    {
+        // Capacities are multiples of 16 aircraft, so every array starts on a cache line.
+        const int capacity = (std::max(count, m_capacity * 2) + 15) & ~15;
+        StateArena arena;
+        arena.Allocate((ARRAY_COUNT * sizeof(float) + 1) * (size_t)capacity);
+        if (!arena.GetData())
+        {
+            printf("%s:%d - out of memory for %d aircraft\n", __FILE__, __LINE__, capacity);
+            return;
+        }
+
+        // The arena is zeroed, so only the aircraft that exist are copied over.
+        size_t offset = 0;
+        ForEachArray(m_state, [&](float*& array) {
+            float* pArray = arena.Get<float>(offset);
+            if (m_count > 0)
+                memcpy(pArray, array, m_count * sizeof(float));
+            array = pArray;
+            offset += capacity * sizeof(float);
+        });
+        unsigned char* pAutopilot = arena.Get<unsigned char>(offset);
+        if (m_count > 0)
+            memcpy(pAutopilot, m_state.autopilot, m_count);
+        m_state.autopilot = pAutopilot;
+
+        m_arena = std::move(arena);
+        m_capacity = capacity;
+    }
+    else if (count > m_count)
+    {
+        // Aircraft removed before may have left their state behind.
+        const int added = count - m_count;
+        ForEachArray(m_state, [&](float* array) { memset(array + m_count, 0, added * sizeof(float)); });
+        memset(m_state.autopilot + m_count, 0, added);
+    }
+
+    m_count = count;
+}
+
+void TrafficSystem::WriteState(std::vector<uint8_t>& data) const
+{
+    // The count, then every array in ForEachArray order.
+    const int32_t count = m_count;
+    WriteBytes(data, &count, sizeof(count));
+    ForEachArray(m_state, [&](const float* array) { WriteBytes(data, array, m_count * sizeof(float)); });
+    WriteBytes(data, m_state.autopilot, m_count);
+}
+
+bool TrafficSystem::ReadState(const uint8_t*& pData, const uint8_t* pEnd)
+{
+    // A count the data can not hold is corrupt, and would allocate before failing.
+    int32_t count = 0;
+    const size_t bytesPerAircraft = ARRAY_COUNT * sizeof(float) + 1;
+    if (!ReadBytes(pData, pEnd, &count, sizeof(count)) || count < 0 ||
+        (size_t)count > (size_t)(pEnd - pData) / bytesPerAircraft)
+    {
+        Resize(0);
+        return false;
+    }
+
+    // Within the capacity this allocates nothing, restoring is a memcpy per array.
+    Resize(count);
+    bool complete = m_count == count;
+    ForEachArray(m_state, [&](float* array) {
+        complete = complete && ReadBytes(pData, pEnd, array, count * sizeof(float));
+    });
+    complete = complete && ReadBytes(pData, pEnd, m_state.autopilot, count);
+    if (!complete)
+        Resize(0);
+    return complete;
+}
+
+void TrafficSystem::Copy(int from, int to)
+{
+    ForEachArray(m_state, [from, to](float* array) { array[to] = array[from]; });
+    m_state.autopilot[to] = m_state.autopilot[from];
+}
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "wind_field.h"
+#include "wind_field_kernel.h"
+#include "parallel.h"
+
+// Box blurs along every axis that turn the white noise into turbulence, and their radius in voxels. Three passes come
+// close to a gaussian about 80 m wide.
+static const int SMOOTHING_PASSES = 3;
+static const int SMOOTHING_RADIUS = 2;
+
+// Smallest change of the wind worth a new mean grid.
+static const float REBUILD_DIRECTION = 0.01f; // rad
+static const float REBUILD_SPEED = 0.1f; // m/s
+
+static const float TWO_PI = 6.28318531f;
+
+// Uniform float in [-0.5, 0.5) from the raw generator output, the same on every standard library.
+static float Noise(std::mt19937& rng)
+{
+    return (rng() >> 8) * (1.0f / 16777216.0f) - 0.5f;
+}
+
+// Moves a value towards a target by at most a step.
+static float Approach(float value, float target, float step)
+{
+    return value < target ? std::min(value + step, target) : std::max(value - step, target);
+}
+
+// Wraps a drift into [0, period), so it keeps its precision however long the wind blows.
+static float Wrap(float value, float period)
+{
+    return value - std::floor(value / period) * period;
+}
+
+void SampleWindSse2(const WindSampleArgs& args)
+{
+    SampleWindKernel<simd::Float4>(args);
+}
+
+WindField::~WindField()
+{
+    if (m_rebuild.IsValid())
+        GetJobSystem().Wait(m_rebuild);
+}
+
+void WindField::Build(const HeightField& ground, const WindSettings& settings, uint32_t seed, float cellSize,
+    float levelHeight, float ceiling)
+{
+    // A rebuild for the old ground would be stale
+    if (m_rebuild.IsValid())
+    {
+        GetJobSystem().Wait(m_rebuild);
+        m_rebuild = {};
+        m_rebuildOutput.reset();
+    }
+
+    m_cellSize = cellSize;
+    m_levelHeight = levelHeight;
+    m_nodesX = std::max((int)(std::max(ground.GetPostsX() - 1, 0) * ground.GetPostSpacing() / cellSize) + 1, 2);
+    m_nodesZ = std::max((int)(std::max(ground.GetPostsZ() - 1, 0) * ground.GetPostSpacing() / cellSize) + 1, 2);
+
+    // The ground under the columns with its slope across one cell
+    auto columns = std::make_shared<Columns>();
+    const size_t columnCount = (size_t)m_nodesX * m_nodesZ;
+    columns->height.resize(columnCount);
+    columns->slopeX.resize(columnCount);
+    columns->slopeZ.resize(columnCount);
+    const float half = 0.5f * cellSize;
+    ParallelForRange(0, m_nodesZ, [&](int firstRow, int lastRow) {
+        for (int iz = firstRow; iz < lastRow; iz++)
+        {
+            for (int ix = 0; ix < m_nodesX; ix++)
+            {
+                const float x = ix * cellSize, z = iz * cellSize;
+                const size_t column = (size_t)iz * m_nodesX + ix;
+                columns->height[column] = ground.GetHeight(x, z);
+                columns->slopeX[column] = (ground.GetHeight(x + half, z) - ground.GetHeight(x - half, z)) / cellSize;
+                columns->slopeZ[column] = (ground.GetHeight(x, z + half) - ground.GetHeight(x, z - half)) / cellSize;
+            }
+        }
+    });
+    m_baseAltitude = *std::min_element(columns->height.begin(), columns->height.end());
+    m_levels = std::max((int)std::ceil((ceiling - m_baseAltitude) / levelHeight) + 1, 2);
+    m_columns = columns;
+
+    GenerateTurbulence(seed);
+
+    m_settings = m_target = settings;
+    m_offset = glm::vec3(0.0f);
+    auto grid = std::make_unique<MeanGrid>();
+    grid->settings = settings;
+    ResizeGrid(*grid);
+    ParallelForRange(0, m_nodesZ, [&](int firstRow, int lastRow) {
+        BuildRows(*m_columns, *grid, firstRow, lastRow);
+    });
+    m_grid = std::move(grid);
+    m_gridCount++;
+}
+
+void WindField::GenerateTurbulence(uint32_t seed)
+{
+    const int size = TURBULENCE_SIZE;
+    const int voxels = size * size * size;
+    std::mt19937 rng(seed);
+    for (std::vector<float>& component : m_turbulence)
+    {
+        component.resize(voxels);
+        for (float& value : component)
+            value = Noise(rng);
+    }
+
+    // Box blurs wrapping around the edges keep the volume tileable. Every pass reads one component and writes a
+    // scratch copy, lines along the axis in parallel.
+    std::vector<float> scratch(voxels);
+    const int strides[3] = { 1, size, size * size };
+    for (std::vector<float>& component : m_turbulence)
+    {
+        for (int pass = 0; pass < SMOOTHING_PASSES; pass++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const int stride = strides[axis];
+                const int across1 = strides[(axis + 1) % 3], across2 = strides[(axis + 2) % 3];
+                ParallelForRange(0, size * size, [&](int firstLine, int lastLine) {
+                    for (int line = firstLine; line < lastLine; line++)
+                    {
+                        const int start = (line % size) * across1 + (line / size) * across2;
+                        for (int i = 0; i < size; i++)
+                        {
+                            float sum = 0.0f;
+                            for (int k = -SMOOTHING_RADIUS; k <= SMOOTHING_RADIUS; k++)
+                                sum += component[start + ((i + k + size) % size) * stride];
+                            scratch[start + i * stride] = sum / (2 * SMOOTHING_RADIUS + 1);
+                        }
+                    }
+                });
+                component.swap(scratch);
+            }
+        }
+
+        // Zero mean and unit deviation, so the intensity alone sets the strength of the gusts
+        double sum = 0.0, squares = 0.0;
+        for (float value : component)
+        {
+            sum += value;
+            squares += (double)value * value;
+        }
+        const double mean = sum / voxels;
+        const double deviation = std::sqrt(std::max(squares / voxels - mean * mean, 1e-12));
+        for (float& value : component)
+            value = (float)((value - mean) / deviation);
+    }
+}
+
+void WindField::ResizeGrid(MeanGrid& grid) const
+{
+    const size_t nodes = (size_t)m_nodesX * m_nodesZ * m_levels;
+    grid.x.resize(nodes);
+    grid.y.resize(nodes);
+    grid.z.resize(nodes);
+}
+
+void WindField::BuildRows(const Columns& columns, MeanGrid& grid, int firstRow, int lastRow) const
+{
+    const WindSettings& wind = grid.settings;
+    const size_t layer = (size_t)m_nodesX * m_nodesZ;
+    const glm::vec3 heading(std::cos(wind.direction), 0.0f, std::sin(wind.direction));
+
+    for (int iz = firstRow; iz < lastRow; iz++)
+    {
+        for (int ix = 0; ix < m_nodesX; ix++)
+        {
+            const size_t column = (size_t)iz * m_nodesX + ix;
+            const glm::vec3 normal = glm::normalize(glm::vec3(-columns.slopeX[column], 1.0f, -columns.slopeZ[column]));
+            for (int level = 0; level < m_levels; level++)
+            {
+                const size_t node = level * layer + column;
+                const float height = m_baseAltitude + level * m_levelHeight - columns.height[column];
+                glm::vec3 velocity(0.0f);
+                if (height > 0.0f)
+                {
+                    // Shear with the height over the ground, then the flow along the slope blended in near it, at the
+                    // same speed
+                    const float shearHeight = std::clamp(height, 1.0f, wind.boundaryLayerHeight);
+                    const float speed = wind.speed * std::pow(shearHeight / wind.referenceHeight, wind.shearExponent);
+                    const glm::vec3 free = heading * speed;
+                    glm::vec3 along = free - normal * glm::dot(free, normal);
+                    const float alongSpeed = glm::length(along);
+                    along = alongSpeed > 0.0f ? along * (speed / alongSpeed) : free;
+                    const float blend = std::exp(-height / wind.slopeDecayHeight);
+                    velocity = free + (along - free) * blend;
+                }
+                grid.x[node] = velocity.x;
+                grid.y[node] = velocity.y;
+                grid.z[node] = velocity.z;
+            }
+        }
+    }
+}
+
+void WindField::Update(float seconds)
+{
+    if (!m_grid)
+        return;
+
+    // Take over a finished rebuild without blocking the frame
+    JobSystem& jobs = GetJobSystem();
+    if (m_rebuild.IsValid() && jobs.IsFinished(m_rebuild))
+    {
+        m_grid = std::move(*m_rebuildOutput);
+        m_rebuildOutput.reset();
+        m_rebuild = {};
+        m_gridCount++;
+    }
+
+    // Turn the short way round and change speed at the fixed rates; the rest of the wind has no slow part
+    const float turn = std::remainder(m_target.direction - m_settings.direction, TWO_PI);
+    const float direction = std::remainder(m_settings.direction + Approach(0.0f, turn, VEER_RATE * seconds), TWO_PI);
+    const float speed = Approach(m_settings.speed, m_target.speed, SPEED_RATE * seconds);
+    m_settings = m_target;
+    m_settings.direction = direction;
+    m_settings.speed = speed;
+
+    // The turbulence is carried along by the wind
+    const float period = TURBULENCE_SIZE * TURBULENCE_SPACING;
+    const glm::vec3 drift = glm::vec3(std::cos(direction), 0.0f, std::sin(direction)) * (speed * seconds);
+    m_offset = glm::vec3(Wrap(m_offset.x - drift.x, period), 0.0f, Wrap(m_offset.z - drift.z, period));
+
+    const WindSettings& built = m_grid->settings;
+    const bool changed = std::fabs(std::remainder(direction - built.direction, TWO_PI)) >=
+        REBUILD_DIRECTION || std::fabs(speed - built.speed) >= REBUILD_SPEED ||
+        m_settings.referenceHeight != built.referenceHeight || m_settings.shearExponent != built.shearExponent ||
+        m_settings.boundaryLayerHeight != built.boundaryLayerHeight ||
+        m_settings.slopeDecayHeight != built.slopeDecayHeight;
+    if (changed && !m_rebuild.IsValid())
+        StartRebuild();
+}
+
+void WindField::StartRebuild()
+{
+    // The job owns its grid and the columns until the field takes the grid over; the field waits for it before it
+    // changes its layout or goes away
+    auto output = std::make_shared<std::unique_ptr<MeanGrid>>(std::make_unique<MeanGrid>());
+    (*output)->settings = m_settings;
+    m_rebuildOutput = output;
+    std::shared_ptr<const Columns> columns = m_columns;
+    m_rebuild = GetJobSystem().RunBackground([this, output, columns]() {
+        ResizeGrid(**output);
+        BuildRows(*columns, **output, 0, m_nodesZ);
+    });
+}
+
+void WindField::MakeArgs(WindSampleArgs& args) const
+{
+    args.mean[0] = m_grid->x.data();
+    args.mean[1] = m_grid->y.data();
+    args.mean[2] = m_grid->z.data();
+    args.nodesX = m_nodesX;
+    args.nodesZ = m_nodesZ;
+    args.levels = m_levels;
+    args.cellSize = m_cellSize;
+    args.levelHeight = m_levelHeight;
+    args.baseAltitude = m_baseAltitude;
+    for (int c = 0; c < 3; c++)
+        args.turbulence[c] = m_turbulence[c].data();
+    args.turbulenceSize = TURBULENCE_SIZE;
+    args.turbulenceSpacing = TURBULENCE_SPACING;
+    args.offsetX = m_offset.x;
+    args.offsetY = m_offset.y;
+    args.offsetZ = m_offset.z;
+    args.turbulenceSigma = m_settings.turbulenceIntensity * m_settings.speed;
+}
+
+glm::vec3 WindField::GetWind(const glm::vec3& position) const
+{
+    glm::vec3 wind(0.0f);
+    GetWinds(&position.x, &position.y, &position.z, &wind.x, &wind.y, &wind.z, 1);
+    return wind;
+}
+
+// Samples whole vectors with the widest kernel and the rest with the SSE2 one through padded copies
+void WindField::GetWinds(const float* x, const float* y, const float* z, float* windX, float* windY, float* windZ,
+    size_t count) const
+{
+    if (!m_grid)
+    {
+        std::fill(windX, windX + count, 0.0f);
+        std::fill(windY, windY + count, 0.0f);
+        std::fill(windZ, windZ + count, 0.0f);
+        return;
+    }
+
+    static const bool avx2 = simd::CpuSupportsAvx2();
+    static const bool avx512 = simd::CpuSupportsAvx512();
+    const size_t width = avx512 ? 16 : avx2 ? 8 : 4;
+    WindSampleArgs args;
+    MakeArgs(args);
+    args.x = x;
+    args.y = y;
+    args.z = z;
+    args.outX = windX;
+    args.outY = windY;
+    args.outZ = windZ;
+    args.count = count / width * width;
+    if (avx512)
+        SampleWindAvx512(args);
+    else if (avx2)
+        SampleWindAvx2(args);
+    else
+        SampleWindSse2(args);
+
+    for (size_t first = args.count; first < count; first += 4)
+    {
+        const size_t n = std::min(count - first, (size_t)4);
+        float in[3][4] = {}, out[3][4];
+        for (size_t i = 0; i < n; i++)
+        {
+            in[0][i] = x[first + i];
+            in[1][i] = y[first + i];
+            in[2][i] = z[first + i];
+        }
+        args.x = in[0];
+        args.y = in[1];
+        args.z = in[2];
+        args.outX = out[0];
+        args.outY = out[1];
+        args.outZ = out[2];
+        args.count = 4;
+        SampleWindSse2(args);
+        for (size_t i = 0; i < n; i++)
+        {
+            windX[first + i] = out[0][i];
+            windY[first + i] = out[1][i];
+            windZ[first + i] = out[2][i];
+        }
+    }
+}
@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX2; only called after WindField checked the processor.
+#include "wind_field_kernel.h"
+
+void SampleWindAvx2(const WindSampleArgs& args)
+{
+    SampleWindKernel<simd::Float8>(args);
+}
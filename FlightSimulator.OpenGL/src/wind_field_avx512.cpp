@@ -0,0 +1,7 @@
+// Compiled with /arch:AVX512; only called after WindField checked the processor.
+#include "wind_field_kernel.h"
+
+void SampleWindAvx512(const WindSampleArgs& args)
+{
+    SampleWindKernel<simd::Float16>(args);
+}
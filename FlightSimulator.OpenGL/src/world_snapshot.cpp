@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <cstring>
+
+#include "world_snapshot.h"
+#include "mapped_file.h"
+
+void WorldSnapshot::Capture(const LockstepSimulation& simulation, const WorldSnapshotView& view)
+{
+    // clear keeps the capacity, so capturing again into the same snapshot allocates nothing
+    m_state.clear();
+    simulation.SaveState(m_state);
+
+    memcpy(m_header.magic, WORLD_SNAPSHOT_MAGIC, sizeof(m_header.magic));
+    m_header.version = WORLD_SNAPSHOT_VERSION;
+    m_header.headerSize = sizeof(WorldSnapshotHeader);
+    m_header.stateSize = m_state.size();
+    m_header.settings = simulation.GetSettings();
+    m_header.view = view;
+    m_valid = true;
+}
+
+bool WorldSnapshot::Restore(LockstepSimulation& simulation, WorldSnapshotView& view) const
+{
+    if (!m_valid)
+        return false;
+
+    // The settings are plain data without padding, and the state only continues the same simulation.
+    if (memcmp(&simulation.GetSettings(), &m_header.settings, sizeof(LockstepSettings)) != 0)
+    {
+        printf("%s:%d - snapshot is of a simulation with other settings\n", __FILE__, __LINE__);
+        return false;
+    }
+
+    if (!simulation.LoadState(m_state.data(), m_state.size()))
+        return false;
+
+    view = m_header.view;
+    return true;
+}
+
+bool WorldSnapshot::Save(const char* pFilename) const
+{
+    if (!m_valid)
+        return false;
+
+    FILE* file = fopen(pFilename, "wb");
+    if (!file)
+    {
+        printf("%s:%d - cannot create %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    bool written = fwrite(&m_header, sizeof(m_header), 1, file) == 1 &&
+        fwrite(m_state.data(), 1, m_state.size(), file) == m_state.size();
+    written = fclose(file) == 0 && written;
+    if (!written)
+        printf("%s:%d - cannot write %s\n", __FILE__, __LINE__, pFilename);
+    return written;
+}
+
+bool WorldSnapshot::Load(const char* pFilename)
+{
+    MappedFile file;
+    if (!file.Open(pFilename))
+    {
+        printf("%s:%d - cannot open %s\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    WorldSnapshotHeader header;
+    if (file.GetSize() < sizeof(header))
+    {
+        printf("%s:%d - %s is not a snapshot\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+    memcpy(&header, file.GetData(), sizeof(header));
+
+    if (memcmp(header.magic, WORLD_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != WORLD_SNAPSHOT_VERSION || header.headerSize != sizeof(WorldSnapshotHeader))
+    {
+        printf("%s:%d - %s is not a snapshot of version %u\n", __FILE__, __LINE__, pFilename,
+            WORLD_SNAPSHOT_VERSION);
+        return false;
+    }
+    if (header.stateSize != file.GetSize() - sizeof(header))
+    {
+        printf("%s:%d - %s is truncated\n", __FILE__, __LINE__, pFilename);
+        return false;
+    }
+
+    m_header = header;
+    const uint8_t* pState = file.GetData() + sizeof(header);
+    m_state.assign(pState, pState + header.stateSize);
+    m_valid = true;
+    return true;
+}
+
+uint64_t WorldSnapshot::GetStepCount() const
+{
+    // SaveState starts with the step count
+    uint64_t step = 0;
+    if (m_state.size() >= sizeof(step))
+        memcpy(&step, m_state.data(), sizeof(step));
+    return step;
+}